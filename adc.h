@@ -0,0 +1,185 @@
+/**
+ * File Name  : adc.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Methods to set up the Analogue to Digital Converter on AD0.1
+ *              and to read single samples from it, either waiting for the
+ *              conversion or collecting the result of one started earlier.
+ *
+ *              It can also capture several channels at once in burst mode,
+ *              where the converter goes round the selected channels by
+ *              itself, one conversion every ADC_CONVERSION_CLOCKS of its
+ *              clock. Each sample clock tick starts one round with a single
+ *              write, and the converter's interrupt once the last channel is
+ *              done stops it there and collects every channel. So every
+ *              channel is converted at the same point after each tick, set
+ *              by the hardware rather than by when the interrupt that reads
+ *              them happens to run.
+ */
+
+#ifndef ADC_H_GUARD
+#define ADC_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "reg.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The most channels that can be captured at once, AD0.0 to AD0.3.
+#define ADC_MAX_CHANNELS 4
+
+// The fastest the converter's clock can run, which burst mode runs it at,
+// and the number of its clocks each 10 bit conversion takes. At 4.5 MHz a
+// round of all four channels is over within 10 us, well inside a tick.
+#define ADC_BURST_HZ 4500000
+#define ADC_CONVERSION_CLOCKS 11
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// The channels being captured in burst mode, as the data register holding
+// each one's latest result, in the order they are collected, and the control
+// words that start a round and leave the converter idle.
+typedef struct {
+    int count;
+    volatile unsigned long* results[ADC_MAX_CHANNELS];
+    unsigned long start, stop;
+} adc_Capture;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void adc_init(int sampleRate);
+short adc_read(void);
+void adc_start(void);
+short adc_result(void);
+void adc_initBurst(adc_Capture* capture, const int* channels, int count);
+static inline void adc_startRound(const adc_Capture* capture);
+static inline void adc_finishRound(const adc_Capture* capture, short* frame);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Prepares the Analogue to Digital Converter for usage with the given sample
+// rate.
+void adc_init(int sampleRate)
+{
+    // Route P0.24 to AD0.1 and power up the ADC.
+    reg_modify(&PINSEL1, fieldMask(PINSEL1_P0_24),
+        fieldVal(PINSEL1_P0_24, PINSEL_AD0_1));
+    reg_set(&PCONP, fieldMask(PCONP_PCAD));
+
+    // Select channel 1, set the clock divider and leave power down mode, all
+    // with a single write.
+    AD0CR = fieldVal(AD0CR_SEL, 1 << 1)
+        | fieldVal(AD0CR_CLKDIV, PCLK_HZ / (sampleRate << 4))
+        | fieldVal(AD0CR_PDN, 1);
+}
+
+// Read a single sample from the ADC.
+short adc_read(void)
+{
+    unsigned long val;
+
+    reg_modify(&AD0CR, fieldMask(AD0CR_START),
+        fieldVal(AD0CR_START, AD0CR_START_NOW));
+
+    // Keep hold of the value that showed the conversion was done, rather than
+    // reading the data register again.
+    while (!fieldGet(val = AD0DR1, AD0DR_DONE));
+
+    return (short) fieldGet(val, AD0DR_RESULT);
+}
+
+// Starts a conversion without waiting for it to finish. Intended for sample
+// clock interrupts, which collect the result with adc_result on the next
+// tick instead of spinning.
+void adc_start(void)
+{
+    reg_modify(&AD0CR, fieldMask(AD0CR_START),
+        fieldVal(AD0CR_START, AD0CR_START_NOW));
+}
+
+// Gives the result of the most recently completed conversion.
+short adc_result(void)
+{
+    return (short) fieldGet(AD0DR1, AD0DR_RESULT);
+}
+
+// Sets up the given channels, from 0 to ADC_MAX_CHANNELS - 1, to be
+// converted a round at a time by adc_startRound and collected by
+// adc_finishRound in the order given. The converter raises its interrupt as
+// each round finishes, which must be handled by something that calls
+// adc_finishRound. adc_init goes back to single conversions.
+void adc_initBurst(adc_Capture* capture, const int* channels, int count)
+{
+    unsigned long select; int i, last;
+
+    reg_set(&PCONP, fieldMask(PCONP_PCAD));
+
+    // The data registers are one after another, one for each channel. A
+    // round goes from the lowest channel to the highest.
+    select = 0;
+    last = 0;
+    for (i = 0; i < count; ++i) {
+        reg_modify(&PINSEL1, fieldMask(PINSEL1_AD0(channels[i])),
+            fieldVal(PINSEL1_AD0(channels[i]), PINSEL_AD0));
+        select |= 1 << channels[i];
+        capture->results[i] = &AD0DR0 + channels[i];
+        last = max(last, channels[i]);
+    }
+    capture->count = count;
+
+    // Burst with the clock as fast as it goes. A single channel is simply
+    // started, as a burst would go straight on to convert it again and
+    // raise the interrupt twice.
+    capture->stop = fieldVal(AD0CR_SEL, select)
+        | fieldVal(AD0CR_CLKDIV, (PCLK_HZ + ADC_BURST_HZ - 1) / ADC_BURST_HZ
+            - 1)
+        | fieldVal(AD0CR_CLKS, AD0CR_CLKS_10BIT)
+        | fieldVal(AD0CR_PDN, 1);
+    capture->start = capture->stop | (count > 1 ? fieldVal(AD0CR_BURST, 1)
+        : fieldVal(AD0CR_START, AD0CR_START_NOW));
+
+    // Stop any round already going before changing the channels, and only
+    // interrupt once the last of them is done.
+    AD0CR = fieldVal(AD0CR_PDN, 1);
+    AD0INTEN = 1 << last;
+    AD0CR = capture->stop;
+}
+
+// Starts a round of conversions of every channel set up by adc_initBurst.
+// Call first thing from the sample clock interrupt, so the round starts the
+// same time after every tick.
+static inline void adc_startRound(const adc_Capture* capture)
+{
+    AD0CR = capture->start;
+}
+
+// Stops the round and writes each channel's result into frame, one sample
+// each, in the order they were given to adc_initBurst. Call first thing from
+// the converter's interrupt, which reading the results acknowledges. The
+// burst has already started on the lowest channel again, and that
+// conversion finishes anyway, so this must run within one conversion of the
+// interrupt or the lowest channel's result is a little later than usual.
+static inline void adc_finishRound(const adc_Capture* capture, short* frame)
+{
+    int i;
+
+    AD0CR = capture->stop;
+
+    for (i = 0; i < capture->count; ++i) {
+        frame[i] = (short) fieldGet(*capture->results[i], AD0DR_RESULT);
+    }
+}
+
+#endif
@@ -0,0 +1,1414 @@
+/**
+ * File Name  : bench.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Measures how many core cycles per iteration the inner loops
+ *              of the exercises take when run from flash (with and without
+ *              the MAM), internal SRAM and external SDRAM, and shows the
+ *              results on the LCD. Build with EXERCISE = bench.
+ *
+ *              Then times the exercises' own drawing and DSP routines as a
+ *              regression suite. The results are shown on the LCD and sent
+ *              over the serial port as JSON, followed by C source to save as
+ *              bench_baseline.h. Build with BASELINE defined to check each
+ *              result against the saved one, failing any that have slowed
+ *              down by more than BENCH_TOLERANCE percent.
+ *
+ *              It also runs a 44.1 kHz sample clock interrupt while the
+ *              star field is drawn over and over, to check that the audio
+ *              path in exercises 4 and 5 always starts in time and never
+ *              overruns into the next sample.
+ *
+ *              Finally it checks the FFT in fft.h against a DFT done the slow
+ *              way in double precision, at a size that uses only radix-4
+ *              passes and one that needs the radix-2 pass as well, and
+ *              measures the frequency response of the resamplers in
+ *              resample.h by passing tones through them at every factor.
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include <math.h>
+#include <lpc24xx.h>
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "lcd.h"
+#include "clock.h"
+#include "ramfunc.h"
+#include "reg.h"
+#include "timer.h"
+#include "uart.h"
+#include "motor.h"
+#include "rng.h"
+#include "star.h"
+#include "graph.h"
+#include "wave.h"
+#include "fft.h"
+#include "resample.h"
+#include "speed.h"
+#include "fx.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of elements each kernel works through per run, and the number
+// of runs timed for each result.
+#define BENCH_LENGTH 128
+#define BENCH_RUNS 16
+
+// Room for a copy of all the RAMFUNC code in SDRAM.
+#define BENCH_CODE_MAX 4096
+
+// Places the kernels can be run from.
+#define BENCH_FLASH_NO_MAM 0
+#define BENCH_FLASH 1
+#define BENCH_SRAM 2
+#define BENCH_SDRAM 3
+#define BENCH_PLACES 4
+
+// The number of kernels being timed.
+#define BENCH_KERNELS 4
+
+// Layout of the results table.
+#define TABLE_X 4
+#define TABLE_Y 40
+#define TABLE_ROW_HEIGHT 12
+#define TABLE_COLUMN_WIDTH 42
+
+// Layout of the regression suite's table, under the other one.
+#define SUITE_Y (TABLE_Y + (BENCH_PLACES + 2) * TABLE_ROW_HEIGHT)
+#define SUITE_ROW_HEIGHT 10
+
+// The number of times each regression case is run. The fastest run is the
+// one reported, which leaves out the first run's cold MAM buffers and the
+// odd SDRAM refresh.
+#define BENCH_CASE_RUNS 3
+
+// How much slower than its baseline, in percent, a case may get before it
+// fails.
+#define BENCH_TOLERANCE 10
+
+// The number of stars drawn per run, as in exercise 3.
+#define BENCH_STARS 128
+
+// The number of samples graphed per run. In the EXTMEM build that's a full
+// five minute recording, as in exercise 5. Otherwise it has to fit in
+// internal RAM.
+#ifdef EXTMEM
+#define BENCH_GRAPH_LENGTH (44100 * 300)
+#else
+#define BENCH_GRAPH_LENGTH 8192
+#endif
+
+// The octave every waveform is built in, and room for the longest table in
+// it.
+#define BENCH_WAVE_OCTAVE 4
+#define BENCH_WAVE_LENGTH 1024
+
+// The number of motor speeds looked up per run, spread over its whole range.
+#define BENCH_MOTOR_SPEEDS 256
+
+// The size of the transforms timed, as a power of two, and how many are done
+// per run, each on fresh samples.
+#define BENCH_FFT_BITS 10
+#define BENCH_FFT_TRANSFORMS 4
+
+// The factor the resampling cases run at, as 11.025 kHz recordings in
+// exercise 5 do, and the number of samples at the higher rate worked through
+// per run.
+#define BENCH_RESAMPLE_FACTOR 4
+#define BENCH_RESAMPLE_LENGTH 4096
+
+// The number of samples played per run by the variable speed cases, and the
+// speed they play at, slow enough that every sample is filled in.
+#define BENCH_SPEED_LENGTH 4096
+#define BENCH_SPEED_STEP (SPEED_ONE * 3 / 4)
+
+// The number of samples run through the effects chain per run, the size of
+// each block, as exercise 5 monitors in, and the echo's delay line and delay.
+#define BENCH_FX_LENGTH 4096
+#define BENCH_FX_BLOCK 32
+#define BENCH_ECHO_LENGTH 1024
+#define BENCH_ECHO_DELAY 700
+
+// The number of regression cases.
+#define BENCH_CASES 12
+
+// The sample rate the deadline test runs at, and the number of frames of
+// stars drawn while it does.
+#define DEADLINE_RATE 44100
+#define DEADLINE_FRAMES 2000
+
+// The transform sizes the accuracy test checks, as powers of two. The
+// reference DFT takes time proportional to the square of the size.
+#define ACCURACY_MIN_BITS 8
+#define ACCURACY_MAX_BITS 9
+
+// The least signal to error ratio the FFT must manage, in tenths of a dB.
+// That's well above what the 10-bit A/D converter itself can give, so the
+// transform never adds noise that could be seen.
+#define ACCURACY_MIN_SNR 700
+
+// Given as the signal to error ratio when there is no error at all.
+#define ACCURACY_EXACT 9999
+
+// The number of resampling factors the response test checks, the number of
+// output samples each tone is measured over once the filter has settled, and
+// the tones' amplitude, most of the converters' range.
+#define RESPONSE_FACTORS 3
+#define RESPONSE_LENGTH 2048
+#define RESPONSE_SETTLE (RESAMPLE_TAPS * RESAMPLE_MAX_FACTOR)
+#define RESPONSE_AMPLITUDE 400.0
+
+// The number of tones tried in each band.
+#define RESPONSE_TONES 3
+
+// The furthest the passband may stray from 0 dB, and the least anything
+// that would alias or image must be cut by, both in tenths of a dB. The
+// filters themselves cut by more than 65 dB, but rounding the output to 10
+// bits leaves spurs of its own around 60 dB down.
+#define RESPONSE_MAX_RIPPLE 1
+#define RESPONSE_MIN_REJECTION 550
+
+// Given as the level, in tenths of a dB, of a tone too quiet to find at all.
+#define RESPONSE_SILENT 999
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Every kernel has the same signature so they can be timed by one function.
+// Each one is a leaf, so it still works when copied somewhere else.
+typedef int (*Kernel)(short* dest, const short* src, int length);
+
+// A regression case. Each run does a fixed amount of work made up of units
+// of the given name, and the result is the time taken per unit.
+typedef struct {
+    char* name;
+    char* unit;
+    unsigned long units;
+    void (*run)(void);
+} Case;
+
+// A saved result for the case with the given name, in tenths of a cycle per
+// unit.
+typedef struct {
+    char* name;
+    unsigned long tenths;
+} Baseline;
+
+// Pull in the saved results, which defines benchBaseline.
+#ifdef BENCH_BASELINE
+#include "bench_baseline.h"
+#endif
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Somewhere to copy the RAMFUNC code to in SDRAM.
+#ifdef EXTMEM
+char sdramCode[BENCH_CODE_MAX] __attribute__((aligned(8)));
+#endif
+
+// Column headings, and which kernel goes in each column.
+char* kernelNames[BENCH_KERNELS] = { "STAT", "VOL", "PHASE", "RNG" };
+
+// Row headings.
+char* placeNames[BENCH_PLACES] = { "ROM-", "ROM", "SRAM", "SDRAM" };
+
+// Inputs for the regression cases.
+Star benchStars[BENCH_STARS];
+short graphSamples[BENCH_GRAPH_LENGTH];
+short waveTable[BENCH_WAVE_LENGTH];
+fft_Complex fftData[1 << BENCH_FFT_BITS];
+
+// Somewhere for results nothing else looks at, so they aren't optimised away.
+volatile int benchSink;
+
+// What the deadline test's sample clock has seen: the number of samples, the
+// most PCLK cycles any started late by, the most any took to finish
+// (counting from when it should have started), and the number that were
+// still running when the next was due.
+volatile unsigned long probeCount;
+volatile unsigned long probeMaxLatency;
+volatile unsigned long probeMaxEnd;
+volatile unsigned long probeOverruns;
+
+// Results of the deadline test: the samples that should have been taken, and
+// how many were lost altogether.
+unsigned long deadlineExpected;
+unsigned long deadlineLost;
+
+// Working space for the accuracy test: the test signal, the transform's input
+// and output, and the reference DFT's twiddles.
+short accuracySamples[1 << ACCURACY_MAX_BITS];
+fft_Complex accuracyInput[1 << ACCURACY_MAX_BITS];
+fft_Complex accuracyData[1 << ACCURACY_MAX_BITS];
+double accuracyCos[1 << ACCURACY_MAX_BITS];
+double accuracySin[1 << ACCURACY_MAX_BITS];
+
+// Results of the accuracy test for each size checked, starting with the
+// smallest: the signal to error ratio in tenths of a dB, and the largest
+// error in any bin.
+long accuracySnr[ACCURACY_MAX_BITS - ACCURACY_MIN_BITS + 1];
+unsigned long accuracyMaxError[ACCURACY_MAX_BITS - ACCURACY_MIN_BITS + 1];
+
+// The resamplers timed by the regression cases.
+resample_Filter benchDecimator, benchInterpolator;
+
+// The effects chain timed by the regression cases, with everything exercise 5
+// can monitor through, and a block to run through it.
+fx_Chain benchChain;
+fx_Gain benchGain;
+fx_Gate benchGate;
+fx_Compressor benchCompressor;
+fx_Echo benchEcho;
+short benchEchoLine[BENCH_ECHO_LENGTH];
+int benchBlock[BENCH_FX_BLOCK];
+
+// The factors the response test checks, and the tones it tries, as
+// fractions of the lower rate's Nyquist frequency. The passband tones go
+// through both ways, the stopband ones through the decimator, and the
+// passband tones' images are looked for in the interpolator's output.
+const int responseFactors[RESPONSE_FACTORS] = { 2, 4, 6 };
+const double responsePass[RESPONSE_TONES] = { 0.1, 0.5, 0.8 };
+const double responseStop[RESPONSE_TONES] = { 1.2, 1.5, 1.9 };
+
+// Working space for the response test: the filter, and what came out of it.
+resample_Filter responseFilter;
+short responseSamples[RESPONSE_LENGTH];
+
+// Results of the response test for each factor: the furthest the passband
+// strayed from 0 dB, and the least anything that would alias or image was
+// cut by, in tenths of a dB.
+long responseRipple[RESPONSE_FACTORS];
+long responseRejection[RESPONSE_FACTORS];
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+int statKernel(short* dest, const short* src, int length) RAMFUNC;
+int volumeKernel(short* dest, const short* src, int length) RAMFUNC;
+int phaseKernel(short* dest, const short* src, int length) RAMFUNC;
+int rngKernel(short* dest, const short* src, int length) RAMFUNC;
+
+Kernel findKernel(Kernel kernel, int place);
+unsigned long timeKernel(Kernel kernel, short* dest, const short* src);
+void drawResult(int column, int row, unsigned long cycles);
+
+void starsCase(void);
+void bigCharCase(void);
+void bigSampleCase(void);
+void graphCase(void);
+void waveCase(void);
+void motorCase(void);
+void fftCase(void);
+void decimCase(void);
+void interpCase(void);
+void linearCase(void);
+void cubicCase(void);
+void speedCase(int method);
+void fxCase(void);
+
+void prepareCases(void);
+unsigned long timeCase(const Case* test);
+long findBaseline(char* name);
+char* checkResult(unsigned long tenths, long baseline);
+void formatTenths(char* dest, unsigned long tenths);
+void sendNumber(unsigned long val);
+float randFloat(rng_Pool* rng);
+
+int runSuite(const Case* cases, unsigned long* results);
+void drawSuite(const Case* cases, const unsigned long* results, int failed);
+void sendSuite(const Case* cases, const unsigned long* results, int failed);
+
+void probeIsr(void) __attribute__((interrupt("IRQ"))) RAMFUNC;
+bool runDeadline(void);
+unsigned long toNanos(unsigned long cycles);
+void drawDeadline(bool passed);
+void sendDeadline(bool passed);
+
+long checkTransform(int bits, unsigned long* maxError);
+bool runAccuracy(void);
+void drawAccuracy(bool passed);
+void sendAccuracy(bool passed);
+
+void resampleTone(resample_Filter* filter, bool interpolate, double freq);
+long measureTone(double freq);
+void checkResampler(int factor, long* ripple, long* rejection);
+bool runResponse(void);
+void drawResponse(bool passed);
+void sendResponse(bool passed);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Finds the minimum, maximum and sum of the samples, like the amplitude
+// graph in exercise 5 does for each column.
+int statKernel(short* dest, const short* src, int length)
+{
+    int i, s, lo, hi, sum;
+
+    lo = hi = sum = 0;
+    for (i = 0; i < length; ++i) {
+        s = src[i];
+        if (s < lo) lo = s;
+        if (s > hi) hi = s;
+        sum += s;
+    }
+
+    dest[0] = lo;
+    dest[1] = hi;
+    return sum;
+}
+
+// Scales each sample by a volume out of 256, like playback in exercise 5.
+int volumeKernel(short* dest, const short* src, int length)
+{
+    int i;
+
+    for (i = 0; i < length; ++i) {
+        dest[i] = (src[i] * 200) >> 8;
+    }
+
+    return length;
+}
+
+// Steps a phase accumulator through a wave table, like the synthesiser in
+// exercise 4.
+int phaseKernel(short* dest, const short* src, int length)
+{
+    int i; unsigned long phase, step, end;
+
+    phase = 0;
+    step = 0x18000;
+    end = (unsigned long) length << 16;
+    for (i = 0; i < length; ++i) {
+        dest[i] = src[phase >> 16];
+        phase += step;
+        if (phase >= end) phase -= end;
+    }
+
+    return (int) phase;
+}
+
+// Produces xorshift values, like the star respawns in exercise 3.
+int rngKernel(short* dest, const short* src, int length)
+{
+    int i; unsigned int s;
+
+    s = (unsigned short) src[0] | 1;
+    for (i = 0; i < length; ++i) {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        dest[i] = (short) s;
+    }
+
+    return (int) s;
+}
+
+// Gives the address to call the given kernel at to run it from the given
+// place. Returns NULL if there's nowhere to run it from.
+Kernel findKernel(Kernel kernel, int place)
+{
+    switch (place) {
+        case BENCH_FLASH_NO_MAM:
+        case BENCH_FLASH:
+            return (Kernel) ramfunc_relocate((void*) kernel, __ramfunc_load);
+        case BENCH_SRAM:
+            return kernel;
+#ifdef EXTMEM
+        case BENCH_SDRAM:
+            if (ramfunc_size() > BENCH_CODE_MAX) return NULL;
+            return (Kernel) ramfunc_relocate((void*) kernel, sdramCode);
+#endif
+        default:
+            return NULL;
+    }
+}
+
+// Runs the given kernel BENCH_RUNS times, and gives the number of cycles
+// taken per element in tenths of a cycle.
+unsigned long timeKernel(Kernel kernel, short* dest, const short* src)
+{
+    int i; unsigned long start, end;
+
+    // Warm up the MAM buffers, as they would be in a loop that runs often.
+    kernel(dest, src, BENCH_LENGTH);
+
+    start = TIMER1->TC;
+    for (i = 0; i < BENCH_RUNS; ++i) {
+        kernel(dest, src, BENCH_LENGTH);
+    }
+    end = TIMER1->TC;
+
+    return (end - start) * 10 / (BENCH_RUNS * BENCH_LENGTH);
+}
+
+// Draws a result, given in tenths of a cycle, in the given cell of the table.
+void drawResult(int column, int row, unsigned long cycles)
+{
+    char num[8];
+
+    formatNumber(num, cycles / 10, 4);
+    num[4] = '.';
+    num[5] = '0' + cycles % 10;
+    num[6] = '\0';
+
+    lcd_putString(TABLE_X + (column + 1) * TABLE_COLUMN_WIDTH,
+        TABLE_Y + (row + 1) * TABLE_ROW_HEIGHT, num);
+}
+
+// Projects and draws a field of stars, as exercise 3 does each frame.
+void starsCase(void)
+{
+    int i;
+
+    for (i = 0; i < BENCH_STARS; ++i) {
+        star_render(benchStars[i], 0.03125f, benchStars[i].clr);
+    }
+}
+
+// Draws the alphabet in the big font, as exercise 5's instructions are.
+void bigCharCase(void)
+{
+    int i;
+
+    for (i = 0; i < 26; ++i) {
+        lcd_putBigChar(4 + (i % 13) * BIG_CHAR_WIDTH,
+            4 + (i / 13) * BIG_CHAR_HEIGHT, 'A' + i);
+    }
+}
+
+// Samples every texel of the alphabet in the big font without drawing it, to
+// tell the cost of the super sampling apart from the cost of the LCD.
+void bigSampleCase(void)
+{
+    int i, x, y, n;
+
+    n = 0;
+    for (i = 0; i < 26; ++i) {
+        for (y = 0; y < BIG_CHAR_HEIGHT; ++y) {
+            for (x = 0; x < BIG_CHAR_WIDTH; ++x) {
+                n += lcd_bigCharSample('A' + i - 0x20, x, y);
+            }
+        }
+    }
+
+    benchSink = n;
+}
+
+// Graphs a whole recording, running the coroutine to the end in one go.
+void graphCase(void)
+{
+    graph_Draw graph;
+
+    graph_start(&graph, graphSamples, BENCH_GRAPH_LENGTH,
+        6, 4, DISPLAY_WIDTH - 14, 120);
+    while (graph_step(&graph) != PT_ENDED);
+}
+
+// Builds a table for every note of an octave in every wave shape, as
+// exercise 4 does on each key press.
+void waveCase(void)
+{
+    int type, note, n;
+
+    n = 0;
+    for (type = 0; type <= WAVE_LAST; ++type) {
+        for (note = NOTE_C; note <= NOTE_B; ++note) {
+            n += wave_build(waveTable, type, BENCH_WAVE_OCTAVE, note);
+        }
+    }
+
+    benchSink = n;
+}
+
+// Looks up motor settings across the whole range of speeds, as each change
+// of target in exercise 3 does.
+void motorCase(void)
+{
+    int i, n;
+
+    n = 0;
+    for (i = 0; i < BENCH_MOTOR_SPEEDS; ++i) {
+        n += motor_findMR2Val(i * (120.0 / BENCH_MOTOR_SPEEDS));
+    }
+
+    benchSink = n;
+}
+
+// Windows and transforms several runs of a recording, as the spectrogram in
+// exercise 5 does for each column.
+void fftCase(void)
+{
+    int i;
+
+    for (i = 0; i < BENCH_FFT_TRANSFORMS; ++i) {
+        fft_load(fftData, &graphSamples[i << BENCH_FFT_BITS], BENCH_FFT_BITS);
+        fft_transform(fftData, BENCH_FFT_BITS);
+    }
+
+    benchSink = fftData[1].re;
+}
+
+// Filters a recording down to a quarter of the rate, as recording at
+// 11.025 kHz in exercise 5 does on each tick of the sample clock.
+void decimCase(void)
+{
+    int i, n; short out;
+
+    n = 0;
+    for (i = 0; i < BENCH_RESAMPLE_LENGTH; ++i) {
+        if (resample_decimate(&benchDecimator, graphSamples[i], &out)) {
+            n += out;
+        }
+    }
+
+    benchSink = n;
+}
+
+// Fills a recording back in to four times the rate, as playing one recorded
+// at 11.025 kHz in exercise 5 does on each tick of the sample clock.
+void interpCase(void)
+{
+    int i, n, next;
+
+    n = 0;
+    next = 0;
+    for (i = 0; i < BENCH_RESAMPLE_LENGTH; ++i) {
+        if (resample_wantsInput(&benchInterpolator)) {
+            resample_push(&benchInterpolator, graphSamples[next++]);
+        }
+        n += resample_interpolate(&benchInterpolator);
+    }
+
+    benchSink = n;
+}
+
+// Plays part of a recording at three quarters speed with linear
+// interpolation.
+void linearCase(void)
+{
+    speedCase(SPEED_LINEAR);
+}
+
+// Plays part of a recording at three quarters speed with cubic
+// interpolation, as exercise 5 does.
+void cubicCase(void)
+{
+    speedCase(SPEED_CUBIC);
+}
+
+// Plays part of a recording at three quarters speed and a little under full
+// volume, with the given SPEED_* method. That includes setting up the
+// weights, as exercise 5 does each time playback starts.
+void speedCase(int method)
+{
+    int i, n; speed_Reader reader;
+
+    speed_start(&reader, graphSamples, BENCH_GRAPH_LENGTH, BENCH_SPEED_STEP,
+        method);
+    speed_setVolume(&reader, 169);
+
+    n = 0;
+    for (i = 0; i < BENCH_SPEED_LENGTH; ++i) n += speed_next(&reader);
+
+    benchSink = n;
+}
+
+// Runs part of a recording through the gate, compressor, echo and gain a
+// block at a time, as monitoring in exercise 5 does, including centring each
+// sample on zero and taking it back.
+void fxCase(void)
+{
+    int i, j, n;
+
+    n = 0;
+    for (i = 0; i < BENCH_FX_LENGTH; i += BENCH_FX_BLOCK) {
+        for (j = 0; j < BENCH_FX_BLOCK; ++j) {
+            benchBlock[j] = graphSamples[i + j] - 0x200;
+        }
+
+        fx_runChain(&benchChain, benchBlock, BENCH_FX_BLOCK);
+
+        for (j = 0; j < BENCH_FX_BLOCK; ++j) n += benchBlock[j] + 0x200;
+    }
+
+    benchSink = n;
+}
+
+// Fills in the inputs for the regression cases. They are the same every time,
+// so results can be compared between builds.
+void prepareCases(void)
+{
+    rng_Pool rng; unsigned long i;
+
+    rng_poolSeed(&rng, 0x3ae14c92);
+
+    for (i = 0; i < BENCH_STARS; ++i) {
+        benchStars[i].x = randFloat(&rng) - 0.5f;
+        benchStars[i].y = randFloat(&rng) - 0.5f;
+        benchStars[i].z = randFloat(&rng) + 0.0625f;
+        benchStars[i].clr = WHITE;
+    }
+
+    // Something like a recording of a few notes: a slow wobble around the
+    // middle of the ADC's range with noise on top.
+    for (i = 0; i < BENCH_GRAPH_LENGTH; ++i) {
+        graphSamples[i] = 512 + (short) ((i >> 6) % 256) - 128
+            + (short) (rng_poolNext(&rng) >> 26);
+    }
+
+    resample_initDecimator(&benchDecimator, BENCH_RESAMPLE_FACTOR);
+    resample_initInterpolator(&benchInterpolator, BENCH_RESAMPLE_FACTOR);
+
+    fx_initGate(&benchGate, 12);
+    fx_initCompressor(&benchCompressor, 128, 4);
+    fx_initEcho(&benchEcho, benchEchoLine, BENCH_ECHO_LENGTH,
+        BENCH_ECHO_DELAY, 112, 160);
+    fx_initGain(&benchGain, 169);
+
+    fx_initChain(&benchChain);
+    fx_addEffect(&benchChain, &benchGate.effect);
+    fx_addEffect(&benchChain, &benchCompressor.effect);
+    fx_addEffect(&benchChain, &benchEcho.effect);
+    fx_addEffect(&benchChain, &benchGain.effect);
+}
+
+// Runs a regression case BENCH_CASE_RUNS times, and gives the time taken per
+// unit by the fastest run in tenths of a cycle.
+unsigned long timeCase(const Case* test)
+{
+    int i; unsigned long start, end, best;
+
+    best = ~0UL;
+    for (i = 0; i < BENCH_CASE_RUNS; ++i) {
+        start = TIMER1->TC;
+        test->run();
+        end = TIMER1->TC;
+
+        best = min(best, end - start);
+    }
+
+    return (unsigned long) ((unsigned long long) best * 10 / test->units);
+}
+
+// Finds the saved result for the case with the given name, or -1 if there
+// isn't one.
+long findBaseline(char* name)
+{
+#ifdef BENCH_BASELINE
+    unsigned int i;
+
+    for (i = 0; i < sizeof(benchBaseline) / sizeof(benchBaseline[0]); ++i) {
+        if (strcmp(benchBaseline[i].name, name) == 0) {
+            return (long) benchBaseline[i].tenths;
+        }
+    }
+#endif
+
+    return -1;
+}
+
+// Compares a result with its baseline. Gives "NEW" if there is no baseline,
+// "FAIL" if the result is more than BENCH_TOLERANCE percent slower, and
+// "PASS" otherwise.
+char* checkResult(unsigned long tenths, long baseline)
+{
+    if (baseline < 0) return "NEW";
+
+    if ((unsigned long long) tenths * 100
+        > (unsigned long long) baseline * (100 + BENCH_TOLERANCE)) {
+        return "FAIL";
+    }
+
+    return "PASS";
+}
+
+// Writes a number of tenths as a decimal, right aligned in 10 characters.
+// dest must have room for 11.
+void formatTenths(char* dest, unsigned long tenths)
+{
+    formatNumber(dest, tenths / 10, 8);
+    dest[8] = '.';
+    dest[9] = '0' + tenths % 10;
+    dest[10] = '\0';
+}
+
+// Sends a number with no padding.
+void sendNumber(unsigned long val)
+{
+    char num[12]; char* digits;
+
+    formatNumber(num, val, 11);
+    for (digits = num; *digits == ' '; ++digits);
+    uart_putString(digits);
+}
+
+// Returns a random number between 0.0 and 1.0 from the given pool, as
+// exercise 3 does.
+float randFloat(rng_Pool* rng)
+{
+    return fixed_toFloat((fixed) (rng_poolNext(rng) >> (32 - FIXED_SHIFT)));
+}
+
+// Times every regression case, writing each result into results. Returns the
+// number that failed against their baselines.
+int runSuite(const Case* cases, unsigned long* results)
+{
+    int i, failed;
+
+    failed = 0;
+    for (i = 0; i < BENCH_CASES; ++i) {
+        results[i] = timeCase(&cases[i]);
+
+        if (strcmp(checkResult(results[i], findBaseline(cases[i].name)),
+            "FAIL") == 0) {
+            ++failed;
+        }
+    }
+
+    return failed;
+}
+
+// Draws a table of the regression results, with their baselines and whether
+// each passed.
+void drawSuite(const Case* cases, const unsigned long* results, int failed)
+{
+    int i, y; long baseline; char num[12];
+
+    lcd_putString(TABLE_X, SUITE_Y, "CASE        CYC/UNIT      BASE");
+
+    for (i = 0; i < BENCH_CASES; ++i) {
+        y = SUITE_Y + (i + 1) * SUITE_ROW_HEIGHT;
+        baseline = findBaseline(cases[i].name);
+
+        lcd_putString(TABLE_X, y, cases[i].name);
+
+        formatTenths(num, results[i]);
+        lcd_putString(TABLE_X + 8 * CHAR_WIDTH, y, num);
+
+        if (baseline >= 0) {
+            formatTenths(num, baseline);
+            lcd_putString(TABLE_X + 20 * CHAR_WIDTH, y, num);
+        }
+
+        lcd_putString(TABLE_X + 32 * CHAR_WIDTH, y,
+            checkResult(results[i], baseline));
+    }
+
+    y = SUITE_Y + (BENCH_CASES + 2) * SUITE_ROW_HEIGHT;
+    if (failed == 0) {
+        lcd_putString(TABLE_X, y, "NO REGRESSIONS");
+    } else {
+        formatNumber(num, failed, 2);
+        lcd_putString(TABLE_X, y, num);
+        lcd_putString(TABLE_X + 3 * CHAR_WIDTH, y, "REGRESSED");
+    }
+}
+
+// Sends the regression results over the serial port as JSON, then again as C
+// source ready to be saved as bench_baseline.h. uart_init must have been
+// called.
+void sendSuite(const Case* cases, const unsigned long* results, int failed)
+{
+    int i; long baseline;
+
+    uart_putString("\n{\"clock\": ");
+    sendNumber(CCLK_HZ);
+    uart_putString(", \"runs\": ");
+    sendNumber(BENCH_CASE_RUNS);
+    uart_putString(", \"tolerance\": ");
+    sendNumber(BENCH_TOLERANCE);
+    uart_putString(", \"failed\": ");
+    sendNumber(failed);
+    uart_putString(", \"cases\": [\n");
+
+    // Times are sent in tenths of a cycle, so no decimal point is needed.
+    for (i = 0; i < BENCH_CASES; ++i) {
+        baseline = findBaseline(cases[i].name);
+
+        uart_putString("  {\"name\": \"");
+        uart_putString(cases[i].name);
+        uart_putString("\", \"unit\": \"");
+        uart_putString(cases[i].unit);
+        uart_putString("\", \"units\": ");
+        sendNumber(cases[i].units);
+        uart_putString(", \"tenths\": ");
+        sendNumber(results[i]);
+        uart_putString(", \"baseline\": ");
+        if (baseline >= 0) sendNumber(baseline);
+        else uart_putString("null");
+        uart_putString(", \"status\": \"");
+        uart_putString(checkResult(results[i], baseline));
+        uart_putString(i < BENCH_CASES - 1 ? "\"},\n" : "\"}\n");
+    }
+
+    uart_putString("]}\n");
+
+    uart_putString("\n// Recorded by bench.c. Save as bench_baseline.h.\n");
+    uart_putString("const Baseline benchBaseline[] = {\n");
+    for (i = 0; i < BENCH_CASES; ++i) {
+        uart_putString("    { \"");
+        uart_putString(cases[i].name);
+        uart_putString("\", ");
+        sendNumber(results[i]);
+        uart_putString(i < BENCH_CASES - 1 ? " },\n" : " }\n");
+    }
+    uart_putString("};\n");
+}
+
+// Sample clock for the deadline test. Does nothing but note how late it
+// started and how long it took, in the same SRAM and VIC slot as the real
+// sample clocks.
+void probeIsr(void)
+{
+    unsigned long latency, end;
+
+    latency = timer_latency(TIMER2);
+    TIMER2->IR = 1 << 0;
+
+    ++probeCount;
+    if (latency > probeMaxLatency) probeMaxLatency = latency;
+
+    // If the next sample is already due, this one ran past its deadline.
+    if (TIMER2->IR & (1 << 0)) {
+        ++probeOverruns;
+    } else {
+        end = TIMER2->TC;
+        if (end > probeMaxEnd) probeMaxEnd = end;
+    }
+
+    VICVectAddr = 0;
+}
+
+// Runs a DEADLINE_RATE sample clock in the audio slot while drawing and
+// erasing the star field DEADLINE_FRAMES times, with the scheduler tick
+// running too. Returns TRUE if every sample started and finished before the
+// next was due.
+bool runDeadline(void)
+{
+    int i; unsigned long start, elapsed;
+
+    probeCount = 0;
+    probeMaxLatency = 0;
+    probeMaxEnd = 0;
+    probeOverruns = 0;
+
+    reg_set(&PCONP, fieldMask(PCONP_PCTIM2));
+    sched_init();
+    timer_startPeriodic(TIMER2, VIC_CHANNEL_TIMER2, VIC_PRIORITY_AUDIO,
+        DEADLINE_RATE, probeIsr);
+
+    start = TIMER1->TC;
+    for (i = 0; i < DEADLINE_FRAMES; ++i) {
+        starsCase();
+        lcd_fillRect(0, 0, DISPLAY_WIDTH - 1, DISPLAY_HEIGHT - 1, BLACK);
+    }
+    elapsed = TIMER1->TC - start;
+
+    // Leave nothing running to disturb the other results.
+    timer_stop(TIMER2, VIC_CHANNEL_TIMER2);
+    timer_stop(TIMER0, VIC_CHANNEL_TIMER0);
+
+    // Timer1 wraps after a minute at the core clock, which is far longer
+    // than the test takes. A sample held up for a whole period is never
+    // taken, so count how many are missing as well as how many overran.
+    deadlineExpected = elapsed / (CCLK_HZ / DEADLINE_RATE);
+    deadlineLost = deadlineExpected > probeCount + 1
+        ? deadlineExpected - probeCount - 1 : 0;
+
+    return probeOverruns == 0 && deadlineLost == 0;
+}
+
+// Converts a number of PCLK cycles into nanoseconds.
+unsigned long toNanos(unsigned long cycles)
+{
+    return (unsigned long) ((unsigned long long) cycles * 1000000000
+        / PCLK_HZ);
+}
+
+// Draws the results of the deadline test under the regression table.
+void drawDeadline(bool passed)
+{
+    int y; char num[12];
+
+    y = SUITE_Y + (BENCH_CASES + 4) * SUITE_ROW_HEIGHT;
+
+    lcd_putString(TABLE_X, y, "44.1KHZ UNDER STARS (NS)");
+    lcd_putString(TABLE_X + 32 * CHAR_WIDTH, y, passed ? "PASS" : "FAIL");
+    y += SUITE_ROW_HEIGHT;
+
+    lcd_putString(TABLE_X, y, "LATE");
+    formatNumber(num, toNanos(probeMaxLatency), 6);
+    lcd_putString(TABLE_X + 5 * CHAR_WIDTH, y, num);
+
+    lcd_putString(TABLE_X + 12 * CHAR_WIDTH, y, "DONE");
+    formatNumber(num, toNanos(probeMaxEnd), 6);
+    lcd_putString(TABLE_X + 17 * CHAR_WIDTH, y, num);
+
+    lcd_putString(TABLE_X + 24 * CHAR_WIDTH, y, "OF");
+    formatNumber(num, toNanos(PCLK_HZ / DEADLINE_RATE), 6);
+    lcd_putString(TABLE_X + 27 * CHAR_WIDTH, y, num);
+}
+
+// Sends the results of the deadline test over the serial port as JSON.
+// uart_init must have been called.
+void sendDeadline(bool passed)
+{
+    uart_putString("\n{\"deadline\": {\"rate\": ");
+    sendNumber(DEADLINE_RATE);
+    uart_putString(", \"samples\": ");
+    sendNumber(probeCount);
+    uart_putString(", \"expected\": ");
+    sendNumber(deadlineExpected);
+    uart_putString(", \"lost\": ");
+    sendNumber(deadlineLost);
+    uart_putString(", \"overruns\": ");
+    sendNumber(probeOverruns);
+    uart_putString(", \"period_ns\": ");
+    sendNumber(toNanos(PCLK_HZ / DEADLINE_RATE));
+    uart_putString(", \"max_latency_ns\": ");
+    sendNumber(toNanos(probeMaxLatency));
+    uart_putString(", \"max_done_ns\": ");
+    sendNumber(toNanos(probeMaxEnd));
+    uart_putString(", \"status\": \"");
+    uart_putString(passed ? "PASS" : "FAIL");
+    uart_putString("\"}}\n");
+}
+
+// Transforms 2^bits points of a test signal, and compares the result with a
+// DFT worked out the slow way in double precision. Gives the ratio of signal
+// to error in tenths of a dB, and writes the largest error in any bin.
+long checkTransform(int bits, unsigned long* maxError)
+{
+    int i, k, n; rng_Pool rng;
+    double re, im, dr, di, signal, noise, err;
+
+    n = 1 << bits;
+    rng_poolSeed(&rng, 0x51f2a7c3);
+
+    // Two tones falling between bins, filling most of the ADC's range, with
+    // a little noise on top.
+    for (i = 0; i < n; ++i) {
+        accuracySamples[i] = (short) (512.0
+            + 300.0 * sin(2.0 * PI * 37.3 * i / n)
+            + 150.0 * sin(2.0 * PI * 101.7 * i / n)
+            + (double) (rng_poolNext(&rng) >> 27) - 16.0);
+    }
+
+    fft_load(accuracyInput, accuracySamples, bits);
+    memcpy(accuracyData, accuracyInput, n * sizeof(fft_Complex));
+    fft_transform(accuracyData, bits);
+
+    for (i = 0; i < n; ++i) {
+        accuracyCos[i] = cos(2.0 * PI * i / n);
+        accuracySin[i] = sin(2.0 * PI * i / n);
+    }
+
+    signal = 0.0;
+    noise = 0.0;
+    *maxError = 0;
+
+    for (k = 0; k < n; ++k) {
+        re = 0.0;
+        im = 0.0;
+        for (i = 0; i < n; ++i) {
+            // The turn for point i in bin k wraps every n.
+            re += accuracyInput[i].re * accuracyCos[(i * k) & (n - 1)]
+                + accuracyInput[i].im * accuracySin[(i * k) & (n - 1)];
+            im += accuracyInput[i].im * accuracyCos[(i * k) & (n - 1)]
+                - accuracyInput[i].re * accuracySin[(i * k) & (n - 1)];
+        }
+
+        re /= n;
+        im /= n;
+        dr = accuracyData[k].re - re;
+        di = accuracyData[k].im - im;
+
+        signal += re * re + im * im;
+        noise += dr * dr + di * di;
+
+        err = sqrt(dr * dr + di * di);
+        if (err + 0.5 > *maxError) *maxError = (unsigned long) (err + 0.5);
+    }
+
+    if (noise == 0.0) return ACCURACY_EXACT;
+
+    return (long) (100.0 * log10(signal / noise));
+}
+
+// Checks the FFT at every size from ACCURACY_MIN_BITS to ACCURACY_MAX_BITS.
+// Returns TRUE if every one was accurate enough.
+bool runAccuracy(void)
+{
+    int bits, i; bool passed;
+
+    passed = TRUE;
+    for (bits = ACCURACY_MIN_BITS; bits <= ACCURACY_MAX_BITS; ++bits) {
+        i = bits - ACCURACY_MIN_BITS;
+        accuracySnr[i] = checkTransform(bits, &accuracyMaxError[i]);
+        if (accuracySnr[i] < ACCURACY_MIN_SNR) passed = FALSE;
+    }
+
+    return passed;
+}
+
+// Draws the results of the accuracy test on a line under the deadline
+// test's.
+void drawAccuracy(bool passed)
+{
+    int bits, i, x, y; char num[12];
+
+    y = SUITE_Y + (BENCH_CASES + 7) * SUITE_ROW_HEIGHT;
+
+    lcd_putString(TABLE_X, y, "FFT SNR");
+    lcd_putString(TABLE_X + 32 * CHAR_WIDTH, y, passed ? "PASS" : "FAIL");
+
+    // The number of points, then the ratio in dB.
+    x = TABLE_X + 8 * CHAR_WIDTH;
+    for (bits = ACCURACY_MIN_BITS; bits <= ACCURACY_MAX_BITS; ++bits) {
+        i = bits - ACCURACY_MIN_BITS;
+
+        formatNumber(num, 1UL << bits, 4);
+        lcd_putString(x, y, num);
+
+        formatTenths(num, (unsigned long) max(accuracySnr[i], 0));
+        lcd_putString(x + 4 * CHAR_WIDTH, y, num + 4);
+
+        x += 12 * CHAR_WIDTH;
+    }
+}
+
+// Sends the results of the accuracy test over the serial port as JSON.
+// uart_init must have been called.
+void sendAccuracy(bool passed)
+{
+    int bits, i;
+
+    uart_putString("\n{\"fft\": {\"min_snr_tenths\": ");
+    sendNumber(ACCURACY_MIN_SNR);
+    uart_putString(", \"sizes\": [\n");
+
+    for (bits = ACCURACY_MIN_BITS; bits <= ACCURACY_MAX_BITS; ++bits) {
+        i = bits - ACCURACY_MIN_BITS;
+
+        uart_putString("  {\"points\": ");
+        sendNumber(1UL << bits);
+        uart_putString(", \"snr_tenths\": ");
+        sendNumber((unsigned long) max(accuracySnr[i], 0));
+        uart_putString(", \"max_error\": ");
+        sendNumber(accuracyMaxError[i]);
+        uart_putString(bits < ACCURACY_MAX_BITS ? "},\n" : "}\n");
+    }
+
+    uart_putString("], \"status\": \"");
+    uart_putString(passed ? "PASS" : "FAIL");
+    uart_putString("\"}}\n");
+}
+
+// Feeds a resampler a tone at the given frequency, in cycles per sample at
+// its input, and keeps the first RESPONSE_LENGTH samples it gives out once
+// it has settled.
+void resampleTone(resample_Filter* filter, bool interpolate, double freq)
+{
+    int n; short sample, out; double c, s, re, im, t;
+
+    resample_reset(filter);
+
+    // Turn a phasor on by the same angle each sample, which is much quicker
+    // than working out a sine each time.
+    c = cos(2.0 * PI * freq);
+    s = sin(2.0 * PI * freq);
+    re = 1.0;
+    im = 0.0;
+
+    for (n = -RESPONSE_SETTLE; n < RESPONSE_LENGTH; ) {
+        if (!interpolate || resample_wantsInput(filter)) {
+            sample = (short) floor(RESAMPLE_MIDDLE + RESPONSE_AMPLITUDE * im
+                + 0.5);
+
+            t = re * c - im * s;
+            im = re * s + im * c;
+            re = t;
+
+            if (interpolate) resample_push(filter, sample);
+            else if (!resample_decimate(filter, sample, &out)) continue;
+        }
+
+        if (interpolate) out = resample_interpolate(filter);
+
+        if (n >= 0) responseSamples[n] = out;
+        ++n;
+    }
+}
+
+// Gives the level of the tone at the given frequency, in cycles per sample,
+// in responseSamples, in tenths of a dB relative to RESPONSE_AMPLITUDE. A
+// Hann window stops a loud tone nearby from leaking into a quiet one.
+long measureTone(double freq)
+{
+    int i; double c, s, re, im, wc, ws, wre, wim, t, w, x;
+    double sumRe, sumIm, sumW, level;
+
+    c = cos(2.0 * PI * freq);
+    s = sin(2.0 * PI * freq);
+    wc = cos(2.0 * PI / RESPONSE_LENGTH);
+    ws = sin(2.0 * PI / RESPONSE_LENGTH);
+    re = wre = 1.0;
+    im = wim = 0.0;
+    sumRe = sumIm = sumW = 0.0;
+
+    for (i = 0; i < RESPONSE_LENGTH; ++i) {
+        w = 0.5 - 0.5 * wre;
+        x = w * (responseSamples[i] - RESAMPLE_MIDDLE);
+        sumRe += x * re;
+        sumIm += x * im;
+        sumW += w;
+
+        t = re * c - im * s;
+        im = re * s + im * c;
+        re = t;
+
+        t = wre * wc - wim * ws;
+        wim = wre * ws + wim * wc;
+        wre = t;
+    }
+
+    level = 2.0 * sqrt(sumRe * sumRe + sumIm * sumIm) / sumW;
+    if (level * pow(10.0, RESPONSE_SILENT / 200.0) < RESPONSE_AMPLITUDE) {
+        return -RESPONSE_SILENT;
+    }
+
+    return (long) floor(200.0 * log10(level / RESPONSE_AMPLITUDE) + 0.5);
+}
+
+// Checks the decimator and interpolator for one factor, writing the furthest
+// the passband strays from 0 dB and the least anything that would alias or
+// image is cut by, in tenths of a dB.
+void checkResampler(int factor, long* ripple, long* rejection)
+{
+    int i; double pass, stop; long level;
+
+    *ripple = 0;
+    *rejection = RESPONSE_SILENT;
+
+    // Tones above the lower rate's Nyquist frequency fold down below it, as
+    // far under it as they were over.
+    resample_initDecimator(&responseFilter, factor);
+    for (i = 0; i < RESPONSE_TONES; ++i) {
+        pass = responsePass[i] * 0.5;
+        stop = responseStop[i] * 0.5;
+
+        resampleTone(&responseFilter, FALSE, pass / factor);
+        level = measureTone(pass);
+        *ripple = max(*ripple, abs(level));
+
+        resampleTone(&responseFilter, FALSE, stop / factor);
+        level = measureTone(1.0 - stop);
+        *rejection = min(*rejection, -level);
+    }
+
+    // Each tone's first image is as far over the lower rate's Nyquist
+    // frequency as the tone is under it.
+    resample_initInterpolator(&responseFilter, factor);
+    for (i = 0; i < RESPONSE_TONES; ++i) {
+        pass = responsePass[i] * 0.5;
+
+        resampleTone(&responseFilter, TRUE, pass);
+        level = measureTone(pass / factor);
+        *ripple = max(*ripple, abs(level));
+
+        level = measureTone((1.0 - pass) / factor);
+        *rejection = min(*rejection, -level);
+    }
+}
+
+// Checks the resamplers at every factor. Returns TRUE if each one was flat
+// enough and cut enough.
+bool runResponse(void)
+{
+    int i; bool passed;
+
+    passed = TRUE;
+    for (i = 0; i < RESPONSE_FACTORS; ++i) {
+        checkResampler(responseFactors[i], &responseRipple[i],
+            &responseRejection[i]);
+
+        if (responseRipple[i] > RESPONSE_MAX_RIPPLE
+            || responseRejection[i] < RESPONSE_MIN_REJECTION) {
+            passed = FALSE;
+        }
+    }
+
+    return passed;
+}
+
+// Draws the results of the response test on a line under the accuracy
+// test's, as the worst of every factor.
+void drawResponse(bool passed)
+{
+    int i, y; long ripple, rejection; char num[12];
+
+    ripple = 0;
+    rejection = RESPONSE_SILENT;
+    for (i = 0; i < RESPONSE_FACTORS; ++i) {
+        ripple = max(ripple, responseRipple[i]);
+        rejection = min(rejection, responseRejection[i]);
+    }
+
+    y = SUITE_Y + (BENCH_CASES + 8) * SUITE_ROW_HEIGHT;
+
+    lcd_putString(TABLE_X, y, "RSMP RIPPLE");
+    lcd_putString(TABLE_X + 32 * CHAR_WIDTH, y, passed ? "PASS" : "FAIL");
+
+    formatTenths(num, (unsigned long) ripple);
+    lcd_putString(TABLE_X + 11 * CHAR_WIDTH, y, num + 5);
+
+    lcd_putString(TABLE_X + 18 * CHAR_WIDTH, y, "CUT");
+    formatTenths(num, (unsigned long) max(rejection, 0));
+    lcd_putString(TABLE_X + 21 * CHAR_WIDTH, y, num + 4);
+}
+
+// Sends the results of the response test over the serial port as JSON.
+// uart_init must have been called.
+void sendResponse(bool passed)
+{
+    int i;
+
+    uart_putString("\n{\"resample\": {\"max_ripple_tenths\": ");
+    sendNumber(RESPONSE_MAX_RIPPLE);
+    uart_putString(", \"min_rejection_tenths\": ");
+    sendNumber(RESPONSE_MIN_REJECTION);
+    uart_putString(", \"factors\": [\n");
+
+    for (i = 0; i < RESPONSE_FACTORS; ++i) {
+        uart_putString("  {\"factor\": ");
+        sendNumber(responseFactors[i]);
+        uart_putString(", \"ripple_tenths\": ");
+        sendNumber((unsigned long) responseRipple[i]);
+        uart_putString(", \"rejection_tenths\": ");
+        sendNumber((unsigned long) max(responseRejection[i], 0));
+        uart_putString(i < RESPONSE_FACTORS - 1 ? "},\n" : "}\n");
+    }
+
+    uart_putString("], \"status\": \"");
+    uart_putString(passed ? "PASS" : "FAIL");
+    uart_putString("\"}}\n");
+}
+
+// Entry point. Runs every kernel from every place once and shows the
+// results, in core cycles per element, then runs the regression suite.
+int main(void)
+{
+    // The buffers live on the stack in internal SRAM, so only where the code
+    // is fetched from changes between runs.
+    short src[BENCH_LENGTH], dest[BENCH_LENGTH];
+    Kernel kernels[BENCH_KERNELS] = {
+        statKernel, volumeKernel, phaseKernel, rngKernel
+    };
+    Kernel kernel;
+    int i, k, p;
+
+    const Case cases[BENCH_CASES] = {
+        { "stars", "star", BENCH_STARS, starsCase },
+        { "bigchar", "char", 26, bigCharCase },
+        { "bigsmp", "texel", 26 * BIG_CHAR_WIDTH * BIG_CHAR_HEIGHT,
+            bigSampleCase },
+        { "graph", "sample", BENCH_GRAPH_LENGTH, graphCase },
+        { "wave", "note", (WAVE_LAST + 1) * 12, waveCase },
+        { "motor", "lookup", BENCH_MOTOR_SPEEDS, motorCase },
+        { "fft", "xform", BENCH_FFT_TRANSFORMS, fftCase },
+        { "decim", "sample", BENCH_RESAMPLE_LENGTH, decimCase },
+        { "interp", "sample", BENCH_RESAMPLE_LENGTH, interpCase },
+        { "linear", "sample", BENCH_SPEED_LENGTH, linearCase },
+        { "cubic", "sample", BENCH_SPEED_LENGTH, cubicCase },
+        { "fx", "sample", BENCH_FX_LENGTH, fxCase }
+    };
+    unsigned long results[BENCH_CASES];
+    int failed; bool deadline, accuracy, response;
+
+    clock_init();
+    ramfunc_init();
+
+#ifdef EXTMEM
+    if (ramfunc_size() <= BENCH_CODE_MAX) {
+        memcpy(sdramCode, __ramfunc_start, ramfunc_size());
+    }
+#endif
+
+    // Some made up audio to work on.
+    for (i = 0; i < BENCH_LENGTH; ++i) {
+        src[i] = (short) ((i * 37) % 1024 - 512);
+    }
+
+    // Free-run Timer1 at the core clock, so it counts single cycles. No
+    // interrupts are used outside the deadline test.
+    reg_modify(&PCLKSEL0, fieldMask(PCLKSEL0_TIMER1),
+        fieldVal(PCLKSEL0_TIMER1, PCLKSEL_CCLK));
+    TIMER1->TCR = 1 << TIMER_TCR_RESET;
+    TIMER1->PR = 0;
+    TIMER1->MCR = 0;
+    TIMER1->TCR = 1 << TIMER_TCR_ENABLE;
+
+    lcd_init();
+    uart_init(UART_DEFAULT_BAUD);
+
+    // The regression cases and deadline test draw all over the screen, so
+    // run them first.
+    lcd_fillScreen(BLACK);
+    lcd_putString(TABLE_X, 8, "RUNNING...");
+    prepareCases();
+    failed = runSuite(cases, results);
+    deadline = runDeadline();
+    accuracy = runAccuracy();
+    response = runResponse();
+
+    lcd_fillScreen(BLACK);
+    lcd_putString(TABLE_X, 8, "CYCLES PER ELEMENT");
+    lcd_putString(TABLE_X, 20, "(ROM- IS FLASH WITHOUT MAM)");
+
+    for (k = 0; k < BENCH_KERNELS; ++k) {
+        lcd_putString(TABLE_X + (k + 1) * TABLE_COLUMN_WIDTH, TABLE_Y,
+            kernelNames[k]);
+    }
+
+    for (p = 0; p < BENCH_PLACES; ++p) {
+        lcd_putString(TABLE_X, TABLE_Y + (p + 1) * TABLE_ROW_HEIGHT,
+            placeNames[p]);
+
+        if (p == BENCH_FLASH_NO_MAM) MAMCR = MAM_DISABLED;
+
+        for (k = 0; k < BENCH_KERNELS; ++k) {
+            kernel = findKernel(kernels[k], p);
+            if (kernel == NULL) continue;
+
+            drawResult(k, p, timeKernel(kernel, dest, src));
+        }
+
+        if (p == BENCH_FLASH_NO_MAM) MAMCR = MAM_FULL;
+    }
+
+    drawSuite(cases, results, failed);
+    drawDeadline(deadline);
+    drawAccuracy(accuracy);
+    drawResponse(response);
+
+    sendSuite(cases, results, failed);
+    sendDeadline(deadline);
+    sendAccuracy(accuracy);
+    sendResponse(response);
+
+    while (TRUE);
+
+    return 0;
+}
@@ -0,0 +1,771 @@
+/**
+ * File Name  : clip.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Keeps several recordings, or clips, in one big array of
+ *              samples, and edits them without ever copying a sample.
+ *
+ *              The array is handed out in slabs of CLIP_SLAB_LENGTH samples.
+ *              A new take gets the longest run of free slabs to record into,
+ *              and gives back the ones it didn't use when it finishes. Each
+ *              slab counts the pieces that use any of it, and is free again
+ *              once none do. The clips and pieces themselves come from pools
+ *              (see mem.h), so nothing touches the heap.
+ *
+ *              A clip is a piece table: a list of pieces, each a run of
+ *              samples somewhere in the array, played one after another.
+ *              Trimming, splitting, splicing one clip into another and
+ *              looping part of a clip only add, remove and relink pieces, so
+ *              they take time in proportion to the number of pieces, however
+ *              long the clips are, and many clips can share the same samples.
+ *
+ *              A player walks through a clip's pieces at any speed.h speed,
+ *              carrying straight on from the end of one piece to the next.
+ *              Each piece remembers whether it follows on from the one before
+ *              it as recorded, and where it doesn't, the player can
+ *              crossfade between them over CLIP_FADE samples to hide the
+ *              join.
+ *
+ *              A take can also keep a pre-roll, recorded into a ring at the
+ *              start of its space before it properly started. The ring
+ *              becomes the first pieces of the clip, oldest first, so it is
+ *              stitched in without being moved.
+ *
+ *              A take of several channels at once splits its run of slabs
+ *              evenly between them, and each channel becomes a clip of its
+ *              own, numbered the same, with its samples kept apart from the
+ *              others'.
+ */
+
+#ifndef CLIP_H_GUARD
+#define CLIP_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "mem.h"
+#include "speed.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of samples in each slab, about a second and a half at 44.1 kHz,
+// and the most slabs a store can manage.
+#define CLIP_SLAB_LENGTH (1L << 16)
+#define CLIP_MAX_SLABS 256
+
+// The most clips, and pieces across all of them, a store can hold.
+#define CLIP_MAX 16
+#define CLIP_MAX_PIECES 256
+
+// The longest name a clip can have.
+#define CLIP_NAME_LENGTH 8
+
+// The number of samples a crossfade between pieces takes, as a power of two.
+// At 44.1 kHz that's about 1.5 ms.
+#define CLIP_FADE_BITS 6
+#define CLIP_FADE (1 << CLIP_FADE_BITS)
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+typedef struct clip_Piece clip_Piece;
+
+// A run of samples, its neighbours in its clip, and whether it carries
+// straight on from the one before it.
+struct clip_Piece {
+    clip_Piece* prev;
+    clip_Piece* next;
+    short* start;
+    unsigned long length;
+    bool follows;
+};
+
+// A clip: a list of pieces, the total number of samples in them, and the
+// rate they were recorded at, in hertz.
+typedef struct {
+    char name[CLIP_NAME_LENGTH + 1];
+    int rate;
+    unsigned long length;
+    clip_Piece* first;
+    clip_Piece* last;
+    int pieces;
+} clip_Clip;
+
+// Everything in a store of clips. The clips are kept in the order they were
+// made, apart from split off parts, which come just after the clip they were
+// split from.
+typedef struct {
+    short* samples;
+    int slabs;
+    unsigned short refs[CLIP_MAX_SLABS];
+
+    mem_Pool clipPool, piecePool;
+    char clipMemory[memPoolBytes(sizeof(clip_Clip), CLIP_MAX)]
+        MEM_ATTR_ALIGNED;
+    char pieceMemory[memPoolBytes(sizeof(clip_Piece), CLIP_MAX_PIECES)]
+        MEM_ATTR_ALIGNED;
+
+    clip_Clip* clips[CLIP_MAX];
+    int count;
+    int number;
+} clip_Store;
+
+// Plays through a clip. One reader plays the current piece, and the other
+// plays the next one while it fades in. fade counts the samples into a
+// crossfade, and is -1 when there isn't one.
+typedef struct {
+    const clip_Clip* clip;
+    clip_Piece* piece;
+    clip_Piece* incoming;
+    unsigned long before;
+    speed_Reader readers[2];
+    int current;
+    bool crossfade;
+    int fade;
+} clip_Player;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void clip_init(clip_Store* store, short* samples, unsigned long length);
+clip_Clip* clip_startTake(clip_Store* store, int rate, short** samples,
+    unsigned long* capacity);
+bool clip_startTakes(clip_Store* store, int rate, int channels,
+    char* const* prefixes, clip_Clip** takes, short** samples,
+    unsigned long* capacity);
+void clip_finishTake(clip_Store* store, clip_Clip* clip,
+    unsigned long length);
+void clip_finishCapture(clip_Store* store, clip_Clip* clip,
+    unsigned long ring, unsigned long head, bool wrapped,
+    unsigned long length);
+void clip_delete(clip_Store* store, clip_Clip* clip);
+int clip_find(clip_Store* store, const clip_Clip* clip);
+
+bool clip_trim(clip_Store* store, clip_Clip* clip, unsigned long start,
+    unsigned long end);
+clip_Clip* clip_split(clip_Store* store, clip_Clip* clip, unsigned long at);
+bool clip_splice(clip_Store* store, clip_Clip* dest, unsigned long at,
+    const clip_Clip* src);
+bool clip_loop(clip_Store* store, clip_Clip* clip, unsigned long start,
+    unsigned long end, int times);
+
+clip_Clip* clip_new(clip_Store* store, char* prefix, int number, int rate,
+    int index);
+int clip_nextNumber(clip_Store* store);
+bool clip_spare(clip_Store* store, int pieces);
+void clip_hold(clip_Store* store, const short* start, unsigned long length,
+    int delta);
+clip_Piece* clip_cut(clip_Store* store, clip_Clip* clip, unsigned long at);
+clip_Piece* clip_addPiece(clip_Store* store, clip_Clip* clip, short* start,
+    unsigned long length, bool follows, clip_Piece* before);
+void clip_remove(clip_Store* store, clip_Clip* clip, unsigned long from,
+    unsigned long to);
+void clip_link(clip_Clip* clip, clip_Piece* piece, clip_Piece* before);
+void clip_unlink(clip_Clip* clip, clip_Piece* piece);
+
+void clip_play(clip_Player* player, const clip_Clip* clip, long step,
+    int method, int volume, bool crossfade);
+void clip_setStep(clip_Player* player, long step);
+static inline bool clip_finished(const clip_Player* player);
+static inline unsigned long clip_position(const clip_Player* player);
+static inline short clip_next(clip_Player* player);
+bool clip_startFade(clip_Player* player);
+short clip_fadeNext(clip_Player* player);
+void clip_advance(clip_Player* player);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Empties a store, which will keep its clips in the given array of samples.
+// Anything past the last whole slab goes unused.
+void clip_init(clip_Store* store, short* samples, unsigned long length)
+{
+    int i;
+
+    store->samples = samples;
+    store->slabs = (int) min(length / CLIP_SLAB_LENGTH,
+        (unsigned long) CLIP_MAX_SLABS);
+
+    for (i = 0; i < CLIP_MAX_SLABS; ++i) store->refs[i] = 0;
+
+    mem_poolInit(&store->clipPool, store->clipMemory, sizeof(clip_Clip),
+        CLIP_MAX);
+    mem_poolInit(&store->piecePool, store->pieceMemory, sizeof(clip_Piece),
+        CLIP_MAX_PIECES);
+
+    store->count = 0;
+    store->number = 0;
+}
+
+// Starts a new take at the given rate, in the longest run of free slabs.
+// Gives where to record to and how many samples there is room for, or
+// returns NULL if there is no room at all. Until it is finished the take
+// is empty, but holds on to the whole run.
+clip_Clip* clip_startTake(clip_Store* store, int rate, short** samples,
+    unsigned long* capacity)
+{
+    char* prefixes[1] = { "TAKE " }; clip_Clip* clip;
+
+    if (!clip_startTakes(store, rate, 1, prefixes, &clip, samples,
+        capacity)) {
+        return NULL;
+    }
+
+    return clip;
+}
+
+// Starts a take of the given number of channels at the given rate, one clip
+// each, named with the given prefixes. The longest run of free slabs is
+// split evenly between them. Gives where to record each channel to and how
+// many samples there is room for in each, or returns FALSE if there isn't a
+// slab for every channel, or room for the clips. Until they are finished
+// the takes are empty, but hold on to the whole run.
+bool clip_startTakes(clip_Store* store, int rate, int channels,
+    char* const* prefixes, clip_Clip** takes, short** samples,
+    unsigned long* capacity)
+{
+    int i, run, best, bestRun, lane, number; clip_Piece* piece;
+
+    best = 0;
+    bestRun = 0;
+    run = 0;
+    for (i = 0; i < store->slabs; ++i) {
+        run = store->refs[i] == 0 ? run + 1 : 0;
+        if (run > bestRun) {
+            bestRun = run;
+            best = i - run + 1;
+        }
+    }
+
+    // Finishing a take with a pre-roll needs three pieces a channel.
+    lane = bestRun / channels;
+    if (lane == 0 || store->count + channels > CLIP_MAX
+        || !clip_spare(store, 3 * channels)) {
+        return FALSE;
+    }
+
+    number = clip_nextNumber(store);
+
+    for (i = 0; i < channels; ++i) {
+        takes[i] = clip_new(store, prefixes[i], number, rate, store->count);
+
+        piece = (clip_Piece*) mem_poolAlloc(&store->piecePool);
+        piece->start = store->samples
+            + (unsigned long) (best + i * lane) * CLIP_SLAB_LENGTH;
+        piece->length = (unsigned long) lane * CLIP_SLAB_LENGTH;
+        piece->follows = FALSE;
+        clip_hold(store, piece->start, piece->length, 1);
+        clip_link(takes[i], piece, NULL);
+        takes[i]->length = 0;
+
+        samples[i] = piece->start;
+    }
+
+    *capacity = (unsigned long) lane * CLIP_SLAB_LENGTH;
+    return TRUE;
+}
+
+// Finishes a take once the given number of samples have been recorded,
+// freeing the slabs it didn't get as far as. A take with nothing in it is
+// deleted.
+void clip_finishTake(clip_Store* store, clip_Clip* clip, unsigned long length)
+{
+    clip_finishCapture(store, clip, 0, 0, FALSE, length);
+}
+
+// Finishes a take that kept a pre-roll in a ring of the first ring samples
+// of its space, with the oldest at head if the ring wrapped, or only the
+// first head if it didn't, and recorded length samples after the ring. The
+// pre-roll and the rest become the clip's pieces in order, and the slabs the
+// take didn't get as far as are freed. A take with nothing in it is deleted.
+void clip_finishCapture(clip_Store* store, clip_Clip* clip,
+    unsigned long ring, unsigned long head, bool wrapped,
+    unsigned long length)
+{
+    clip_Piece* space; short* start;
+
+    // Let go of the whole space, and build the clip up out of it.
+    space = clip->first;
+    start = space->start;
+    clip_hold(store, space->start, space->length, -1);
+    clip_unlink(clip, space);
+    mem_poolFree(&store->piecePool, space);
+    clip->length = 0;
+
+    if (wrapped && head < ring) {
+        clip_addPiece(store, clip, start + head, ring - head, FALSE, NULL);
+    }
+    if (head > 0) clip_addPiece(store, clip, start, head, TRUE, NULL);
+    if (length > 0) {
+        clip_addPiece(store, clip, start + ring, length, TRUE, NULL);
+    }
+
+    if (clip->length == 0) clip_delete(store, clip);
+}
+
+// Deletes a clip, freeing any slabs no other clip uses.
+void clip_delete(clip_Store* store, clip_Clip* clip)
+{
+    int i; clip_Piece *piece, *next;
+
+    for (piece = clip->first; piece != NULL; piece = next) {
+        next = piece->next;
+        clip_hold(store, piece->start, piece->length, -1);
+        mem_poolFree(&store->piecePool, piece);
+    }
+
+    i = clip_find(store, clip);
+    --store->count;
+    for (; i < store->count; ++i) store->clips[i] = store->clips[i + 1];
+
+    mem_poolFree(&store->clipPool, clip);
+}
+
+// Gives the index of a clip in the store, or -1 if it isn't there.
+int clip_find(clip_Store* store, const clip_Clip* clip)
+{
+    int i;
+
+    for (i = 0; i < store->count; ++i) {
+        if (store->clips[i] == clip) return i;
+    }
+
+    return -1;
+}
+
+// Cuts a clip down to the samples from start up to end. Returns FALSE,
+// leaving it as it was, if that would leave nothing or there aren't the
+// pieces to spare.
+bool clip_trim(clip_Store* store, clip_Clip* clip, unsigned long start,
+    unsigned long end)
+{
+    if (start >= end || end > clip->length || !clip_spare(store, 2)) {
+        return FALSE;
+    }
+
+    clip_remove(store, clip, end, clip->length);
+    clip_remove(store, clip, 0, start);
+    return TRUE;
+}
+
+// Splits a clip in two at the given sample. The clip keeps everything before
+// it, and everything from it on goes to a new clip, which is returned, or
+// NULL if it can't be made.
+clip_Clip* clip_split(clip_Store* store, clip_Clip* clip, unsigned long at)
+{
+    clip_Clip* part; clip_Piece *piece, *next;
+
+    if (at == 0 || at >= clip->length || !clip_spare(store, 1)) return NULL;
+
+    part = clip_new(store, "PART ", clip_nextNumber(store), clip->rate,
+        clip_find(store, clip) + 1);
+    if (part == NULL) return NULL;
+
+    // The pieces move over as they are, so still use the same slabs.
+    for (piece = clip_cut(store, clip, at); piece != NULL; piece = next) {
+        next = piece->next;
+        clip_unlink(clip, piece);
+        clip_link(part, piece, NULL);
+    }
+
+    return part;
+}
+
+// Inserts the whole of one clip into another at the given sample, sharing
+// its samples. Returns FALSE, leaving both as they were, if they are the same
+// clip, or were recorded at different rates, or there aren't the pieces to
+// spare.
+bool clip_splice(clip_Store* store, clip_Clip* dest, unsigned long at,
+    const clip_Clip* src)
+{
+    clip_Piece *before, *piece, *copy;
+
+    if (src == dest || src->rate != dest->rate || at > dest->length
+        || !clip_spare(store, src->pieces + 1)) {
+        return FALSE;
+    }
+
+    before = clip_cut(store, dest, at);
+
+    for (piece = src->first; piece != NULL; piece = piece->next) {
+        copy = clip_addPiece(store, dest, piece->start, piece->length,
+            piece->follows, before);
+        if (piece == src->first) copy->follows = FALSE;
+    }
+
+    if (before != NULL) before->follows = FALSE;
+
+    return TRUE;
+}
+
+// Makes the samples from start up to end in a clip play the given number of
+// times in a row. Returns FALSE, leaving the clip sounding as it did, if the
+// range is empty or there aren't the pieces to spare.
+bool clip_loop(clip_Store* store, clip_Clip* clip, unsigned long start,
+    unsigned long end, int times)
+{
+    clip_Piece *first, *after, *piece; int i, j, count;
+
+    if (start >= end || end > clip->length || times < 1
+        || !clip_spare(store, 2)) {
+        return FALSE;
+    }
+
+    // Cutting on its own doesn't change how the clip sounds.
+    first = clip_cut(store, clip, start);
+    after = clip_cut(store, clip, end);
+
+    count = 0;
+    for (piece = first; piece != after; piece = piece->next) ++count;
+    if (!clip_spare(store, count * (times - 1))) return FALSE;
+
+    // Each copy goes in after the last, so walking count pieces on from the
+    // first only ever sees the originals. The piece after the range follows
+    // a copy of the same samples it did before.
+    for (i = 1; i < times; ++i) {
+        piece = first;
+        for (j = 0; j < count; ++j) {
+            clip_addPiece(store, clip, piece->start, piece->length,
+                j > 0 && piece->follows, after);
+            piece = piece->next;
+        }
+    }
+
+    return TRUE;
+}
+
+// Makes an empty clip at the given rate, named with the given prefix and
+// number, and puts it at the given index in the store. Returns NULL if the
+// store is full.
+clip_Clip* clip_new(clip_Store* store, char* prefix, int number, int rate,
+    int index)
+{
+    int i, len; clip_Clip* clip;
+
+    if (store->count >= CLIP_MAX) return NULL;
+
+    clip = (clip_Clip*) mem_poolAlloc(&store->clipPool);
+    if (clip == NULL) return NULL;
+
+    strcpy(clip->name, prefix);
+    len = strlen(clip->name);
+    formatNumber(clip->name + len, number, number < 10 ? 1 : 2);
+
+    clip->rate = rate;
+    clip->length = 0;
+    clip->first = NULL;
+    clip->last = NULL;
+    clip->pieces = 0;
+
+    for (i = store->count; i > index; --i) {
+        store->clips[i] = store->clips[i - 1];
+    }
+    store->clips[index] = clip;
+    ++store->count;
+
+    return clip;
+}
+
+// Gives the number for the next clip to be made, counting from 1 to 99 and
+// round again.
+int clip_nextNumber(clip_Store* store)
+{
+    store->number = store->number < 99 ? store->number + 1 : 1;
+    return store->number;
+}
+
+// Whether there are at least the given number of pieces free, so an edit
+// can be made without running out halfway through.
+bool clip_spare(clip_Store* store, int pieces)
+{
+    return store->piecePool.count - store->piecePool.inUse
+        >= (unsigned long) pieces;
+}
+
+// Adds delta to the count of pieces using each slab the given run of
+// samples touches.
+void clip_hold(clip_Store* store, const short* start, unsigned long length,
+    int delta)
+{
+    unsigned long first, last, i;
+
+    if (length == 0) return;
+
+    first = (unsigned long) (start - store->samples) / CLIP_SLAB_LENGTH;
+    last = ((unsigned long) (start - store->samples) + length - 1)
+        / CLIP_SLAB_LENGTH;
+
+    for (i = first; i <= last; ++i) store->refs[i] += delta;
+}
+
+// Makes sure a piece starts at the given sample of a clip, splitting the one
+// it falls in if need be, and returns it, or NULL if the sample is the end of
+// the clip. Check there is a piece to spare first.
+clip_Piece* clip_cut(clip_Store* store, clip_Clip* clip, unsigned long at)
+{
+    clip_Piece *piece, *rest;
+
+    for (piece = clip->first; piece != NULL; piece = piece->next) {
+        if (at == 0) return piece;
+        if (at < piece->length) break;
+        at -= piece->length;
+    }
+
+    if (piece == NULL) return NULL;
+
+    rest = (clip_Piece*) mem_poolAlloc(&store->piecePool);
+    rest->start = piece->start + at;
+    rest->length = piece->length - at;
+    rest->follows = TRUE;
+
+    // Both halves count against the slab they were split in.
+    clip_hold(store, piece->start, piece->length, -1);
+    piece->length = at;
+    clip_hold(store, piece->start, piece->length, 1);
+    clip_hold(store, rest->start, rest->length, 1);
+
+    clip->length -= rest->length;
+    clip_link(clip, rest, piece->next);
+
+    return rest;
+}
+
+// Takes the samples from one sample up to another out of a clip. Check
+// there are two pieces to spare first.
+void clip_remove(clip_Store* store, clip_Clip* clip, unsigned long from,
+    unsigned long to)
+{
+    clip_Piece *piece, *end, *next;
+
+    if (from >= to) return;
+
+    piece = clip_cut(store, clip, from);
+    end = clip_cut(store, clip, to);
+
+    for (; piece != end; piece = next) {
+        next = piece->next;
+        clip_unlink(clip, piece);
+        clip_hold(store, piece->start, piece->length, -1);
+        mem_poolFree(&store->piecePool, piece);
+    }
+
+    if (end != NULL) end->follows = FALSE;
+}
+
+// Makes a new piece of the given samples and puts it into a clip before
+// another, or at the end if that is NULL. Check there is a piece to spare
+// first.
+clip_Piece* clip_addPiece(clip_Store* store, clip_Clip* clip, short* start,
+    unsigned long length, bool follows, clip_Piece* before)
+{
+    clip_Piece* piece;
+
+    piece = (clip_Piece*) mem_poolAlloc(&store->piecePool);
+    piece->start = start;
+    piece->length = length;
+    piece->follows = follows;
+
+    clip_hold(store, start, length, 1);
+    clip_link(clip, piece, before);
+
+    return piece;
+}
+
+// Puts a piece into a clip before another, or at the end if that is NULL.
+void clip_link(clip_Clip* clip, clip_Piece* piece, clip_Piece* before)
+{
+    piece->next = before;
+    piece->prev = before != NULL ? before->prev : clip->last;
+
+    if (piece->prev != NULL) piece->prev->next = piece;
+    else clip->first = piece;
+
+    if (before != NULL) before->prev = piece;
+    else clip->last = piece;
+
+    clip->length += piece->length;
+    ++clip->pieces;
+}
+
+// Takes a piece out of a clip, without freeing it.
+void clip_unlink(clip_Clip* clip, clip_Piece* piece)
+{
+    if (piece->prev != NULL) piece->prev->next = piece->next;
+    else clip->first = piece->next;
+
+    if (piece->next != NULL) piece->next->prev = piece->prev;
+    else clip->last = piece->prev;
+
+    clip->length -= piece->length;
+    --clip->pieces;
+}
+
+// Starts playing a clip with the given step, in SPEED_ONEs, SPEED_* method
+// and volume out of 256, crossfading at joins if asked to. A negative step
+// plays backwards from the end. The clip mustn't be edited or deleted until
+// playback stops.
+void clip_play(clip_Player* player, const clip_Clip* clip, long step,
+    int method, int volume, bool crossfade)
+{
+    int i;
+
+    player->clip = clip;
+    player->piece = step < 0 ? clip->last : clip->first;
+    player->before = step < 0 ? clip->length - clip->last->length : 0;
+    player->current = 0;
+    player->crossfade = crossfade;
+    player->fade = -1;
+
+    for (i = 0; i < 2; ++i) {
+        speed_start(&player->readers[i], player->piece->start,
+            player->piece->length, step, method);
+        speed_setVolume(&player->readers[i], volume);
+    }
+}
+
+// Changes the speed and direction of playback from the next sample on.
+// Safe to call while an interrupt is playing.
+void clip_setStep(clip_Player* player, long step)
+{
+    speed_setStep(&player->readers[0], step);
+    speed_setStep(&player->readers[1], step);
+}
+
+// Whether a player has gone past either end of its clip.
+static inline bool clip_finished(const clip_Player* player)
+{
+    return speed_finished(&player->readers[player->current]);
+}
+
+// Gives the index in the whole clip of the sample at or just before a
+// player's position. Call clip_finished first.
+static inline unsigned long clip_position(const clip_Player* player)
+{
+    return player->before
+        + speed_index(&player->readers[player->current]);
+}
+
+// Gives the next sample of a clip, and moves on through it. Call
+// clip_finished first.
+static inline short clip_next(clip_Player* player)
+{
+    speed_Reader* reader; short val; long step;
+
+    if (player->fade >= 0) return clip_fadeNext(player);
+
+    reader = &player->readers[player->current];
+
+    // Start fading into the next piece once there are no more than
+    // CLIP_FADE samples left of this one.
+    if (player->crossfade) {
+        step = reader->step;
+        if ((step >= 0 ? player->piece->next != NULL
+                && ((long long) reader->length << SPEED_FRACTION_BITS)
+                    - reader->position <= (long long) step * CLIP_FADE
+            : player->piece->prev != NULL
+                && reader->position < -(long long) step * CLIP_FADE)
+            && clip_startFade(player)) {
+            return clip_fadeNext(player);
+        }
+    }
+
+    val = speed_next(reader);
+    if (speed_finished(reader)) clip_advance(player);
+
+    return val;
+}
+
+// Starts the other reader on the piece playback is heading into, unless it
+// carries straight on from this one. Returns whether it did.
+bool clip_startFade(clip_Player* player)
+{
+    speed_Reader *reader, *incoming; clip_Piece *piece, *next;
+
+    reader = &player->readers[player->current];
+    incoming = &player->readers[1 - player->current];
+    piece = player->piece;
+
+    if (reader->step >= 0) {
+        next = piece->next;
+        if (next->follows) return FALSE;
+        speed_move(incoming, next->start, next->length, 0);
+    } else {
+        next = piece->prev;
+        if (piece->follows) return FALSE;
+        speed_move(incoming, next->start, next->length,
+            (long long) (next->length - 1) << SPEED_FRACTION_BITS);
+    }
+
+    incoming->step = reader->step;
+    player->incoming = next;
+    player->fade = 0;
+    return TRUE;
+}
+
+// Gives the next sample of a crossfade, and hands over to the incoming piece
+// once it is done.
+short clip_fadeNext(clip_Player* player)
+{
+    int a, b, val;
+
+    a = speed_next(&player->readers[player->current]);
+    b = speed_next(&player->readers[1 - player->current]);
+    val = a + (((b - a) * player->fade) >> CLIP_FADE_BITS);
+
+    if (++player->fade >= CLIP_FADE) {
+        if (player->incoming == player->piece->next) {
+            player->before += player->piece->length;
+        } else {
+            player->before -= player->incoming->length;
+        }
+
+        player->piece = player->incoming;
+        player->current = 1 - player->current;
+        player->fade = -1;
+
+        if (clip_finished(player)) clip_advance(player);
+    }
+
+    return (short) val;
+}
+
+// Moves the current reader on from a piece it has run off the end of into
+// the next piece in that direction, as far past its start as it went past
+// the end, so the join is seamless. Pieces shorter than a step are skipped.
+// If there are none left it stays finished.
+void clip_advance(clip_Player* player)
+{
+    speed_Reader* reader; clip_Piece* piece; long long position;
+
+    reader = &player->readers[player->current];
+
+    while (speed_finished(reader)) {
+        piece = player->piece;
+
+        if (reader->position >= 0) {
+            if (piece->next == NULL) return;
+            position = reader->position
+                - ((long long) piece->length << SPEED_FRACTION_BITS);
+            player->before += piece->length;
+            piece = piece->next;
+        } else {
+            if (piece->prev == NULL) return;
+            piece = piece->prev;
+            position = reader->position
+                + ((long long) piece->length << SPEED_FRACTION_BITS);
+            player->before -= piece->length;
+        }
+
+        player->piece = piece;
+        speed_move(reader, piece->start, piece->length, position);
+    }
+}
+
+#endif
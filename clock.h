@@ -0,0 +1,223 @@
+/**
+ * File Name  : clock.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Sets the core clock to its maximum frequency using the PLL,
+ *              and enables the Memory Accelerator Module fully so code runs
+ *              from flash with as few stalls as possible. Retunes everything
+ *              that counts in core clock cycles to match: the SDRAM timings
+ *              and the delay loop behind wait.
+ */
+
+#ifndef CLOCK_H_GUARD
+#define CLOCK_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "reg.h"
+#include "timer.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Frequency of the main oscillator crystal.
+#define CLOCK_OSC_HZ 12000000
+
+// PLL multiplier and pre-divider. Gives a 288 MHz current controlled
+// oscillator, which must be between 275 and 550 MHz.
+#define CLOCK_PLL_M 12
+#define CLOCK_PLL_N 1
+
+// Divider from the PLL output down to CCLK. Must match CCLK_HZ in utils.h.
+#define CLOCK_CCLK_DIV 4
+
+// The core clock while the PLL is off and locking, which is the oscillator
+// through the same divider.
+#define CLOCK_LOCK_HZ (CLOCK_OSC_HZ / CLOCK_CCLK_DIV)
+
+// Flash access time in CCLKs. Four is needed above 60 MHz.
+#define CLOCK_MAM_CYCLES 4
+
+// MAM control modes.
+#define MAM_DISABLED 0
+#define MAM_FULL 2
+
+// Bits in the PLL control and status registers.
+#define PLLCON_PLLE 0
+#define PLLCON_PLLC 1
+#define PLLSTAT_PLLE 24
+#define PLLSTAT_PLLC 25
+#define PLLSTAT_PLOCK 26
+
+// Bits in the system control and status register.
+#define SCS_OSCEN 5
+#define SCS_OSCSTAT 6
+
+// Timings of the board's SDRAM in nanoseconds, from its data sheet (-7 speed
+// grade), and the interval each row must be refreshed within (4096 rows in
+// 64 ms). The EMC runs from CCLK, so these are turned into CCLK cycles.
+#define CLOCK_SDRAM_RP_NS 20
+#define CLOCK_SDRAM_RAS_NS 45
+#define CLOCK_SDRAM_XSR_NS 75
+#define CLOCK_SDRAM_APR_NS 20
+#define CLOCK_SDRAM_WR_NS 15
+#define CLOCK_SDRAM_RC_NS 70
+#define CLOCK_SDRAM_RFC_NS 70
+#define CLOCK_SDRAM_RRD_NS 15
+#define CLOCK_SDRAM_REFRESH_NS 15625
+
+// The mode register command takes a number of clocks, not a time.
+#define CLOCK_SDRAM_MRD_CYCLES 2
+
+// Iterations of the delay loop timed to calibrate wait.
+#define CLOCK_DELAY_CALIBRATION 20000
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Converts a time in nanoseconds into whole CCLK cycles, rounding up so the
+// time is always met.
+#define clockCycles(ns) (((ns) * (CCLK_HZ / 1000000) + 999) / 1000)
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void clock_init(void);
+void clock_feed(void);
+void clock_setSdramTimings(void);
+void clock_setSdramRefresh(unsigned long hz);
+void clock_calibrateDelay(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Runs the core at CCLK_HZ from the PLL, with peripherals at PCLK_HZ, and
+// turns the MAM on fully. Retunes the SDRAM and wait to suit. Must be called
+// before interrupts are enabled, and before anything that depends on
+// PCLK_HZ is set up.
+void clock_init(void)
+{
+    // The MAM timing can only be changed while it is off.
+    MAMCR = MAM_DISABLED;
+    MAMTIM = CLOCK_MAM_CYCLES;
+
+    // The SDRAM timings are set for the faster clock before switching to it.
+    // They're also safe at the slower clock until then, as every wait just
+    // takes longer. The refresh interval isn't: counted in cycles of the
+    // slower clock it would come far too seldom. So it's set for the clock
+    // the core runs at while the PLL locks, and only for CCLK_HZ once the
+    // PLL is connected.
+#ifdef EXTMEM
+    clock_setSdramTimings();
+    clock_setSdramRefresh(CLOCK_LOCK_HZ);
+#endif
+
+    // If the PLL is already driving the core, disconnect it before changing
+    // anything, then turn it off.
+    if (getBit(PLLSTAT, PLLSTAT_PLLC)) {
+        PLLCON = 1 << PLLCON_PLLE;
+        clock_feed();
+    }
+    PLLCON = 0;
+    clock_feed();
+
+    // Divide the core clock down to CLOCK_LOCK_HZ straight away, rather than
+    // running on whatever divider the startup code left.
+    CCLKCFG = CLOCK_CCLK_DIV - 1;
+
+    // Start the main oscillator and use it as the PLL input.
+    SCS = setBit(SCS, SCS_OSCEN);
+    while (!getBit(SCS, SCS_OSCSTAT));
+    CLKSRCSEL = 1;
+
+    PLLCFG = (CLOCK_PLL_M - 1) | ((CLOCK_PLL_N - 1) << 16);
+    clock_feed();
+
+    PLLCON = 1 << PLLCON_PLLE;
+    clock_feed();
+
+    while (!getBit(PLLSTAT, PLLSTAT_PLOCK));
+
+    // Every peripheral runs at CCLK / 4, which is the reset default.
+    PCLKSEL0 = PCLKSEL_CCLK_4;
+    PCLKSEL1 = PCLKSEL_CCLK_4;
+
+    PLLCON = (1 << PLLCON_PLLE) | (1 << PLLCON_PLLC);
+    clock_feed();
+    while (!getBit(PLLSTAT, PLLSTAT_PLLC));
+
+#ifdef EXTMEM
+    clock_setSdramRefresh(CCLK_HZ);
+#endif
+
+    MAMCR = MAM_FULL;
+
+    clock_calibrateDelay();
+}
+
+// Makes changes to the PLL registers take effect. Nothing else may touch the
+// APB bus in between the two writes, so interrupts must be off.
+void clock_feed(void)
+{
+    PLLFEED = 0xAA;
+    PLLFEED = 0x55;
+}
+
+// Sets the EMC's SDRAM command timings for CCLK_HZ. The startup code sets
+// them for the clock it runs at, which would leave too few cycles for each
+// command at the faster one. Most of the registers hold one less than the
+// number of cycles; the write recovery to activate time (DAL) holds the
+// number itself. The refresh interval is left to clock_setSdramRefresh, and
+// the CAS latency and the SDRAM's own mode register as the startup code set
+// them.
+void clock_setSdramTimings(void)
+{
+    EMC_DYN_RP = clockCycles(CLOCK_SDRAM_RP_NS) - 1;
+    EMC_DYN_RAS = clockCycles(CLOCK_SDRAM_RAS_NS) - 1;
+    EMC_DYN_SREX = clockCycles(CLOCK_SDRAM_XSR_NS) - 1;
+    EMC_DYN_APR = clockCycles(CLOCK_SDRAM_APR_NS) - 1;
+    EMC_DYN_DAL = clockCycles(CLOCK_SDRAM_WR_NS + CLOCK_SDRAM_RP_NS);
+    EMC_DYN_WR = clockCycles(CLOCK_SDRAM_WR_NS) - 1;
+    EMC_DYN_RC = clockCycles(CLOCK_SDRAM_RC_NS) - 1;
+    EMC_DYN_RFC = clockCycles(CLOCK_SDRAM_RFC_NS) - 1;
+    EMC_DYN_XSR = clockCycles(CLOCK_SDRAM_XSR_NS) - 1;
+    EMC_DYN_RRD = clockCycles(CLOCK_SDRAM_RRD_NS) - 1;
+    EMC_DYN_MRD = CLOCK_SDRAM_MRD_CYCLES - 1;
+}
+
+// Sets the EMC's SDRAM refresh interval for a core clock of hz. It's counted
+// in units of 16 cycles, and rounded down so rows are refreshed at least as
+// often as they need to be.
+void clock_setSdramRefresh(unsigned long hz)
+{
+    EMC_DYN_RFSH = CLOCK_SDRAM_REFRESH_NS * (hz / 1000) / 1000000 / 16;
+}
+
+// Times CLOCK_DELAY_CALIBRATION iterations of the delay loop against Timer 0,
+// which counts PCLK cycles, and sets delayMult so wait is right at the new
+// clock. Leaves Timer 0 stopped and reset for sched_init.
+void clock_calibrateDelay(void)
+{
+    unsigned long ticks;
+
+    TIMER0->TCR = 1 << TIMER_TCR_RESET;
+    TIMER0->PR = 0;
+    TIMER0->TCR = 1 << TIMER_TCR_ENABLE;
+
+    delayLoop(CLOCK_DELAY_CALIBRATION);
+
+    ticks = TIMER0->TC;
+    TIMER0->TCR = 1 << TIMER_TCR_RESET;
+
+    delayMult = (int) ((unsigned long long) CLOCK_DELAY_CALIBRATION
+        * (PCLK_HZ / 1000) / max(ticks, 1ul));
+}
+
+#endif
@@ -0,0 +1,225 @@
+/**
+ * File Name  : cursor.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Drives the LCD controller's hardware cursor, a small two
+ *              colour image the controller lays over the frame buffer as it
+ *              scans it out. Moving the cursor is a single register write and
+ *              never touches the frame buffer, so it suits markers that move
+ *              every frame over something expensive to redraw.
+ *
+ *              There is one cursor, either 64x64 pixels or 32x32 pixels. In
+ *              the smaller size, the image memory holds four images that can
+ *              be switched between. Each pixel is one of the CURSOR_*
+ *              values, which pick a palette colour, let the frame buffer
+ *              show through, or invert it.
+ */
+
+#ifndef CURSOR_H_GUARD
+#define CURSOR_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "reg.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The cursor registers, and the image memory.
+#define CURSOR_REGS ((cursor_Regs*) 0xFFE10C00)
+#define CURSOR_IMAGE ((volatile unsigned long*) 0xFFE10800)
+
+// The two cursor sizes, as written to the size field.
+#define CURSOR_SIZE_32 0
+#define CURSOR_SIZE_64 1
+
+// The number of images the image memory holds in each size.
+#define CURSOR_IMAGES_32 4
+#define CURSOR_IMAGES_64 1
+
+// What each pixel of an image shows.
+#define CURSOR_COLOUR0 0
+#define CURSOR_COLOUR1 1
+#define CURSOR_CLEAR 2
+#define CURSOR_INVERT 3
+
+// A word of image memory with every pixel clear.
+#define CURSOR_CLEAR_WORD 0xaaaaaaaaUL
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Layout of the cursor register block.
+typedef struct {
+    volatile unsigned long CTRL;
+    volatile unsigned long CFG;
+    volatile unsigned long PAL0;
+    volatile unsigned long PAL1;
+    volatile unsigned long XY;
+    volatile unsigned long CLIP;
+    volatile unsigned long reserved[2];
+    volatile unsigned long INTMSK;
+    volatile unsigned long INTCLR;
+    volatile unsigned long INTRAW;
+    volatile unsigned long INTSTAT;
+} cursor_Regs;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The side length of the cursor in pixels.
+int cursor_size;
+
+// The point in the image placed at the position given to cursor_move.
+int cursor_hotX, cursor_hotY;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void cursor_init(int size);
+void cursor_clear(int image);
+void cursor_fillRect(int image, int x, int y, int w, int h, int pixel);
+void cursor_setPalette(lcd_color_t colour0, lcd_color_t colour1);
+unsigned long cursor_paletteColour(lcd_color_t colour);
+void cursor_setHotspot(int x, int y);
+void cursor_show(int image);
+void cursor_hide(void);
+void cursor_move(int x, int y);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Hides the cursor and picks its size, one of the CURSOR_SIZE_* constants.
+// Every image is cleared and the hotspot is put in the top left corner. Call
+// after lcd_init.
+void cursor_init(int size)
+{
+    int image, images;
+
+    CURSOR_REGS->CTRL = 0;
+
+    // Only take on new positions between frames, so the cursor never tears.
+    CURSOR_REGS->CFG = fieldVal(CRSR_CFG_SIZE, size)
+        | fieldVal(CRSR_CFG_FRAME_SYNC, 1);
+
+    cursor_size = size == CURSOR_SIZE_64 ? 64 : 32;
+    images = size == CURSOR_SIZE_64 ? CURSOR_IMAGES_64 : CURSOR_IMAGES_32;
+    for (image = 0; image < images; ++image) cursor_clear(image);
+
+    cursor_setHotspot(0, 0);
+}
+
+// Makes every pixel of the given image clear.
+void cursor_clear(int image)
+{
+    int i, words;
+    volatile unsigned long* dest;
+
+    // Two bits a pixel, 16 pixels a word.
+    words = cursor_size * cursor_size / 16;
+    dest = CURSOR_IMAGE + image * words;
+
+    for (i = 0; i < words; ++i) dest[i] = CURSOR_CLEAR_WORD;
+}
+
+// Sets every pixel of an area of the given image to one of the CURSOR_*
+// values. The area is clipped to the image.
+void cursor_fillRect(int image, int x, int y, int w, int h, int pixel)
+{
+    int i, j, bit, x1, y1;
+    volatile unsigned long* dest;
+
+    x1 = min(x + w, cursor_size);
+    y1 = min(y + h, cursor_size);
+    x = max(x, 0);
+    y = max(y, 0);
+
+    dest = CURSOR_IMAGE + image * (cursor_size * cursor_size / 16);
+
+    for (j = y; j < y1; ++j) {
+        for (i = x; i < x1; ++i) {
+            // Bytes run left to right, but within each byte the leftmost
+            // pixel is in the top two bits.
+            bit = (((j * cursor_size + i) >> 2) & 3) * 8 + 6 - 2 * (i & 3);
+            dest[(j * cursor_size + i) >> 4] =
+                (dest[(j * cursor_size + i) >> 4] & ~(3UL << bit))
+                | ((unsigned long) pixel << bit);
+        }
+    }
+}
+
+// Sets the two colours an image can use, given in the same format as the
+// rest of the drawing functions.
+void cursor_setPalette(lcd_color_t colour0, lcd_color_t colour1)
+{
+    CURSOR_REGS->PAL0 = cursor_paletteColour(colour0);
+    CURSOR_REGS->PAL1 = cursor_paletteColour(colour1);
+}
+
+// Converts a 5-6-5 display colour to the 8 bits per channel used by the
+// palette registers, copying the top bits down so white stays white.
+unsigned long cursor_paletteColour(lcd_color_t colour)
+{
+    unsigned long r, g, b;
+
+    r = getBits(colour, 11, 5);
+    g = getBits(colour, 5, 6);
+    b = getBits(colour, 0, 5);
+
+    return fieldVal(CRSR_PAL_RED, (r << 3) | (r >> 2))
+        | fieldVal(CRSR_PAL_GREEN, (g << 2) | (g >> 4))
+        | fieldVal(CRSR_PAL_BLUE, (b << 3) | (b >> 2));
+}
+
+// Sets which point of the image is placed at the position given to
+// cursor_move, such as the tip of an arrow.
+void cursor_setHotspot(int x, int y)
+{
+    cursor_hotX = x;
+    cursor_hotY = y;
+}
+
+// Shows the cursor using the given image, which must be 0 when the cursor
+// is 64x64.
+void cursor_show(int image)
+{
+    CURSOR_REGS->CTRL = fieldVal(CRSR_CTRL_ON, 1)
+        | fieldVal(CRSR_CTRL_NUM, image);
+}
+
+// Hides the cursor, leaving its images and position alone.
+void cursor_hide(void)
+{
+    CURSOR_REGS->CTRL = 0;
+}
+
+// Moves the cursor so its hotspot is at the given point on the display. The
+// cursor may hang off the left or top edge, which is done by clipping away
+// the part of the image that would be off screen.
+void cursor_move(int x, int y)
+{
+    int clipX, clipY;
+
+    x -= cursor_hotX;
+    y -= cursor_hotY;
+
+    clipX = x < 0 ? min(-x, cursor_size - 1) : 0;
+    clipY = y < 0 ? min(-y, cursor_size - 1) : 0;
+
+    CURSOR_REGS->CLIP = fieldVal(CRSR_CLIP_X, clipX)
+        | fieldVal(CRSR_CLIP_Y, clipY);
+    CURSOR_REGS->XY = fieldVal(CRSR_XY_X, max(x, 0))
+        | fieldVal(CRSR_XY_Y, max(y, 0));
+}
+
+#endif
@@ -0,0 +1,44 @@
+/**
+ * File Name  : dac.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Methods to set up the Digital to Analogue Converter output on
+ *              AOUT, and to write 10 bit samples to it.
+ */
+
+#ifndef DAC_H_GUARD
+#define DAC_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "reg.h"
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void dac_init(void);
+void dac_write(int val);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Initialize the Digital to Analogue Converter.
+void dac_init(void)
+{
+    reg_modify(&PINSEL1, fieldMask(PINSEL1_P0_26),
+        fieldVal(PINSEL1_P0_26, PINSEL_AOUT));
+}
+
+// Output a 10 bit sample. Nothing else lives in DACR that we care about, so
+// it is written outright rather than read first.
+void dac_write(int val)
+{
+    DACR = fieldVal(DACR_VALUE, val);
+}
+
+#endif
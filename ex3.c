@@ -16,42 +16,25 @@
 #include <lpc24xx.h>
 #include <lcd_grph.h>
 
+#include "utils.h"
+#include "input.h"
+#include "motor.h"
+#include "fixed.h"
+#include "rng.h"
+#include "sched.h"
+#include "clock.h"
+#include "ramfunc.h"
+#include "prof.h"
+#include "star.h"
+#include "widget.h"
+
 ///////////////////////
 // Const Definitions //
 ///////////////////////
 
-// I'm pretty sure this is the case.
-#define TRUE 1
-#define FALSE 0
-
-// Approximate number of iterations of the delay loop per millisecond.
-#define DELAY_MULT 3000
-
-// According to Wikipedia.
-#define PI 3.14159265358979323846264338327950288419716939937511
-#define E 2.71828182845904523536028747135266249775724709369995
-
-// The number of recorded motor speed keypoints.
-#define KEYPOINT_COUNT 18
-
-// The number of possible buttons that can be pressed.
-#define BUTTON_COUNT 5
-
-// Bit numbers in FIO0PIN for each button.
-#define BUTTON_NONE -1
-#define BUTTON_UP 10
-#define BUTTON_DOWN 11
-#define BUTTON_LEFT 12
-#define BUTTON_RIGHT 13
-#define BUTTON_CENTER 22
-
 // The total number of stars to display.
 #define STAR_COUNT 128
 
-// The distance of the virtual view plane from the camera, which affects the
-// field of view of the scene.
-#define Z_PLANE_DIST 0.75f
-
 // The acceleration / deceleration rate while warping.
 #define BOOST_ACCEL 1.01f
 
@@ -67,87 +50,17 @@
 // The minimum speed the camera is allowed to travel at.
 #define MIN_SPEED 0.00390625f
 
-///////////////////////
-// Macro Definitions //
-///////////////////////
-
-// Produces a binary number with the given number of 1s in a row.
-#define bitMask(c) ((1 << (c)) - 1)
-
-// Isolates and shifts a single bit for easy comparison.
-#define getBit(x, i) (((x) >> (i)) & 1)
-
-// Isolates and shifts a group of bits for easy comparison.
-#define getBits(x, i, c) (((x) >> (i)) & bitMask((c)))
- 
-// Sets a single bit at the specified position to 0.
-#define clrBit(x, i) ((x) & ~(1 << (i)))
-
-// Sets a single bit at the specified position to 1.
-#define setBit(x, i) ((x) | (1 << (i)))
-
-// Sets a single bit at the specified position to whatever.
-#define cpyBit(x, i, v) (clrBit(x, i) | (((v) & 1) << i))
- 
-// Sets a group of bits at the specified position to 0.
-#define clrBits(x, i, c) ((x) & ~(bitMask(c) << (i)))
-
-// Sets a group of bits at the specified position to 1.
-#define setBits(x, i, c) ((x) | (bitMask(c) << (i)))
-
-// Sets a group of bits at the specified position to whatever.
-#define cpyBits(x, i, c, v) (clrBits(x, i, c) | (((v) & bitMask(c)) << (i)))
+// Scheduler ticks between frames, giving roughly 60 frames per second.
+#define FRAME_PERIOD 16
 
-// Compares and gives the smallest of the two inputs.
-#define min(a, b) ((a) <= (b) ? (a) : (b))
-
-// Compares and gives the largest of the two inputs.
-#define max(a, b) ((a) >= (b) ? (a) : (b))
-
-// Gives the absolute value of the input.
-#define abs(a) ((a) < 0 ? -(a) : (a))
-
-//////////////////////
-// Type Definitions //
-//////////////////////
-
-// I'm homesick for C#.
-typedef int bool;
-
-// Contains a frequency / match register 2 value pair from a recorded keypoint.
-typedef struct {
-    double hz;
-    int mr2;
-} motor_KeyPoint;
-
-// Star structure, recording the location of the star in 3D space, and colour.
-typedef struct {
-    float x;
-    float y;
-    float z;
-    int clr;
-} Star;
+// Where the profiler overlay is drawn, clear of the speed bars.
+#define OVERLAY_X 12
+#define OVERLAY_Y 8
 
 ///////////////////////////
 // Function Declarations //
 ///////////////////////////
 
-void srand(int seed);
-int rand(void);
-
-double round(double val);
-double sqrt(double val);
-
-float randFloat(void);
-void wait(int millis);
-
-int motor_findMR2Val(double hz);
-void motor_init(void);
-void motor_setSpeed(double hz);
-
-int input_getButtonPress(void);
-bool input_isKeyDown(int key);
-
 float getSpeedRatio(float speedVal);
 
 void updateMotor(float speed);
@@ -155,160 +68,71 @@ void updateMotor(float speed);
 bool accelerate(float* speed, float accel);
 bool decelerate(float* speed, float accel);
 
-void randomizeStar(Star* star);
+float randFloat(rng_Pool* rng);
 
-void renderStar(Star star, float speed, int colour);
-void renderSpeedBar(int x, int y, int width, int height,
-    float speed, int colour);
+void randomizeStar(Star* star, rng_Pool* rng);
 
-//////////////////////////
-// Function Definitions //
-//////////////////////////
-
-// Returns a random single precision number between 0.0 and 1.0.
-float randFloat(void)
-{
-    return (rand() % 65536) / 65536.0f;
-}
-
-// Blocks execution for approximately the given number of milliseconds.
-void wait(int millis)
-{
-    volatile int i = 0;
-    for (i = 0; i < millis * DELAY_MULT; ++i);
-}
-
-// For a given frequency (in hertz), find the corresponding value for the MR2
-// register that would produce (approximately) that motor speed.
-int motor_findMR2Val(double hz) {
-    int i; motor_KeyPoint curr, prev; double t;
-
-    // List of all recorded keypoints in order of frequency.
-    const motor_KeyPoint _keyPoints[KEYPOINT_COUNT] = {
-        { 0.000000000,     0 },
-        { 39.68253968,  5000 },
-        { 50.00000000,  6000 },
-        { 60.24096386,  7000 },
-        { 63.69426752,  7500 },
-        { 66.66666667,  8000 },
-        { 72.99270073,  9000 },
-        { 75.18796992, 10000 },
-        { 84.45945946, 12000 },
-        { 90.57971014, 15000 },
-        { 98.03921569, 18000 },
-        { 98.42519685, 20000 },
-        { 104.1666667, 22500 },
-        { 106.3829787, 25000 },
-        { 108.6956522, 27500 },
-        { 109.6491228, 30000 },
-        { 112.6126126, 35000 },
-        { 115.7407407, 40000 }
-    };
-
-    // Record the previous keypoint (starting with the first) to be used when
-    // interpolating the final MR2 value.
-    prev = _keyPoints[0];
-
-    // Loop through each keypoint after the first until one with a frequency
-    // greater than the desired value is found.
-    for (i = 1; i < KEYPOINT_COUNT; ++i) {
-        curr = _keyPoints[i];
-
-        // If this keypoint exceeds the desired frequency, find an interpolated
-        // MR2 between this keypoint and the previous one.
-        if (curr.hz >= hz) {
-            t = (hz - prev.hz) / (curr.hz - prev.hz);
-            return (int) round(t * curr.mr2 + (1.0 - t) * prev.mr2);
-        }
-
-        // Record the current keypoint to be used as the previous one next
-        // iteration.
-        prev = curr;
-    }
-
-    return _keyPoints[KEYPOINT_COUNT - 1].mr2;
-}
-
-// Set up the various motor registers and stuff.
-void motor_init(void)
-{
-    // Apparently this enables PWM output on P1.3 or something.
-    PINSEL2 = setBits(PINSEL2, 6, 2);
+void initSpeedBar(widget_Bar* bar, int x, int y, int width, int height);
+void renderSpeedBar(widget_Bar* bar, float speed, int colour);
+void renderStar(Star star, float speed, int colour);
 
-    // This tells the PWM unit to control something or other.
-    PWM0PCR = setBit(PWM0PCR, 10);
+void frameTask(void);
+void hudTask(void);
 
-    // Use 40k for the pulse period counter.
-    PWM0MR0 = 40000;
+//////////////////////
+// Global Variables //
+//////////////////////
 
-    // Don't start the motor just yet.
-    PWM0MR2 = 0;
+// Array of all existing stars.
+Star stars[STAR_COUNT];
 
-    // Start the PWM unit.
-    PWM0TCR = setBit(setBit(0, 0), 3);
-}
+// Records whether warp / warp effect is active.
+bool warping = FALSE;
 
-// Set the motor to spin at a specified speed in revolutions per second.
-void motor_setSpeed(double hz)
-{
-    PWM0MR2 = motor_findMR2Val(hz);
+// Records whether warp is currently accelerating or decelerating.
+bool accelerating = TRUE;
 
-    // Update next cycle
-    PWM0LER = 1 << 2;
-}
+// The number of frames the camera has been warping at full speed for.
+int warpFrames = 0;
 
-// Checks to see if a button has been pressed since the last time this function
-// was called, and returns that button's ID if one has. If no button has been
-// pressed, returns BUTTON_NONE.
-int input_getButtonPress(void)
-{
-    int i, curr, diff;
-
-    // Record the previous state of ~FIO0PIN between invocations.
-    static int prev = 0;
-
-    // List of button IDs to loop through.
-    const int buttons[BUTTON_COUNT] = {
-        BUTTON_UP,
-        BUTTON_DOWN,
-        BUTTON_LEFT,
-        BUTTON_RIGHT,
-        BUTTON_CENTER
-    };
+// The current speed of the camera.
+float cameraSpeed = MIN_SPEED;
 
-    // Why on earth does FIO0PIN use a 0 to signify a button being pressed?
-    curr = ~FIO0PIN;
+// Lateral camera speed.
+float strafeSpeed = 0.0f;
 
-    // Find the buttons that have been pressed since last invocation.
-    diff = (curr ^ prev) & curr;
+// An interpolated version of the camera speed for the HUD bars.
+float smoothSpeed = MIN_SPEED;
 
-    // Remember the current button state for next time.
-    prev = curr;
+// The speed bars on either side of the display, which only repaint the part
+// that changed since the last frame.
+widget_Bar leftBar, rightBar;
 
-    // Find the first button that has just been pressed and return it.
-    for (i = 0; i < BUTTON_COUNT; ++i) {
-        if (getBit(diff, buttons[i])) return buttons[i];
-    }
+// Random numbers used when respawning stars.
+rng_Pool starRng;
 
-    // Otherwise, nothing new has been pressed.
-    return BUTTON_NONE;
-}
+// Profiler zones.
+int inputZone, hudZone;
 
-// Checks to see if the specified button is currently pressed.
-bool input_isKeyDown(int button)
-{
-    return getBit(~FIO0PIN, button);
-}
+//////////////////////////
+// Function Definitions //
+//////////////////////////
 
 // Converts the given speed into a value from 0.0 to 1.0, where 0.0 is
 // MIN_SPEED and 1.0 is MAX_SPEED. Assumes the given speed is within those
 // two bounds.
 float getSpeedRatio(float speedVal)
 {
-	return (float) sqrt((speedVal - MIN_SPEED) / (MAX_SPEED - MIN_SPEED));
+    fixed ratio;
+
+    ratio = fixed_fromFloat((speedVal - MIN_SPEED)
+        * (1.0f / (MAX_SPEED - MIN_SPEED)));
+
+    return fixed_toFloat(fixed_sqrt(ratio));
 }
 
-// Sets the speed of the motor to reflect the current camera speed.
+// Posts a new motor target to reflect the current camera speed. The motor
+// eases towards it from the PWM interrupt, so this never holds up the frame.
 void updateMotor(float speed)
 {
     float ratio;
@@ -316,9 +140,9 @@ void updateMotor(float speed)
     ratio = getSpeedRatio(speed);
 
     if (ratio == 0.0f) {
-        motor_setSpeed(0.0);
+        motor_setTarget(0.0, MOTOR_RAMP_EXPONENTIAL);
     } else {
-        motor_setSpeed(ratio * 100.0 + 20.0);
+        motor_setTarget(ratio * 100.0 + 20.0, MOTOR_RAMP_EXPONENTIAL);
     }
 }
 
@@ -358,10 +182,19 @@ bool decelerate(float* speed, float accel)
     return FALSE;
 }
 
+// Returns a random single precision number between 0.0 and 1.0, taken from
+// the given pool.
+float randFloat(rng_Pool* rng)
+{
+    return fixed_toFloat((fixed) (rng_poolNext(rng) >> (32 - FIXED_SHIFT)));
+}
+
 // Sets the X and Y components of a given star's position to random values
-// between -0.5 and 0.5.
-void randomizeStar(Star* star)
+// between -0.5 and 0.5, and picks a random colour biased towards white.
+void randomizeStar(Star* star, rng_Pool* rng)
 {
+    unsigned int a, b;
+
     const int colours[4] = {
         WHITE,
         LIGHT_GRAY,
@@ -369,217 +202,218 @@ void randomizeStar(Star* star)
         YELLOW
     };
 
-    star->x = randFloat() - 0.5f;
-    star->y = randFloat() - 0.5f;
-    star->clr = colours[(int) (randFloat() * randFloat() * 4)];
-}
+    star->x = randFloat(rng) - 0.5f;
+    star->y = randFloat(rng) - 0.5f;
 
-// Projects a given star in 3D, and draws it to the screen. The star is drawn
-// as a line, with a length proportional to the camera speed to give the
-// illusion of non-instantaneous camera exposure. Draws the star in the
-// provided colour.
-void renderStar(Star star, float speed, int colour)
-{
-    float mn, mf; int xn, yn, xf, yf;
-
-    // Don't draw a star if it is behind the camera! This should never occur
-    // anyway, since we push them back when they pass the camera.
-    if (star.z <= 0.0f) return;
-
-    // Work out the perspective multipliers for the near and far points of the
-    // line we will draw for the star. Also ensures that we don't draw nothing
-    // if the camera is stopped.
-    mn = Z_PLANE_DIST / star.z;
-    mf = Z_PLANE_DIST / (star.z + max(speed * 2.0f, MIN_SPEED));
-
-    // Make sure the line doesn't go off screen because apparently that crashes
-    // the program occasionally.
-    mn = min(mn, 0.5f / abs(star.x));
-    mn = min(mn, 0.5f / abs(star.y));
-
-    // Using the perspective multipliers, calculate the two (X, Y) coordinate
-    // pairs for the star's line. Positions the line to be relative to the
-    // centre of the screen, and stretches it.
-    xn = (int) ((star.x * mn + 0.5f) * DISPLAY_WIDTH);
-    yn = (int) ((star.y * mn + 0.5f) * DISPLAY_HEIGHT);
-    xf = (int) ((star.x * mf + 0.5f) * DISPLAY_WIDTH);
-    yf = (int) ((star.y * mf + 0.5f) * DISPLAY_HEIGHT);
-
-    // If the line isn't completely off-screen, draw it.
-    if (xf >= 0 && xf < DISPLAY_WIDTH && yf >= 0 && yf < DISPLAY_HEIGHT) {
-        lcd_line(xn, yn, xf, yf, colour);
-    }
+    // Multiply two 16 bit fractions and keep the top two bits of the product,
+    // giving an index from 0 to 3.
+    a = rng_poolNext(rng) >> 16;
+    b = rng_poolNext(rng) >> 16;
+    star->clr = colours[(a * b) >> 30];
 }
 
-// Draw a box with a certain percentage filled up that represents the current
-// camera speed at the given position, and with the given size.
-void renderSpeedBar(int x, int y, int width, int height,
-    float speed, int colour)
+// Sets up a bar at the given position and with the given size, to be filled
+// from the bottom as the camera speeds up.
+void initSpeedBar(widget_Bar* bar, int x, int y, int width, int height)
 {
-	float ratio; int filled;
-
-    // Find how much of the box to fill.
-	ratio = 1.0f - getSpeedRatio(speed);
-    filled = (int) round(ratio * (height - 2));
+    Rect rect;
 
-    // Draw a white outline around the bar.
-    lcd_drawRect(x, y, x + width, y + height, colour);
-
-    // If the bar isn't full, draw a black box to erase any part of the bar
-    // left from last frame that shouldn't be there.
-    if (filled > 0) {
-        lcd_fillRect(x + 2, y + 2, x + width - 2, y + filled, BLACK);
-    }
+    rect.pos.x = x;
+    rect.pos.y = y;
+    rect.size.width = width + 1;
+    rect.size.height = height + 1;
 
-    // If the bar isn't empty, draw a white box for the bar.
-    if (filled < height - 3) {
-        lcd_fillRect(x + 2, y + 2 + filled,
-            x + width - 2, y + height - 2, colour);
-    }
+    widget_initBar(bar, rect, WIDGET_FILL_UP, TRUE, WHITE, BLACK);
 }
 
-// Entry point, containing initialization and the main draw / update loop.
-int main(void)
+// Fill a bar in proportion to the current camera speed, in the given colour.
+void renderSpeedBar(widget_Bar* bar, float speed, int colour)
 {
-    int i;
+    widget_setBarColour(bar, colour);
+    widget_setBar(bar, fixed_fromFloat(getSpeedRatio(speed)), FIXED_ONE);
+    widget_drawBar(bar);
+}
 
-    // Array of all existing stars.
-    Star stars[STAR_COUNT];
+// Draws a star, and notes that the speed bars need repairing wherever it
+// was drawn over them.
+void renderStar(Star star, float speed, int colour)
+{
+    star_render(star, speed, colour);
 
-    // Records whether warp / warp effect is active.
-    bool warping = FALSE;
+    widget_damageBar(&leftBar, star_lastLine);
+    widget_damageBar(&rightBar, star_lastLine);
+}
 
-    // Records whether warp is currently accelerating or decelerating.
-    bool accelerating = TRUE;
+// Handles input, moves the camera, and redraws the stars.
+void frameTask(void)
+{
+    static int frame = 0;
 
-    // The number of frames the camera has been warping at full speed for.
-    int warpFrames = 0;
+    int i;
 
-    // The current speed of the camera.
-    float speed = MIN_SPEED;
+    TRACE(TRACE_FRAME, 0, frame++);
 
-    // Lateral camera speed.
-    float strafeSpeed = 0.0f;
+    // Erase all the stars from the sky. I'm assuming it's faster to do
+    // this than do lcd_fillScreen(BLACK).
+    for (i = 0; i < STAR_COUNT; ++i) {
+        renderStar(stars[i], cameraSpeed, BLACK);
+    }
 
-    // An interpolated version of the camera speed for the HUD bars.
-    float smoothSpeed = MIN_SPEED;
+    PROF_BEGIN(inputZone);
 
-    // Seed the RNG with a carefully constructed non-arbitrary number.
-    srand(0x3ae14c92);
+    // Left and right together toggle the profiler overlay. Wipe the screen
+    // when it goes away, and the stars will be drawn back next frame.
+    if (prof_pollHotkey() && !prof_showing) {
+        lcd_fillScreen(BLACK);
+        widget_invalidateBar(&leftBar);
+        widget_invalidateBar(&rightBar);
+    }
 
-    // Prepare the LCD display and motor for use.
-    lcd_init();
-    motor_init();
+    strafeSpeed *= 0.95f;
 
-    // Make sure the motor is going at the initial speed.
-    updateMotor(speed);
+    // Strafe left when left button is pressed.
+    if (input_isKeyDown(BUTTON_LEFT)) {
+        strafeSpeed -= 0.001f;
+    }
 
-    // Give each star a random starting position.
-    for (i = 0; i < STAR_COUNT; ++i) {
-        randomizeStar(&stars[i]);
-        stars[i].z = randFloat();
+    // Likewise, but for strafing right.
+    if (input_isKeyDown(BUTTON_RIGHT)) {
+        strafeSpeed += 0.001f;
+    }
+        
+    // If the centre key has been pressed, toggle warping.
+    if (input_getButtonPress() == BUTTON_CENTER) {
+        warping = !warping;
     }
 
-    // Main loop.
-    for (;;) {
-        // Erase all the stars from the sky. I'm assuming it's faster to do
-        // this than do lcd_fillScreen(BLACK).
-        for (i = 0; i < STAR_COUNT; ++i) {
-            renderStar(stars[i], speed, BLACK);
+    // If we aren't currently warping, accept button press inputs.
+    if (!warping) {
+        // Accelerate when pressing up.
+        if (input_isKeyDown(BUTTON_UP)) {
+            accelerate(&cameraSpeed, MANUAL_ACCEL);
         }
 
-        strafeSpeed *= 0.95f;
-
-        // Strafe left when left button is pressed.
-        if (input_isKeyDown(BUTTON_LEFT)) {
-            strafeSpeed -= 0.001f;
+        // Decelerate when pressing down.
+        if (input_isKeyDown(BUTTON_DOWN)) {
+            decelerate(&cameraSpeed, MANUAL_ACCEL);
         }
 
-        // Likewise, but for strafing right.
-        if (input_isKeyDown(BUTTON_RIGHT)) {
-            strafeSpeed += 0.001f;
+    // Otherwise, if we are in the acceleration phase of warping, speed up
+    // the camera until it is at maximum speed.
+    } else if (accelerating && accelerate(&cameraSpeed, BOOST_ACCEL)) {
+
+        // When we've been at maximum speed for the given duration, start
+        // to decelerate.
+        if (++warpFrames >= BOOST_FRAMES) {
+            warpFrames = 0;
+            accelerating = FALSE;
         }
-            
-        // If the centre key has been pressed, toggle warping.
-        if (input_getButtonPress() == BUTTON_CENTER) {
-            warping = !warping;
+
+    // Otherwise, if we are in the deceleration phase of warping, slow down
+    // the camera until it is at minimum speed.
+    } else if (!accelerating && decelerate(&cameraSpeed, BOOST_ACCEL)) {
+        
+        // When we've been at minimum speed for the given duration, start
+        // to accelerate.
+        if (++warpFrames >= BOOST_FRAMES) {
+            warpFrames = 0;
+            accelerating = TRUE;
         }
+    }
+
+    PROF_END(inputZone);
 
-        // If we aren't currently warping, accept button press inputs.
-        if (!warping) {
-            // Accelerate when pressing up.
-            if (input_isKeyDown(BUTTON_UP)) {
-                accelerate(&speed, MANUAL_ACCEL);
-            }
-
-            // Decelerate when pressing down.
-            if (input_isKeyDown(BUTTON_DOWN)) {
-                decelerate(&speed, MANUAL_ACCEL);
-            }
-
-        // Otherwise, if we are in the acceleration phase of warping, speed up
-        // the camera until it is at maximum speed.
-        } else if (accelerating && accelerate(&speed, BOOST_ACCEL)) {
-
-            // When we've been at maximum speed for the given duration, start
-            // to decelerate.
-            if (++warpFrames >= BOOST_FRAMES) {
-                warpFrames = 0;
-                accelerating = FALSE;
-            }
-
-        // Otherwise, if we are in the deceleration phase of warping, slow down
-        // the camera until it is at minimum speed.
-        } else if (!accelerating && decelerate(&speed, BOOST_ACCEL)) {
-            
-            // When we've been at minimum speed for the given duration, start
-            // to accelerate.
-            if (++warpFrames >= BOOST_FRAMES) {
-                warpFrames = 0;
-                accelerating = TRUE;
-            }
+    // Now loop through each star again, to update their positions and draw
+    // them to the display.
+    for (i = 0; i < STAR_COUNT; ++i) {
+        stars[i].z -= cameraSpeed;
+        stars[i].x -= strafeSpeed;
+
+        // If the star is too far to the left, move it right.
+        if (stars[i].x < -0.5f) {
+            stars[i].x += 1.0f;
+        } 
+
+        // If the star is too far to the right, move it left.
+        if (stars[i].x >= 0.5f) {
+            stars[i].x -= 1.0f;
         }
 
-        // Now loop through each star again, to update their positions and draw
-        // them to the display.
-        for (i = 0; i < STAR_COUNT; ++i) {
-            stars[i].z -= speed;
-            stars[i].x -= strafeSpeed;
-
-            // If the star is too far to the left, move it right.
-            if (stars[i].x < -0.5f) {
-                stars[i].x += 1.0f;
-            } 
-
-            // If the star is too far to the right, move it left.
-            if (stars[i].x >= 0.5f) {
-                stars[i].x -= 1.0f;
-            }
-
-            // If the star is behind the camera, push it to the back of the
-            // scene and randomize its X and Y position.
-            if (stars[i].z <= 0.0f) {
-                stars[i].z = 1.0f;
-                randomizeStar(&stars[i]);
-            }
-
-            // Draw the star in white.
-            renderStar(stars[i], speed, stars[i].clr);
+        // If the star is behind the camera, push it to the back of the
+        // scene and randomize its X and Y position.
+        if (stars[i].z <= 0.0f) {
+            stars[i].z = 1.0f;
+            randomizeStar(&stars[i], &starRng);
         }
 
-        // Ease smoothSpeed towards the current value of speed.
-        smoothSpeed += (speed - smoothSpeed) * 0.1f;
+        // Draw the star in white.
+        renderStar(stars[i], cameraSpeed, stars[i].clr);
+    }
+}
+
+// Eases the HUD towards the current camera speed and redraws it. Runs after
+// each frame, since it has a lower priority than frameTask.
+void hudTask(void)
+{
+    PROF_BEGIN(hudZone);
+
+    // Ease smoothSpeed towards the current value of speed.
+    smoothSpeed += (cameraSpeed - smoothSpeed) * 0.1f;
 
-        // Draw the speed bar things on either side of the display.
-        renderSpeedBar(4, 4, 6, DISPLAY_HEIGHT - 8,
-            smoothSpeed, warping ? YELLOW : WHITE);
-        renderSpeedBar(DISPLAY_WIDTH - 10, 4, 6, DISPLAY_HEIGHT - 8,
-            smoothSpeed, warping ? YELLOW : WHITE);
+    // Draw the speed bar things on either side of the display.
+    renderSpeedBar(&leftBar, smoothSpeed, warping ? YELLOW : WHITE);
+    renderSpeedBar(&rightBar, smoothSpeed, warping ? YELLOW : WHITE);
 
-        // I think we have some time to spare.
-        wait(16);
+    PROF_END(hudZone);
+}
+
+// Entry point, containing initialization. The draw / update loop is run by
+// the scheduler.
+int main(void)
+{
+    int i;
+
+    // Run at full speed, with the star renderer in SRAM.
+    clock_init();
+    ramfunc_init();
+
+    // Seed the RNG with a carefully constructed non-arbitrary number, unless
+    // a recorded session is being replayed with its own.
+    rng_poolSeed(&starRng, replay_init(0x3ae14c92));
+
+    // Prepare the LCD display and motor for use.
+    lcd_init();
+    motor_init();
+
+    // Time the interesting parts of each frame.
+    prof_init(OVERLAY_X, OVERLAY_Y);
+    star_projectZone = prof_addZone("proj");
+    star_drawZone = prof_addZone("draw");
+    inputZone = prof_addZone("input");
+    hudZone = prof_addZone("hud");
+
+    // Put a speed bar on either side of the display.
+    initSpeedBar(&leftBar, 4, 4, 6, DISPLAY_HEIGHT - 8);
+    initSpeedBar(&rightBar, DISPLAY_WIDTH - 10, 4, 6, DISPLAY_HEIGHT - 8);
+
+    // Make sure the motor is going at the initial speed.
+    updateMotor(cameraSpeed);
+
+    // Give each star a random starting position.
+    for (i = 0; i < STAR_COUNT; ++i) {
+        randomizeStar(&stars[i], &starRng);
+        stars[i].z = randFloat(&starRng);
     }
 
+    // Frames now run at a fixed rate rather than with a guessed delay
+    // between them.
+    sched_init();
+    sched_addTask("frame", frameTask, 1, FRAME_PERIOD);
+    sched_addTask("hud", hudTask, 2, FRAME_PERIOD);
+    sched_addTask("prof", prof_overlayTask, 3, PROF_OVERLAY_PERIOD);
+
+    sched_run();
+
     // This should never happen.
     return (int) (1.0 / 0.0);
 }
@@ -2,274 +2,520 @@
 #include "utils.h"
 #include "lcd.h"
 #include "input.h"
-
-#define WAVE_TRIANGLE 0
-#define WAVE_SQUARE 1
-#define WAVE_SINE 2
-#define WAVE_LAST 2
+#include "fixed.h"
+#include "dac.h"
+#include "adc.h"
+#include "timer.h"
+#include "sched.h"
+#include "pt.h"
+#include "mem.h"
+#include "clock.h"
+#include "ramfunc.h"
+#include "prof.h"
+#include "wave.h"
+#include "widget.h"
+#include "pitch.h"
 
 #define ELEM_NONE 0
 #define ELEM_WAVEFORM 1
 #define ELEM_KEYBOARD 2
 #define ELEM_BOTH (ELEM_WAVEFORM | ELEM_KEYBOARD)
 
-#define KEY_WHITE 0
-#define KEY_BLACK 1
-
-#define KEY_WHITE_WIDTH 120
-#define KEY_WHITE_HEIGHT 20
-#define KEY_BLACK_WIDTH 80
-#define KEY_BLACK_HEIGHT 10
+#define SYNTH_SAMPLE_RATE 44100
 
-#define NOTE_C 0
-#define NOTE_C_SHARP 1
-#define NOTE_D 2
-#define NOTE_D_SHARP 3
-#define NOTE_E 4
-#define NOTE_F 5
-#define NOTE_F_SHARP 6
-#define NOTE_G 7
-#define NOTE_G_SHARP 8
-#define NOTE_A 9
-#define NOTE_A_SHARP 10
-#define NOTE_B 11
+// What the sample clock interrupt is doing. The centre button steps through
+// them in order.
+#define MODE_PLAYING 0
+#define MODE_SILENT 1
+#define MODE_TUNING 2
+#define MODE_LAST 2
 
-#define OCTAVE_MIN 0
-#define OCTAVE_MAX 7
+// One table being played and one being built to replace it. Without
+// external memory there's only room in internal RAM for one, which is
+// rebuilt in place.
+#ifdef EXTMEM
+#define WAVE_POOL_BLOCKS 2
+#else
+#define WAVE_POOL_BLOCKS 1
+#endif
 
-double sin(double theta);
+// Scheduler ticks between checks for enough input to analyse, while tuning.
+#define TUNER_PERIOD 5
 
-void* malloc(int size);
-void* realloc(void* ptr, int size);
-void free(void* ptr);
+#define WAVE_ROWS_PER_SLICE 32
 
-int getWaveFormLength(int hz);
-int getHertz(int octave, int note);
+#define OVERLAY_X 4
+#define OVERLAY_Y 4
 
-int buildWaveForm(short** dest, int type, int octave, int note);
+typedef struct {
+	pt_Thread pt;
+	int x, y, w, h, octave, length, i, l, count;
+	short* waveForm;
+} WaveDraw;
 
-void drawWaveForm(int x, int y, int w, int h, int octave, short* waveForm, int length);
-void drawKeyboard(int x, int y, int curNote);
-void drawNoteText(int x, int y, int w, int h, int octave, int note);
+void startDrawWaveForm(WaveDraw* draw, int x, int y, int w, int h, int octave, short* waveForm, int length);
+int drawWaveForm(WaveDraw* draw);
+void initKeyboard(int x, int y, int w, int h);
+void invalidateKeyboard(void);
+void drawKeyboard(int octave, int note);
 
 void redraw(short* waveForm, int length, int octave, int note, int elems);
 
-int getWaveFormLength(int hz) {
-	return 266980 / hz;
-}
+bool changeWaveForm(void);
+void setMode(int next);
+void formatCents(char* dest, int cents);
 
-int getHertz(int octave, int note) {
-	const int notes[12] = {
-		2093, // NOTE_C
-		2217, // NOTE_C_SHARP
-		2349, // NOTE_D
-		2489, // NOTE_D_SHARP
-		2637, // NOTE_E
-		2794, // NOTE_F
-		2960, // NOTE_F_SHARP
-		3136, // NOTE_G
-		3322, // NOTE_G_SHARP
-		3520, // NOTE_A
-		3729, // NOTE_A_SHARP
-		3951  // NOTE_B
-	};
+void synthIsr(void) __attribute__((interrupt("IRQ"))) RAMFUNC;
+void inputTask(void);
+void uiTask(void);
+void tunerTask(void);
 
-	return notes[note] >> (7 - octave);
-}
+// Shared with synthIsr, which steps through the waveform in Q16 increments
+// so the pitch is right even though the table length is rounded.
+short* volatile synthWave;
+volatile int synthLength;
+volatile unsigned int phaseStep;
+volatile int mode;
 
-int buildWaveForm(short** dest, int type, int octave, int note) {
-	int length, hz, i; double t, v;
+int synthOctave, synthNote, synthType;
 
-	v = 0.0;
+// Waveform tables come from a fixed pool rather than the heap, so changing
+// note takes the same time however long the synth has been running.
+char waveStore[memPoolBytes(WAVE_MAX_LENGTH * sizeof(short),
+	WAVE_POOL_BLOCKS)] MEM_ATTR_ALIGNED;
+mem_Pool wavePool;
 
-	hz = getHertz(octave, note);
-	length = getWaveFormLength(hz);
+// Parts of the display waiting to be redrawn by uiTask.
+volatile int pendingElems;
+int uiTaskId;
 
-	if (*dest == NULL) {
-		*dest = (short*) malloc(length * sizeof(short));
-	} else {
-		*dest = (short*) realloc(*dest, length * sizeof(short));
-	}
+// The waveform display is drawn a slice at a time by uiTask.
+WaveDraw waveDraw;
+bool waveDrawing;
 
-	for (i = 0; i < length; ++i) {
-		t = (double) i / (double) length;
-		switch (type) {
-			case WAVE_SQUARE:
-				v = t < 0.5 ? 0.0 : 1.0;
-				break;
-			case WAVE_TRIANGLE:
-				v = t < 0.5 ? t * 2.0 : 2.0 - t * 2.0;
-				break;
-			case WAVE_SINE:
-				v = sin(t * PI * 2.0) * 0.5 + 0.5;
-				break;
-		}
-
-		(*dest)[i] = (short) (v * 512.0) & 0x3ff;
-	}
+// The keyboard and the note under it only repaint what changes.
+widget_Keyboard keyboard;
+widget_Label noteLabel, octaveLabel, centsLabel;
+
+// Fed from synthIsr while tuning, and analysed a slice at a time by
+// tunerTask, which leaves the note it last heard for uiTask to show.
+pitch_Detector tuner;
+int tunerTaskId;
+int tunerOctave, tunerNote;
+char tunerText[WIDGET_LABEL_LENGTH + 1];
+
+int inputZone, buildZone, drawZone, dacZone, latencyZone, pitchZone;
 
-	return length;
+void startDrawWaveForm(WaveDraw* draw, int x, int y, int w, int h, int octave, short* waveForm, int length)
+{
+	PT_INIT(&draw->pt);
+
+	draw->x = x;
+	draw->y = y;
+	draw->w = w;
+	draw->h = h;
+	draw->octave = octave;
+	draw->waveForm = waveForm;
+	draw->length = length;
+	draw->count = 0;
 }
 
-void drawWaveForm(int x, int y, int w, int h, int octave, short* waveForm, int length)
+// Draws the next WAVE_ROWS_PER_SLICE rows of the waveform, returning PT_ENDED
+// once it is complete.
+int drawWaveForm(WaveDraw* draw)
 {
-	int i, p, c, l;
+	int p, c;
+
+	PT_BEGIN(&draw->pt);
+
+	lcd_fillRect(draw->x, draw->y, draw->x + draw->w, draw->y + draw->h, BLACK);
+	lcd_drawRect(draw->x - 1, draw->y - 1, draw->x + draw->w + 1, draw->y + draw->h + 1, WHITE);
 
-	lcd_fillRect(x, y, x + w, y + h, BLACK);
-	lcd_drawRect(x - 1, y - 1, x + w + 1, y + h + 1, WHITE);
+	draw->l = (draw->waveForm[0] * (draw->w - 8)) / 0x200;
+	for (draw->i = 1; draw->i < draw->h; ++draw->i) {
+		p = (draw->i * (1 << (8 - draw->octave))) % draw->length;
+		c = (draw->waveForm[p] * (draw->w - 8)) / 0x200;
+		lcd_line(draw->x + draw->l + 4, draw->y + draw->i - 1, draw->x + c + 4, draw->y + draw->i, RED);
+		draw->l = c;
 
-	l = (waveForm[0] * (w - 8)) / 0x200;
-	for (i = 1; i < h; ++ i) {
-		p = (i * (1 << (8 - octave))) % length;
-		c = (waveForm[p] * (w - 8)) / 0x200;
-		lcd_line(x + l + 4, y + i - 1, x + c + 4, y + i, RED);
-		l = c;
+		PT_YIELD_EVERY(&draw->pt, draw->count, WAVE_ROWS_PER_SLICE);
 	}
+
+	PT_END(&draw->pt);
 }
 
-void drawKeyboard(int x, int y, int curNote)
+// Sets up the keyboard at the top right, with the note, octave and tuner
+// text in the given area below it.
+void initKeyboard(int x, int y, int w, int h)
 {
-	int xPos, yPos, key;
-
-	const bool keyTypes[] = {
-		KEY_WHITE,
-		KEY_BLACK,
-		KEY_WHITE,
-		KEY_BLACK,
-		KEY_WHITE,
-		KEY_WHITE,
-		KEY_BLACK,
-		KEY_WHITE,
-		KEY_BLACK,
-		KEY_WHITE,
-		KEY_BLACK,
-		KEY_WHITE
-	};
+	Point pos; Rect rect;
 
-	xPos = x;
-	yPos = y;
-	for (key = NOTE_C; key <= NOTE_B; ++key) {
-		if (keyTypes[key] == KEY_BLACK) continue;
+	pos.x = x;
+	pos.y = 8;
+	widget_initKeyboard(&keyboard, pos, NOTE_C);
 
-		lcd_fillRect(xPos, yPos + 1, xPos + KEY_WHITE_WIDTH - 1,
-			yPos + KEY_WHITE_HEIGHT - 1, key == curNote ? RED : WHITE);
+	rect.pos.x = x;
+	rect.pos.y = y;
+	rect.size.width = w;
+	rect.size.height = h / 3;
+	widget_initLabel(&noteLabel, rect, FALSE);
 
-		yPos += KEY_WHITE_HEIGHT;
-	}
+	rect.pos.y += h / 3;
+	widget_initLabel(&octaveLabel, rect, FALSE);
 
-	xPos = x + KEY_WHITE_WIDTH - KEY_BLACK_WIDTH;
-	yPos = y - (KEY_BLACK_HEIGHT >> 1);
-	for (key = NOTE_C; key <= NOTE_B; ++key) {
-		if (keyTypes[key] == KEY_WHITE) {
-			yPos += KEY_WHITE_HEIGHT;
-			continue;
-		}
+	rect.pos.y += h / 3;
+	widget_initLabel(&centsLabel, rect, FALSE);
+}
 
-		lcd_fillRect(xPos, yPos, xPos + KEY_BLACK_WIDTH, yPos + KEY_BLACK_HEIGHT,
-			key == curNote ? RED : BLACK);
-	}
+// Has the keyboard and text painted in full next time, after something has
+// been drawn over them.
+void invalidateKeyboard(void)
+{
+	widget_invalidateKeyboard(&keyboard);
+	widget_invalidateLabel(&noteLabel);
+	widget_invalidateLabel(&octaveLabel);
+	widget_invalidateLabel(&centsLabel);
 }
 
-void drawNoteText(int x, int y, int w, int h, int octave, int note)
+void drawKeyboard(int octave, int note)
 {
 	static char* noteStrs[] = {
-		" C ",
-		" C# ",
-		" D ",
-		" D# ",
-		" E ",
-		" F ",
-		" F# ",
-		" G ",
-		" G# ",
-		" A ",
-		" A# ",
-		" B "
+		"C",
+		"C#",
+		"D",
+		"D#",
+		"E",
+		"F",
+		"F#",
+		"G",
+		"G#",
+		"A",
+		"A#",
+		"B"
 	};
 
 	char octStr[2] = { (char) (48 + octave), '\0' };
 
-	lcd_putStringCentered(x, y, w, h / 2, noteStrs[note]);
-	lcd_putStringCentered(x, y + h / 2, w, h / 2, octStr);
+	widget_setKeyboard(&keyboard, note);
+	widget_drawKeyboard(&keyboard);
+
+	widget_setLabel(&noteLabel, noteStrs[note]);
+	widget_drawLabel(&noteLabel);
+
+	widget_setLabel(&octaveLabel, octStr);
+	widget_drawLabel(&octaveLabel);
 }
 
 void redraw(short* waveForm, int length, int octave, int note, int elems)
 {
 	if (elems & ELEM_WAVEFORM) {
-		drawWaveForm(4, 4, DISPLAY_WIDTH - 24 - KEY_WHITE_WIDTH,
+		startDrawWaveForm(&waveDraw, 4, 4, DISPLAY_WIDTH - 24 - WIDGET_KEY_WHITE_WIDTH,
 			DISPLAY_HEIGHT - 8, octave, waveForm, length);
+		waveDrawing = TRUE;
 	}
 
+	// While tuning, the keyboard shows the note heard rather than the one
+	// being played.
 	if (elems & ELEM_KEYBOARD) {
-		drawKeyboard(DISPLAY_WIDTH - 8 - KEY_WHITE_WIDTH, 8, note);
-		drawNoteText(DISPLAY_WIDTH - 8 - KEY_WHITE_WIDTH, DISPLAY_HEIGHT / 2 - 4,
-			KEY_WHITE_WIDTH, DISPLAY_HEIGHT / 2 - 8, octave, note);
+		if (mode == MODE_TUNING) drawKeyboard(tunerOctave, tunerNote);
+		else drawKeyboard(octave, note);
+
+		widget_setLabel(&centsLabel, mode == MODE_TUNING ? tunerText : "");
+		widget_drawLabel(&centsLabel);
+	}
+}
+
+// Builds the waveform for the current settings and swaps it in for the one
+// being played. Returns FALSE, leaving the old waveform playing, if the pool
+// has no table free to build it in.
+bool changeWaveForm(void)
+{
+	short *next, *prev; int length, hz;
+
+	next = (short*) mem_poolAlloc(&wavePool);
+
+#ifndef EXTMEM
+	// The only table is the one being played, so hold off the sample clock
+	// and rebuild it in place, with the output muted until it's done.
+	if (next == NULL && synthWave != NULL) {
+		vic_disable(VIC_CHANNEL_TIMER1);
+		dac_write(0x100);
+		next = synthWave;
 	}
+#endif
+
+	if (next == NULL) return FALSE;
+
+	PROF_BEGIN(buildZone);
+	length = wave_build(next, synthType, synthOctave, synthNote);
+	PROF_END(buildZone);
+	hz = wave_getHertz(synthOctave, synthNote);
+
+	vic_disable(VIC_CHANNEL_TIMER1);
+
+	prev = synthWave;
+	synthWave = next;
+	synthLength = length;
+	phaseStep = (unsigned int) ((((long long) length * hz) << FIXED_SHIFT)
+		/ SYNTH_SAMPLE_RATE);
+
+	vic_enable(VIC_CHANNEL_TIMER1);
+
+	if (prev != next) mem_poolFree(&wavePool, prev);
+
+	return TRUE;
+}
+
+// Moves on to the given mode. Tuning starts with an empty detector and a
+// conversion under way, so the first tick has a result to collect.
+void setMode(int next)
+{
+	if (next == MODE_TUNING) {
+		pitch_init(&tuner, SYNTH_SAMPLE_RATE);
+		tunerOctave = synthOctave;
+		tunerNote = synthNote;
+		strcpy(tunerText, "LISTENING");
+		adc_start();
+	}
+
+	mode = next;
+
+	// The keyboard changes between the note played and the note heard.
+	pendingElems |= ELEM_KEYBOARD;
+	sched_signal(uiTaskId);
+}
+
+// Writes how far off a note the tuner is, such as "+ 5 CENTS". The number
+// always takes two places, so the label only repaints the digits.
+void formatCents(char* dest, int cents)
+{
+	dest[0] = cents < 0 ? '-' : '+';
+	formatNumber(dest + 1, abs(cents), 2);
+	strcpy(dest + 3, " CENTS");
+}
+
+void synthIsr(void)
+{
+	static unsigned int phase = 0;
+
+	// How late this sample is, which must stay well under a sample period.
+	PROF_VALUE(latencyZone, timer_latency(TIMER1));
+
+	TRACE(TRACE_ISR_ENTER, VIC_CHANNEL_TIMER1, 0);
+
+	TIMER1->IR = 1 << 0;
+
+	PROF_BEGIN(dacZone);
+
+	switch (mode) {
+		case MODE_PLAYING:
+			phase += phaseStep;
+			while (phase >= (unsigned int) synthLength << FIXED_SHIFT) {
+				phase -= (unsigned int) synthLength << FIXED_SHIFT;
+			}
+
+			dac_write(synthWave[phase >> FIXED_SHIFT]);
+			break;
+
+		case MODE_TUNING:
+			// Collect the conversion started last tick, and start the next.
+			pitch_feed(&tuner, adc_result());
+			adc_start();
+			dac_write(0x100);
+			break;
+
+		default:
+			dac_write(0x100);
+			break;
+	}
+
+	PROF_END(dacZone);
+
+	TRACE(TRACE_ISR_EXIT, VIC_CHANNEL_TIMER1, 0);
+
+	VICVectAddr = 0;
+}
+
+void inputTask(void)
+{
+	int elems, button, octave, note, type;
+
+	PROF_BEGIN(inputZone);
+	elems = ELEM_NONE;
+
+	// Left and right together toggle the profiler overlay, after which
+	// everything under it needs drawing again.
+	if (prof_pollHotkey() && !prof_showing) {
+		prof_clearOverlay(BLACK);
+		invalidateKeyboard();
+		pendingElems |= ELEM_BOTH;
+		sched_signal(uiTaskId);
+	}
+
+	button = input_getButtonPress();
+
+	// While tuning the keyboard isn't showing the synth's note, so leave it
+	// alone.
+	if (mode == MODE_TUNING && button != BUTTON_CENTER) button = BUTTON_NONE;
+
+	octave = synthOctave;
+	note = synthNote;
+	type = synthType;
+
+	switch (button) {
+		case BUTTON_CENTER:
+			setMode(mode < MODE_LAST ? mode + 1 : 0);
+			break;
+		case BUTTON_DOWN:
+			++synthNote;
+			if (synthNote > NOTE_B) {
+				synthNote = NOTE_C;
+				synthOctave = min(synthOctave + 1, OCTAVE_MAX);
+			}
+			elems = ELEM_BOTH;
+			break;
+		case BUTTON_UP:
+			--synthNote;
+			if (synthNote < NOTE_C) {
+				synthNote = NOTE_B;
+				synthOctave = max(synthOctave - 1, OCTAVE_MIN);
+			}
+			elems = ELEM_BOTH;
+			break;
+		case BUTTON_LEFT:
+			--synthType;
+			if (synthType < 0) synthType = WAVE_LAST;
+			elems = ELEM_WAVEFORM;
+			break;
+		case BUTTON_RIGHT:
+			++synthType;
+			if (synthType > WAVE_LAST) synthType = 0;
+			elems = ELEM_WAVEFORM;
+			break;
+	}
+
+	// If there's no room for the new waveform, keep playing the old one and
+	// put the settings back to match it.
+	if (elems != ELEM_NONE && !changeWaveForm()) {
+		synthOctave = octave;
+		synthNote = note;
+		synthType = type;
+		elems = ELEM_NONE;
+	}
+
+	if (elems != ELEM_NONE) {
+		// Leave the drawing to uiTask, so the buttons stay responsive.
+		pendingElems |= elems;
+		sched_signal(uiTaskId);
+	}
+
+	input_nextPoll();
+	PROF_END(inputZone);
+}
+
+void uiTask(void)
+{
+	int elems;
+
+	elems = pendingElems;
+	pendingElems = ELEM_NONE;
+
+	// Anything new restarts the waveform display, so it never reads a table
+	// that has since been freed.
+	if (elems != ELEM_NONE) {
+		redraw(synthWave, synthLength, synthOctave, synthNote, elems);
+	}
+
+	if (waveDrawing) {
+		PROF_BEGIN(drawZone);
+		if (drawWaveForm(&waveDraw) == PT_ENDED) waveDrawing = FALSE;
+		else sched_signal(uiTaskId);
+		PROF_END(drawZone);
+	}
+}
+
+// Runs the pitch detector over the latest input while tuning, a few lags at a
+// time, and has the result shown once it is done.
+void tunerTask(void)
+{
+	int state, octave, note, cents;
+
+	if (mode != MODE_TUNING) return;
+
+	PROF_BEGIN(pitchZone);
+	state = pitch_step(&tuner);
+	PROF_END(pitchZone);
+
+	// Carry on as soon as nothing more urgent needs doing.
+	if (state == PT_YIELDED) {
+		sched_signal(tunerTaskId);
+		return;
+	}
+
+	if (state != PT_ENDED) return;
+
+	// Leave the last note on the keyboard through any gaps.
+	if (pitch_findNote(tuner.hz16, &octave, &note, &cents)) {
+		tunerOctave = octave;
+		tunerNote = note;
+		formatCents(tunerText, cents);
+	} else {
+		strcpy(tunerText, "NO NOTE");
+	}
+
+	pendingElems |= ELEM_KEYBOARD;
+	sched_signal(uiTaskId);
 }
 
 int main(void)
 {
-	bool playing; short* waveForm; int octave, note, type, length; volatile int i;
+	clock_init();
+	ramfunc_init();
 
 	lcd_init();
+	dac_init();
+	adc_init(SYNTH_SAMPLE_RATE);
 
-	waveForm = NULL;
-
-	PINSEL1 = cpyBits(PINSEL1, 20, 2, 1 << 1);
-
-	octave = 4;
-	note = NOTE_C;
-
-	type = WAVE_TRIANGLE;
-	length = buildWaveForm(&waveForm, type, octave, note);
-
-	playing = TRUE;
-
-	redraw(waveForm, length, octave, note, ELEM_BOTH);
-
-	for (i = 0;; i = i + 1 < length ? i + 1 : 0) {
-		switch (input_getButtonPress()) {
-			case BUTTON_CENTER:
-				playing = !playing;
-				break;
-			case BUTTON_DOWN:
-				++note;
-				if (note > NOTE_B) {
-					note = NOTE_C;
-					octave = min(octave + 1, OCTAVE_MAX);
-				}
-				length = buildWaveForm(&waveForm, type, octave, note);
-				redraw(waveForm, length, octave, note, ELEM_BOTH);
-				break;
-			case BUTTON_UP:
-				--note;
-				if (note < NOTE_C) {
-					note = NOTE_B;
-					octave = max(octave - 1, OCTAVE_MIN);
-				}
-				length = buildWaveForm(&waveForm, type, octave, note);
-				redraw(waveForm, length, octave, note, ELEM_BOTH);
-				break;
-			case BUTTON_LEFT:
-				--type;
-				if (type < 0) type = WAVE_LAST;
-				length = buildWaveForm(&waveForm, type, octave, note);
-				redraw(waveForm, length, octave, note, ELEM_WAVEFORM);
-				break;
-			case BUTTON_RIGHT:
-				++type;
-				if (type > WAVE_LAST) type = 0;
-				length = buildWaveForm(&waveForm, type, octave, note);
-				redraw(waveForm, length, octave, note, ELEM_WAVEFORM);
-				break;
-			default:
-				if (playing) DACR = cpyBits(0, 6, 10, waveForm[i]);
-				else DACR = cpyBits(0, 6, 10, 0x100);
-				break;
-		}
-	}
+	prof_init(OVERLAY_X, OVERLAY_Y);
+	inputZone = prof_addZone("input");
+	buildZone = prof_addZone("build");
+	drawZone = prof_addZone("draw");
+	dacZone = prof_addZone("dac");
+	latencyZone = prof_addZone("lat");
+	pitchZone = prof_addZone("pitch");
+
+	mem_poolInit(&wavePool, waveStore, WAVE_MAX_LENGTH * sizeof(short),
+		WAVE_POOL_BLOCKS);
+	synthWave = NULL;
+
+	synthOctave = 4;
+	synthNote = NOTE_C;
+	synthType = WAVE_TRIANGLE;
+	mode = MODE_PLAYING;
+
+	// Every table is free at this point, so this can't fail.
+	changeWaveForm();
+
+	initKeyboard(DISPLAY_WIDTH - 8 - WIDGET_KEY_WHITE_WIDTH,
+		DISPLAY_HEIGHT / 2 - 4, WIDGET_KEY_WHITE_WIDTH, DISPLAY_HEIGHT / 2 - 8);
+
+	replay_init(0);
+	sched_init();
+	input_startTask(sched_addTask("input", inputTask, 1, SCHED_NOT_PERIODIC));
+	uiTaskId = sched_addTask("ui", uiTask, 2, SCHED_NOT_PERIODIC);
+	tunerTaskId = sched_addTask("tuner", tunerTask, 3, TUNER_PERIOD);
+	sched_addTask("prof", prof_overlayTask, 4, PROF_OVERLAY_PERIOD);
+	trace_name(TRACE_ISR_ENTER, VIC_CHANNEL_TIMER1, "synth");
+
+	pendingElems = ELEM_BOTH;
+	sched_signal(uiTaskId);
+
+	timer_startPeriodic(TIMER1, VIC_CHANNEL_TIMER1, VIC_PRIORITY_AUDIO,
+		SYNTH_SAMPLE_RATE, synthIsr);
+
+	sched_run();
 
-	free(waveForm);
+	mem_poolFree(&wavePool, synthWave);
 
 	return 0;
 }
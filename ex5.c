@@ -4,628 +4,1345 @@
  * Email      : james.king3@durham.ac.uk
  * Contents   : Exercise 5 main source file. A sound recording application that
                 can record up to five minutes of audio CD quality (44100 Hz)
-                sound. Also provides a amplitude graph to show peaks in the
-                recorded sample, and a playback bar to show the playback
-                progress which corresponds to the graph above it. Features
-                anti-aliased 2x scaled text rendering.
- * Controls   : Centre button to start / stop recording. Right button to play
-                or stop, and up / down buttons to select volume.
+                sound, or longer at one of the lower rates. Also provides a
+                amplitude graph to show peaks in the recorded sample, and a
+                playback bar to show the playback progress which corresponds
+                to the graph above it. The graph can also show a spectrogram
+                of the recording instead. Features anti-aliased 2x scaled text
+                rendering.
+ *              Sampling and playback happen in the sample clock
+ *              interrupt, with input and drawing left to scheduler tasks so
+ *              the display can never make the audio stutter. The playhead
+ *              over the graph is the LCD's hardware cursor, so moving it
+ *              never disturbs the graph. While recording, the display shows
+ *              a live strip chart or waterfall of the input instead, scrolled
+ *              by the LCD controller. Lower rates are recorded at a higher
+ *              one and filtered down by resample.h, then filtered back up
+ *              again for playback, so the converters always run fast enough
+ *              to keep out aliasing. Playback can run from a quarter up to
+ *              four times as fast, forwards or backwards, with speed.h
+ *              filling in between recorded samples. When neither recording
+ *              nor playing, the input can be monitored live through a chain
+ *              of effects from fx.h, run a block at a time by live.h.
+ *              Every take is kept as a clip by clip.h until it is deleted,
+ *              and clips can be cut, split, looped and joined without
+ *              copying a sample, at the mark where playback last stopped.
+ *              Recording can also wait for a voice, keeping what came just
+ *              before it as a pre-roll, and stop once it goes quiet. Two
+ *              inputs can be recorded at once, as a stereo pair or a mic and
+ *              a line, with the A/D converter in burst mode going round them
+ *              by itself. Each input's samples are kept apart as a clip of
+ *              its own.
+ * Controls   : Centre button to start / stop recording, or to make the
+                shown edit when the edit setting is picked. Right button to
+                play or stop. Left button to pick a setting (volume, speed,
+                rate, view, monitor, clip, edit, fade, voice or input) and
+                up / down buttons to change it. While playing, up / down
+                change the speed, to scrub through the recording.
  */
 
 //////////////
 // Includes //
 //////////////
 
-#include <string.h>
 #include <lpc24xx.h>
 #include <lcd_grph.h>
-#include <font5x7.h>
+
+#include "utils.h"
+#include "input.h"
+#include "lcd.h"
+#include "reg.h"
+#include "adc.h"
+#include "dac.h"
+#include "timer.h"
+#include "sched.h"
+#include "pt.h"
+#include "clock.h"
+#include "ramfunc.h"
+#include "prof.h"
+#include "widget.h"
+#include "cursor.h"
+#include "scope.h"
+#include "resample.h"
+#include "speed.h"
+#include "fx.h"
+#include "live.h"
+#include "clip.h"
+#include "trigger.h"
 
 ///////////////////////
 // Const Definitions //
 ///////////////////////
 
-// Used to make it clear when a literal should be interpreted as a bool
-// by anyone reading the code.
-#define TRUE 1
-#define FALSE 0
-
-// Approximate number of iterations of the delay loop per millisecond.
-#define DELAY_MULT 3000
-
-// The number of possible buttons that can be pressed.
-#define BUTTON_COUNT 5
-
-// Bit numbers in FIO0PIN for each button.
-#define BUTTON_NONE -1
-#define BUTTON_UP 10
-#define BUTTON_DOWN 11
-#define BUTTON_LEFT 12
-#define BUTTON_RIGHT 13
-#define BUTTON_CENTER 22
-
-// Width of each character when drawn to the display, in pixels.
-#define CHAR_WIDTH 6
-#define BIG_CHAR_WIDTH 12
-
-// Height of each character when drawn to the display, in pixels.
-#define CHAR_HEIGHT 8
-#define BIG_CHAR_HEIGHT 16
-
-// The number of seconds to record a sample for.
+// The number of seconds of recordings kept at the highest rate, shared by
+// every clip. Lower rates fit proportionally longer in the same buffer.
 #define SAMPLE_PERIOD 300
 
-// The number of samples recorded per second.
-#define SAMPLE_RATE 44100
-
-// The total number of samples to be recorded.
-#define SAMPLE_LENGTH (SAMPLE_RATE * SAMPLE_PERIOD)
-
-// Range for the playback timing loop.
-#define PLAYBACK_LOOP_ITERS (2900000 / SAMPLE_RATE)
-
-///////////////////////
-// Macro Definitions //
-///////////////////////
-
-// Produces a binary number with the given number of 1s in a row.
-#define bitMask(c) ((1 << (c)) - 1)
-
-// Isolates and shifts a single bit for easy comparison.
-#define getBit(x, i) (((x) >> (i)) & 1)
-
-// Isolates and shifts a group of bits for easy comparison.
-#define getBits(x, i, c) (((x) >> (i)) & bitMask((c)))
- 
-// Sets a single bit at the specified position to 0.
-#define clrBit(x, i) ((x) & ~(1 << (i)))
-
-// Sets a single bit at the specified position to 1.
-#define setBit(x, i) ((x) | (1 << (i)))
-
-// Sets a single bit at the specified position to whatever.
-#define cpyBit(x, i, v) (clrBit(x, i) | (((v) & 1) << i))
- 
-// Sets a group of bits at the specified position to 0.
-#define clrBits(x, i, c) ((x) & ~(bitMask(c) << (i)))
-
-// Sets a group of bits at the specified position to 1.
-#define setBits(x, i, c) ((x) | (bitMask(c) << (i)))
-
-// Sets a group of bits at the specified position to whatever.
-#define cpyBits(x, i, c, v) (clrBits(x, i, c) | (((v) & bitMask(c)) << (i)))
-
-// Compares and gives the smallest of the two inputs.
-#define min(a, b) ((a) <= (b) ? (a) : (b))
-
-// Compares and gives the largest of the two inputs.
-#define max(a, b) ((a) >= (b) ? (a) : (b))
-
-// Finds the magnitude of a number.
-#define abs(a) ((a) < 0 ? -(a) : (a))
+// The total number of samples kept.
+#define SAMPLE_LENGTH (44100 * SAMPLE_PERIOD)
+
+// The number of recording rates.
+#define RATES 4
+
+// The number of playback speeds, and the one that plays at the recorded
+// speed.
+#define SPEEDS 10
+#define NORMAL_SPEED 7
+
+// What the up and down buttons change, picked with the left button.
+#define SETTING_VOLUME 0
+#define SETTING_SPEED 1
+#define SETTING_RATE 2
+#define SETTING_VIEW 3
+#define SETTING_MONITOR 4
+#define SETTING_CLIP 5
+#define SETTING_EDIT 6
+#define SETTING_FADE 7
+#define SETTING_VOICE 8
+#define SETTING_INPUT 9
+#define SETTING_LAST 9
+
+// The edits the centre button can make to the selected clip, at the mark.
+#define EDIT_CUT_BEFORE 0
+#define EDIT_CUT_AFTER 1
+#define EDIT_SPLIT 2
+#define EDIT_LOOP 3
+#define EDIT_INSERT 4
+#define EDIT_DELETE 5
+#define EDITS 6
+
+// The number of times EDIT_LOOP makes the start of a clip play.
+#define LOOP_TIMES 2
+
+// The number of sets of inputs that can be recorded.
+#define INPUTS 3
+
+// The number of pre-roll lengths on offer for voice activated recording,
+// the first of which turns it off.
+#define PREROLLS 4
+
+// The RMS levels, in 10 bit sample units, at which a voice starts a
+// recording, and under which it counts as quiet. The A/D converter's own
+// noise is about 2.
+#define VOICE_START_LEVEL 20
+#define VOICE_STOP_LEVEL 10
+
+// How long it must be quiet for to stop a voice activated recording, and
+// how much of that is kept on the end, in milliseconds.
+#define VOICE_SILENCE 1500
+#define VOICE_HOLD 250
+
+// The effects the input can be monitored through, each adding to the one
+// before. MONITOR_OFF doesn't monitor at all.
+#define MONITOR_OFF 0
+#define MONITOR_DRY 1
+#define MONITOR_GATE 2
+#define MONITOR_COMPRESS 3
+#define MONITOR_ECHO 4
+#define MONITORS 5
+
+// The rate the input is monitored at.
+#define MONITOR_RATE 44100
+
+// Settings for the monitor's effects, in 10 bit sample units centred on
+// zero, and for the echo, in samples at MONITOR_RATE. The echo's delay line
+// has room for two seconds, though it only uses half a second of it.
+#define GATE_THRESHOLD 12
+#define COMPRESS_THRESHOLD 128
+#define COMPRESS_RATIO 4
+#define ECHO_LENGTH (2 * MONITOR_RATE)
+#define ECHO_DELAY (MONITOR_RATE / 2)
+#define ECHO_FEEDBACK 112
+#define ECHO_MIX 160
+
+// What the sample clock and A/D converter interrupts are currently doing.
+#define MODE_IDLE 0
+#define MODE_RECORDING 1
+#define MODE_PLAYING 2
+#define MODE_MONITORING 3
+#define MODE_ARMED 4
+
+// Size of the playhead's marker, which sits on top of a line down to the
+// bottom of the graph.
+#define PLAYHEAD_MARKER_WIDTH 7
+#define PLAYHEAD_MARKER_HEIGHT 4
+
+// Scheduler ticks between updates of the display.
+#define UI_PERIOD 20
+
+// Where the profiler overlay is drawn, over the instructions.
+#define OVERLAY_X 4
+#define OVERLAY_Y 160
 
 //////////////////////
 // Type Definitions //
 //////////////////////
 
-// Used to assist readability of variables that are expected to hold a truth
-// value.
-typedef int bool;
-
-// Structure representing a position in 2D space.
+// A recording rate, made by running the sample clock at clock times a second
+// and keeping one sample in every factor, and its name.
 typedef struct {
-    int x, y;
-} Point;
+    int clock;
+    int factor;
+    char* name;
+} Rate;
 
-// Structure representing the size of an object in 2D space.
+// A set of inputs recorded together, as the A/D channel each is on and the
+// name each one's clips get, and the name of the set.
 typedef struct {
-    int width, height;
-} Size;
-
-// Structure representing the combined position and size of a rectangle.
+    int count;
+    int channels[ADC_MAX_CHANNELS];
+    char* prefixes[ADC_MAX_CHANNELS];
+    char* name;
+} Input;
+
+// A playback speed, as the step through the recording each sample in
+// SPEED_ONEs, negative to play backwards, and its name.
 typedef struct {
-    Point pos;
-    Size size;
-} Rect;
+    long step;
+    char* name;
+} Speed;
 
 ///////////////////////////
 // Function Declarations //
 ///////////////////////////
 
-int input_getButtonPress(void);
-int input_waitForButtonPress(void);
-
-bool lcd_charSample(unsigned char ch, int x, int y);
-bool lcd_bigCharSample(unsigned char ch, int x, int y);
-
-bool lcd_putBigChar(unsigned short x, unsigned short y, char chr);
-void lcd_putBigString(unsigned short x, unsigned short y, char *pStr);
-
-Size lcd_getStringSize(char* str);
-Rect lcd_putStringCentered(unsigned short x, unsigned short y,
-    unsigned short w, unsigned short h, char* str);
-
-Size lcd_getBigStringSize(char* str);
-Rect lcd_putBigStringCentered(unsigned short x, unsigned short y,
-    unsigned short w, unsigned short h, char* str);
-
-void adc_init(void);
-short adc_read(void);
-
-void dac_init(void);
-
-void clear(void);
-void record(void);
-void play(int volume);
-
-void drawBuffer(int x, int y, int w, int h);
-void drawVolume(int volume, int x, int y, int w, int h);
+void startRecording(void);
+void stopRecording(void);
+void startPlayback(void);
+void stopPlayback(void);
+void startMonitoring(void);
+void stopMonitoring(void);
+void buildChain(void);
+void finishRecording(void);
+bool isRecording(int curMode);
+void showClip(void);
+bool nextGraphPart(void);
+void showMark(void);
+void applyEdit(void);
+int findRate(int hz);
+void toggleView(void);
+void nextSetting(void);
+void changeSetting(int step);
+void showSetting(void);
+
+void audioIsr(void) __attribute__((interrupt("IRQ"))) RAMFUNC;
+void captureIsr(void) __attribute__((interrupt("IRQ"))) RAMFUNC;
+void inputTask(void);
+void uiTask(void);
+
+void initWidgets(void);
+void initPlayhead(void);
+void movePlayhead(unsigned long at, unsigned long total);
+void drawInstructions(void);
 
 //////////////////////
 // Global Variables //
 //////////////////////
 
 // The sample buffer must be global otherwise it exceeds the allowed stack
-// frame size for the function it is declared in.
+// frame size for the function it is declared in. Every clip lives in it.
 short sampleBuffer[SAMPLE_LENGTH];
 
-// The number of samples recorded.
-unsigned long recordedSamples;
+// The clips, and their samples in sampleBuffer.
+clip_Store store;
+
+// The number of inputs in the take being recorded, or 0 if there isn't one,
+// the clip for each input, where each one's samples go, and how many there
+// is room for in each.
+int takeChannels;
+clip_Clip* takes[ADC_MAX_CHANNELS];
+short* takeSamples[ADC_MAX_CHANNELS];
+unsigned long takeCapacity;
+
+// Index in inputs of the inputs recorded, and the A/D converter's capture
+// of them, a round every sample clock tick while recording or monitoring.
+int selectedInput;
+adc_Capture capture;
+
+// The number of samples recorded, once recording stops.
+volatile unsigned long recordedSamples;
+
+// Index in prerolls of the selected pre-roll, or 0 to record straight away.
+int selectedPreroll;
+
+// Whether the take being recorded waited for a voice, and so stops once it
+// goes quiet. Latched when the take starts, so the interrupt never sees the
+// setting change under it.
+bool voiceTake;
+
+// While waiting for a voice, the start of each input's space is a ring of
+// ringLength samples, which the pre-roll goes round. ringHead is where the
+// next goes, and ringWrapped says whether it has gone all the way round.
+// The rest of the take goes after the ring.
+short* ringSamples[ADC_MAX_CHANNELS];
+unsigned long ringLength;
+volatile unsigned long ringHead;
+volatile bool ringWrapped;
+
+// Listens to the first input for a voice to start and stop the recording,
+// and the number of quiet samples that stop it and that are kept.
+trigger_Detector detector;
+unsigned long silenceSamples, holdSamples;
+
+// Index in the store of the selected clip, which is played and edited, or
+// -1 if there are no clips.
+int selectedClip;
+
+// Where playback of the selected clip last stopped, which edits are made
+// at, and which of the EDIT_* constants the centre button makes.
+unsigned long mark;
+int selectedEdit;
+
+// Whether to crossfade where pieces of a clip that weren't recorded
+// together meet.
+bool crossfade;
+
+// The next piece of the selected clip to graph, and the number of samples
+// in the pieces before it.
+clip_Piece* graphPiece;
+unsigned long graphDone;
+
+// One of the MODE_* constants. Only the main code moves out of MODE_IDLE, but
+// the interrupts move back into it when they run out of samples, and from
+// MODE_ARMED to MODE_RECORDING when they hear a voice.
+volatile int mode;
+
+// Index of the next sample to be recorded or played.
+volatile unsigned long position;
+
+// Index of the selected volume in volumes.
+int selectedVolume;
+
+// Index of the selected playback speed in speeds.
+int selectedSpeed;
+
+// Plays through the selected clip at the playback speed and volume.
+clip_Player player;
+
+// Index in rates of the rate the next recording is made at.
+int selectedRate;
+
+// Interpolates while playing, between the recording's rate and the sample
+// clock rate.
+resample_Filter filter;
+
+// Decimates the inputs together while recording, from the sample clock rate
+// to the recording's own.
+resample_Frames decimator;
+
+// Index of the selected effects to monitor through, one of the MONITOR_*
+// constants.
+int selectedMonitor;
+
+// The chain of effects the input is monitored through, and every effect
+// that can go in it. They are all set up when monitoring starts, and only
+// the chain changes after that.
+fx_Chain chain;
+fx_Gain gain;
+fx_Gate gate;
+fx_Compressor compressor;
+fx_Echo echo;
+
+// The echo's delay line, kept apart from the recording so monitoring never
+// spoils it.
+short echoLine[ECHO_LENGTH];
+
+// The SETTING_* constant the up and down buttons change, the label that
+// shows it, and the text in the label.
+int setting;
+widget_Label settingLabel;
+char settingText[WIDGET_LABEL_LENGTH + 1];
+
+// The progress bar under the graph, and the volume meter to its right.
+widget_Bar progressBar, volumeBar;
+
+// ID of the display task, so the sample clock can wake it when it finishes.
+int uiTaskId;
+
+// The graph of the recording, which is drawn a slice at a time.
+widget_Graph recordingGraph;
+
+// Profiler zones.
+int inputZone, graphZone, scopeZone, adcZone, dacZone, resampleZone;
+int latencyZone;
+
+// Array of volume settings, which are approximately exponential.
+const int volumes[10] = {
+    0, 16, 22, 31, 44, 61, 86, 120, 169, 256
+};
+
+// The recording rates on offer. 8 kHz doesn't divide 44.1 kHz, so it runs
+// the sample clock at 48 kHz instead.
+const Rate rates[RATES] = {
+    { 44100, 1, "44.1KHZ" },
+    { 44100, 2, "22.05KHZ" },
+    { 44100, 4, "11.025KHZ" },
+    { 48000, 6, "8KHZ" }
+};
+
+// The playback speeds on offer, slowest backwards to fastest forwards.
+const Speed speeds[SPEEDS] = {
+    { -4 * SPEED_ONE, "-4X" },
+    { -2 * SPEED_ONE, "-2X" },
+    { -SPEED_ONE, "-1X" },
+    { -SPEED_ONE / 2, "-0.5X" },
+    { -SPEED_ONE / 4, "-0.25X" },
+    { SPEED_ONE / 4, "0.25X" },
+    { SPEED_ONE / 2, "0.5X" },
+    { SPEED_ONE, "1X" },
+    { 2 * SPEED_ONE, "2X" },
+    { 4 * SPEED_ONE, "4X" }
+};
+
+// The sets of inputs on offer. Each starts with AD0.1, the usual input, so
+// monitoring hears the same whichever is picked. AD0.3 shares its pin with
+// the D/A converter's output, so the line goes on AD0.0.
+const Input inputs[INPUTS] = {
+    { 1, { 1 }, { "TAKE " }, "INPUT MONO" },
+    { 2, { 1, 2 }, { "LEFT ", "RIGHT " }, "INPUT STEREO" },
+    { 2, { 1, 0 }, { "MIC ", "LINE " }, "INPUT MIC+LINE" }
+};
+
+// The pre-rolls on offer, in milliseconds, and their names.
+const int prerolls[PREROLLS] = { 0, 250, 500, 1000 };
+char* const prerollNames[PREROLLS] = {
+    "VOICE OFF", "VOICE 250MS", "VOICE 500MS", "VOICE 1S"
+};
+
+// The names of the EDIT_* constants.
+char* const edits[EDITS] = {
+    "CUT BEFORE", "CUT AFTER", "SPLIT AT MARK", "LOOP TO MARK",
+    "INSERT NEXT", "DELETE CLIP"
+};
+
+// The names of the MONITOR_* constants.
+char* const monitors[MONITORS] = {
+    "MONITOR OFF", "MONITOR DRY", "MONITOR GATE", "MONITOR COMP",
+    "MONITOR ECHO"
+};
 
 //////////////////////////
 // Function Definitions //
 //////////////////////////
 
-// Checks to see if a button has been pressed since the last time this function
-// was called, and returns that button's ID if one has. If no button has been
-// pressed, returns BUTTON_NONE.
-inline int input_getButtonPress(void)
+// Start recording a new take of the selected inputs from the A/D converter
+// interrupt at the selected rate, into the longest stretch of free space
+// split between them, until either it is full or stopRecording is called.
+// With a pre-roll selected, wait for a voice first, and stop once it goes
+// quiet.
+void startRecording(void)
 {
-    int i, curr, diff;
+    const Rate* rate; const Input* input; int hz, c;
 
-    // Record the previous state of ~FIO0PIN between invocations.
-    static int prev = 0;
+    if (mode == MODE_MONITORING) stopMonitoring();
 
-    // List of button IDs to loop through.
-    const int buttons[BUTTON_COUNT] = {
-        BUTTON_UP,
-        BUTTON_DOWN,
-        BUTTON_LEFT,
-        BUTTON_RIGHT,
-        BUTTON_CENTER
-    };
+    rate = &rates[selectedRate];
+    hz = rate->clock / rate->factor;
+    input = &inputs[selectedInput];
+    if (!clip_startTakes(&store, hz, input->count, input->prefixes, takes,
+        takeSamples, &takeCapacity)) {
+        return;
+    }
+    takeChannels = input->count;
+
+    // Keep the pre-roll in a ring at the start of each input's space, as
+    // long as that leaves at least as much again to record into.
+    ringLength = min((unsigned long) hz * prerolls[selectedPreroll] / 1000,
+        takeCapacity / 2);
+    ringHead = 0;
+    ringWrapped = FALSE;
+    for (c = 0; c < takeChannels; ++c) {
+        ringSamples[c] = takeSamples[c];
+        takeSamples[c] += ringLength;
+    }
+    resample_initFrames(&decimator, rate->factor, takeChannels);
+    takeCapacity -= ringLength;
+
+    trigger_init(&detector, VOICE_START_LEVEL, VOICE_STOP_LEVEL);
+    silenceSamples = (unsigned long) hz * VOICE_SILENCE / 1000;
+    holdSamples = (unsigned long) hz * VOICE_HOLD / 1000;
 
-    // Invert FIO0PIN so a 1 to signifies a button being pressed.
-    curr = ~FIO0PIN;
+    // Abandon the graph if it was still being drawn, and the playhead, while
+    // the live chart shows instead.
+    widget_clearGraph(&recordingGraph);
+    graphPiece = NULL;
+    cursor_hide();
 
-    // Find the buttons that have been pressed since last invocation.
-    diff = (curr ^ prev) & curr;
+    timer_setRate(TIMER1, rate->clock);
 
-    // Remember the current button state for next time.
-    prev = curr;
+    // Empty the progress bar.
+    widget_setBar(&progressBar, 0, takeCapacity);
+    widget_drawBar(&progressBar);
 
-    // Find the first button that has just been pressed and return it.
-    for (i = 0; i < BUTTON_COUNT; ++i) {
-        if (getBit(diff, buttons[i])) return buttons[i];
+    position = 0;
+
+    // Show the input live until recording stops.
+    scope_start();
+
+    voiceTake = selectedPreroll > 0;
+    mode = voiceTake ? MODE_ARMED : MODE_RECORDING;
+}
+
+// Stop recording early, keeping whatever has been recorded so far, or give
+// up waiting for a voice.
+void stopRecording(void)
+{
+    // Keep the A/D interrupt out while the take is cut short, so it can't
+    // store another sample, or end the take itself, half way through. If it
+    // already has ended it, what it recorded stands.
+    vic_disable(VIC_CHANNEL_ADC0);
+
+    if (mode == MODE_RECORDING) {
+        recordedSamples = position;
+    } else if (mode == MODE_ARMED) {
+        recordedSamples = 0;
+        ringHead = 0;
+        ringWrapped = FALSE;
+    }
+    mode = MODE_IDLE;
+
+    vic_enable(VIC_CHANNEL_ADC0);
+
+    finishRecording();
+}
+
+// Once recording has stopped, however it stopped, hands back the space the
+// take didn't use and selects its first input's clip. Does nothing if it has
+// already been done.
+void finishRecording(void)
+{
+    int c, found;
+
+    if (takeChannels == 0) return;
+
+    // The pre-roll is joined on to the front without moving it.
+    for (c = 0; c < takeChannels; ++c) {
+        clip_finishCapture(&store, takes[c], ringLength, ringHead,
+            ringWrapped, recordedSamples);
     }
+    found = clip_find(&store, takes[0]);
+    if (found >= 0) selectedClip = found;
+    takeChannels = 0;
 
-    // Otherwise, nothing new has been pressed.
-    return BUTTON_NONE;
+    mark = 0;
+    showClip();
+    showSetting();
 }
 
-// Blocks until a button is pressed, and then returns that buttons's ID.
-int input_waitForButtonPress(void)
+// Whether the given mode is recording, or waiting to.
+bool isRecording(int curMode)
 {
-    int btn;
-    
-    // Super condensed.
-    while ((btn = input_getButtonPress()) == BUTTON_NONE);
-    return btn;
+    return curMode == MODE_RECORDING || curMode == MODE_ARMED;
 }
 
-// Finds whether the given texel of the specified character is
-// solid in that character's bitmap.
-bool lcd_charSample(unsigned char ch, int x, int y)
+// Clears the graph and starts drawing the selected clip in it, a piece at a
+// time, each across its share of the width.
+void showClip(void)
 {
-    static unsigned char const font_mask[8] = {
-        0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
-    };
+    widget_clearGraph(&recordingGraph);
 
-    // Check to see if the texel is out of bounds.
-    if (x < 0 || x >= CHAR_WIDTH) return FALSE;
-    if (y < 0 || y >= CHAR_HEIGHT) return FALSE;
+    graphPiece = selectedClip >= 0 ? store.clips[selectedClip]->first
+        : NULL;
+    graphDone = 0;
 
-    return font5x7[ch][y] & font_mask[x];
+    if (nextGraphPart()) sched_signal(uiTaskId);
 }
 
-// Finds whether the given texel of the specified character is
-// solid in a 2x super sampled version of that character's bitmap.
-bool lcd_bigCharSample(unsigned char ch, int x, int y)
+// Starts graphing the next piece of the selected clip that is at least a
+// column wide. Returns FALSE once there are none left.
+bool nextGraphPart(void)
 {
-    int ix, iy, l, r, t, b, i, j, n; bool dx, dy;
-
-    // Find the texel in the original bitmap.
-    ix = x >> 1;
-    iy = y >> 1;
-
-    // Find which edge of the original texel this texel is.
-    dx = x & 1;
-    dy = y & 1;
-
-    // Find bounds for finding neighbours of the texel.
-    l = ix - !dx; r = ix + dx; t = iy - !dy; b = iy + dy;
-
-    // Count how many neighbouring texels are solid.
-    n = 0;
-    for (i = l; i <= r; ++i) {
-        for (j = t; j <= b; ++j) {
-            if (!lcd_charSample(ch, i, j)) continue;
-            else if (i == ix && j == iy) n += 3;
-            else if (i == ix || j == iy) n += 2;
-            else                         n += 1;
+    unsigned long total; int width, from, to; clip_Piece* piece;
+
+    if (graphPiece == NULL) return FALSE;
+
+    total = store.clips[selectedClip]->length;
+    width = recordingGraph.rect.size.width - 2;
+
+    while (graphPiece != NULL) {
+        piece = graphPiece;
+        from = (int) ((unsigned long long) graphDone * width / total);
+        graphDone += piece->length;
+        to = (int) ((unsigned long long) graphDone * width / total);
+        graphPiece = piece->next;
+
+        if (to > from) {
+            widget_setGraphPart(&recordingGraph, piece->start, piece->length,
+                from, to - from);
+            return TRUE;
         }
     }
 
-    // Only draw this texel as solid if at least 4 neighbours are.
-    return lcd_charSample(ch, ix, iy) || (n >= 4);
+    return FALSE;
 }
 
-// Draws the given character at the specified location in a font twice the
-// size of the default style. Adapted from lcd_grph.h
-bool lcd_putBigChar(unsigned short x, unsigned short y, char chr)
+// Shows the playhead at the mark, or hides it if the mark is at the start
+// of the clip.
+void showMark(void)
 {
-    unsigned char i = 0, j = 0;
-    unsigned char ch = (unsigned char) chr & 0x7f;
-    lcd_color_t color;
-
-    // Don't draw off-screen.
-    if ((x >= (DISPLAY_WIDTH - BIG_CHAR_WIDTH)) ||
-        (y >= (DISPLAY_HEIGHT - BIG_CHAR_HEIGHT))) return FALSE;
-
-    // Treat strange characters as just spaces.
-    if ((ch < 0x20) || (ch > 0x7f)) ch = 0x20;
-
-    // The character bitmap array is offset by 0x20 from the actual char value.
-    ch -= 0x20;
-
-
-    // Sample each pixel to be drawn. 
-    for (i = 0; i < BIG_CHAR_HEIGHT; ++i) {
-        for (j = 0; j < BIG_CHAR_WIDTH; ++j) {
-            color = lcd_bigCharSample(ch, j, i) ? WHITE : BLACK;
-            lcd_point(x, y, color);
-            ++x;
-        }   
-        ++y;
-        x -= BIG_CHAR_WIDTH;
+    if (selectedClip >= 0 && mark > 0) {
+        movePlayhead(mark, store.clips[selectedClip]->length);
+        cursor_show(0);
+    } else {
+        cursor_hide();
     }
-
-    // I'm not sure why lcd_putChar returns TRUE, but we may as well replicate
-    // its functionality here just in case.
-    return TRUE;
 }
 
-// Draws a string in the specified location in a font twice the size of the
-// default style.
-void lcd_putBigString(unsigned short x, unsigned short y, char *pStr)
+// Makes the selected edit to the selected clip at the mark, and shows the
+// result. Edits that can't be made, such as cutting everything, or inserting
+// a clip recorded at another rate, do nothing.
+void applyEdit(void)
 {
-    for (;;) {      
-        if((*pStr) == '\0') return;
-        if(!lcd_putBigChar(x, y, *pStr++)) return;
-        x += BIG_CHAR_WIDTH;
+    clip_Clip *clip, *next; bool done;
+
+    if (selectedClip < 0) return;
+
+    clip = store.clips[selectedClip];
+    done = FALSE;
+
+    switch (selectedEdit) {
+        case EDIT_CUT_BEFORE:
+            done = clip_trim(&store, clip, mark, clip->length);
+            if (done) mark = 0;
+            break;
+
+        case EDIT_CUT_AFTER:
+            done = clip_trim(&store, clip, 0, mark);
+            break;
+
+        case EDIT_SPLIT:
+            done = clip_split(&store, clip, mark) != NULL;
+            break;
+
+        case EDIT_LOOP:
+            done = clip_loop(&store, clip, 0, mark, LOOP_TIMES);
+            break;
+
+        // Splice the clip after the selected one in, leaving it as it is.
+        case EDIT_INSERT:
+            if (selectedClip + 1 < store.count) {
+                next = store.clips[selectedClip + 1];
+                done = clip_splice(&store, clip, mark, next);
+            }
+            break;
+
+        case EDIT_DELETE:
+            clip_delete(&store, clip);
+            selectedClip = min(selectedClip, store.count - 1);
+            mark = 0;
+            done = TRUE;
+            break;
     }
+
+    if (!done) return;
+
+    showClip();
+    showMark();
 }
 
-// Calculates the width and height of the given string if it were to be drawn
-// on the LCD display.
-Size lcd_getStringSize(char* str)
+// Gives the index in rates of the given recording rate.
+int findRate(int hz)
 {
-    Size size;
+    int i;
 
-    // No newline support yet.
-    size.width = strlen(str) * CHAR_WIDTH;
-    size.height = CHAR_HEIGHT;
+    for (i = 0; i < RATES - 1; ++i) {
+        if (rates[i].clock / rates[i].factor == hz) break;
+    }
 
-    return size;
+    return i;
 }
 
-// Calculates the width and height of the given string if it were to be drawn
-// on the LCD display in a font twice the default size.
-Size lcd_getBigStringSize(char* str)
+// Switch the graph between the recording's amplitude and its spectrogram,
+// and the live chart between ranges and a waterfall to match.
+void toggleView(void)
 {
-    Size size;
+    bool spectrum;
 
-    size = lcd_getStringSize(str);
+    spectrum = recordingGraph.view != WIDGET_GRAPH_SPECTRUM;
 
-    size.width *= 2;
-    size.height *= 2;
+    widget_setGraphView(&recordingGraph,
+        spectrum ? WIDGET_GRAPH_SPECTRUM : WIDGET_GRAPH_AMPLITUDE);
+    scope_view = spectrum ? SCOPE_VIEW_WATERFALL : SCOPE_VIEW_RANGE;
 
-    return size;
+    // Redraw the selected clip, if there is one, in the new view. While
+    // recording it isn't shown, and the chart switches from its next row.
+    if (!isRecording(mode)) showClip();
 }
 
-// Draws the given string in the centre of the provided rectangle, as defined
-// by its top-left position, width, and height. Returns a Rect structure
-// containing the position and size of the drawn text.
-Rect lcd_putStringCentered(unsigned short x, unsigned short y,
-    unsigned short w, unsigned short h, char* str)
+// Move on to the next setting for the up and down buttons to change.
+void nextSetting(void)
 {
-    Rect rect;
+    setting = setting < SETTING_LAST ? setting + 1 : 0;
+    showSetting();
+}
+
+// Change the current setting by one step up or down. The rate can't change
+// in the middle of a recording, but the speed takes effect straight away.
+void changeSetting(int step)
+{
+    unsigned long cpsr;
+
+    switch (setting) {
+        case SETTING_VOLUME:
+            selectedVolume = min(9, max(0, selectedVolume + step));
+            fx_setGain(&gain, volumes[selectedVolume]);
+            widget_setBar(&volumeBar, selectedVolume, 9);
+            widget_drawBar(&volumeBar);
+            break;
 
-    // Find the size of the text.
-    rect.size = lcd_getStringSize(str);
+        case SETTING_SPEED:
+            selectedSpeed = min(SPEEDS - 1, max(0, selectedSpeed + step));
+            if (mode == MODE_PLAYING) {
+                clip_setStep(&player, speeds[selectedSpeed].step);
+            }
+            break;
+
+        case SETTING_MONITOR:
+            if (isRecording(mode) || mode == MODE_PLAYING) return;
+            selectedMonitor = min(MONITORS - 1, max(MONITOR_OFF,
+                selectedMonitor + step));
+
+            if (selectedMonitor == MONITOR_OFF) {
+                if (mode == MODE_MONITORING) stopMonitoring();
+            } else if (mode == MODE_MONITORING) {
+                buildChain();
+            } else {
+                startMonitoring();
+            }
+            break;
 
-    // Position the text taking the size into account.
-    rect.pos.x = x + ((w - rect.size.width) >> 1);
-    rect.pos.y = y + ((h - rect.size.height) >> 1);
+        case SETTING_CLIP:
+            if (isRecording(mode) || mode == MODE_PLAYING) return;
+            if (store.count == 0) break;
+            selectedClip = min(store.count - 1, max(0, selectedClip + step));
+            mark = 0;
+            showClip();
+            showMark();
+            break;
 
-    // Draw the text at the calculated position.
-    lcd_putString(rect.pos.x, rect.pos.y, str);
+        case SETTING_EDIT:
+            selectedEdit = min(EDITS - 1, max(0, selectedEdit + step));
+            break;
+
+        // Up turns crossfades on and down turns them off, straight away if
+        // playing.
+        case SETTING_FADE:
+            crossfade = step > 0;
+            player.crossfade = crossfade;
+            break;
+
+        // Takes effect from the next recording. The ring the current take
+        // goes round was sized from it, so it can't change until it ends.
+        case SETTING_VOICE:
+            if (isRecording(mode)) return;
+            selectedPreroll = min(PREROLLS - 1, max(0, selectedPreroll + step));
+            break;
+
+        case SETTING_RATE:
+            if (isRecording(mode)) return;
+            selectedRate = min(RATES - 1, max(0, selectedRate + step));
+            break;
+
+        // Capture the new inputs straight away, with the interrupts held off
+        // so no round runs half set up. The first is always the same, so
+        // monitoring carries on undisturbed.
+        case SETTING_INPUT:
+            if (isRecording(mode)) return;
+            selectedInput = min(INPUTS - 1, max(0, selectedInput + step));
+            cpsr = vic_maskInterrupts();
+            adc_initBurst(&capture, inputs[selectedInput].channels,
+                inputs[selectedInput].count);
+            vic_restoreInterrupts(cpsr);
+            break;
 
-    return rect;
+        case SETTING_VIEW:
+            toggleView();
+            break;
+    }
+
+    showSetting();
 }
 
-// Draws the given string in large lettering in the centre of the provided
-// rectangle, as defined by its top-left position, width, and height. Returns
-// a Rect structure containing the position and size of the drawn text.
-Rect lcd_putBigStringCentered(unsigned short x, unsigned short y,
-    unsigned short w, unsigned short h, char* str)
+// Show the current setting and its value under the instructions.
+void showSetting(void)
 {
-    Rect rect;
+    switch (setting) {
+        case SETTING_VOLUME:
+            strcpy(settingText, "VOLUME ");
+            formatNumber(settingText + 7, selectedVolume, 1);
+            break;
+
+        case SETTING_SPEED:
+            strcpy(settingText, "SPEED ");
+            strcat(settingText, speeds[selectedSpeed].name);
+            break;
+
+        case SETTING_RATE:
+            strcpy(settingText, "RATE ");
+            strcat(settingText, rates[selectedRate].name);
+            break;
+
+        case SETTING_VIEW:
+            strcpy(settingText, recordingGraph.view == WIDGET_GRAPH_SPECTRUM
+                ? "VIEW SPECTRUM" : "VIEW AMPLITUDE");
+            break;
+
+        case SETTING_MONITOR:
+            strcpy(settingText, monitors[selectedMonitor]);
+            break;
 
-    // Find the size of the text.
-    rect.size = lcd_getBigStringSize(str);
+        // The clip's name and length in seconds.
+        case SETTING_CLIP:
+            if (selectedClip < 0) {
+                strcpy(settingText, "NO CLIPS");
+                break;
+            }
+            strcpy(settingText, store.clips[selectedClip]->name);
+            strcat(settingText, " ");
+            formatNumber(settingText + strlen(settingText),
+                store.clips[selectedClip]->length
+                    / store.clips[selectedClip]->rate, 3);
+            strcat(settingText, "S");
+            break;
 
-    // Position the text taking the size into account.
-    rect.pos.x = x + ((w - rect.size.width) >> 1);
-    rect.pos.y = y + ((h - rect.size.height) >> 1);
+        case SETTING_EDIT:
+            strcpy(settingText, edits[selectedEdit]);
+            break;
 
-    // Draw the text at the calculated position.
-    lcd_putBigString(rect.pos.x, rect.pos.y, str);
+        case SETTING_FADE:
+            strcpy(settingText, crossfade ? "FADE ON" : "FADE OFF");
+            break;
+
+        case SETTING_VOICE:
+            strcpy(settingText, prerollNames[selectedPreroll]);
+            break;
 
-    return rect;
+        case SETTING_INPUT:
+            strcpy(settingText, inputs[selectedInput].name);
+            break;
+    }
+
+    // The profiler overlay covers the label, which is drawn again when it
+    // goes.
+    widget_setLabel(&settingLabel, settingText);
+    if (!prof_showing) widget_drawLabel(&settingLabel);
 }
 
-// Prepares the Analogue to Digital Converter for usage with the sample
-// rate as defined by the SAMPLE_RATE constant.
-void adc_init(void)
+// Start playing back the selected clip from the sample clock interrupt, at
+// the rate it was recorded at and the selected speed and volume. Playing
+// backwards starts from the end.
+void startPlayback(void)
 {
-    PINSEL1 = cpyBits(PINSEL1, 16, 2, 1);
-    PCONP = setBit(PCONP, 12);
+    clip_Clip* clip; const Rate* rate;
+
+    if (mode == MODE_MONITORING) stopMonitoring();
+
+    clip = store.clips[selectedClip];
+    rate = &rates[findRate(clip->rate)];
+
+    // Empty the progress bar.
+    widget_setBar(&progressBar, 0, clip->length);
+    widget_drawBar(&progressBar);
 
-    AD0CR = setBit(cpyBits(2, 8, 8, 12000000 / (SAMPLE_RATE << 4)), 21);
+    resample_initInterpolator(&filter, rate->factor);
+    timer_setRate(TIMER1, rate->clock);
+
+    clip_play(&player, clip, speeds[selectedSpeed].step, SPEED_CUBIC,
+        volumes[selectedVolume], crossfade);
+    position = clip_position(&player);
+
+    mode = MODE_PLAYING;
 }
 
-// Read a single sample from the ADC.
-short adc_read(void)
+// Stop playback before it reaches the end of the clip, leaving the mark
+// where it stopped.
+void stopPlayback(void)
 {
-    AD0CR = cpyBits(AD0CR, 24, 3, 1);
-    while (!getBit(AD0DR1, 31));
-    return (short) getBits(AD0DR1, 6, 10);
+    mode = MODE_IDLE;
+    mark = position;
 }
 
-// Initialize the Digital to Analogue Converter.
-void dac_init(void)
+// Start passing the input straight through to the output, through the
+// selected effects, with the echo starting out silent.
+void startMonitoring(void)
 {
-    PINSEL1 = cpyBits(PINSEL1, 20, 2, 1 << 1);
+    timer_setRate(TIMER1, MONITOR_RATE);
+
+    fx_initGain(&gain, volumes[selectedVolume]);
+    fx_initGate(&gate, GATE_THRESHOLD);
+    fx_initCompressor(&compressor, COMPRESS_THRESHOLD, COMPRESS_RATIO);
+    fx_initEcho(&echo, echoLine, ECHO_LENGTH, ECHO_DELAY, ECHO_FEEDBACK,
+        ECHO_MIX);
+
+    buildChain();
+    live_start(&chain);
+
+    mode = MODE_MONITORING;
 }
 
-// Forget any previous recording.
-void clear(void)
+// Stop monitoring, and show that it has stopped if it was recording or
+// playing that stopped it.
+void stopMonitoring(void)
 {
-    recordedSamples = 0;
+    // The interrupt stops exchanging samples once the mode changes, so the
+    // blocks can stop after it.
+    mode = MODE_IDLE;
+    live_stop();
 
-    // Clear the volume graph for redrawing.
-    lcd_fillRect(4, 4, DISPLAY_WIDTH - 8, 126, BLACK);
+    selectedMonitor = MONITOR_OFF;
+    showSetting();
 }
 
-// Record samples until either SAMPLE_LENGTH samples are recorded or
-// the centre button is pressed.
-void record(void)
+// Put together the chain of effects for the selected monitor. The effects
+// keep their state, so the gate and echo carry on where they were.
+void buildChain(void)
 {
-    unsigned long b;
-    int x, oldX; short val;
-
-    clear();
-
-    // Clear the progress bar.
-    lcd_fillRect(4, 126, DISPLAY_WIDTH - 8, 128, WHITE);
-
-    oldX = 0;
-    for (b = 0; b < SAMPLE_LENGTH; ++b) {
-        // Read and store a sample.
-        val = adc_read();
-        sampleBuffer[b] = val;
-
-        // Find the current horizontal position of the progress bar.
-        x = (b * (DISPLAY_WIDTH - 12)) / SAMPLE_LENGTH;
-        if (x > oldX) {
-            // If the bar has moved since last time, draw the difference.
-            lcd_fillRect(4 + oldX, 126, 4 + x, 128, RED);
-            oldX = x;
-        }
+    live_lock();
 
-        // Listen out for the centre button being pressed to stop recording.
-        if (input_getButtonPress() == BUTTON_CENTER) {
-            recordedSamples = b;
-            break;
-        }
+    fx_initChain(&chain);
+    if (selectedMonitor >= MONITOR_GATE) fx_addEffect(&chain, &gate.effect);
+    if (selectedMonitor >= MONITOR_COMPRESS) {
+        fx_addEffect(&chain, &compressor.effect);
     }
+    if (selectedMonitor >= MONITOR_ECHO) fx_addEffect(&chain, &echo.effect);
+    fx_addEffect(&chain, &gain.effect);
 
-    // Ensure the entire progress bar is filled.
-    lcd_fillRect(4, 126, DISPLAY_WIDTH - 8, 128, RED);
+    live_unlock();
 }
 
-// Play back the recording until either the playback is complete or a button
-// is pressed by the user.
-void play(int volume)
+// Sample clock interrupt, running at the clock rate for the recording's
+// rate, or MONITOR_RATE while monitoring. While recording or monitoring it
+// starts a round of conversions of each input, which captureIsr takes from
+// there. While playing it plays a sample, and wakes the display task when it
+// reaches the end of the clip. Each sample read back is played for factor
+// ticks, filtered so the steps between them are smoothed out.
+void audioIsr(void)
 {
-    int b, val, x, oldX; volatile int i;
-
-    // Clear the progress bar.
-    lcd_fillRect(4, 126, DISPLAY_WIDTH - 8, 128, WHITE);
-    
-    oldX = 0;
-    for (b = 0; b < recordedSamples; ++b) {
-        // Retrieve a sample and adjust it with the given volume, then send it
-        // to the DAC.
-        val = (sampleBuffer[b] * volume) / 256;
-        DACR = cpyBits(0, 6, 10, val);
-
-        // Find the current horizontal position of the progress bar.
-        x = (b * (DISPLAY_WIDTH - 12)) / recordedSamples;
-        if (x > oldX) {
-            // If the bar has moved since last time, draw the difference.
-            oldX = x;
-            lcd_fillRect(4 + x - 1, 126, 4 + x, 128, RED);
+    short sample; int curMode;
+
+    // How late this sample is, which must stay well under a sample period
+    // or the recording will drift.
+    PROF_VALUE(latencyZone, timer_latency(TIMER1));
+
+    // Start converting straight away, so every conversion is the same time
+    // after the tick.
+    curMode = mode;
+    if (isRecording(curMode) || curMode == MODE_MONITORING) {
+        adc_startRound(&capture);
+    }
+
+    TRACE(TRACE_ISR_ENTER, VIC_CHANNEL_TIMER1, curMode);
+
+    TIMER1->IR = 1 << 0;
+
+    if (curMode == MODE_PLAYING) {
+        // Stop once the player runs off either end of the clip.
+        if (resample_wantsInput(&filter) && clip_finished(&player)) {
+            mode = MODE_IDLE;
+            sched_signal(uiTaskId);
+        } else {
+            // Read the next sample at the playback speed and volume every
+            // factor ticks, and fill in between.
+            PROF_BEGIN(resampleZone);
+            if (resample_wantsInput(&filter)) {
+                position = clip_position(&player);
+                resample_push(&filter, clip_next(&player));
+            }
+            sample = resample_interpolate(&filter);
+            PROF_END(resampleZone);
+
+            PROF_BEGIN(dacZone);
+            dac_write(sample);
+            PROF_END(dacZone);
         }
+    }
+
+    TRACE(TRACE_ISR_EXIT, VIC_CHANNEL_TIMER1, 0);
 
-        // Listen out for a button being pressed to stop playback.
-        if (input_getButtonPress() != BUTTON_NONE) break;
+    VICVectAddr = 0;
+}
 
-        for (i = 0; i < PLAYBACK_LOOP_ITERS; ++ i);
+// A/D converter interrupt, once each round of conversions audioIsr started
+// is done. Records a sample of each input, or passes the first input
+// through, depending on the current mode, and wakes the display task when
+// it reaches the end of the buffer. Only one in every factor samples taken
+// is stored.
+void captureIsr(void)
+{
+    short frame[ADC_MAX_CHANNELS]; bool stored;
+
+    // Stop the round before the burst goes any further, whatever the mode
+    // has changed to since it started.
+    PROF_BEGIN(adcZone);
+    adc_finishRound(&capture, frame);
+    PROF_END(adcZone);
+
+    TRACE(TRACE_ISR_ENTER, VIC_CHANNEL_ADC0, mode);
+
+    switch (mode) {
+        case MODE_RECORDING:
+            // Put each input's sample in its own space. The inputs are
+            // decimated together, so they all store on the same ticks.
+            PROF_BEGIN(resampleZone);
+            stored = resample_decimateFrame(&decimator, frame, takeSamples,
+                position);
+            PROF_END(resampleZone);
+
+            if (!stored) break;
+
+            // A voice activated recording stops once it has been quiet for
+            // long enough, keeping only the start of the quiet.
+            if (voiceTake) {
+                trigger_feed(&detector, takeSamples[0][position]);
+                if (detector.quiet >= silenceSamples) {
+                    recordedSamples = position + 1 - detector.quiet
+                        + holdSamples;
+                    mode = MODE_IDLE;
+                    sched_signal(uiTaskId);
+                    break;
+                }
+            }
+
+            if (++position >= takeCapacity) {
+                recordedSamples = position;
+                mode = MODE_IDLE;
+                sched_signal(uiTaskId);
+            }
+            break;
+
+        case MODE_ARMED:
+            // Go round the ring until there's a voice, then carry on
+            // recording after it.
+            PROF_BEGIN(resampleZone);
+            stored = resample_decimateFrame(&decimator, frame, ringSamples,
+                ringHead);
+            PROF_END(resampleZone);
+
+            if (!stored) break;
+
+            trigger_feed(&detector, ringSamples[0][ringHead]);
+
+            if (++ringHead >= ringLength) {
+                ringHead = 0;
+                ringWrapped = TRUE;
+            }
+
+            if (detector.triggered) {
+                mode = MODE_RECORDING;
+                sched_signal(uiTaskId);
+            }
+            break;
+
+        case MODE_MONITORING:
+            // Swap each sample of the first input for one that has been
+            // through the effects.
+            PROF_BEGIN(dacZone);
+            dac_write(live_exchange(frame[0]));
+            PROF_END(dacZone);
+            break;
     }
 
-    // Ensure the entire progress bar is filled.
-    lcd_fillRect(4, 126, DISPLAY_WIDTH - 8, 128, RED);
+    TRACE(TRACE_ISR_EXIT, VIC_CHANNEL_ADC0, 0);
+
+    VICVectAddr = 0;
 }
 
-// Draw a graph of the amplitude for the recorded sample. Finds the minimum and
-// maximum samples, average sample, and then uses the magnitude of the
-// difference between each sample and the average to generate the graph which
-// is appropriately scaled so that the maximum and minimum values fill the
-// graph area.
-void drawBuffer(int x, int y, int w, int h)
+// Reads the buttons when woken by one and acts on any that have been pressed.
+void inputTask(void)
 {
-    short val, prev, rangeMin, rangeMax, valMin, valMax;
-    int i, b, start, end;
-    long int avg;
-
-    // Default values for the range which will naturally be replaced by the
-    // first sample.
-    rangeMin = 0x3ff;
-    rangeMax = 0x000;
-    avg = 0;
-
-    // Find the true values for the range, and find the sum from which an
-    // average may be calculated.
-    for (b = 0; b < recordedSamples; ++b) {
-        val = sampleBuffer[b];
-        avg += val;
-        
-        if (val > rangeMax) rangeMax = val;
-        if (val < rangeMin) rangeMin = val;
+    int button;
+
+    PROF_BEGIN(inputZone);
+
+    // Left and right together toggle the profiler overlay, which covers up
+    // the instructions.
+    if (prof_pollHotkey() && !prof_showing) {
+        prof_clearOverlay(BLACK);
+        drawInstructions();
+        widget_invalidateLabel(&settingLabel);
+        widget_drawLabel(&settingLabel);
+    }
+
+    // Tidy up after a take that filled its space, if the display task hasn't
+    // yet, before anything else looks at the clips.
+    if (!isRecording(mode)) finishRecording();
+
+    button = input_getButtonPress();
+
+    switch (mode) {
+        // While recording, or waiting to, the centre button stops it, and the
+        // left, up and down buttons change settings as usual, apart from the
+        // rate.
+        case MODE_RECORDING:
+        case MODE_ARMED:
+            if (button == BUTTON_CENTER) stopRecording();
+            if (button == BUTTON_CENTER || button == BUTTON_RIGHT) {
+                button = BUTTON_NONE;
+            }
+            break;
+
+        // While playing, up and down change the speed, to scrub through the
+        // recording, and any other button stops playback.
+        case MODE_PLAYING:
+            if (button == BUTTON_UP || button == BUTTON_DOWN) {
+                setting = SETTING_SPEED;
+            } else {
+                if (button != BUTTON_NONE) stopPlayback();
+                button = BUTTON_NONE;
+            }
+            break;
+    }
+
+    switch (button) {
+        // Centre button starts recording, or makes the edit on show.
+        case BUTTON_CENTER:
+            if (setting == SETTING_EDIT) applyEdit();
+            else startRecording();
+            break;
+
+        // Left button picks the next setting.
+        case BUTTON_LEFT:
+            nextSetting();
+            break;
+
+        // Right button initiates playback.
+        case BUTTON_RIGHT:
+            if (selectedClip >= 0) startPlayback();
+            break;
+
+        // Up and down buttons change the setting.
+        case BUTTON_UP:
+            changeSetting(1);
+            break;
+
+        case BUTTON_DOWN:
+            changeSetting(-1);
+            break;
     }
 
-    // Find the true mean as the sum divided by the number of samples.
-    avg /= recordedSamples;
-
-    // Find the largest difference from the average.
-    rangeMax = max(rangeMax - avg, avg - rangeMin);
-
-    prev = 0;
-    for (i = 0; i < w; ++i) {
-        // Each column of pixels will represent many samples, so find the range
-        // of samples to.. sample from.
-        start = (i * recordedSamples) / w;
-        end = ((i + 1) * recordedSamples) / w;
-
-        // If the size of the sample sample is zero we can skip this column.
-        if (start == end) continue;
-
-        // Find the largest and smallest samples from the sample sample.
-        valMin = 0x3ff;
-        valMax = 0x000;
-        for (b = start; b < end; ++b) {
-            val = sampleBuffer[b];
-            if (val < valMin) valMin = val;
-            if (val > valMax) valMax = val;
+    input_nextPoll();
+    PROF_END(inputZone);
+}
+
+// Keeps the progress bar up to date while recording or playing, tidies up
+// the display once the sample clock interrupt has finished, and draws the
+// graph of the selected clip a slice at a time so input and playback carry
+// on while it appears.
+void uiTask(void)
+{
+    static int lastMode = MODE_IDLE;
+
+    int curMode; unsigned long total;
+
+    curMode = mode;
+
+    if (curMode == MODE_RECORDING || curMode == MODE_PLAYING) {
+        total = curMode == MODE_RECORDING ? takeCapacity
+            : player.clip->length;
+
+        // Move the progress bar along, which only draws the difference.
+        widget_setBar(&progressBar, position, total);
+        widget_drawBar(&progressBar);
+
+        // Chart whatever has been recorded since last time.
+        if (curMode == MODE_RECORDING) {
+            PROF_BEGIN(scopeZone);
+            scope_update(takeSamples[0], position);
+            PROF_END(scopeZone);
+        }
+
+        if (curMode == MODE_PLAYING) {
+            movePlayhead(position, total);
+            if (lastMode != MODE_PLAYING) cursor_show(0);
         }
+    } else if (curMode == MODE_ARMED) {
+        // Show how close the input is to starting the recording.
+        widget_setBar(&progressBar, trigger_percent(&detector), 100);
+        widget_drawBar(&progressBar);
+    } else if (isRecording(lastMode) || lastMode == MODE_PLAYING) {
+        // Ensure the entire progress bar is filled.
+        widget_setBar(&progressBar, 1, 1);
+        widget_drawBar(&progressBar);
+
+        // Start showing the new take.
+        if (isRecording(lastMode)) finishRecording();
+    }
+
+    // Go back to the normal display once recording stops, however quickly.
+    if (!isRecording(curMode)) scope_stop();
 
-        // Find the largest difference from the mean.
-        val = max(abs(valMax - avg), abs(avg - valMin));
+    // Leave the playhead at the mark once playback stops for any reason,
+    // unless recording has already taken over.
+    if (lastMode == MODE_PLAYING && curMode != MODE_PLAYING
+        && !isRecording(curMode)) {
+        mark = position;
+        showMark();
+    }
 
-        // Draw a line from the previous column of the graph to this column's
-        // value, scaled to fit the graph height.
-        lcd_line(x + i - 1, y + h - (prev * h) / rangeMax,
-            x + i, y + h - (val * h) / rangeMax, WHITE);
+    lastMode = curMode;
 
-        // Remember the last value drawn so a line can be drawn from it.
-        prev = val;
+    // Draw the next slice of the graph, and ask to be run again as soon as
+    // nothing more urgent needs doing.
+    if (recordingGraph.drawing) {
+        PROF_BEGIN(graphZone);
+        if (widget_drawGraph(&recordingGraph) || nextGraphPart()) {
+            sched_signal(uiTaskId);
+        }
+        PROF_END(graphZone);
     }
 }
 
-// Draw the volume meter in the specified location with the given size.
-void drawVolume(int volume, int x, int y, int w, int h)
+// Set up the graph, progress bar and volume meter along the top of the
+// display, and the setting under the instructions.
+void initWidgets(void)
 {
-    lcd_fillRect(x, y, x + w, y + h - (volume * h) / 9, WHITE);
-    lcd_fillRect(x, y + h - (volume * h) / 9, x + w, y + h, RED);
+    Rect rect;
+
+    rect.pos.x = 5;
+    rect.pos.y = 4;
+    rect.size.width = DISPLAY_WIDTH - 12;
+    rect.size.height = 121;
+    widget_initGraph(&recordingGraph, rect);
+
+    rect.pos.x = 4;
+    rect.pos.y = 126;
+    rect.size.width = DISPLAY_WIDTH - 11;
+    rect.size.height = 3;
+    widget_initBar(&progressBar, rect, WIDGET_FILL_RIGHT, FALSE, RED, WHITE);
+
+    rect.pos.x = DISPLAY_WIDTH - 5;
+    rect.pos.y = 4;
+    rect.size.width = 3;
+    rect.size.height = 121;
+    widget_initBar(&volumeBar, rect, WIDGET_FILL_UP, FALSE, RED, WHITE);
+
+    rect.pos.x = 0;
+    rect.pos.y = 288;
+    rect.size.width = DISPLAY_WIDTH;
+    rect.size.height = 32;
+    widget_initLabel(&settingLabel, rect, TRUE);
 }
 
-// Entry point, containing initialization and main update loop.
-int main(void)
+// Draw the playhead into the cursor image: a marker with a line below it,
+// with the hotspot at the bottom of the line.
+void initPlayhead(void)
 {
-    int volume;
+    int i, mid;
 
-    // Array of volume settings, which are approximately exponential.
-    const int volumes[10] = {
-        0, 16, 22, 31, 44, 61, 86, 120, 169, 256
-    };
+    cursor_init(CURSOR_SIZE_64);
+    cursor_setPalette(YELLOW, BLACK);
 
-    // Initialize the display, DAC and ADC.
-    lcd_init();
-    dac_init();
-    adc_init();
+    mid = PLAYHEAD_MARKER_WIDTH >> 1;
 
-    // Draw the on-screen instructions.
-    lcd_putBigStringCentered(0, 160, DISPLAY_WIDTH, 32, "Center : Record  ");
-    lcd_putBigStringCentered(0, 192, DISPLAY_WIDTH, 32, " Right : Play    ");
-    lcd_putBigStringCentered(0, 224, DISPLAY_WIDTH, 32, "    Up : +Volume ");
-    lcd_putBigStringCentered(0, 256, DISPLAY_WIDTH, 32, "  Down : -Volume ");
+    // Each row of the marker is narrower than the last, down to a point.
+    for (i = 0; i < PLAYHEAD_MARKER_HEIGHT; ++i) {
+        cursor_fillRect(0, i, i, PLAYHEAD_MARKER_WIDTH - 2 * i, 1,
+            CURSOR_COLOUR0);
+    }
 
-    // Ensure the sample count is zero.
-    clear();
+    cursor_fillRect(0, mid, PLAYHEAD_MARKER_HEIGHT, 1,
+        cursor_size - PLAYHEAD_MARKER_HEIGHT, CURSOR_COLOUR0);
 
-    // Set the initial volume and draw the volume display.
-    volume = 8;
-    drawVolume(volume, DISPLAY_WIDTH - 5, 4, 2, 120);
+    cursor_setHotspot(mid, cursor_size - 1);
+}
 
-    // Main input loop.
-    for(;;) {
+// Moves the playhead to the column of the graph matching the given sample
+// of a clip total samples long, standing on the graph's baseline.
+void movePlayhead(unsigned long at, unsigned long total)
+{
+    Rect* rect;
 
-        // Wait for a button press and then act according to its value.
-        switch (input_waitForButtonPress()) {
+    rect = &recordingGraph.rect;
 
-            // Centre button starts recording.
-            case BUTTON_CENTER:
-                record();
-                drawBuffer(6, 4, DISPLAY_WIDTH - 14, 120);
-                break;
+    cursor_move(rect->pos.x + 1 + (int) ((unsigned long long) at
+        * (rect->size.width - 2) / total),
+        rect->pos.y + rect->size.height - 1);
+}
 
-            // Left button clears the recording.
-            case BUTTON_LEFT:
-                clear();
-                break;
+// Draw the on-screen instructions.
+void drawInstructions(void)
+{
+    lcd_putBigStringCentered(0, 160, DISPLAY_WIDTH, 32, "Center : Rec/Edit");
+    lcd_putBigStringCentered(0, 192, DISPLAY_WIDTH, 32, " Right : Play    ");
+    lcd_putBigStringCentered(0, 224, DISPLAY_WIDTH, 32, "  Left : Setting ");
+    lcd_putBigStringCentered(0, 256, DISPLAY_WIDTH, 32, "Up/Down: Change  ");
+}
 
-            // Right button initiates playback.
-            case BUTTON_RIGHT:
-                if (recordedSamples > 0) {
-                    play(volumes[volume]);
-                }
-                break;
+// Entry point, containing initialization. Everything after that happens in
+// the scheduler tasks and the sample clock and A/D converter interrupts.
+int main(void)
+{
+    // Run at full speed, with the sample handlers in SRAM.
+    clock_init();
+    ramfunc_init();
 
-            // Up button increases volume.
-            case BUTTON_UP:
-                volume = min(9, volume + 1);
-                drawVolume(volume, DISPLAY_WIDTH - 5, 4, 2, 120);
-                break;
+    // Initialize the display and DAC, and start capturing the usual input.
+    lcd_init();
+    dac_init();
+    selectedInput = 0;
+    adc_initBurst(&capture, inputs[0].channels, inputs[0].count);
+
+    drawInstructions();
+
+    // Time input, drawing and each sample, and how late each sample starts.
+    prof_init(OVERLAY_X, OVERLAY_Y);
+    inputZone = prof_addZone("input");
+    graphZone = prof_addZone("graph");
+    scopeZone = prof_addZone("scope");
+    adcZone = prof_addZone("adc");
+    dacZone = prof_addZone("dac");
+    resampleZone = prof_addZone("rsmp");
+    latencyZone = prof_addZone("lat");
+    live_zone = prof_addZone("fx");
+    live_delayZone = prof_addZone("mon");
+
+    // Start with no clips, and an empty graph.
+    mode = MODE_IDLE;
+    clip_init(&store, sampleBuffer, SAMPLE_LENGTH);
+    takeChannels = 0;
+    selectedClip = -1;
+    mark = 0;
+    initWidgets();
+    initPlayhead();
+    showClip();
 
-            // Down button decreases volume.
-            case BUTTON_DOWN:
-                volume = max(0, volume - 1);
-                drawVolume(volume, DISPLAY_WIDTH - 5, 4, 2, 120);
-                break;
-        }
-    }
+    // Set the initial volume and draw the volume display.
+    selectedVolume = 8;
+    widget_setBar(&volumeBar, selectedVolume, 9);
+    widget_drawBar(&volumeBar);
+
+    // Record at the full rate and play at the recorded speed unless told
+    // otherwise, starting with the volume setting.
+    selectedSpeed = NORMAL_SPEED;
+    selectedRate = 0;
+    selectedMonitor = MONITOR_OFF;
+    selectedEdit = EDIT_CUT_BEFORE;
+    crossfade = TRUE;
+    selectedPreroll = 0;
+    voiceTake = FALSE;
+    setting = SETTING_VOLUME;
+    showSetting();
+
+    // Record or replay the buttons if built to.
+    replay_init(0);
+
+    // Input is more urgent than drawing, so a long redraw can't swallow a
+    // button press for longer than it takes to finish.
+    sched_init();
+    input_startTask(sched_addTask("input", inputTask, 1,
+        SCHED_NOT_PERIODIC));
+    uiTaskId = sched_addTask("ui", uiTask, 2, UI_PERIOD);
+    sched_addTask("prof", prof_overlayTask, 3, PROF_OVERLAY_PERIOD);
+    trace_name(TRACE_ISR_ENTER, VIC_CHANNEL_TIMER1, "audio");
+    trace_name(TRACE_ISR_ENTER, VIC_CHANNEL_ADC0, "capture");
+
+    // The sample clock and the conversions it starts trump everything else.
+    // Its rate is set again for each recording and playback.
+    vic_install(VIC_CHANNEL_ADC0, VIC_PRIORITY_AUDIO, captureIsr);
+    timer_startPeriodic(TIMER1, VIC_CHANNEL_TIMER1, VIC_PRIORITY_AUDIO,
+        rates[0].clock, audioIsr);
+
+    sched_run();
 
     // Control flow will never reach here, so the actual return value is
     // irrelevant.
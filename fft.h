@@ -0,0 +1,382 @@
+/**
+ * File Name  : fft.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : An in-place fixed point FFT of 2^FFT_MIN_BITS to
+ *              2^FFT_MAX_BITS points, for showing the spectrum of recorded
+ *              audio. Runs radix-4 passes, with one radix-2 pass at the end
+ *              when the size is an odd power of two. Twiddles come from a
+ *              Q15 quarter-wave table in flash, and the output is put back
+ *              in order with a bit reversal table.
+ *
+ *              Data is kept with plenty of headroom below 32 bits and
+ *              multiplied by the twiddles with 64-bit products, which the
+ *              ARM7 does in a single SMULL or SMLAL. Each pass scales its
+ *              output down to match its gain, so nothing can overflow and the
+ *              result is the DFT divided by the number of points.
+ */
+
+#ifndef FFT_H_GUARD
+#define FFT_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "ramfunc.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The range of transform sizes, as powers of two.
+#define FFT_MIN_BITS 8
+#define FFT_MAX_BITS 11
+#define FFT_MAX_POINTS (1 << FFT_MAX_BITS)
+
+// Number of fractional bits in the twiddle table.
+#define FFT_TWIDDLE_SHIFT 15
+
+// How far samples from the A/D converter are shifted up when loaded, which
+// puts a full scale swing at about +/-2^22.
+#define FFT_SAMPLE_SHIFT 13
+
+// Number of fractional bits in the levels given by fft_level.
+#define FFT_LEVEL_FRAC 2
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A complex value, such as a point of the transform.
+typedef struct {
+    int re, im;
+} fft_Complex;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// A quarter turn of sin, in Q1.15, over FFT_MAX_POINTS / 4 steps. The rest
+// of the turn, and cos, are found by symmetry. Unsigned, so the last entry
+// can be exactly one.
+const unsigned short fft_quarterSine[(FFT_MAX_POINTS >> 2) + 1] = {
+          0,    101,    201,    302,    402,    503,    603,    704,
+        804,    905,   1005,   1106,   1206,   1307,   1407,   1507,
+       1608,   1708,   1809,   1909,   2009,   2110,   2210,   2310,
+       2411,   2511,   2611,   2711,   2811,   2912,   3012,   3112,
+       3212,   3312,   3412,   3512,   3612,   3712,   3812,   3911,
+       4011,   4111,   4211,   4310,   4410,   4510,   4609,   4709,
+       4808,   4907,   5007,   5106,   5205,   5305,   5404,   5503,
+       5602,   5701,   5800,   5899,   5998,   6097,   6195,   6294,
+       6393,   6491,   6590,   6688,   6787,   6885,   6983,   7081,
+       7180,   7278,   7376,   7473,   7571,   7669,   7767,   7864,
+       7962,   8059,   8157,   8254,   8351,   8449,   8546,   8643,
+       8740,   8836,   8933,   9030,   9127,   9223,   9319,   9416,
+       9512,   9608,   9704,   9800,   9896,   9992,  10088,  10183,
+      10279,  10374,  10469,  10565,  10660,  10755,  10850,  10945,
+      11039,  11134,  11228,  11323,  11417,  11511,  11605,  11699,
+      11793,  11887,  11980,  12074,  12167,  12261,  12354,  12447,
+      12540,  12633,  12725,  12818,  12910,  13003,  13095,  13187,
+      13279,  13371,  13463,  13554,  13646,  13737,  13828,  13919,
+      14010,  14101,  14192,  14282,  14373,  14463,  14553,  14643,
+      14733,  14823,  14912,  15002,  15091,  15180,  15269,  15358,
+      15447,  15535,  15624,  15712,  15800,  15888,  15976,  16064,
+      16151,  16239,  16326,  16413,  16500,  16587,  16673,  16760,
+      16846,  16932,  17018,  17104,  17190,  17275,  17361,  17446,
+      17531,  17616,  17700,  17785,  17869,  17953,  18037,  18121,
+      18205,  18288,  18372,  18455,  18538,  18621,  18703,  18786,
+      18868,  18950,  19032,  19114,  19195,  19277,  19358,  19439,
+      19520,  19601,  19681,  19761,  19841,  19921,  20001,  20081,
+      20160,  20239,  20318,  20397,  20475,  20554,  20632,  20710,
+      20788,  20865,  20943,  21020,  21097,  21174,  21251,  21327,
+      21403,  21479,  21555,  21631,  21706,  21781,  21856,  21931,
+      22006,  22080,  22154,  22228,  22302,  22375,  22449,  22522,
+      22595,  22668,  22740,  22812,  22884,  22956,  23028,  23099,
+      23170,  23241,  23312,  23383,  23453,  23523,  23593,  23663,
+      23732,  23801,  23870,  23939,  24008,  24076,  24144,  24212,
+      24279,  24347,  24414,  24481,  24548,  24614,  24680,  24746,
+      24812,  24878,  24943,  25008,  25073,  25138,  25202,  25266,
+      25330,  25394,  25457,  25520,  25583,  25646,  25708,  25771,
+      25833,  25894,  25956,  26017,  26078,  26139,  26199,  26259,
+      26320,  26379,  26439,  26498,  26557,  26616,  26674,  26733,
+      26791,  26848,  26906,  26963,  27020,  27077,  27133,  27190,
+      27246,  27301,  27357,  27412,  27467,  27522,  27576,  27630,
+      27684,  27738,  27791,  27844,  27897,  27950,  28002,  28054,
+      28106,  28158,  28209,  28260,  28311,  28361,  28411,  28461,
+      28511,  28560,  28610,  28658,  28707,  28755,  28803,  28851,
+      28899,  28946,  28993,  29040,  29086,  29132,  29178,  29224,
+      29269,  29314,  29359,  29404,  29448,  29492,  29535,  29579,
+      29622,  29665,  29707,  29750,  29792,  29833,  29875,  29916,
+      29957,  29997,  30038,  30078,  30118,  30157,  30196,  30235,
+      30274,  30312,  30350,  30388,  30425,  30462,  30499,  30536,
+      30572,  30608,  30644,  30680,  30715,  30750,  30784,  30819,
+      30853,  30886,  30920,  30953,  30986,  31018,  31050,  31082,
+      31114,  31146,  31177,  31207,  31238,  31268,  31298,  31328,
+      31357,  31386,  31415,  31443,  31471,  31499,  31527,  31554,
+      31581,  31608,  31634,  31660,  31686,  31711,  31737,  31761,
+      31786,  31810,  31834,  31858,  31881,  31904,  31927,  31950,
+      31972,  31994,  32015,  32037,  32058,  32078,  32099,  32119,
+      32138,  32158,  32177,  32196,  32214,  32233,  32251,  32268,
+      32286,  32303,  32319,  32336,  32352,  32368,  32383,  32398,
+      32413,  32428,  32442,  32456,  32470,  32483,  32496,  32509,
+      32522,  32534,  32546,  32557,  32568,  32579,  32590,  32600,
+      32610,  32620,  32629,  32638,  32647,  32656,  32664,  32672,
+      32679,  32686,  32693,  32700,  32706,  32712,  32718,  32723,
+      32729,  32733,  32738,  32742,  32746,  32749,  32753,  32756,
+      32758,  32760,  32762,  32764,  32766,  32767,  32767,  32768,
+      32768
+};
+
+// Each byte with its bits in reverse order.
+const unsigned char fft_reverseByte[256] = {
+    0x00, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0,
+    0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
+    0x08, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8,
+    0x18, 0x98, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
+    0x04, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x64, 0xe4,
+    0x14, 0x94, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
+    0x0c, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x6c, 0xec,
+    0x1c, 0x9c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
+    0x02, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x62, 0xe2,
+    0x12, 0x92, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
+    0x0a, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x6a, 0xea,
+    0x1a, 0x9a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
+    0x06, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x66, 0xe6,
+    0x16, 0x96, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
+    0x0e, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x6e, 0xee,
+    0x1e, 0x9e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
+    0x01, 0x81, 0x41, 0xc1, 0x21, 0xa1, 0x61, 0xe1,
+    0x11, 0x91, 0x51, 0xd1, 0x31, 0xb1, 0x71, 0xf1,
+    0x09, 0x89, 0x49, 0xc9, 0x29, 0xa9, 0x69, 0xe9,
+    0x19, 0x99, 0x59, 0xd9, 0x39, 0xb9, 0x79, 0xf9,
+    0x05, 0x85, 0x45, 0xc5, 0x25, 0xa5, 0x65, 0xe5,
+    0x15, 0x95, 0x55, 0xd5, 0x35, 0xb5, 0x75, 0xf5,
+    0x0d, 0x8d, 0x4d, 0xcd, 0x2d, 0xad, 0x6d, 0xed,
+    0x1d, 0x9d, 0x5d, 0xdd, 0x3d, 0xbd, 0x7d, 0xfd,
+    0x03, 0x83, 0x43, 0xc3, 0x23, 0xa3, 0x63, 0xe3,
+    0x13, 0x93, 0x53, 0xd3, 0x33, 0xb3, 0x73, 0xf3,
+    0x0b, 0x8b, 0x4b, 0xcb, 0x2b, 0xab, 0x6b, 0xeb,
+    0x1b, 0x9b, 0x5b, 0xdb, 0x3b, 0xbb, 0x7b, 0xfb,
+    0x07, 0x87, 0x47, 0xc7, 0x27, 0xa7, 0x67, 0xe7,
+    0x17, 0x97, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7,
+    0x0f, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f, 0xef,
+    0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
+};
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void fft_twiddle(int m, int* c, int* s);
+int fft_reverseIndex(int i, int bits);
+static inline void fft_rotate(fft_Complex* dest, int re, int im, int c,
+    int s);
+
+void fft_load(fft_Complex* data, const short* samples, int bits);
+void fft_transform(fft_Complex* data, int bits) RAMFUNC;
+void fft_reorder(fft_Complex* data, int bits);
+int fft_level(fft_Complex val);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Finds the cos and sin of m / FFT_MAX_POINTS of a turn in Q1.15, for m from
+// 0 to FFT_MAX_POINTS - 1.
+void fft_twiddle(int m, int* c, int* s)
+{
+    int r;
+
+    r = m & bitMask(FFT_MAX_BITS - 2);
+
+    switch (m >> (FFT_MAX_BITS - 2)) {
+        case 0:
+            *s = fft_quarterSine[r];
+            *c = fft_quarterSine[(FFT_MAX_POINTS >> 2) - r];
+            break;
+        case 1:
+            *s = fft_quarterSine[(FFT_MAX_POINTS >> 2) - r];
+            *c = -fft_quarterSine[r];
+            break;
+        case 2:
+            *s = -fft_quarterSine[r];
+            *c = -fft_quarterSine[(FFT_MAX_POINTS >> 2) - r];
+            break;
+        default:
+            *s = -fft_quarterSine[(FFT_MAX_POINTS >> 2) - r];
+            *c = fft_quarterSine[r];
+            break;
+    }
+}
+
+// Reverses the lowest bits bits of i, by looking up each byte.
+int fft_reverseIndex(int i, int bits)
+{
+    return ((fft_reverseByte[i & 0xff] << 8) | fft_reverseByte[(i >> 8) & 0xff])
+        >> (16 - bits);
+}
+
+// Multiplies re + i im by the twiddle c - i s, which turns it clockwise by
+// the twiddle's angle. Rounds to nearest.
+static inline void fft_rotate(fft_Complex* dest, int re, int im, int c,
+    int s)
+{
+    dest->re = (int) (((long long) re * c + (long long) im * s
+        + (1 << (FFT_TWIDDLE_SHIFT - 1))) >> FFT_TWIDDLE_SHIFT);
+    dest->im = (int) (((long long) im * c - (long long) re * s
+        + (1 << (FFT_TWIDDLE_SHIFT - 1))) >> FFT_TWIDDLE_SHIFT);
+}
+
+// Fills data with 2^bits samples from the A/D converter, ready to transform.
+// The average is taken off so it doesn't swamp the lowest bins, and a Hann
+// window is applied so a tone between two bins doesn't smear across the rest.
+void fft_load(fft_Complex* data, const short* samples, int bits)
+{
+    int i, n, step, c, s, val, window; long sum, mean;
+
+    n = 1 << bits;
+    step = FFT_MAX_POINTS >> bits;
+
+    sum = 0;
+    for (i = 0; i < n; ++i) sum += samples[i];
+    mean = sum >> bits;
+
+    for (i = 0; i < n; ++i) {
+        // The window is (1 - cos) / 2 over a whole turn.
+        fft_twiddle(i * step, &c, &s);
+
+        window = ((1 << FFT_TWIDDLE_SHIFT) - c) >> 1;
+        val = (samples[i] - mean) * (1 << FFT_SAMPLE_SHIFT);
+
+        data[i].re = (int) (((long long) val * window) >> FFT_TWIDDLE_SHIFT);
+        data[i].im = 0;
+    }
+}
+
+// Transforms 2^bits points in place, leaving bin k at data[k] divided by the
+// number of points. bits must be from FFT_MIN_BITS to FFT_MAX_BITS, and
+// values must be no more than 2^29 in size.
+void fft_transform(fft_Complex* data, int bits)
+{
+    int n, len, q, j, g, step, c1, s1, c2, s2, c3, s3;
+    int ar, ai, br, bi, ur, ui, vr, vi;
+    fft_Complex *x0, *x1, *x2, *x3;
+
+    n = 1 << bits;
+
+    // Each radix-4 pass does the work of two radix-2 decimation in frequency
+    // passes over blocks of len points. The middle two outputs of each
+    // butterfly are swapped to match, so the result comes out in bit
+    // reversed order rather than base 4 digit reversed order.
+    for (len = n; len >= 4; len >>= 2) {
+        q = len >> 2;
+        step = FFT_MAX_POINTS / len;
+
+        for (j = 0; j < q; ++j) {
+            // The twiddles only depend on the position within the block, so
+            // are looked up once for every block.
+            fft_twiddle(j * step, &c1, &s1);
+            fft_twiddle(2 * j * step, &c2, &s2);
+            fft_twiddle(3 * j * step, &c3, &s3);
+
+            for (g = j; g < n; g += len) {
+                x0 = &data[g];
+                x1 = x0 + q;
+                x2 = x1 + q;
+                x3 = x2 + q;
+
+                // Scale by a quarter on the way in, to match the gain of
+                // the butterfly, rounding to nearest so the error doesn't
+                // build up in one direction over the passes.
+                ar = (x0->re + x2->re + 2) >> 2;
+                ai = (x0->im + x2->im + 2) >> 2;
+                br = (x1->re + x3->re + 2) >> 2;
+                bi = (x1->im + x3->im + 2) >> 2;
+                ur = (x0->re - x2->re + 2) >> 2;
+                ui = (x0->im - x2->im + 2) >> 2;
+
+                // v is x1 - x3 turned a quarter turn clockwise.
+                vr = (x1->im - x3->im + 2) >> 2;
+                vi = (x3->re - x1->re + 2) >> 2;
+
+                x0->re = ar + br;
+                x0->im = ai + bi;
+                fft_rotate(x1, ar - br, ai - bi, c2, s2);
+                fft_rotate(x2, ur + vr, ui + vi, c1, s1);
+                fft_rotate(x3, ur - vr, ui - vi, c3, s3);
+            }
+        }
+    }
+
+    // An odd number of bits leaves a final radix-2 pass, which has no
+    // twiddles.
+    if (len == 2) {
+        for (g = 0; g < n; g += 2) {
+            x0 = &data[g];
+            x1 = x0 + 1;
+
+            ar = x0->re >> 1;
+            ai = x0->im >> 1;
+            br = x1->re >> 1;
+            bi = x1->im >> 1;
+
+            x0->re = ar + br;
+            x0->im = ai + bi;
+            x1->re = ar - br;
+            x1->im = ai - bi;
+        }
+    }
+
+    fft_reorder(data, bits);
+}
+
+// Swaps each point with the one at its bit reversed position.
+void fft_reorder(fft_Complex* data, int bits)
+{
+    int i, j, n; fft_Complex t;
+
+    n = 1 << bits;
+
+    for (i = 0; i < n; ++i) {
+        j = fft_reverseIndex(i, bits);
+        if (j > i) {
+            t = data[i];
+            data[i] = data[j];
+            data[j] = t;
+        }
+    }
+}
+
+// Gives the power of a bin on a log scale, as log2(re^2 + im^2) with
+// FFT_LEVEL_FRAC fractional bits. Each step of 1 << FFT_LEVEL_FRAC is about
+// 3 dB. Gives 0 for an empty bin.
+int fft_level(fft_Complex val)
+{
+    unsigned long long power, rest; int bit, frac;
+
+    power = (unsigned long long) ((long long) val.re * val.re)
+        + (unsigned long long) ((long long) val.im * val.im);
+
+    if (power == 0) return 0;
+
+    // Find the highest set bit by halves, as prof_bucket does.
+    rest = power;
+    bit = 0;
+    if (rest >= 1ULL << 32) { rest >>= 32; bit += 32; }
+    if (rest >= 1ULL << 16) { rest >>= 16; bit += 16; }
+    if (rest >= 1ULL << 8) { rest >>= 8; bit += 8; }
+    if (rest >= 1ULL << 4) { rest >>= 4; bit += 4; }
+    if (rest >= 1ULL << 2) { rest >>= 2; bit += 2; }
+    if (rest >= 1ULL << 1) { bit += 1; }
+
+    // The bits below the highest one make a close enough fraction.
+    frac = bit >= FFT_LEVEL_FRAC
+        ? (int) (power >> (bit - FFT_LEVEL_FRAC))
+        : (int) (power << (FFT_LEVEL_FRAC - bit));
+
+    return (bit << FFT_LEVEL_FRAC) | (frac & bitMask(FFT_LEVEL_FRAC));
+}
+
+#endif
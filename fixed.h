@@ -0,0 +1,275 @@
+/**
+ * File Name  : fixed.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Integer replacements for the soft-float libm functions used on
+ *              hot paths. Values are Q16.16 fixed point unless stated
+ *              otherwise, and angles are measured in turns so that a whole
+ *              revolution is FIXED_ONE.
+ */
+
+#ifndef FIXED_H_GUARD
+#define FIXED_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Number of fractional bits in a fixed point value.
+#define FIXED_SHIFT 16
+
+// Fixed point representations of some handy numbers.
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define FIXED_HALF (1 << (FIXED_SHIFT - 1))
+#define FIXED_MAX 0x7fffffff
+
+// Number of fractional bits in the values held by the sine table.
+#define FIXED_SIN_SHIFT 15
+
+// The sine table has 2^FIXED_SIN_BITS segments per turn.
+#define FIXED_SIN_BITS 8
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Conversions between integers and fixed point. fixed_toInt truncates towards
+// negative infinity, fixed_round rounds to the nearest integer.
+#define fixed_fromInt(i) ((fixed) (i) << FIXED_SHIFT)
+#define fixed_toInt(f) ((f) >> FIXED_SHIFT)
+#define fixed_round(f) (((f) + FIXED_HALF) >> FIXED_SHIFT)
+
+// Conversions between floating point and fixed point. Try to keep these out of
+// inner loops, they still go through the soft-float library.
+#define fixed_fromFloat(x) ((fixed) ((x) * (float) FIXED_ONE))
+#define fixed_toFloat(f) ((f) * (1.0f / FIXED_ONE))
+
+// Conversions between Q16.16 and other Q formats with n fractional bits.
+#define fixed_fromQ(x, n) ((n) <= FIXED_SHIFT \
+    ? (fixed) (x) << (FIXED_SHIFT - (n)) : (fixed) (x) >> ((n) - FIXED_SHIFT))
+#define fixed_toQ(f, n) ((n) >= FIXED_SHIFT \
+    ? (f) << ((n) - FIXED_SHIFT) : (f) >> (FIXED_SHIFT - (n)))
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A signed Q16.16 fixed point number.
+typedef int fixed;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+fixed fixed_mul(fixed a, fixed b);
+int fixed_mulInt(fixed a, int b);
+
+fixed fixed_sin(fixed turns);
+fixed fixed_cos(fixed turns);
+
+unsigned int fixed_isqrt(unsigned int val);
+fixed fixed_sqrt(fixed val);
+
+fixed fixed_recip(fixed val);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Multiplies two fixed point numbers, rounding to the nearest representable
+// result. Exact to within half an LSB as long as the result fits.
+fixed fixed_mul(fixed a, fixed b)
+{
+    return (fixed) (((long long) a * b + FIXED_HALF) >> FIXED_SHIFT);
+}
+
+// Multiplies a fixed point number by an integer, giving the nearest integer
+// result. Useful for scaling values too large to convert to fixed point.
+int fixed_mulInt(fixed a, int b)
+{
+    return (int) (((long long) a * b + FIXED_HALF) >> FIXED_SHIFT);
+}
+
+// Finds the sine of the given angle, where FIXED_ONE is a whole turn. Uses a
+// 256 segment table with linear interpolation between entries. The absolute
+// error compared to libm's sin is at most 1.5e-4 (about 10 LSBs) for any input.
+fixed fixed_sin(fixed turns)
+{
+    // One full turn of sin, in Q1.15, with the first entry repeated at the end
+    // so interpolation never has to wrap.
+    static const short table[(1 << FIXED_SIN_BITS) + 1] = {
+             0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+          6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+         12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+         18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+         23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+         27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+         30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+         32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+         32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+         32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+         30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+         27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+         23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+         18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+         12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+          6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+             0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+         -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+        -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+        -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+        -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+        -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+        -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+        -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+        -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+        -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+        -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+        -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+        -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+        -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+        -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+         -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+             0
+
+    };
+
+    int i, frac, a, b;
+
+    // Use the top bits of the fractional part of the angle to pick a table
+    // segment, and the rest to interpolate along it.
+    i = (turns >> (FIXED_SHIFT - FIXED_SIN_BITS)) & bitMask(FIXED_SIN_BITS);
+    frac = turns & bitMask(FIXED_SHIFT - FIXED_SIN_BITS);
+
+    a = table[i];
+    b = table[i + 1];
+
+    a += ((b - a) * frac) >> (FIXED_SHIFT - FIXED_SIN_BITS);
+
+    return fixed_fromQ(a, FIXED_SIN_SHIFT);
+}
+
+// Finds the cosine of the given angle, where FIXED_ONE is a whole turn. Has
+// the same error bound as fixed_sin.
+fixed fixed_cos(fixed turns)
+{
+    return fixed_sin(turns + (FIXED_ONE >> 2));
+}
+
+// Finds the square root of an integer, rounded down. Always exact.
+unsigned int fixed_isqrt(unsigned int val)
+{
+    unsigned int res, bit;
+
+    res = 0;
+
+    // Start at the highest power of four that doesn't exceed the input.
+    bit = 1u << 30;
+    while (bit > val) bit >>= 2;
+
+    // Work out one bit of the result per iteration.
+    while (bit != 0) {
+        if (val >= res + bit) {
+            val -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return res;
+}
+
+// Finds the square root of a non-negative fixed point number, rounded to the
+// nearest representable result, so the error is at most half an LSB. Negative
+// inputs give zero.
+fixed fixed_sqrt(fixed val)
+{
+    unsigned long long rem, res, bit;
+
+    if (val <= 0) return 0;
+
+    // sqrt(val / 2^16) * 2^16 == sqrt(val * 2^16), so take the integer square
+    // root of the input with another 16 fractional bits.
+    rem = (unsigned long long) val << FIXED_SHIFT;
+    res = 0;
+
+    bit = 1ull << 46;
+    while (bit > rem) bit >>= 2;
+
+    while (bit != 0) {
+        if (rem >= res + bit) {
+            rem -= res + bit;
+            res = (res >> 1) + bit;
+        } else {
+            res >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    // Round up if the remainder puts us past the half way point.
+    if (rem > res) ++res;
+
+    return (fixed) res;
+}
+
+// Finds 1 / val. Normalises the input into [0.5, 1), makes a linear first
+// guess and refines it with three Newton-Raphson iterations, then nudges the
+// result to the nearest, so no division is needed. The result is within half
+// an LSB of the exact value, and saturates at +/- FIXED_MAX when it doesn't
+// fit (including for zero).
+fixed fixed_recip(fixed val)
+{
+    unsigned int v, m, r, e; unsigned long long res, twice; int n, i;
+    bool neg;
+
+    neg = val < 0;
+    v = (unsigned int) abs(val);
+    m = v;
+
+    if (m == 0) return FIXED_MAX;
+
+    // Shift the input up until its top bit is set, so that as a 0.32 fraction
+    // it lies in [0.5, 1). Takes five steps rather than up to 31.
+    n = 0;
+    if (!(m & 0xffff0000u)) { m <<= 16; n += 16; }
+    if (!(m & 0xff000000u)) { m <<= 8;  n += 8;  }
+    if (!(m & 0xf0000000u)) { m <<= 4;  n += 4;  }
+    if (!(m & 0xc0000000u)) { m <<= 2;  n += 2;  }
+    if (!(m & 0x80000000u)) { m <<= 1;  n += 1;  }
+
+    // First guess of 48/17 - 32/17 * m, with the reciprocal held as a 2.30
+    // fraction. Never more than 1/17 out.
+    r = 3031741621u - (unsigned int) (((unsigned long long) 2021161081u * m) >> 32);
+
+    // Each iteration of r = r * (2 - m * r) roughly squares the error.
+    for (i = 0; i < 3; ++i) {
+        e = (unsigned int) (((unsigned long long) m * r) >> 32);
+        r = (unsigned int) (((unsigned long long) r * ((2u << 30) - e)) >> 30);
+    }
+
+    // Undo the normalisation. The input was val * 2^(n - 32) as a fraction,
+    // so the result is r * 2^(n - 30) once converted back to Q16.16.
+    if (n > 30) return neg ? -FIXED_MAX : FIXED_MAX;
+    res = ((unsigned long long) r + (1u << (30 - n) >> 1)) >> (30 - n);
+
+    // That can be out by one where the result has more bits than r had to
+    // spare. The exact result is 2^32 / v, so the nearest has res * v
+    // within v / 2 of 2^32.
+    twice = 2 * res * v;
+    if (twice > (1ull << 33) + v) --res;
+    else if (twice + v < (1ull << 33)) ++res;
+
+    if (res > FIXED_MAX) return neg ? -FIXED_MAX : FIXED_MAX;
+
+    return neg ? -(fixed) res : (fixed) res;
+}
+
+#endif
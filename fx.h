@@ -0,0 +1,325 @@
+/**
+ * File Name  : fx.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Audio effects that work on a block of samples at a time, and
+ *              chains that run several in turn. Samples are centred on zero,
+ *              with room to go well past the 10 bit range in between effects.
+ *
+ *              Each effect is a struct of its own that starts with an
+ *              fx_Effect, which holds the function that processes a block.
+ *              A chain is just a list of pointers to effects declared
+ *              anywhere, so effects can be added and taken away while audio
+ *              is running without allocating anything, as long as the code
+ *              running the chain is kept out while it changes.
+ *
+ *              There is a gain, a noise gate that fades out anything quieter
+ *              than a threshold, a compressor that pulls anything louder than
+ *              a threshold back towards it, and an echo with feedback whose
+ *              delay line can be as long as the memory given to it.
+ */
+
+#ifndef FX_H_GUARD
+#define FX_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "ramfunc.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The most effects one chain can hold.
+#define FX_MAX_EFFECTS 8
+
+// Number of fractional bits in the gains the gate and compressor work out.
+#define FX_GAIN_SHIFT 15
+#define FX_UNITY (1 << FX_GAIN_SHIFT)
+
+// How quickly the gate opens and closes, as the change in its gain each
+// sample. At 44.1 kHz it opens in about a millisecond, so the start of a
+// note isn't lost, and closes over about 50 ms, so the end of one isn't cut
+// off.
+#define FX_GATE_OPEN_STEP 745
+#define FX_GATE_CLOSE_STEP 15
+
+// How quickly the gate's measure of the level dies away once the signal
+// goes quiet, as a power of two fraction each sample.
+#define FX_GATE_DECAY_SHIFT 10
+
+// How quickly the compressor's measure of the level dies away, as a power of
+// two fraction each block, and how much of the way towards its new gain it
+// moves each block.
+#define FX_COMPRESSOR_DECAY_SHIFT 4
+#define FX_COMPRESSOR_SMOOTH_SHIFT 2
+
+// The range of samples that can be kept in an echo's delay line.
+#define FX_ECHO_MIN -32768
+#define FX_ECHO_MAX 32767
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+typedef struct fx_Effect fx_Effect;
+
+// Processes a block of samples in place.
+typedef void (*fx_ProcessFunc)(fx_Effect* effect, int* block, int length);
+
+// The part every effect starts with.
+struct fx_Effect {
+    fx_ProcessFunc process;
+};
+
+// A list of effects run one after another.
+typedef struct {
+    fx_Effect* effects[FX_MAX_EFFECTS];
+    int count;
+} fx_Chain;
+
+// Scales every sample by gain out of 256.
+typedef struct {
+    fx_Effect effect;
+    volatile int gain;
+} fx_Gain;
+
+// Fades out the signal while its level is under threshold. The level is the
+// peak of the signal, dying away slowly, with 8 fractional bits.
+typedef struct {
+    fx_Effect effect;
+    int threshold;
+    int level;
+    int gain;
+} fx_Gate;
+
+// Divides how far the level is over threshold by ratio. The level is worked
+// out and the gain changed once a block, and the gain slides from the old
+// value to the new over the block so it never steps.
+typedef struct {
+    fx_Effect effect;
+    int threshold;
+    int ratio;
+    int level;
+    int gain;
+} fx_Compressor;
+
+// Mixes in the signal from delay samples ago at mix out of 256, and feeds it
+// back into the delay line at feedback out of 256.
+typedef struct {
+    fx_Effect effect;
+    short* line;
+    unsigned long length;
+    unsigned long head;
+    unsigned long delay;
+    int feedback;
+    int mix;
+} fx_Echo;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void fx_initChain(fx_Chain* chain);
+bool fx_addEffect(fx_Chain* chain, fx_Effect* effect);
+void fx_runChain(fx_Chain* chain, int* block, int length);
+
+void fx_initGain(fx_Gain* gain, int level);
+void fx_setGain(fx_Gain* gain, int level);
+void fx_processGain(fx_Effect* effect, int* block, int length) RAMFUNC;
+
+void fx_initGate(fx_Gate* gate, int threshold);
+void fx_processGate(fx_Effect* effect, int* block, int length) RAMFUNC;
+
+void fx_initCompressor(fx_Compressor* comp, int threshold, int ratio);
+void fx_processCompressor(fx_Effect* effect, int* block, int length)
+    RAMFUNC;
+
+void fx_initEcho(fx_Echo* echo, short* line, unsigned long length,
+    unsigned long delay, int feedback, int mix);
+void fx_processEcho(fx_Effect* effect, int* block, int length) RAMFUNC;
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Empties a chain, so blocks run through it come out unchanged.
+void fx_initChain(fx_Chain* chain)
+{
+    chain->count = 0;
+}
+
+// Adds an effect to the end of a chain. Returns FALSE if the chain is full.
+bool fx_addEffect(fx_Chain* chain, fx_Effect* effect)
+{
+    if (chain->count >= FX_MAX_EFFECTS) return FALSE;
+
+    chain->effects[chain->count++] = effect;
+    return TRUE;
+}
+
+// Runs a block through every effect in a chain, in order.
+void fx_runChain(fx_Chain* chain, int* block, int length)
+{
+    int i;
+
+    for (i = 0; i < chain->count; ++i) {
+        chain->effects[i]->process(chain->effects[i], block, length);
+    }
+}
+
+// Sets up a gain of level out of 256.
+void fx_initGain(fx_Gain* gain, int level)
+{
+    gain->effect.process = fx_processGain;
+    gain->gain = level;
+}
+
+// Changes a gain to level out of 256, from the next block on. Safe to call
+// while the chain is running.
+void fx_setGain(fx_Gain* gain, int level)
+{
+    gain->gain = level;
+}
+
+// Scales a block by a gain. Run by fx_runChain, like each process function.
+void fx_processGain(fx_Effect* effect, int* block, int length)
+{
+    int i, level;
+
+    level = ((fx_Gain*) effect)->gain;
+    for (i = 0; i < length; ++i) block[i] = (block[i] * level) >> 8;
+}
+
+// Sets up a gate that stays open while the peak level is at least threshold,
+// in the same units as the samples. It starts out closed.
+void fx_initGate(fx_Gate* gate, int threshold)
+{
+    gate->effect.process = fx_processGate;
+    gate->threshold = threshold << 8;
+    gate->level = 0;
+    gate->gain = 0;
+}
+
+// Passes a block through a gate, opening and closing it as the level
+// crosses the threshold.
+void fx_processGate(fx_Effect* effect, int* block, int length)
+{
+    fx_Gate* gate; int i, peak, level, gain;
+
+    gate = (fx_Gate*) effect;
+    level = gate->level;
+    gain = gate->gain;
+
+    for (i = 0; i < length; ++i) {
+        // Follow peaks straight away, but let the level fall slowly.
+        peak = abs(block[i]) << 8;
+        level = peak > level ? peak : level - (level >> FX_GATE_DECAY_SHIFT);
+
+        if (level >= gate->threshold) {
+            gain = min(gain + FX_GATE_OPEN_STEP, FX_UNITY);
+        } else {
+            gain = max(gain - FX_GATE_CLOSE_STEP, 0);
+        }
+
+        block[i] = (block[i] * gain) >> FX_GAIN_SHIFT;
+    }
+
+    gate->level = level;
+    gate->gain = gain;
+}
+
+// Sets up a compressor that divides how far the peak level is over
+// threshold, in the same units as the samples, by ratio.
+void fx_initCompressor(fx_Compressor* comp, int threshold, int ratio)
+{
+    comp->effect.process = fx_processCompressor;
+    comp->threshold = threshold;
+    comp->ratio = ratio;
+    comp->level = 0;
+    comp->gain = FX_UNITY;
+}
+
+// Passes a block through a compressor.
+void fx_processCompressor(fx_Effect* effect, int* block, int length)
+{
+    fx_Compressor* comp; int i, peak, target, gain, step;
+
+    comp = (fx_Compressor*) effect;
+
+    // Find the block's peak, and let the level fall slowly if it's lower.
+    peak = 0;
+    for (i = 0; i < length; ++i) peak = max(peak, abs(block[i]));
+    comp->level = max(peak, comp->level
+        - (comp->level >> FX_COMPRESSOR_DECAY_SHIFT));
+
+    // The gain that would bring the level down to where it should be. The
+    // divides are done once a block, not once a sample.
+    if (comp->level > comp->threshold) {
+        target = (int) ((((long long) comp->threshold
+            + (comp->level - comp->threshold) / comp->ratio)
+            << FX_GAIN_SHIFT) / comp->level);
+    } else {
+        target = FX_UNITY;
+    }
+
+    // Move part of the way there, sliding across the block.
+    gain = comp->gain;
+    comp->gain += (target - comp->gain) >> FX_COMPRESSOR_SMOOTH_SHIFT;
+    step = (comp->gain - gain) / length;
+
+    for (i = 0; i < length; ++i) {
+        gain += step;
+        block[i] = (block[i] * gain) >> FX_GAIN_SHIFT;
+    }
+}
+
+// Sets up an echo of delay samples, with a delay line of length samples at
+// line, which must be more than delay. The line is cleared, so the echo
+// starts out silent.
+void fx_initEcho(fx_Echo* echo, short* line, unsigned long length,
+    unsigned long delay, int feedback, int mix)
+{
+    unsigned long i;
+
+    echo->effect.process = fx_processEcho;
+    echo->line = line;
+    echo->length = length;
+    echo->head = 0;
+    echo->delay = min(delay, length - 1);
+    echo->feedback = feedback;
+    echo->mix = mix;
+
+    for (i = 0; i < length; ++i) line[i] = 0;
+}
+
+// Mixes the delayed signal into a block, and feeds the block into the
+// delay line.
+void fx_processEcho(fx_Effect* effect, int* block, int length)
+{
+    fx_Echo* echo; int i, delayed, fed; unsigned long head, tail;
+
+    echo = (fx_Echo*) effect;
+    head = echo->head;
+    tail = head >= echo->delay ? head - echo->delay
+        : head + echo->length - echo->delay;
+
+    for (i = 0; i < length; ++i) {
+        delayed = echo->line[tail];
+
+        fed = block[i] + ((delayed * echo->feedback) >> 8);
+        echo->line[head] = (short) min(max(fed, FX_ECHO_MIN), FX_ECHO_MAX);
+
+        block[i] += (delayed * echo->mix) >> 8;
+
+        if (++head >= echo->length) head = 0;
+        if (++tail >= echo->length) tail = 0;
+    }
+
+    echo->head = head;
+}
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * File Name  : graph.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Draws an amplitude graph of a long run of samples as a
+ *              coroutine (see pt.h), a slice at a time, so a recording of
+ *              minutes can be shown without holding anything else up.
+ */
+
+#ifndef GRAPH_H_GUARD
+#define GRAPH_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "pt.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// How many samples are summed, or graph columns drawn, in each slice of
+// graph_step before it yields.
+#define GRAPH_SAMPLES_PER_SLICE 32768
+#define GRAPH_COLUMNS_PER_SLICE 4
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Everything graph_step needs to remember between slices.
+typedef struct {
+    pt_Thread pt;
+    const short* samples;
+    int x, y, w, h;
+    unsigned long b, total;
+    long long sum;
+    int i, count;
+    short prev, avg, rangeMin, rangeMax;
+} graph_Draw;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void graph_start(graph_Draw* graph, const short* samples, unsigned long total,
+    int x, int y, int w, int h);
+int graph_step(graph_Draw* graph);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Start drawing a graph of the amplitude of the given samples, with the given
+// position and size. The drawing itself is done a slice at a time by
+// graph_step. The samples must stay put until the graph is finished.
+void graph_start(graph_Draw* graph, const short* samples, unsigned long total,
+    int x, int y, int w, int h)
+{
+    PT_INIT(&graph->pt);
+
+    graph->samples = samples;
+    graph->x = x;
+    graph->y = y;
+    graph->w = w;
+    graph->h = h;
+    graph->total = total;
+    graph->count = 0;
+}
+
+// Draw the next slice of a graph of the amplitude of the samples.
+// Finds the minimum and maximum samples, average sample, and then uses the
+// magnitude of the difference between each sample and the average to
+// generate the graph which is appropriately scaled so that the maximum and
+// minimum values fill the graph area. Returns PT_ENDED once the graph is
+// complete, and PT_YIELDED if there is more to do.
+int graph_step(graph_Draw* graph)
+{
+    short val, valMin, valMax;
+    unsigned long b, start, end;
+
+    PT_BEGIN(&graph->pt);
+
+    // Default values for the range which will naturally be replaced by the
+    // first sample.
+    graph->rangeMin = 0x3ff;
+    graph->rangeMax = 0x000;
+    graph->sum = 0;
+
+    // Find the true values for the range, and find the sum from which an
+    // average may be calculated. A whole recording takes a while to get
+    // through, so do it in chunks.
+    for (graph->b = 0; graph->b < graph->total; ) {
+        end = min(graph->b + GRAPH_SAMPLES_PER_SLICE, graph->total);
+
+        for (b = graph->b; b < end; ++b) {
+            val = graph->samples[b];
+            graph->sum += val;
+
+            if (val > graph->rangeMax) graph->rangeMax = val;
+            if (val < graph->rangeMin) graph->rangeMin = val;
+        }
+
+        graph->b = end;
+        PT_YIELD(&graph->pt);
+    }
+
+    // Find the true mean as the sum divided by the number of samples.
+    graph->avg = graph->sum / graph->total;
+
+    // Find the largest difference from the average, making sure a silent
+    // recording doesn't leave us dividing by zero.
+    graph->rangeMax = max(graph->rangeMax - graph->avg,
+        graph->avg - graph->rangeMin);
+    graph->rangeMax = max(graph->rangeMax, 1);
+
+    graph->prev = 0;
+    for (graph->i = 0; graph->i < graph->w; ++graph->i) {
+        // Each column of pixels will represent many samples, so find the range
+        // of samples to.. sample from.
+        start = (graph->i * graph->total) / graph->w;
+        end = ((graph->i + 1) * graph->total) / graph->w;
+
+        // If the size of the sample sample is zero we can skip this column.
+        if (start == end) continue;
+
+        // Find the largest and smallest samples from the sample sample.
+        valMin = 0x3ff;
+        valMax = 0x000;
+        for (b = start; b < end; ++b) {
+            val = graph->samples[b];
+            if (val < valMin) valMin = val;
+            if (val > valMax) valMax = val;
+        }
+
+        // Find the largest difference from the mean.
+        val = max(abs(valMax - graph->avg), abs(graph->avg - valMin));
+
+        // Draw a line from the previous column of the graph to this column's
+        // value, scaled to fit the graph height.
+        lcd_line(graph->x + graph->i - 1,
+            graph->y + graph->h - (graph->prev * graph->h) / graph->rangeMax,
+            graph->x + graph->i,
+            graph->y + graph->h - (val * graph->h) / graph->rangeMax, WHITE);
+
+        // Remember the last value drawn so a line can be drawn from it.
+        graph->prev = val;
+
+        PT_YIELD_EVERY(&graph->pt, graph->count, GRAPH_COLUMNS_PER_SLICE);
+    }
+
+    PT_END(&graph->pt);
+}
+
+#endif
@@ -0,0 +1,229 @@
+/**
+ * File Name  : ffttest.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host test for fft.h. Checks the transform against a DFT done
+ *              the slow way in double precision, at every size from
+ *              2^FFT_MIN_BITS to 2^FFT_MAX_BITS points, both for recorded
+ *              audio loaded by fft_load and for full range complex noise.
+ *              Checks fft_level against log2, then times each size.
+ * Usage      : ffttest
+ *              Build with "make ffttest", or run with the rest by "make
+ *              check".
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include <math.h>
+
+#include "host.h"
+#include "rng.h"
+#include "fft.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The least signal to error ratio the transform must manage, in dB. It
+// gives 88 to 95 dB at every size. That's far above what the 10-bit A/D
+// converter itself can give, so the transform never adds noise that could
+// be seen.
+#define MIN_SNR 85.0
+
+// The size of the complex noise, just under the most fft_transform takes.
+#define NOISE_RANGE (1 << 28)
+
+// How far under log2 fft_level may be, in steps of its last bit.
+#define LEVEL_BOUND 1.35
+
+// The number of random values fft_level is checked on.
+#define LEVEL_TRIALS 1000000
+
+// The number of transforms timed at each size.
+#define TIMED_TRANSFORMS 2000
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The samples transformed, the transform's input and output, and the
+// reference DFT's output.
+short samples[FFT_MAX_POINTS];
+fft_Complex input[FFT_MAX_POINTS];
+fft_Complex data[FFT_MAX_POINTS];
+double refRe[FFT_MAX_POINTS];
+double refIm[FFT_MAX_POINTS];
+
+// Where the test signals come from.
+rng_State rng;
+
+// Somewhere for timed results to go, so they aren't optimised away.
+volatile int sink;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void referenceDft(int bits);
+double compare(int bits, double* worst);
+void checkAudio(int bits);
+void checkNoise(int bits);
+void checkLevel(void);
+void timeAll(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Transforms input the slow way in double precision into refRe and refIm,
+// divided by the number of points as fft_transform's output is.
+void referenceDft(int bits)
+{
+    int n, i, k, m; double re, im, turn;
+
+    n = 1 << bits;
+    turn = 2.0 * PI / n;
+
+    for (k = 0; k < n; ++k) {
+        re = im = 0.0;
+        for (i = 0; i < n; ++i) {
+            // The turn for point i in bin k wraps every n.
+            m = (int) (((long long) i * k) & (n - 1));
+            re += input[i].re * cos(turn * m) + input[i].im * sin(turn * m);
+            im += input[i].im * cos(turn * m) - input[i].re * sin(turn * m);
+        }
+        refRe[k] = re / n;
+        refIm[k] = im / n;
+    }
+}
+
+// Transforms input with fft_transform and compares the result with the
+// reference. Gives the signal to error ratio in dB, and sets worst to the
+// largest error in any bin.
+double compare(int bits, double* worst)
+{
+    int n, k; double dr, di, signal, noise;
+
+    n = 1 << bits;
+    memcpy(data, input, n * sizeof(fft_Complex));
+    fft_transform(data, bits);
+    referenceDft(bits);
+
+    signal = noise = *worst = 0.0;
+    for (k = 0; k < n; ++k) {
+        dr = data[k].re - refRe[k];
+        di = data[k].im - refIm[k];
+
+        signal += refRe[k] * refRe[k] + refIm[k] * refIm[k];
+        noise += dr * dr + di * di;
+        *worst = fmax(*worst, sqrt(dr * dr + di * di));
+    }
+
+    return noise == 0.0 ? INFINITY : 10.0 * log10(signal / noise);
+}
+
+// Checks the transform of something like a recording: two tones falling
+// between bins, filling most of the A/D converter's range, with a little
+// noise on top, loaded by fft_load.
+void checkAudio(int bits)
+{
+    int n, i; double snr, worst;
+
+    n = 1 << bits;
+    for (i = 0; i < n; ++i) {
+        samples[i] = (short) (512.0
+            + 300.0 * sin(2.0 * PI * 37.3 * i / n)
+            + 150.0 * sin(2.0 * PI * 101.7 * i / n)
+            + (double) (rng_next(&rng) >> 27) - 16.0);
+    }
+
+    fft_load(input, samples, bits);
+    snr = compare(bits, &worst);
+
+    printf("%4d points, audio: SNR %5.1f dB, worst bin error %4.1f\n",
+        n, snr, worst);
+    host_check(snr >= MIN_SNR, "%d point audio SNR %.1f dB", n, snr);
+}
+
+// Checks the transform of complex noise as large as fft_transform takes,
+// which has something in every bin.
+void checkNoise(int bits)
+{
+    int n, i; double snr, worst;
+
+    n = 1 << bits;
+    for (i = 0; i < n; ++i) {
+        input[i].re = (int) (rng_next(&rng) % (2 * NOISE_RANGE)) - NOISE_RANGE;
+        input[i].im = (int) (rng_next(&rng) % (2 * NOISE_RANGE)) - NOISE_RANGE;
+    }
+
+    snr = compare(bits, &worst);
+
+    printf("%4d points, noise: SNR %5.1f dB, worst bin error %4.1f\n",
+        n, snr, worst);
+    host_check(snr >= MIN_SNR, "%d point noise SNR %.1f dB", n, snr);
+}
+
+// Checks fft_level against log2 of the power for random bins of every size.
+// The fraction is just the two bits under the highest, cut short, which is
+// never over and at most 1.35 steps under.
+void checkLevel(void)
+{
+    int i, level; fft_Complex val; double exact; bool good;
+
+    val.re = val.im = 0;
+    good = fft_level(val) == 0;
+
+    for (i = 0; i < LEVEL_TRIALS && good; ++i) {
+        val.re = (int) rng_next(&rng) >> (rng_next(&rng) % 32);
+        val.im = (int) rng_next(&rng) >> (rng_next(&rng) % 32);
+        if (val.re == 0 && val.im == 0) continue;
+
+        level = fft_level(val);
+        exact = log2((double) val.re * val.re + (double) val.im * val.im)
+            * (1 << FFT_LEVEL_FRAC);
+        good = level <= exact + 1e-9 && level > exact - LEVEL_BOUND;
+    }
+
+    host_check(good, "fft_level(%d, %d) gave %d", val.re, val.im,
+        fft_level(val));
+}
+
+// Times a transform at every size.
+void timeAll(void)
+{
+    int bits, i; double start;
+
+    for (bits = FFT_MIN_BITS; bits <= FFT_MAX_BITS; ++bits) {
+        fft_load(input, samples, bits);
+
+        start = host_now();
+        for (i = 0; i < TIMED_TRANSFORMS; ++i) {
+            memcpy(data, input, sizeof(fft_Complex) << bits);
+            fft_transform(data, bits);
+        }
+
+        printf("%4d points  %7.2f us\n", 1 << bits,
+            (host_now() - start) * 1e6 / TIMED_TRANSFORMS);
+        sink = data[1].re;
+    }
+}
+
+// Runs every check, then the timings. Exits with 0 if every check passed.
+int main(void)
+{
+    int bits;
+
+    rng_seed(&rng, 43);
+
+    for (bits = FFT_MIN_BITS; bits <= FFT_MAX_BITS; ++bits) {
+        checkAudio(bits);
+        checkNoise(bits);
+    }
+    checkLevel();
+    timeAll();
+
+    return host_finish("ffttest");
+}
@@ -0,0 +1,209 @@
+/**
+ * File Name  : fixedtest.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host test for fixed.h. Checks every function against libm in
+ *              double precision, over the whole of its input range, against
+ *              the error bound its comment gives, then times each one next
+ *              to the libm call it replaces.
+ * Usage      : fixedtest
+ *              Build with "make fixedtest", or run with the rest by "make
+ *              check".
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include <math.h>
+
+#include "host.h"
+#include "fixed.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The error bounds given in fixed.h: that of the sine and cosine, as a
+// fraction of one, and half an LSB for the rest.
+#define SIN_BOUND 1.5e-4
+#define HALF_LSB (0.5 / FIXED_ONE)
+
+// A little slack on the half LSB bounds for the rounding of the double
+// precision reference itself.
+#define SLACK 1e-9
+
+// The number of calls timed for each function.
+#define TIMED_CALLS 10000000
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Somewhere for timed results to go, so they aren't optimised away.
+volatile int sink;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+double toDouble(fixed val);
+void checkSin(void);
+void checkSqrt(void);
+void checkMul(void);
+void checkRecip(void);
+void timeAll(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Converts a fixed point number to a double exactly.
+double toDouble(fixed val)
+{
+    return (double) val / FIXED_ONE;
+}
+
+// Checks the sine and cosine at every angle in a turn, and a few turns
+// either side to check that whole turns are ignored.
+void checkSin(void)
+{
+    fixed turns; double worst, err;
+
+    worst = 0.0;
+    for (turns = -2 * FIXED_ONE; turns <= 2 * FIXED_ONE; ++turns) {
+        err = fabs(toDouble(fixed_sin(turns))
+            - sin(2.0 * PI * toDouble(turns)));
+        worst = fmax(worst, err);
+
+        err = fabs(toDouble(fixed_cos(turns))
+            - cos(2.0 * PI * toDouble(turns)));
+        worst = fmax(worst, err);
+    }
+
+    printf("sin/cos  worst error %.3g (bound %.3g)\n", worst, SIN_BOUND);
+    host_check(worst <= SIN_BOUND, "fixed_sin/cos error %g", worst);
+}
+
+// Checks the integer square root exactly and the fixed point one to half an
+// LSB, over a spread of inputs from the smallest to the largest.
+void checkSqrt(void)
+{
+    unsigned long long i; unsigned int val, root; fixed f; bool exact;
+    double worst, err;
+
+    exact = TRUE;
+    val = root = 0;
+    for (i = 0; i <= 0xffffffffull && exact; i += 1 + (i >> 12)) {
+        val = (unsigned int) i;
+        root = fixed_isqrt(val);
+        exact = (unsigned long long) root * root <= val
+            && (unsigned long long) (root + 1) * (root + 1) > val;
+    }
+    host_check(exact, "fixed_isqrt(%u) gave %u", val, root);
+
+    worst = 0.0;
+    for (i = 0; i <= FIXED_MAX; i += 1 + (i >> 14)) {
+        f = (fixed) i;
+        err = fabs(toDouble(fixed_sqrt(f)) - sqrt(toDouble(f)));
+        worst = fmax(worst, err);
+    }
+
+    printf("sqrt     worst error %.3g (bound %.3g)\n", worst, HALF_LSB);
+    host_check(worst <= HALF_LSB + SLACK, "fixed_sqrt error %g", worst);
+    host_check(fixed_sqrt(-FIXED_ONE) == 0, "fixed_sqrt of a negative");
+}
+
+// Checks multiplication to half an LSB, over products that fit.
+void checkMul(void)
+{
+    fixed a, b; double worst, err, exact;
+
+    worst = 0.0;
+    for (a = -256 * FIXED_ONE; a <= 256 * FIXED_ONE; a += 4099) {
+        for (b = -64 * FIXED_ONE; b <= 64 * FIXED_ONE; b += 65537) {
+            exact = toDouble(a) * toDouble(b);
+            if (fabs(exact) >= 32767.0) continue;
+
+            err = fabs(toDouble(fixed_mul(a, b)) - exact);
+            worst = fmax(worst, err);
+        }
+    }
+
+    printf("mul      worst error %.3g (bound %.3g)\n", worst, HALF_LSB);
+    host_check(worst <= HALF_LSB + SLACK, "fixed_mul error %g", worst);
+}
+
+// Checks the reciprocal to half an LSB wherever the result fits, and that it
+// saturates where it doesn't.
+void checkRecip(void)
+{
+    long long i; fixed f; double worst, err, exact;
+
+    worst = 0.0;
+    for (i = 1; i <= FIXED_MAX; i += 1 + (i >> 12)) {
+        f = (fixed) i;
+        exact = 1.0 / toDouble(f);
+
+        if (exact >= toDouble(FIXED_MAX)) {
+            host_check(fixed_recip(f) == FIXED_MAX,
+                "fixed_recip(%d) didn't saturate", f);
+            continue;
+        }
+
+        err = fabs(toDouble(fixed_recip(f)) - exact);
+        worst = fmax(worst, err);
+        err = fabs(toDouble(fixed_recip(-f)) + exact);
+        worst = fmax(worst, err);
+    }
+
+    printf("recip    worst error %.3g (bound %.3g)\n", worst, HALF_LSB);
+    host_check(worst <= HALF_LSB + SLACK, "fixed_recip error %g", worst);
+    host_check(fixed_recip(0) == FIXED_MAX, "fixed_recip(0)");
+}
+
+// Times each function next to the libm call it replaces. Only the ratio
+// means much, as the board's soft-float calls are far slower than the
+// PC's.
+void timeAll(void)
+{
+    int i, n; double start, fixedTime, floatTime; float x;
+
+    n = 0;
+    start = host_now();
+    for (i = 0; i < TIMED_CALLS; ++i) n += fixed_sin(i * 7);
+    fixedTime = host_now() - start;
+
+    x = 0.0f;
+    start = host_now();
+    for (i = 0; i < TIMED_CALLS; ++i) x += sinf(i * 7 * (1.0f / 65536));
+    floatTime = host_now() - start;
+
+    printf("sin      %6.2f ns, sinf  %6.2f ns\n",
+        fixedTime * 1e9 / TIMED_CALLS, floatTime * 1e9 / TIMED_CALLS);
+
+    start = host_now();
+    for (i = 0; i < TIMED_CALLS; ++i) n += fixed_sqrt(i * 211);
+    fixedTime = host_now() - start;
+
+    start = host_now();
+    for (i = 0; i < TIMED_CALLS; ++i) x += sqrtf(i * 211 * (1.0f / 65536));
+    floatTime = host_now() - start;
+
+    printf("sqrt     %6.2f ns, sqrtf %6.2f ns\n",
+        fixedTime * 1e9 / TIMED_CALLS, floatTime * 1e9 / TIMED_CALLS);
+
+    sink = n + (int) x;
+}
+
+// Runs every check, then the timings. Exits with 0 if every check passed.
+int main(void)
+{
+    checkSin();
+    checkSqrt();
+    checkMul();
+    checkRecip();
+    timeAll();
+
+    return host_finish("fixedtest");
+}
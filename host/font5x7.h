@@ -0,0 +1,43 @@
+/**
+ * File Name  : font5x7.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Stand-in for the course LCD library's font, for the host test
+ *              programs only. Laid out like the real one (a row of eight
+ *              pixels per byte, most significant bit on the left, indexed by
+ *              character), but every glyph is the same hollow box with a
+ *              diagonal through it. Nothing on the host looks at the shapes,
+ *              so only the layout matters.
+ */
+
+#ifndef FONT5X7_H_GUARD
+#define FONT5X7_H_GUARD
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// The stand-in glyph, as its eight rows.
+#define FONT_HOST_GLYPH { 0xf8, 0xc8, 0xa8, 0x98, 0x88, 0x88, 0xf8, 0x00 }
+
+// Eight and then sixty four glyphs at once.
+#define FONT_HOST_GLYPHS_8 FONT_HOST_GLYPH, FONT_HOST_GLYPH, FONT_HOST_GLYPH, \
+    FONT_HOST_GLYPH, FONT_HOST_GLYPH, FONT_HOST_GLYPH, FONT_HOST_GLYPH, \
+    FONT_HOST_GLYPH
+#define FONT_HOST_GLYPHS_64 FONT_HOST_GLYPHS_8, FONT_HOST_GLYPHS_8, \
+    FONT_HOST_GLYPHS_8, FONT_HOST_GLYPHS_8, FONT_HOST_GLYPHS_8, \
+    FONT_HOST_GLYPHS_8, FONT_HOST_GLYPHS_8, FONT_HOST_GLYPHS_8
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// A glyph for every character code. Not const, or the compiler could work
+// out everything the big font does with it ahead of time, and hostbench
+// would time nothing.
+unsigned char font5x7[256][8] = {
+    FONT_HOST_GLYPHS_64, FONT_HOST_GLYPHS_64,
+    FONT_HOST_GLYPHS_64, FONT_HOST_GLYPHS_64
+};
+
+#endif
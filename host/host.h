@@ -0,0 +1,92 @@
+/**
+ * File Name  : host.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Shared by the host test programs in this directory, which
+ *              build the board's headers with the PC's compiler, against the
+ *              stand-in hardware headers here instead of the real ones. Each
+ *              program is one source file that includes the headers it
+ *              tests, as the exercises do. Counts the checks that fail, and
+ *              times code by the PC's clock. Build and run them all with
+ *              "make check".
+ */
+
+#ifndef HOST_H_GUARD
+#define HOST_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+// The board's interrupt handlers are marked interrupt("IRQ"), which means
+// something else to the PC's compiler. Nothing interrupts the host
+// programs, so the attribute is swapped for one that does nothing.
+#define interrupt(kind) unused
+
+#include "utils.h"
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The number of checks made, and the number of them that failed.
+int host_checks;
+int host_failures;
+
+// Provided by ramfunc.ld on the board. Nothing is copied on the host, but
+// ramfunc.h still needs them to link.
+char __ramfunc_start[1], __ramfunc_end[1], __ramfunc_load[1];
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void host_check(bool passed, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+double host_now(void);
+int host_finish(const char* name);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Counts a check, and reports it if it didn't pass. format and what follows
+// say what was checked, as printf would.
+void host_check(bool passed, const char* format, ...)
+{
+    va_list args;
+
+    ++host_checks;
+    if (passed) return;
+
+    ++host_failures;
+
+    printf("FAIL: ");
+    va_start(args, format);
+    vprintf(format, args);
+    va_end(args);
+    printf("\n");
+}
+
+// Gives the time by the PC's clock, in seconds from some fixed point.
+double host_now(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+// Reports how many checks the named program made and how many failed, and
+// gives its exit status: 0 if they all passed.
+int host_finish(const char* name)
+{
+    printf("%s: %d checks, %d failed\n", name, host_checks, host_failures);
+    return host_failures == 0 ? 0 : 1;
+}
+
+#endif
@@ -0,0 +1,404 @@
+/**
+ * File Name  : hostbench.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host benchmark of the drawing and DSP routines that bench.c
+ *              times on the board: star_render, lcd_putBigChar,
+ *              lcd_bigCharSample, the amplitude graph over a full five
+ *              minute recording, wave_build and motor_findMR2Val. Built
+ *              against the stand-in hardware headers here, so drawing costs
+ *              only what the routines themselves do, not the LCD. Writes the
+ *              results as JSON, and fails any case more than
+ *              HOSTBENCH_TOLERANCE percent slower than the baseline saved in
+ *              hostbench_baseline.h.
+ *
+ *              The baseline is only good for the PC it was recorded on.
+ *              Record one for another with "make benchbaseline". The board
+ *              run in bench.c is still the one to trust for cycle counts.
+ * Usage      : hostbench results.json [baseline.h]
+ *              Build and check with "make benchcheck". Given a second file,
+ *              writes the results there as a new baseline instead of
+ *              checking them.
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include "host.h"
+#include "rng.h"
+#include "star.h"
+#include "lcd.h"
+#include "graph.h"
+#include "wave.h"
+#include "motor.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of timed runs of each case. The fastest is the one reported,
+// which leaves out runs the PC was interrupted in.
+#define HOSTBENCH_RUNS 15
+
+// The shortest a timed run may be, in seconds. Cases that are quicker than
+// this are repeated within each run until they take this long, so the
+// clock's resolution doesn't matter.
+#define HOSTBENCH_MIN_TIME 0.01
+
+// The most times a case is timed. A case that fails is timed again, keeping
+// the fastest result, in case something else on the PC slowed it down for
+// longer than a run. A real regression fails every time. A new baseline
+// always takes the fastest of them all.
+#define HOSTBENCH_ATTEMPTS 3
+
+// How much slower than its baseline, in percent, a case may get before it
+// fails. Far looser than the board's: on a busy PC even the fastest run of
+// a case can come out a third slower from one go to the next. That still
+// catches the regressions that matter here, like work the compiler used to
+// leave out or a loop that has gone quadratic.
+#define HOSTBENCH_TOLERANCE 50
+
+// The amount of work in each case, as in bench.c.
+#define HOSTBENCH_STARS 128
+#define HOSTBENCH_GRAPH_LENGTH (44100 * 300)
+#define HOSTBENCH_WAVE_OCTAVE 4
+#define HOSTBENCH_WAVE_LENGTH 1024
+#define HOSTBENCH_MOTOR_SPEEDS 256
+
+// The number of cases.
+#define HOSTBENCH_CASES 6
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A case. Each run does a fixed amount of work made up of units of the given
+// name, and the result is the time taken per unit.
+typedef struct {
+    char* name;
+    char* unit;
+    unsigned long units;
+    void (*run)(void);
+} Case;
+
+// A saved result for the case with the given name, in tenths of a
+// nanosecond per unit.
+typedef struct {
+    char* name;
+    unsigned long tenths;
+} Baseline;
+
+// Pull in the saved results, which defines hostBaseline.
+#include "hostbench_baseline.h"
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void starsCase(void);
+void bigCharCase(void);
+void bigSampleCase(void);
+void graphCase(void);
+void waveCase(void);
+void motorCase(void);
+
+float randFloat(rng_Pool* rng);
+void prepareCases(void);
+double timeCase(const Case* test, unsigned long* pixels);
+long findBaseline(char* name);
+char* checkResult(unsigned long tenths, long baseline);
+bool writeResults(const char* path, const unsigned long* results,
+    const unsigned long* pixels, int failed);
+bool writeBaseline(const char* path, const unsigned long* results);
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Every case, with the names bench.c gives them on the board.
+const Case cases[HOSTBENCH_CASES] = {
+    { "stars", "star", HOSTBENCH_STARS, starsCase },
+    { "bigchar", "char", 26, bigCharCase },
+    { "bigsmp", "texel", 26 * BIG_CHAR_WIDTH * BIG_CHAR_HEIGHT,
+        bigSampleCase },
+    { "graph", "sample", HOSTBENCH_GRAPH_LENGTH, graphCase },
+    { "wave", "note", (WAVE_LAST + 1) * 12, waveCase },
+    { "motor", "lookup", HOSTBENCH_MOTOR_SPEEDS, motorCase }
+};
+
+// Inputs for the cases.
+Star benchStars[HOSTBENCH_STARS];
+short graphSamples[HOSTBENCH_GRAPH_LENGTH];
+short waveTable[HOSTBENCH_WAVE_LENGTH];
+
+// Somewhere for results nothing else looks at, so they aren't optimised away.
+volatile int benchSink;
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Projects and draws a field of stars, as exercise 3 does each frame.
+void starsCase(void)
+{
+    int i;
+
+    for (i = 0; i < HOSTBENCH_STARS; ++i) {
+        star_render(benchStars[i], 0.03125f, benchStars[i].clr);
+    }
+}
+
+// Draws the alphabet in the big font, as exercise 5's instructions are.
+void bigCharCase(void)
+{
+    int i;
+
+    for (i = 0; i < 26; ++i) {
+        lcd_putBigChar(4 + (i % 13) * BIG_CHAR_WIDTH,
+            4 + (i / 13) * BIG_CHAR_HEIGHT, 'A' + i);
+    }
+}
+
+// Samples every texel of the alphabet in the big font without drawing it.
+void bigSampleCase(void)
+{
+    int i, x, y, n;
+
+    n = 0;
+    for (i = 0; i < 26; ++i) {
+        for (y = 0; y < BIG_CHAR_HEIGHT; ++y) {
+            for (x = 0; x < BIG_CHAR_WIDTH; ++x) {
+                n += lcd_bigCharSample('A' + i - 0x20, x, y);
+            }
+        }
+    }
+
+    benchSink = n;
+}
+
+// Graphs a whole recording, running the coroutine to the end in one go.
+void graphCase(void)
+{
+    graph_Draw graph;
+
+    graph_start(&graph, graphSamples, HOSTBENCH_GRAPH_LENGTH,
+        6, 4, DISPLAY_WIDTH - 14, 120);
+    while (graph_step(&graph) != PT_ENDED);
+}
+
+// Builds a table for every note of an octave in every wave shape, as
+// exercise 4 does on each key press.
+void waveCase(void)
+{
+    int type, note, n;
+
+    n = 0;
+    for (type = 0; type <= WAVE_LAST; ++type) {
+        for (note = NOTE_C; note <= NOTE_B; ++note) {
+            n += wave_build(waveTable, type, HOSTBENCH_WAVE_OCTAVE, note);
+        }
+    }
+
+    benchSink = n;
+}
+
+// Looks up motor settings across the whole range of speeds, as each change
+// of target in exercise 3 does.
+void motorCase(void)
+{
+    int i, n;
+
+    n = 0;
+    for (i = 0; i < HOSTBENCH_MOTOR_SPEEDS; ++i) {
+        n += motor_findMR2Val(i * (120.0 / HOSTBENCH_MOTOR_SPEEDS));
+    }
+
+    benchSink = n;
+}
+
+// Returns a random number between 0.0 and 1.0 from the given pool, as
+// exercise 3 does.
+float randFloat(rng_Pool* rng)
+{
+    return fixed_toFloat((fixed) (rng_poolNext(rng) >> (32 - FIXED_SHIFT)));
+}
+
+// Fills in the inputs for the cases, the same way bench.c does, so the work
+// done is the same as on the board.
+void prepareCases(void)
+{
+    rng_Pool rng; unsigned long i;
+
+    rng_poolSeed(&rng, 0x3ae14c92);
+
+    for (i = 0; i < HOSTBENCH_STARS; ++i) {
+        benchStars[i].x = randFloat(&rng) - 0.5f;
+        benchStars[i].y = randFloat(&rng) - 0.5f;
+        benchStars[i].z = randFloat(&rng) + 0.0625f;
+        benchStars[i].clr = WHITE;
+    }
+
+    for (i = 0; i < HOSTBENCH_GRAPH_LENGTH; ++i) {
+        graphSamples[i] = 512 + (short) ((i >> 6) % 256) - 128
+            + (short) (rng_poolNext(&rng) >> 26);
+    }
+}
+
+// Runs a case HOSTBENCH_RUNS times, repeating it within each run so that
+// every run takes at least HOSTBENCH_MIN_TIME, and gives the time taken per
+// unit by the fastest run in nanoseconds. Sets pixels to the number of
+// pixels one go of the case would have drawn.
+double timeCase(const Case* test, unsigned long* pixels)
+{
+    int i, n, repeats; double start, once, best;
+
+    lcd_hostPixels = 0;
+    start = host_now();
+    test->run();
+    once = host_now() - start;
+    *pixels = lcd_hostPixels;
+
+    repeats = once >= HOSTBENCH_MIN_TIME ? 1
+        : (int) (HOSTBENCH_MIN_TIME / max(once, 1e-9)) + 1;
+
+    best = 1e30;
+    for (i = 0; i < HOSTBENCH_RUNS; ++i) {
+        start = host_now();
+        for (n = 0; n < repeats; ++n) test->run();
+        best = min(best, (host_now() - start) / repeats);
+    }
+
+    return best * 1e9 / test->units;
+}
+
+// Finds the saved result for the case with the given name, or -1 if there
+// isn't one.
+long findBaseline(char* name)
+{
+    unsigned int i;
+
+    for (i = 0; i < sizeof(hostBaseline) / sizeof(hostBaseline[0]); ++i) {
+        if (strcmp(hostBaseline[i].name, name) == 0) {
+            return (long) hostBaseline[i].tenths;
+        }
+    }
+
+    return -1;
+}
+
+// Compares a result with its baseline. Gives "NEW" if there is no baseline,
+// "FAIL" if the result is more than HOSTBENCH_TOLERANCE percent slower, and
+// "PASS" otherwise.
+char* checkResult(unsigned long tenths, long baseline)
+{
+    if (baseline < 0) return "NEW";
+
+    if ((unsigned long long) tenths * 100
+        > (unsigned long long) baseline * (100 + HOSTBENCH_TOLERANCE)) {
+        return "FAIL";
+    }
+
+    return "PASS";
+}
+
+// Writes the results to the file at path as JSON, in the same form bench.c
+// sends them from the board, with times in tenths of a nanosecond and the
+// pixels each case would have drawn. Returns FALSE if the file couldn't be
+// written.
+bool writeResults(const char* path, const unsigned long* results,
+    const unsigned long* pixels, int failed)
+{
+    FILE* out; int i; long baseline;
+
+    out = fopen(path, "w");
+    if (out == NULL) return FALSE;
+
+    fprintf(out, "{\"runs\": %d, \"tolerance\": %d, \"failed\": %d, "
+        "\"cases\": [\n", HOSTBENCH_RUNS, HOSTBENCH_TOLERANCE, failed);
+
+    for (i = 0; i < HOSTBENCH_CASES; ++i) {
+        baseline = findBaseline(cases[i].name);
+
+        fprintf(out, "  {\"name\": \"%s\", \"unit\": \"%s\", \"units\": %lu, "
+            "\"pixels\": %lu, \"tenths\": %lu, \"baseline\": ",
+            cases[i].name, cases[i].unit, cases[i].units, pixels[i],
+            results[i]);
+        if (baseline >= 0) fprintf(out, "%ld", baseline);
+        else fprintf(out, "null");
+        fprintf(out, ", \"status\": \"%s\"}%s\n",
+            checkResult(results[i], baseline),
+            i < HOSTBENCH_CASES - 1 ? "," : "");
+    }
+
+    fprintf(out, "]}\n");
+    return fclose(out) == 0;
+}
+
+// Writes the results to the file at path as C source, to be used as
+// hostbench_baseline.h. Returns FALSE if the file couldn't be written.
+bool writeBaseline(const char* path, const unsigned long* results)
+{
+    FILE* out; int i;
+
+    out = fopen(path, "w");
+    if (out == NULL) return FALSE;
+
+    fprintf(out, "// Recorded by hostbench, in tenths of a nanosecond per "
+        "unit. Only good for\n// the PC it was recorded on: record another "
+        "with \"make benchbaseline\".\n");
+    fprintf(out, "const Baseline hostBaseline[] = {\n");
+    for (i = 0; i < HOSTBENCH_CASES; ++i) {
+        fprintf(out, "    { \"%s\", %lu }%s\n", cases[i].name, results[i],
+            i < HOSTBENCH_CASES - 1 ? "," : "");
+    }
+    fprintf(out, "};\n");
+
+    return fclose(out) == 0;
+}
+
+// Times every case, then writes the results, and either checks them against
+// the baseline or writes them out as a new one. Exits with 0 if nothing
+// regressed.
+int main(int argc, char** argv)
+{
+    unsigned long results[HOSTBENCH_CASES], pixels[HOSTBENCH_CASES];
+    int i, attempt, failed; char* status;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Usage: %s results.json [baseline.h]\n", argv[0]);
+        return 2;
+    }
+
+    prepareCases();
+
+    failed = 0;
+    for (i = 0; i < HOSTBENCH_CASES; ++i) {
+        results[i] = ~0ul;
+        for (attempt = 0; attempt < HOSTBENCH_ATTEMPTS; ++attempt) {
+            results[i] = min(results[i], (unsigned long)
+                (timeCase(&cases[i], &pixels[i]) * 10 + 0.5));
+            status = checkResult(results[i], findBaseline(cases[i].name));
+
+            if (argc == 2 && strcmp(status, "FAIL") != 0) break;
+        }
+
+        printf("%-8s %10.1f ns/%-6s %s\n", cases[i].name, results[i] / 10.0,
+            cases[i].unit, status);
+
+        // A new baseline is being recorded, so the old one doesn't count.
+        if (argc == 2 && strcmp(status, "FAIL") == 0) ++failed;
+    }
+
+    host_check(writeResults(argv[1], results, pixels, failed),
+        "couldn't write %s", argv[1]);
+    if (argc == 3) {
+        host_check(writeBaseline(argv[2], results),
+            "couldn't write %s", argv[2]);
+    }
+
+    host_check(failed == 0, "%d cases more than %d%% slower than baseline",
+        failed, HOSTBENCH_TOLERANCE);
+
+    return host_finish("hostbench");
+}
@@ -0,0 +1,10 @@
+// Recorded by hostbench, in tenths of a nanosecond per unit. Only good for
+// the PC it was recorded on: record another with "make benchbaseline".
+const Baseline hostBaseline[] = {
+    { "stars", 112 },
+    { "bigchar", 20195 },
+    { "bigsmp", 130 },
+    { "graph", 19 },
+    { "wave", 16583 },
+    { "motor", 168 }
+};
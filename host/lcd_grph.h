@@ -0,0 +1,147 @@
+/**
+ * File Name  : lcd_grph.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Stand-in for the course LCD library's header, for the host
+ *              test programs only. Has the same names as the real one, and
+ *              drawing functions that count the pixels they would have
+ *              touched instead of drawing anything, so code that draws can
+ *              be run and timed on the PC.
+ */
+
+#ifndef LCD_GRPH_H_GUARD
+#define LCD_GRPH_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <string.h>
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Size of the display, in pixels.
+#define DISPLAY_WIDTH 240
+#define DISPLAY_HEIGHT 320
+
+// The colours we use, in the display's RGB565 format.
+#define BLACK 0x0000
+#define WHITE 0xffff
+#define RED 0xf800
+#define GREEN 0x07e0
+#define BLUE 0x001f
+#define CYAN 0x07ff
+#define YELLOW 0xffe0
+#define LIGHT_GRAY 0xc618
+#define DARK_GRAY 0x7bef
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+typedef unsigned short lcd_color_t;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The number of pixels the drawing functions would have touched.
+unsigned long lcd_hostPixels;
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// The real library is linked in afterwards, so the compiler can't see what
+// its functions do. Marking the stand-ins the same way stops it throwing
+// away the work that goes into their arguments, which they ignore.
+#define LCD_HOST_EXTERN __attribute__((noipa))
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+unsigned long lcd_hostSpan(unsigned short a, unsigned short b);
+
+void lcd_init(void) LCD_HOST_EXTERN;
+void lcd_fillScreen(lcd_color_t color) LCD_HOST_EXTERN;
+void lcd_point(unsigned short x, unsigned short y, lcd_color_t color)
+    LCD_HOST_EXTERN;
+void lcd_drawRect(unsigned short x0, unsigned short y0,
+    unsigned short x1, unsigned short y1, lcd_color_t color) LCD_HOST_EXTERN;
+void lcd_fillRect(unsigned short x0, unsigned short y0,
+    unsigned short x1, unsigned short y1, lcd_color_t color) LCD_HOST_EXTERN;
+void lcd_line(unsigned short x0, unsigned short y0,
+    unsigned short x1, unsigned short y1, lcd_color_t color) LCD_HOST_EXTERN;
+void lcd_putChar(unsigned short x, unsigned short y, unsigned char ch)
+    LCD_HOST_EXTERN;
+void lcd_putString(unsigned short x, unsigned short y, char* str)
+    LCD_HOST_EXTERN;
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Gives the number of pixels from a to b, both included.
+unsigned long lcd_hostSpan(unsigned short a, unsigned short b)
+{
+    return (a > b ? a - b : b - a) + 1;
+}
+
+// Does nothing, as there is no display.
+void lcd_init(void)
+{
+}
+
+// Counts every pixel of the display.
+void lcd_fillScreen(lcd_color_t color)
+{
+    lcd_hostPixels += DISPLAY_WIDTH * DISPLAY_HEIGHT;
+}
+
+// Counts one pixel.
+void lcd_point(unsigned short x, unsigned short y, lcd_color_t color)
+{
+    ++lcd_hostPixels;
+}
+
+// Counts the pixels around the edge of the rectangle.
+void lcd_drawRect(unsigned short x0, unsigned short y0,
+    unsigned short x1, unsigned short y1, lcd_color_t color)
+{
+    lcd_hostPixels += 2 * (lcd_hostSpan(x0, x1) + lcd_hostSpan(y0, y1)) - 4;
+}
+
+// Counts the pixels inside the rectangle, edges included.
+void lcd_fillRect(unsigned short x0, unsigned short y0,
+    unsigned short x1, unsigned short y1, lcd_color_t color)
+{
+    lcd_hostPixels += lcd_hostSpan(x0, x1) * lcd_hostSpan(y0, y1);
+}
+
+// Counts the pixels along the longer axis of the line.
+void lcd_line(unsigned short x0, unsigned short y0,
+    unsigned short x1, unsigned short y1, lcd_color_t color)
+{
+    unsigned long w, h;
+
+    w = lcd_hostSpan(x0, x1);
+    h = lcd_hostSpan(y0, y1);
+    lcd_hostPixels += w > h ? w : h;
+}
+
+// Counts the pixels of a character cell.
+void lcd_putChar(unsigned short x, unsigned short y, unsigned char ch)
+{
+    lcd_hostPixels += 6 * 8;
+}
+
+// Counts the pixels of a character cell for each character.
+void lcd_putString(unsigned short x, unsigned short y, char* str)
+{
+    lcd_hostPixels += 6 * 8 * strlen(str);
+}
+
+#endif
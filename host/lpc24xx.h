@@ -0,0 +1,117 @@
+/**
+ * File Name  : lpc24xx.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Stand-in for the board's register header, for the host test
+ *              programs only. Every register is a word of host_registers
+ *              picked by the bottom bits of its real address, so registers
+ *              that follow one another on the board still do, and code that
+ *              sets up a peripheral can be run and its writes looked at.
+ *              Nothing happens when they are written, of course.
+ */
+
+#ifndef LPC24XX_H_GUARD
+#define LPC24XX_H_GUARD
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// The register at the given address on the board.
+#define HOST_REGISTER(a) (host_registers[((a) >> 2) & 0xfffff])
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Every register, all starting out zero.
+volatile unsigned long host_registers[1 << 20];
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+#define FIO0PIN HOST_REGISTER(0x3FFFC014)
+#define FIO3DIR HOST_REGISTER(0x3FFFC060)
+#define FIO3PIN HOST_REGISTER(0x3FFFC074)
+#define PINSEL1 HOST_REGISTER(0xE002C004)
+#define PINSEL2 HOST_REGISTER(0xE002C008)
+#define PINSEL0 HOST_REGISTER(0xE002C000)
+#define PCONP HOST_REGISTER(0xE01FC0C4)
+#define AD0CR HOST_REGISTER(0xE0034000)
+#define AD0GDR HOST_REGISTER(0xE0034004)
+#define AD0INTEN HOST_REGISTER(0xE003400C)
+#define AD0DR0 HOST_REGISTER(0xE0034010)
+#define AD0DR1 HOST_REGISTER(0xE0034014)
+#define AD0DR2 HOST_REGISTER(0xE0034018)
+#define AD0DR3 HOST_REGISTER(0xE003401C)
+#define AD0STAT HOST_REGISTER(0xE0034030)
+#define DACR HOST_REGISTER(0xE006C000)
+#define PWM0IR HOST_REGISTER(0xE0014000)
+#define PWM0TCR HOST_REGISTER(0xE0014004)
+#define PWM0TC HOST_REGISTER(0xE0014008)
+#define PWM0PR HOST_REGISTER(0xE001400C)
+#define PWM0MCR HOST_REGISTER(0xE0014014)
+#define PWM0MR0 HOST_REGISTER(0xE0014018)
+#define PWM0MR2 HOST_REGISTER(0xE0014020)
+#define PWM0PCR HOST_REGISTER(0xE001404C)
+#define PWM0LER HOST_REGISTER(0xE0014050)
+#define T0IR HOST_REGISTER(0xE0004000)
+#define T0TCR HOST_REGISTER(0xE0004004)
+#define T0TC HOST_REGISTER(0xE0004008)
+#define T0PR HOST_REGISTER(0xE000400C)
+#define T0PC HOST_REGISTER(0xE0004010)
+#define T0MCR HOST_REGISTER(0xE0004014)
+#define T0MR0 HOST_REGISTER(0xE0004018)
+#define T0MR1 HOST_REGISTER(0xE000401C)
+#define T0MR2 HOST_REGISTER(0xE0004020)
+#define T0MR3 HOST_REGISTER(0xE0004024)
+#define T1IR HOST_REGISTER(0xE0008000)
+#define T2IR HOST_REGISTER(0xE0070000)
+#define T3IR HOST_REGISTER(0xE0074000)
+#define T1TCR HOST_REGISTER(0xE0008004)
+#define T1TC HOST_REGISTER(0xE0008008)
+#define T1PR HOST_REGISTER(0xE000800C)
+#define T1MCR HOST_REGISTER(0xE0008014)
+#define T1MR0 HOST_REGISTER(0xE0008018)
+#define VICIRQStatus HOST_REGISTER(0xFFFFF000)
+#define VICFIQStatus HOST_REGISTER(0xFFFFF004)
+#define VICRawIntr HOST_REGISTER(0xFFFFF008)
+#define VICIntSelect HOST_REGISTER(0xFFFFF00C)
+#define VICIntEnable HOST_REGISTER(0xFFFFF010)
+#define VICIntEnClr HOST_REGISTER(0xFFFFF014)
+#define VICSoftInt HOST_REGISTER(0xFFFFF018)
+#define VICSoftIntClr HOST_REGISTER(0xFFFFF01C)
+#define VICSWPriorityMask HOST_REGISTER(0xFFFFF024)
+#define VICVectAddr HOST_REGISTER(0xFFFFFF00)
+#define PCON HOST_REGISTER(0xE01FC0C0)
+#define INTWAKE HOST_REGISTER(0xE01FC144)
+#define IO0_INT_EN_R HOST_REGISTER(0xE0028090)
+#define IO0_INT_EN_F HOST_REGISTER(0xE0028094)
+#define IO0_INT_CLR HOST_REGISTER(0xE002808C)
+#define IO0_INT_STAT_F HOST_REGISTER(0xE0028088)
+#define IO_INT_STAT HOST_REGISTER(0xE0028080)
+#define MAMCR HOST_REGISTER(0xE01FC000)
+#define MAMTIM HOST_REGISTER(0xE01FC004)
+#define PLLCON HOST_REGISTER(0xE01FC080)
+#define PLLCFG HOST_REGISTER(0xE01FC084)
+#define PLLSTAT HOST_REGISTER(0xE01FC088)
+#define PLLFEED HOST_REGISTER(0xE01FC08C)
+#define CCLKCFG HOST_REGISTER(0xE01FC104)
+#define CLKSRCSEL HOST_REGISTER(0xE01FC10C)
+#define SCS HOST_REGISTER(0xE01FC1A0)
+#define PCLKSEL0 HOST_REGISTER(0xE01FC1A8)
+#define PCLKSEL1 HOST_REGISTER(0xE01FC1AC)
+#define U0RBR HOST_REGISTER(0xE000C000)
+#define U0THR HOST_REGISTER(0xE000C000)
+#define U0DLL HOST_REGISTER(0xE000C000)
+#define U0DLM HOST_REGISTER(0xE000C004)
+#define U0IER HOST_REGISTER(0xE000C004)
+#define U0FCR HOST_REGISTER(0xE000C008)
+#define U0LCR HOST_REGISTER(0xE000C00C)
+#define U0LSR HOST_REGISTER(0xE000C014)
+#define U0FDR HOST_REGISTER(0xE000C028)
+#define LCD_UPBASE HOST_REGISTER(0xFFE10010)
+#define LCD_CTRL HOST_REGISTER(0xFFE10018)
+
+#endif
@@ -0,0 +1,262 @@
+/**
+ * File Name  : memtest.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host test for mem.h. Churns pools and arenas with random
+ *              allocations and frees, checking that blocks never overlap,
+ *              stay aligned and inside their region, that the usage counts
+ *              stay right, and that nothing fragments: after any churn the
+ *              whole of a pool or arena can still be handed out. Then times
+ *              each call, to show the slowest calls don't get slower with
+ *              the size of the pool or with how much of it is in use.
+ * Usage      : memtest
+ *              Build with "make memtest", or run with the rest by "make
+ *              check".
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include <stdlib.h>
+
+#include "host.h"
+#include "rng.h"
+#include "mem.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The pools tested: a small one like ex4's, and a large one.
+#define SMALL_BLOCKS 4
+#define LARGE_BLOCKS 4096
+#define BLOCK_SIZE 20
+
+// The size of the arena tested, and the largest single allocation tried.
+#define ARENA_SIZE 65536
+#define ARENA_MAX_ALLOC 300
+
+// The number of random operations in each churn.
+#define CHURN_STEPS 200000
+
+// The number of calls timed for each case.
+#define TIMED_CALLS 1000000
+
+// The fraction of the slowest timings thrown away before taking the worst,
+// as they are the PC being interrupted rather than anything mem.h does.
+#define OUTLIERS 0.001
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Backing for the pools and the arena. One extra byte lets the arena start
+// misaligned.
+char poolStore[memPoolBytes(BLOCK_SIZE, LARGE_BLOCKS)] MEM_ATTR_ALIGNED;
+char arenaStore[ARENA_SIZE + 1] MEM_ATTR_ALIGNED;
+
+// The blocks currently held during a churn, in no particular order.
+void* held[LARGE_BLOCKS];
+
+// Where the random operations come from.
+rng_State rng;
+
+// How long each timed call took.
+double timings[TIMED_CALLS];
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+bool checkBlock(mem_Pool* pool, void* block, int count);
+void checkPool(int count);
+void checkArena(void);
+int compareDoubles(const void* a, const void* b);
+void timePool(int count, int inUse);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Checks that the given block lies on a block boundary inside the pool's
+// backing, and so can't overlap another block.
+bool checkBlock(mem_Pool* pool, void* block, int count)
+{
+    unsigned long offset;
+
+    if (block == NULL) return FALSE;
+
+    offset = (unsigned long) ((char*) block - poolStore);
+    return (char*) block >= poolStore
+        && offset < pool->blockSize * count
+        && offset % pool->blockSize == 0
+        && (unsigned long) block % MEM_ALIGN == 0;
+}
+
+// Churns a pool of count blocks with random allocations and frees. Checks
+// every block handed out and the counts after every step, then checks that
+// every block can be taken at once, each exactly once, and that one more
+// fails.
+void checkPool(int count)
+{
+    static bool taken[LARGE_BLOCKS];
+    mem_Pool pool; int n, i, step; unsigned long highWater; void* block;
+    bool good;
+
+    mem_poolInit(&pool, poolStore, BLOCK_SIZE, count);
+
+    n = 0;
+    highWater = 0;
+    good = TRUE;
+    for (step = 0; step < CHURN_STEPS && good; ++step) {
+        if (n < count && (n == 0 || rng_next(&rng) % 2 == 0)) {
+            block = mem_poolAlloc(&pool);
+            good &= checkBlock(&pool, block, count);
+            held[n++] = block;
+        } else {
+            i = rng_next(&rng) % n;
+            mem_poolFree(&pool, held[i]);
+            held[i] = held[--n];
+        }
+
+        highWater = max(highWater, (unsigned long) n);
+        good &= pool.inUse == (unsigned long) n;
+        good &= pool.highWater == highWater;
+    }
+    host_check(good, "pool of %d went wrong at step %d", count, step);
+
+    // Whatever order they were freed in, the whole pool is still there.
+    while (n > 0) mem_poolFree(&pool, held[--n]);
+
+    for (i = 0; i < count; ++i) taken[i] = FALSE;
+
+    good = TRUE;
+    for (n = 0; n < count && good; ++n) {
+        block = mem_poolAlloc(&pool);
+        good = checkBlock(&pool, block, count);
+        if (!good) break;
+
+        i = (int) (((char*) block - poolStore) / pool.blockSize);
+        good = !taken[i];
+        taken[i] = TRUE;
+    }
+    host_check(good, "pool of %d only gave %d blocks after churning",
+        count, n);
+
+    host_check(mem_poolAlloc(&pool) == NULL && pool.failures == 1,
+        "full pool of %d gave another block", count);
+
+    mem_poolFree(&pool, NULL);
+    host_check(pool.inUse == (unsigned long) count, "freeing NULL counted");
+}
+
+// Churns an arena with random allocations and roll backs to random marks,
+// checking each allocation, then checks that rolling back to 0 always gives
+// the whole arena back, and that a failed allocation takes nothing.
+void checkArena(void)
+{
+    static unsigned long marks[ARENA_SIZE / MEM_ALIGN];
+    mem_Arena arena; int step, depth; unsigned long size, end; char* ptr;
+    bool good;
+
+    // Start one byte in, to check the start is aligned.
+    mem_arenaInit(&arena, arenaStore + 1, ARENA_SIZE);
+    good = arena.base == arenaStore + MEM_ALIGN
+        && arena.size == ARENA_SIZE + 1 - MEM_ALIGN;
+    host_check(good, "arena didn't align its start");
+
+    depth = 0;
+    good = TRUE;
+    for (step = 0; step < CHURN_STEPS && good; ++step) {
+        if (depth > 0 && rng_next(&rng) % 4 == 0) {
+            depth = rng_next(&rng) % depth;
+            mem_arenaReset(&arena, marks[depth]);
+            good &= arena.used == marks[depth];
+            continue;
+        }
+
+        size = 1 + rng_next(&rng) % ARENA_MAX_ALLOC;
+        marks[depth] = mem_arenaMark(&arena);
+        ptr = (char*) mem_arenaAlloc(&arena, size);
+
+        if (ptr == NULL) {
+            good &= memAlign(size) > arena.size - marks[depth];
+            good &= arena.used == marks[depth];
+            continue;
+        }
+
+        ++depth;
+        end = (unsigned long) (ptr - arena.base) + size;
+        good &= ptr == arena.base + marks[depth - 1];
+        good &= (unsigned long) ptr % MEM_ALIGN == 0;
+        good &= end <= arena.size;
+        good &= arena.highWater >= arena.used;
+    }
+    host_check(good, "arena went wrong at step %d", step);
+
+    mem_arenaReset(&arena, 0);
+    ptr = (char*) mem_arenaAlloc(&arena, arena.size & ~(MEM_ALIGN - 1ul));
+    host_check(ptr == arena.base, "arena lost space after churning");
+
+    mem_arenaReset(&arena, 0);
+    size = arena.failures;
+    ptr = (char*) mem_arenaAlloc(&arena, arena.size + 1);
+    host_check(ptr == NULL && arena.used == 0
+        && arena.failures == size + 1, "oversized arena allocation");
+}
+
+// Orders doubles for qsort.
+int compareDoubles(const void* a, const void* b)
+{
+    double x, y;
+
+    x = *(const double*) a;
+    y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Times taking a block from, and giving one back to, a pool of count blocks
+// with inUse of them already taken. Reports the mean and the worst call once
+// the outliers are gone. Both include reading the PC's clock, so they are
+// only comparable between cases, not to the board.
+void timePool(int count, int inUse)
+{
+    mem_Pool pool; int i; void* block; double start, total;
+
+    mem_poolInit(&pool, poolStore, BLOCK_SIZE, count);
+    for (i = 0; i < inUse; ++i) held[i] = mem_poolAlloc(&pool);
+
+    total = 0.0;
+    for (i = 0; i < TIMED_CALLS; ++i) {
+        start = host_now();
+        block = mem_poolAlloc(&pool);
+        mem_poolFree(&pool, block);
+        timings[i] = host_now() - start;
+
+        total += timings[i];
+    }
+
+    qsort(timings, TIMED_CALLS, sizeof(timings[0]), compareDoubles);
+
+    printf("pool of %4d, %4d in use: alloc+free mean %5.1f ns, "
+        "worst %5.1f ns\n", count, inUse, total * 1e9 / TIMED_CALLS,
+        timings[(int) (TIMED_CALLS * (1.0 - OUTLIERS))] * 1e9);
+}
+
+// Runs every check, then the timings. Exits with 0 if every check passed.
+int main(void)
+{
+    rng_seed(&rng, 32);
+
+    checkPool(SMALL_BLOCKS);
+    checkPool(LARGE_BLOCKS);
+    checkArena();
+
+    timePool(SMALL_BLOCKS, 0);
+    timePool(SMALL_BLOCKS, SMALL_BLOCKS - 1);
+    timePool(LARGE_BLOCKS, 0);
+    timePool(LARGE_BLOCKS, LARGE_BLOCKS - 1);
+
+    return host_finish("memtest");
+}
@@ -0,0 +1,235 @@
+/**
+ * File Name  : regtest.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host test for reg.h. Checks that the field accessors give the
+ *              same register values as the bit macros in utils.h they
+ *              replaced, for every field described and for random register
+ *              contents, and that each replaced line of the exercises
+ *              writes what it used to.
+ * Usage      : regtest
+ *              Build with "make regtest", or run with the rest by "make
+ *              check".
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include "host.h"
+#include "rng.h"
+#include "reg.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of random register contents and values tried for each field.
+#define TRIALS 10000
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A field described in reg.h, by name, along with the mask reg.h makes of
+// it.
+typedef struct {
+    const char* name;
+    int first;
+    int count;
+    unsigned long mask;
+} Field;
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Produces the Field entry for the given field description.
+#define FIELD(f) _FIELD(#f, f)
+#define _FIELD(name, i, c) { name, i, c, _fieldMask(i, c) }
+
+// Registers are 32 bits on the board, but unsigned long is wider here, and
+// the old macros sign extend when they reach bit 31. Only the bits the
+// board has are compared.
+#define reg32(x) ((unsigned int) (x))
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Every field described in reg.h.
+const Field fields[] = {
+    FIELD(PINSEL0_P0_2), FIELD(PINSEL0_P0_3), FIELD(PINSEL1_P0_23),
+    FIELD(PINSEL1_P0_24), FIELD(PINSEL1_P0_25), FIELD(PINSEL1_P0_26),
+    FIELD(PINSEL1_AD0(0)), FIELD(PINSEL1_AD0(3)), FIELD(PINSEL2_P1_3),
+    FIELD(PCONP_PCUART0), FIELD(PCONP_PCAD), FIELD(PCONP_PCTIM2),
+    FIELD(PCON_IDL), FIELD(PCON_PD), FIELD(PCLKSEL0_TIMER1),
+    FIELD(AD0CR_SEL), FIELD(AD0CR_CLKDIV), FIELD(AD0CR_BURST),
+    FIELD(AD0CR_CLKS), FIELD(AD0CR_PDN), FIELD(AD0CR_START),
+    FIELD(AD0CR_EDGE), FIELD(AD0DR_RESULT), FIELD(AD0DR_CHN),
+    FIELD(AD0DR_OVERRUN), FIELD(AD0DR_DONE), FIELD(U0LCR_WORD_LENGTH),
+    FIELD(U0LCR_DLAB), FIELD(U0LSR_THRE), FIELD(U0FDR_DIVADDVAL),
+    FIELD(U0FDR_MULVAL), FIELD(DACR_VALUE), FIELD(DACR_BIAS),
+    FIELD(PWMMCR_MR0I), FIELD(PWMMCR_MR0R), FIELD(PWMPCR_ENA2),
+    FIELD(PWMTCR_ENABLE), FIELD(PWMTCR_RESET), FIELD(PWMTCR_PWM_ENABLE),
+    FIELD(CRSR_CTRL_ON), FIELD(CRSR_CTRL_NUM), FIELD(CRSR_CFG_SIZE),
+    FIELD(CRSR_CFG_FRAME_SYNC), FIELD(CRSR_PAL_RED), FIELD(CRSR_PAL_GREEN),
+    FIELD(CRSR_PAL_BLUE), FIELD(CRSR_XY_X), FIELD(CRSR_XY_Y),
+    FIELD(CRSR_CLIP_X), FIELD(CRSR_CLIP_Y)
+};
+
+// Where the random register contents and values come from.
+rng_State rng;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void checkField(const Field* f);
+void checkReplaced(void);
+void checkOnce(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Checks every accessor against the old macro it replaces for the given
+// field, with random register contents and field values, some of which
+// don't fit the field.
+void checkField(const Field* f)
+{
+    volatile unsigned long reg; unsigned long x, v; int i, c, t; bool same;
+
+    i = f->first;
+    c = f->count;
+    same = reg32(f->mask) == reg32(setBits(0, i, c));
+
+    for (t = 0; t < TRIALS && same; ++t) {
+        x = rng_next(&rng);
+        v = rng_next(&rng) >> (rng_next(&rng) % 32);
+
+        reg = x;
+        reg_modify(&reg, _fieldMask(i, c), _fieldVal(i, c, v));
+        same &= reg32(reg) == reg32(cpyBits(x, i, c, v));
+
+        same &= reg32(_fieldGet(x, i, c)) == reg32(getBits(x, i, c));
+
+        reg = x;
+        reg_set(&reg, f->mask);
+        same &= reg32(reg) == reg32(setBits(x, i, c));
+
+        reg = x;
+        reg_clear(&reg, f->mask);
+        same &= reg32(reg) == reg32(clrBits(x, i, c));
+
+        if (c == 1) {
+            reg = x;
+            reg_modify(&reg, f->mask, _fieldVal(i, c, v));
+            same &= reg32(reg) == reg32(cpyBit(x, i, v));
+            same &= reg32(_fieldGet(x, i, c)) == reg32(getBit(x, i));
+        }
+    }
+
+    host_check(same, "%s (bit %d, %d bits) differs from the old macros",
+        f->name, i, c);
+}
+
+// Checks each line the accessors replaced in the exercises and motor.h,
+// old form against new, for random register contents.
+void checkReplaced(void)
+{
+    volatile unsigned long reg; unsigned long x; int t, v; bool same;
+
+    same = TRUE;
+    for (t = 0; t < TRIALS; ++t) {
+        x = rng_next(&rng);
+
+        // dac_init.
+        reg = x;
+        reg_modify(&reg, fieldMask(PINSEL1_P0_26),
+            fieldVal(PINSEL1_P0_26, PINSEL_AOUT));
+        same &= reg32(reg) == reg32(cpyBits(x, 20, 2, 1 << 1));
+
+        // adc_init.
+        reg = x;
+        reg_modify(&reg, fieldMask(PINSEL1_P0_24),
+            fieldVal(PINSEL1_P0_24, PINSEL_AD0_1));
+        same &= reg32(reg) == reg32(cpyBits(x, 16, 2, 1));
+
+        reg = x;
+        reg_set(&reg, fieldMask(PCONP_PCAD));
+        same &= reg32(reg) == reg32(setBit(x, 12));
+
+        // adc_read.
+        reg = x;
+        reg_modify(&reg, fieldMask(AD0CR_START),
+            fieldVal(AD0CR_START, AD0CR_START_NOW));
+        same &= reg32(reg) == reg32(cpyBits(x, 24, 3, 1));
+        same &= fieldGet(x, AD0DR_DONE) == getBit(x, 31);
+        same &= fieldGet(x, AD0DR_RESULT) == getBits(x, 6, 10);
+
+        // motor_init.
+        reg = x;
+        reg_modify(&reg, fieldMask(PINSEL2_P1_3),
+            fieldVal(PINSEL2_P1_3, PINSEL_PWM0_2));
+        same &= reg32(reg) == reg32(setBits(x, 6, 2));
+
+        reg = x;
+        reg_set(&reg, fieldMask(PWMPCR_ENA2));
+        same &= reg32(reg) == reg32(setBit(x, 10));
+
+        reg = x;
+        reg_set(&reg, fieldMask(PWMMCR_MR0I) | fieldMask(PWMMCR_MR0R));
+        same &= reg32(reg) == reg32(setBits(x, 0, 2));
+    }
+
+    // The whole A/D control word written by adc_init, for every divider.
+    for (v = 0; v < 256; ++v) {
+        x = fieldVal(AD0CR_SEL, 1 << 1) | fieldVal(AD0CR_CLKDIV, v)
+            | fieldVal(AD0CR_PDN, 1);
+        same &= reg32(x) == reg32(setBit(cpyBits(2, 8, 8, v), 21));
+    }
+
+    // dac_write, for every sample value.
+    for (v = 0; v < 1024; ++v) {
+        same &= reg32(fieldVal(DACR_VALUE, v)) == reg32(cpyBits(0, 6, 10, v));
+    }
+
+    // motor_init's timer control word.
+    x = fieldVal(PWMTCR_ENABLE, 1) | fieldVal(PWMTCR_PWM_ENABLE, 1);
+    same &= reg32(x) == reg32(setBit(setBit(0, 0), 3));
+
+    host_check(same, "a replaced line writes something different");
+}
+
+// Checks that the accessors evaluate each argument once, which the old
+// macros didn't.
+void checkOnce(void)
+{
+    volatile unsigned long reg; int n;
+
+    n = 0;
+    reg = 0;
+    reg_modify(&reg, fieldMask(AD0CR_SEL), fieldVal(AD0CR_SEL, ++n));
+    reg_modify(&reg, fieldMask(AD0CR_CLKDIV),
+        fieldVal(AD0CR_CLKDIV, fieldGet(++n, AD0CR_SEL)));
+
+    host_check(n == 2 && reg == (1 | (2 << 8)),
+        "arguments evaluated more than once");
+}
+
+// Runs every check. Exits with 0 if they all passed.
+int main(void)
+{
+    int i;
+
+    rng_seed(&rng, 29);
+
+    for (i = 0; i < (int) (sizeof(fields) / sizeof(fields[0])); ++i) {
+        checkField(&fields[i]);
+    }
+    checkReplaced();
+    checkOnce();
+
+    return host_finish("regtest");
+}
@@ -0,0 +1,251 @@
+/**
+ * File Name  : replaytest.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host test for replay.h and the input.h functions built on it.
+ *              Plays a scripted session on the stand-in button pins while
+ *              recording, the way an exercise's input task polls them, then
+ *              plays the recording back with different buttons on the pins
+ *              and checks the exercise would see exactly the same presses at
+ *              the same ticks. Also checks that chords never arrive as
+ *              single presses.
+ *
+ *              The exercises themselves aren't built here. Their main loops
+ *              hand over to the scheduler and the sample clock interrupt,
+ *              which the PC doesn't have, so input.h is as far up as the
+ *              recorded buttons are followed.
+ * Usage      : replaytest
+ *              Build with "make replaytest", or run with the rest by "make
+ *              check".
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include "host.h"
+#include "input.h"
+#include "replay.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Ticks between polls of the buttons, as in ex4 and ex5.
+#define POLL_PERIOD 10
+
+// The most presses a session can give.
+#define MAX_PRESSES 64
+
+// The seed recorded with the session.
+#define SEED 0x1234abcd
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// The buttons held on the pins from the given tick on.
+typedef struct {
+    int tick;
+    unsigned long buttons;
+} Change;
+
+// A button press seen by the program, and the tick it was seen at.
+typedef struct {
+    int tick;
+    int button;
+} Press;
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// The FIO0PIN mask of a single button.
+#define B(button) (1ul << (button))
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// A session with taps of each button, a press that spans several polls,
+// changes between polls that a poll never sees, and both chords, with
+// a tap of the centre button while one is held. Ends with nothing held.
+const Change session[] = {
+    { 0, 0 },
+    { 15, B(BUTTON_UP) },
+    { 32, 0 },
+    { 47, B(BUTTON_CENTER) },
+    { 58, 0 },
+    { 60, B(BUTTON_DOWN) },
+    { 121, 0 },
+    { 133, B(BUTTON_RIGHT) },
+    { 134, 0 },
+    { 150, B(BUTTON_LEFT) },
+    { 171, B(BUTTON_LEFT) | B(BUTTON_RIGHT) },
+    { 205, B(BUTTON_RIGHT) },
+    { 216, 0 },
+    { 240, B(BUTTON_UP) },
+    { 251, B(BUTTON_UP) | B(BUTTON_DOWN) },
+    { 262, B(BUTTON_UP) | B(BUTTON_DOWN) | B(BUTTON_CENTER) },
+    { 283, B(BUTTON_DOWN) },
+    { 299, 0 },
+    { 310, B(BUTTON_LEFT) },
+    { 333, 0 },
+    { 400, 0 }
+};
+
+// The presses the program should see from that session, polled every
+// POLL_PERIOD ticks. Chord buttons count when they're let go; the centre
+// counts when it goes down. Nothing counts while a chord is held, or
+// between changes a poll doesn't see.
+const Press expected[] = {
+    { 40, BUTTON_UP },
+    { 50, BUTTON_CENTER },
+    { 130, BUTTON_DOWN },
+    { 340, BUTTON_LEFT }
+};
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void setPins(unsigned long buttons);
+int runSession(const Change* changes, int count, Press* presses);
+bool samePresses(const Press* a, int aCount, const Press* b, int bCount);
+void checkLive(void);
+void checkReplay(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Puts the given buttons on the stand-in pins, which read 0 while pressed.
+void setPins(unsigned long buttons)
+{
+    FIO0PIN = ~buttons;
+}
+
+// Runs a session, putting each change on the pins at its tick (if changes
+// isn't NULL) and polling the buttons every POLL_PERIOD ticks, as the
+// scheduler would run an input task. Writes the presses seen into presses
+// and returns how many there were.
+int runSession(const Change* changes, int count, Press* presses)
+{
+    int tick, next, n, button, end;
+
+    next = n = 0;
+    end = session[sizeof(session) / sizeof(session[0]) - 1].tick;
+
+    for (tick = 0; tick <= end; ++tick) {
+        sched_ticks = tick;
+
+        while (changes != NULL && next < count && changes[next].tick <= tick) {
+            setPins(changes[next++].buttons);
+        }
+
+        if (tick % POLL_PERIOD != 0) continue;
+
+        button = input_getButtonPress();
+        if (button != BUTTON_NONE && n < MAX_PRESSES) {
+            presses[n].tick = tick;
+            presses[n++].button = button;
+        }
+    }
+
+    return n;
+}
+
+// Checks whether two lists of presses are the same.
+bool samePresses(const Press* a, int aCount, const Press* b, int bCount)
+{
+    int i;
+
+    if (aCount != bCount) return FALSE;
+
+    for (i = 0; i < aCount; ++i) {
+        if (a[i].tick != b[i].tick || a[i].button != b[i].button) return FALSE;
+    }
+
+    return TRUE;
+}
+
+// Checks that without recording or playback the real buttons come straight
+// through, and give the expected presses.
+void checkLive(void)
+{
+    Press presses[MAX_PRESSES]; int n, count;
+
+    host_check(replay_init(SEED) == SEED && replay_mode == REPLAY_LIVE,
+        "replay_init didn't leave the buttons live");
+
+    count = sizeof(session) / sizeof(session[0]);
+    n = runSession(session, count, presses);
+
+    host_check(samePresses(presses, n, expected,
+        sizeof(expected) / sizeof(expected[0])),
+        "live session gave %d presses, not the expected ones", n);
+}
+
+// Records the session, checks the script holds every change a poll saw, then
+// plays it back with other buttons held on the pins and checks the presses
+// match.
+void checkReplay(void)
+{
+    Press recorded[MAX_PRESSES], played[MAX_PRESSES]; Change noise[2];
+    int nRecorded, nPlayed, i; bool ordered;
+
+    replay_record(SEED);
+    nRecorded = runSession(session, sizeof(session) / sizeof(session[0]),
+        recorded);
+
+    host_check(samePresses(recorded, nRecorded, expected,
+        sizeof(expected) / sizeof(expected[0])),
+        "recording changed the presses seen");
+
+    // Every step is a change, in time order, and the last lets go of
+    // everything.
+    ordered = replay_length > 0 && replay_steps[0].buttons != 0;
+    for (i = 1; i < replay_length; ++i) {
+        ordered &= replay_steps[i].tick > replay_steps[i - 1].tick;
+        ordered &= replay_steps[i].buttons != replay_steps[i - 1].buttons;
+        ordered &= replay_steps[i].tick % POLL_PERIOD == 0;
+    }
+    ordered &= replay_steps[max(replay_length - 1, 0)].buttons == 0;
+    host_check(ordered, "recorded script of %d steps is malformed",
+        replay_length);
+
+    // Play it back with the real buttons doing something else entirely,
+    // which should be ignored until the script runs out.
+    noise[0].tick = 0;
+    noise[0].buttons = B(BUTTON_CENTER);
+    noise[1].tick = 100;
+    noise[1].buttons = B(BUTTON_LEFT);
+
+    replay_play(replay_steps, replay_length, SEED);
+    nPlayed = runSession(noise, 2, played);
+
+    host_check(samePresses(played, nPlayed, recorded, nRecorded),
+        "playback gave %d presses, recording %d", nPlayed, nRecorded);
+
+    host_check(replay_seedValue == SEED, "playback lost the seed");
+    host_check(replay_takeFinished() && !replay_takeFinished(),
+        "end of playback not reported exactly once");
+    host_check(replay_mode == REPLAY_LIVE, "buttons not live after playback");
+
+    // Afterwards the real buttons come through again.
+    setPins(B(BUTTON_LEFT));
+    host_check(input_isKeyDown(BUTTON_LEFT), "real buttons ignored after");
+    setPins(0);
+    input_getButtonPress();
+}
+
+// Runs every check. Exits with 0 if they all passed.
+int main(void)
+{
+    setPins(0);
+
+    checkLive();
+    checkReplay();
+
+    return host_finish("replaytest");
+}
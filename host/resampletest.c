@@ -0,0 +1,347 @@
+/**
+ * File Name  : resampletest.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host test for resample.h. Works out the frequency response of
+ *              the filter for each factor exactly from its taps and checks it
+ *              against what resample.h claims, then passes tones through the
+ *              decimators and interpolators themselves, 10 bit rounding and
+ *              all, and measures how flat the passband is and how much is
+ *              left of anything that would alias or image. Also checks that
+ *              decimating several channels together gives exactly what
+ *              decimating each alone does.
+ * Usage      : resampletest
+ *              Build with "make resampletest", or run with the rest by "make
+ *              check".
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include <math.h>
+
+#include "host.h"
+#include "rng.h"
+#include "resample.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of factors there are filters for.
+#define FACTORS 3
+
+// What resample.h claims of each filter: flat to within FLAT_RIPPLE dB up to
+// FLAT_EDGE of the lower rate's Nyquist frequency, and anything that would
+// fold down below STOP_EDGE of it cut by at least STOP_REJECTION dB.
+#define FLAT_EDGE 0.85
+#define FLAT_RIPPLE 0.1
+#define STOP_EDGE 0.8
+#define STOP_REJECTION 65.0
+
+// The number of frequencies the exact response is worked out at, from 0 to
+// the higher rate's Nyquist frequency.
+#define RESPONSE_POINTS 20000
+
+// The number of tones tried in each band, the number of output samples each
+// is measured over once the filter has settled, and the tones' amplitude,
+// most of the converters' range.
+#define TONES 8
+#define TONE_LENGTH 8192
+#define TONE_SETTLE (RESAMPLE_TAPS * RESAMPLE_MAX_FACTOR)
+#define TONE_AMPLITUDE 400.0
+
+// The least anything that would alias or image must be cut by in the real
+// thing, in dB. Rounding the output to 10 bits leaves spurs of its own
+// around 60 dB down, so it can't be measured as deep as the filters cut. The
+// passband is held to FLAT_RIPPLE, the same as the design.
+#define TONE_REJECTION 55.0
+
+// The number of frames of noise decimated together and one channel at a
+// time.
+#define FRAMES_LENGTH 5000
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The factors there are filters for.
+const int factors[FACTORS] = { 2, 4, 6 };
+
+// The filter being tested, and what came out of it.
+resample_Filter filter;
+short output[TONE_LENGTH];
+
+// The frame decimator being tested and a filter for each channel, and what
+// came out of each.
+resample_Frames frames;
+resample_Filter channelFilters[RESAMPLE_MAX_CHANNELS];
+short together[RESAMPLE_MAX_CHANNELS][FRAMES_LENGTH];
+short alone[RESAMPLE_MAX_CHANNELS][FRAMES_LENGTH];
+
+// Where the noise comes from.
+rng_State rng;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+double gainAt(const short* taps, int count, double freq);
+double foldDistance(double freq, int factor);
+void checkDesign(int factor);
+void playTone(bool interpolate, double freq);
+double measureTone(double freq);
+void checkTones(int factor);
+void checkUnity(void);
+void checkFrames(int factor, int channels);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Gives the gain in dB of the given taps at the given frequency, in cycles
+// per sample.
+double gainAt(const short* taps, int count, double freq)
+{
+    int k; double re, im;
+
+    re = im = 0.0;
+    for (k = 0; k < count; ++k) {
+        re += taps[k] * cos(2.0 * PI * freq * k);
+        im -= taps[k] * sin(2.0 * PI * freq * k);
+    }
+
+    return 20.0 * log10(sqrt(re * re + im * im) / (1 << RESAMPLE_COEFF_SHIFT)
+        + 1e-300);
+}
+
+// Gives how far the given frequency at the higher rate lands from 0 once
+// decimated by factor, as a fraction of the lower rate's Nyquist frequency.
+double foldDistance(double freq, int factor)
+{
+    double folded;
+
+    folded = fmod(freq * factor, 1.0);
+    return 2.0 * fmin(folded, 1.0 - folded);
+}
+
+// Works out the response of the filter for the given factor from its taps,
+// and checks the taps add up to one, the passband is as flat as claimed, and
+// everything that would fold into the band is cut as far as claimed.
+void checkDesign(int factor)
+{
+    const short* taps; int i, count; long sum; double freq, gain;
+    double ripple, rejection;
+
+    taps = resample_prototype(factor);
+    count = factor * RESAMPLE_TAPS;
+
+    sum = 0;
+    for (i = 0; i < count; ++i) sum += taps[i];
+    host_check(sum == 1 << RESAMPLE_COEFF_SHIFT,
+        "factor %d taps add up to %ld", factor, sum);
+
+    ripple = 0.0;
+    rejection = 1000.0;
+    for (i = 0; i <= RESPONSE_POINTS; ++i) {
+        freq = 0.5 * i / RESPONSE_POINTS;
+        gain = gainAt(taps, count, freq);
+
+        // In the band itself, or folding into it from above.
+        if (freq * factor * 2.0 <= FLAT_EDGE) {
+            ripple = fmax(ripple, fabs(gain));
+        } else if (freq * factor * 2.0 >= 1.0
+            && foldDistance(freq, factor) < STOP_EDGE) {
+            rejection = fmin(rejection, -gain);
+        }
+    }
+
+    printf("factor %d design: ripple %.3f dB, rejection %.1f dB\n",
+        factor, ripple, rejection);
+    host_check(ripple <= FLAT_RIPPLE, "factor %d ripple %.3f dB", factor,
+        ripple);
+    host_check(rejection >= STOP_REJECTION, "factor %d rejection %.1f dB",
+        factor, rejection);
+}
+
+// Runs a tone at the given frequency, in cycles per sample at the rate it
+// goes in, through the filter until it has settled, then keeps TONE_LENGTH
+// samples of what comes out in output.
+void playTone(bool interpolate, double freq)
+{
+    int n, i; short sample, out;
+
+    resample_reset(&filter);
+
+    i = 0;
+    for (n = -TONE_SETTLE; n < TONE_LENGTH; ) {
+        if (!interpolate || resample_wantsInput(&filter)) {
+            sample = (short) floor(RESAMPLE_MIDDLE
+                + TONE_AMPLITUDE * sin(2.0 * PI * freq * i++) + 0.5);
+
+            if (interpolate) resample_push(&filter, sample);
+            else if (!resample_decimate(&filter, sample, &out)) continue;
+        }
+
+        if (interpolate) out = resample_interpolate(&filter);
+        if (n >= 0) output[n] = out;
+        ++n;
+    }
+}
+
+// Gives the level of the tone at the given frequency, in cycles per sample,
+// in output, in dB relative to TONE_AMPLITUDE. A Hann window stops a loud
+// tone nearby from leaking into a quiet one.
+double measureTone(double freq)
+{
+    int i; double w, x, re, im, sumW;
+
+    re = im = sumW = 0.0;
+    for (i = 0; i < TONE_LENGTH; ++i) {
+        w = 0.5 - 0.5 * cos(2.0 * PI * i / TONE_LENGTH);
+        x = w * (output[i] - RESAMPLE_MIDDLE);
+        re += x * cos(2.0 * PI * freq * i);
+        im += x * sin(2.0 * PI * freq * i);
+        sumW += w;
+    }
+
+    return 20.0 * log10(2.0 * sqrt(re * re + im * im) / sumW
+        / TONE_AMPLITUDE + 1e-300);
+}
+
+// Passes tones through the decimator and interpolator for the given factor,
+// and checks how flat the passband is and how far anything that would alias
+// or image is cut. Passband tones are spread up to FLAT_EDGE of the lower
+// rate's Nyquist frequency. The tones that would alias or image are the ones
+// landing below STOP_EDGE of it, which is all the filters promise to cut.
+void checkTones(int factor)
+{
+    int i; double pass, near, level, ripple, rejection;
+
+    ripple = 0.0;
+    rejection = 1000.0;
+
+    // Tones above the lower rate's Nyquist frequency fold down below it, as
+    // far under it as they were over. Frequencies here are in cycles per
+    // sample at the lower rate.
+    resample_initDecimator(&filter, factor);
+    for (i = 0; i < TONES; ++i) {
+        pass = 0.5 * FLAT_EDGE * (i + 1) / TONES;
+        near = 0.5 * STOP_EDGE * (i + 1) / TONES;
+
+        playTone(FALSE, pass / factor);
+        level = measureTone(pass);
+        ripple = fmax(ripple, fabs(level));
+
+        playTone(FALSE, (1.0 - near) / factor);
+        level = measureTone(near);
+        rejection = fmin(rejection, -level);
+    }
+
+    // Each tone's first image is as far over the lower rate's Nyquist
+    // frequency as the tone is under it.
+    resample_initInterpolator(&filter, factor);
+    for (i = 0; i < TONES; ++i) {
+        pass = 0.5 * FLAT_EDGE * (i + 1) / TONES;
+        near = 0.5 * STOP_EDGE * (i + 1) / TONES;
+
+        playTone(TRUE, pass);
+        level = measureTone(pass / factor);
+        ripple = fmax(ripple, fabs(level));
+
+        playTone(TRUE, near);
+        level = measureTone((1.0 - near) / factor);
+        rejection = fmin(rejection, -level);
+    }
+
+    printf("factor %d tones:  ripple %.3f dB, rejection %.1f dB\n",
+        factor, ripple, rejection);
+    host_check(ripple <= FLAT_RIPPLE, "factor %d tone ripple %.3f dB",
+        factor, ripple);
+    host_check(rejection >= TONE_REJECTION, "factor %d tone rejection %.1f dB",
+        factor, rejection);
+}
+
+// Checks that a factor of 1 passes samples straight through both ways.
+void checkUnity(void)
+{
+    int i; short out; bool same;
+
+    same = TRUE;
+
+    resample_initDecimator(&filter, 1);
+    for (i = 0; i <= RESAMPLE_SAMPLE_MAX; ++i) {
+        same &= resample_decimate(&filter, (short) i, &out) && out == i;
+    }
+
+    resample_initInterpolator(&filter, 1);
+    for (i = 0; i <= RESAMPLE_SAMPLE_MAX; ++i) {
+        same &= resample_wantsInput(&filter);
+        resample_push(&filter, (short) i);
+        same &= resample_interpolate(&filter) == i;
+    }
+
+    host_check(same, "a factor of 1 changed the samples");
+}
+
+// Decimates the same noise on each of the given number of channels together
+// and one channel at a time by the given factor, and checks both give the
+// same samples on the same frames.
+void checkFrames(int factor, int channels)
+{
+    short frame[RESAMPLE_MAX_CHANNELS]; short* outs[RESAMPLE_MAX_CHANNELS];
+    int i, c, n; bool stored, same;
+
+    resample_initFrames(&frames, factor, channels);
+    for (c = 0; c < channels; ++c) {
+        resample_initDecimator(&channelFilters[c], factor);
+        outs[c] = together[c];
+    }
+
+    n = 0;
+    same = TRUE;
+    for (i = 0; i < FRAMES_LENGTH * factor; ++i) {
+        for (c = 0; c < channels; ++c) {
+            frame[c] = (short) (rng_next(&rng) % (RESAMPLE_SAMPLE_MAX + 1));
+        }
+
+        stored = resample_decimateFrame(&frames, frame, outs,
+            (unsigned long) n);
+        for (c = 0; c < channels; ++c) {
+            same &= resample_decimate(&channelFilters[c], frame[c],
+                &alone[c][n]) == stored;
+        }
+
+        if (stored) ++n;
+    }
+
+    for (c = 0; c < channels; ++c) {
+        same &= memcmp(together[c], alone[c], n * sizeof(short)) == 0;
+    }
+
+    host_check(same && n == FRAMES_LENGTH,
+        "factor %d, %d channels decimated together differ", factor,
+        channels);
+}
+
+// Runs every check. Exits with 0 if they all passed.
+int main(void)
+{
+    int i, c;
+
+    rng_seed(&rng, 45);
+
+    for (i = 0; i < FACTORS; ++i) {
+        checkDesign(factors[i]);
+        checkTones(factors[i]);
+    }
+    checkUnity();
+
+    for (c = 1; c <= RESAMPLE_MAX_CHANNELS; ++c) {
+        checkFrames(1, c);
+        for (i = 0; i < FACTORS; ++i) checkFrames(factors[i], c);
+    }
+
+    return host_finish("resampletest");
+}
@@ -0,0 +1,232 @@
+/**
+ * File Name  : rngtest.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host test for rng.h. Checks that the bulk and pooled outputs
+ *              give the same sequence as rng_next, then tests the output
+ *              statistically: how evenly it fills buckets (chi-square), the
+ *              correlation between successive values and how often each bit
+ *              is set. Finishes by timing each way of getting values.
+ * Usage      : rngtest
+ *              Build with "make rngtest", or run with the rest by "make
+ *              check".
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include <math.h>
+
+#include "host.h"
+#include "rng.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of values each statistical test draws.
+#define SAMPLES (1 << 22)
+
+// The number of buckets for the chi-square test, and the value of the
+// statistic (for BUCKETS - 1 degrees of freedom) that a good generator only
+// exceeds one time in a thousand.
+#define BUCKETS 256
+#define CHI_SQUARE_LIMIT 330.5
+
+// How many standard deviations from what is expected the correlation and
+// the bit counts may be. Five makes a false failure very unlikely across
+// the 33 values tested.
+#define SIGMAS 5.0
+
+// The number of values timed for each way of getting them.
+#define TIMED_VALUES 100000000
+
+// The number of values in each bulk fill while timing.
+#define FILL_COUNT 1024
+
+// The seed used throughout.
+#define SEED 12345
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Somewhere for timed results to go, so they aren't optimised away.
+volatile unsigned int sink;
+
+// Filled in bulk by the tests and timings.
+unsigned int values[FILL_COUNT];
+fixed fractions[FILL_COUNT];
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void checkSequences(void);
+void checkBuckets(int shift, const char* name);
+void checkCorrelation(void);
+void checkBits(void);
+void timeAll(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Checks that rng_fill, rng_fillQ16 and the pool give the same values as
+// rng_next and rng_nextQ16, and that a zero seed still gives values.
+void checkSequences(void)
+{
+    rng_State one, bulk; rng_Pool pool; int i; bool same;
+
+    rng_seed(&one, SEED);
+    rng_seed(&bulk, SEED);
+    rng_fill(&bulk, values, FILL_COUNT);
+
+    same = TRUE;
+    for (i = 0; i < FILL_COUNT; ++i) same &= values[i] == rng_next(&one);
+    same &= bulk.s == one.s;
+    host_check(same, "rng_fill differs from rng_next");
+
+    rng_fillQ16(&bulk, fractions, FILL_COUNT);
+
+    same = TRUE;
+    for (i = 0; i < FILL_COUNT; ++i) {
+        same &= fractions[i] == rng_nextQ16(&one);
+        same &= fractions[i] >= 0 && fractions[i] < FIXED_ONE;
+    }
+    host_check(same, "rng_fillQ16 differs from rng_nextQ16");
+
+    rng_seed(&one, SEED);
+    rng_poolSeed(&pool, SEED);
+
+    same = TRUE;
+    for (i = 0; i < 3 * RNG_POOL_SIZE + 5; ++i) {
+        same &= rng_poolNext(&pool) == rng_next(&one);
+    }
+    host_check(same, "rng_poolNext differs from rng_next");
+
+    rng_seed(&one, 0);
+    host_check(rng_next(&one) != 0, "zero seed gives zero");
+}
+
+// Draws SAMPLES values and sorts them into BUCKETS buckets by their bits from
+// shift up, then checks how far the counts are from even by the chi-square
+// statistic.
+void checkBuckets(int shift, const char* name)
+{
+    static unsigned int counts[BUCKETS];
+    rng_State rng; int i; double expected, chi, d;
+
+    for (i = 0; i < BUCKETS; ++i) counts[i] = 0;
+
+    rng_seed(&rng, SEED);
+    for (i = 0; i < SAMPLES; ++i) {
+        ++counts[(rng_next(&rng) >> shift) % BUCKETS];
+    }
+
+    expected = (double) SAMPLES / BUCKETS;
+    chi = 0.0;
+    for (i = 0; i < BUCKETS; ++i) {
+        d = counts[i] - expected;
+        chi += d * d / expected;
+    }
+
+    printf("%s bits chi-square %.1f (limit %.1f)\n",
+        name, chi, CHI_SQUARE_LIMIT);
+    host_check(chi < CHI_SQUARE_LIMIT, "%s bits chi-square %g", name, chi);
+}
+
+// Checks the correlation between each fixed point value and the next, which
+// should be zero to within the spread expected of SAMPLES values.
+void checkCorrelation(void)
+{
+    rng_State rng; int i; double x, last, sum, sumSq, sumPairs, mean, r;
+    double limit;
+
+    rng_seed(&rng, SEED);
+    last = (double) rng_nextQ16(&rng) / FIXED_ONE;
+    sum = sumSq = sumPairs = 0.0;
+
+    for (i = 0; i < SAMPLES; ++i) {
+        x = (double) rng_nextQ16(&rng) / FIXED_ONE;
+        sum += x;
+        sumSq += x * x;
+        sumPairs += x * last;
+        last = x;
+    }
+
+    mean = sum / SAMPLES;
+    r = (sumPairs / SAMPLES - mean * mean) / (sumSq / SAMPLES - mean * mean);
+    limit = SIGMAS / sqrt(SAMPLES);
+
+    printf("serial correlation %.2e (limit %.2e)\n", r, limit);
+    host_check(fabs(r) < limit, "serial correlation %g", r);
+}
+
+// Checks that each of the 32 bits is set in half of the values, to within
+// the spread expected of SAMPLES values.
+void checkBits(void)
+{
+    static unsigned int counts[32];
+    rng_State rng; unsigned int v; int i, b; double worst, off;
+
+    for (b = 0; b < 32; ++b) counts[b] = 0;
+
+    rng_seed(&rng, SEED);
+    for (i = 0; i < SAMPLES; ++i) {
+        v = rng_next(&rng);
+        for (b = 0; b < 32; ++b) counts[b] += (v >> b) & 1;
+    }
+
+    worst = 0.0;
+    for (b = 0; b < 32; ++b) {
+        off = fabs(counts[b] - SAMPLES / 2.0) / (0.5 * sqrt(SAMPLES));
+        worst = fmax(worst, off);
+        host_check(off < SIGMAS, "bit %d set %u times", b, counts[b]);
+    }
+
+    printf("bit balance worst %.2f sigma (limit %.1f)\n", worst, SIGMAS);
+}
+
+// Times getting values one by one, in bulk and from a pool.
+void timeAll(void)
+{
+    rng_State rng; rng_Pool pool; unsigned int n; int i; double start;
+
+    rng_seed(&rng, SEED);
+    n = 0;
+    start = host_now();
+    for (i = 0; i < TIMED_VALUES; ++i) n += rng_next(&rng);
+    printf("rng_next     %7.1f M values/s\n",
+        TIMED_VALUES / (host_now() - start) * 1e-6);
+
+    start = host_now();
+    for (i = 0; i < TIMED_VALUES; i += FILL_COUNT) {
+        rng_fill(&rng, values, FILL_COUNT);
+        n += values[FILL_COUNT - 1];
+    }
+    printf("rng_fill     %7.1f M values/s\n",
+        TIMED_VALUES / (host_now() - start) * 1e-6);
+
+    rng_poolSeed(&pool, SEED);
+    start = host_now();
+    for (i = 0; i < TIMED_VALUES; ++i) n += rng_poolNext(&pool);
+    printf("rng_poolNext %7.1f M values/s\n",
+        TIMED_VALUES / (host_now() - start) * 1e-6);
+
+    sink = n;
+}
+
+// Runs every check, then the timings. Exits with 0 if every check passed.
+int main(void)
+{
+    checkSequences();
+    checkBuckets(24, "top");
+    checkBuckets(0, "bottom");
+    checkCorrelation();
+    checkBits();
+    timeAll();
+
+    return host_finish("rngtest");
+}
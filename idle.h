@@ -0,0 +1,46 @@
+/**
+ * File Name  : idle.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Puts the core to sleep until the next interrupt, in place of
+ *              spinning on a register or a counter. In Idle mode only the
+ *              core's clock stops, so the peripherals (and their interrupts)
+ *              carry on as normal and waking takes a few cycles.
+ *
+ *              To wait for something an interrupt handler does without
+ *              missing it, mask IRQs, check whether it has already happened,
+ *              and only then go idle. A pending interrupt still wakes the
+ *              core while IRQs are masked, and its handler runs once they
+ *              are unmasked.
+ */
+
+#ifndef IDLE_H_GUARD
+#define IDLE_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lpc24xx.h>
+
+#include "utils.h"
+#include "reg.h"
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void idle_enter(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Stops the core until an interrupt enabled in the VIC is raised, whether or
+// not IRQs are masked. Returns straight away if one is already pending.
+void idle_enter(void)
+{
+    PCON = fieldVal(PCON_IDL, 1);
+}
+
+#endif
@@ -3,8 +3,17 @@
  * Author     : James King (gvnj58)
  * Email      : james.king3@durham.ac.uk
  * Contents   : Provides a method to get the last key pressed since the
- *              previous call to that method (if any), and another that waits
- *              for a key to be pressed before returning it.
+ *              previous call to that method (if any). Every read of the
+ *              buttons goes through replay.h, so a session can be recorded
+ *              and played back. Buttons held together as a chord (for the
+ *              profiler's hotkeys) never count as presses.
+ *
+ *              The task that reads the buttons only runs while they're in
+ *              use. A press raises an interrupt that signals it, and it
+ *              polls every INPUT_PERIOD ticks until they've all been let go,
+ *              so nothing runs at all while waiting for a press. A played
+ *              back session polls all the time instead, as only the ticks
+ *              release its scripted presses.
  */
 
 #ifndef INPUT_H_GUARD
@@ -15,6 +24,10 @@
 //////////////
 
 #include "utils.h"
+#include "trace.h"
+#include "replay.h"
+#include "vic.h"
+#include "sched.h"
 
 ///////////////////////
 // Const Definitions //
@@ -31,27 +44,74 @@
 #define BUTTON_RIGHT 13
 #define BUTTON_CENTER 22
 
+// Mask of every button's bit in FIO0PIN.
+#define BUTTON_MASK ((1 << BUTTON_UP) | (1 << BUTTON_DOWN) | (1 << BUTTON_LEFT) \
+    | (1 << BUTTON_RIGHT) | (1 << BUTTON_CENTER))
+
+// Pairs of buttons held together as hotkeys, and every button in any of
+// them.
+#define INPUT_CHORD_LEFT_RIGHT ((1 << BUTTON_LEFT) | (1 << BUTTON_RIGHT))
+#define INPUT_CHORD_UP_DOWN ((1 << BUTTON_UP) | (1 << BUTTON_DOWN))
+#define INPUT_CHORD_BUTTONS (INPUT_CHORD_LEFT_RIGHT | INPUT_CHORD_UP_DOWN)
+
+// Scheduler ticks between polls of the buttons while any is held, and the
+// number of polls in a row that must find them all up before waiting for a
+// press again, so a bouncing release isn't taken for one.
+#define INPUT_PERIOD 10
+#define INPUT_SETTLE_POLLS 2
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The task that reads the buttons, and the number of polls in a row that
+// have found them all up.
+int input_task;
+int input_quietPolls;
+
 ///////////////////////////
 // Function Declarations //
 ///////////////////////////
 
+unsigned long input_readButtons(void);
 int input_getButtonPress(void);
 bool input_isKeyDown(int key);
-int input_waitForButtonPress(void);
+bool input_isChordDown(unsigned long chord);
+
+void input_startTask(int task);
+void input_nextPoll(void);
+void input_armWake(void);
+void input_wakeIsr(void) __attribute__((interrupt("IRQ")));
 
 //////////////////////////
 // Function Definitions //
 //////////////////////////
 
+// Gives a mask of the buttons held down, with a 1 for each one. Real or
+// replayed, depending on replay.h.
+unsigned long input_readButtons(void)
+{
+    // Why on earth does FIO0PIN use a 0 to signify a button being pressed?
+    return replay_filter(~FIO0PIN & BUTTON_MASK);
+}
+
 // Checks to see if a button has been pressed since the last time this function
 // was called, and returns that button's ID if one has. If no button has been
 // pressed, returns BUTTON_NONE.
+//
+// A button that can be part of a chord is only counted once it's let go,
+// and only if no chord was held meanwhile, so pressing the first of a chord
+// doesn't count as pressing it alone. The centre button counts as soon as
+// it goes down. Once a chord is held, nothing counts until every button has
+// been let go.
 int input_getButtonPress(void)
 {
     int i, curr, diff;
 
-    // Record the previous state of ~FIO0PIN between invocations.
+    // Record the previous state of ~FIO0PIN between invocations, and whether
+    // a chord has been held since the buttons were last all up.
     static int prev = 0;
+    static bool chorded = FALSE;
 
     // List of button IDs to loop through.
     const int buttons[BUTTON_COUNT] = {
@@ -62,15 +122,34 @@ int input_getButtonPress(void)
         BUTTON_CENTER
     };
 
-    // Why on earth does FIO0PIN use a 0 to signify a button being pressed?
-    curr = ~FIO0PIN;
+    curr = input_readButtons();
 
-    // Find the buttons that have been pressed since last invocation.
-    diff = (curr ^ prev) & curr;
+    // Note every button that has gone down or up in the trace.
+    for (i = 0; i < BUTTON_COUNT; ++i) {
+        if (getBit(curr ^ prev, buttons[i])) {
+            TRACE(getBit(curr, buttons[i])
+                ? TRACE_BUTTON_DOWN : TRACE_BUTTON_UP, buttons[i], 0);
+        }
+    }
+
+    // Find the buttons that have been pressed, or for the chord buttons
+    // released, since last invocation.
+    diff = ((curr ^ prev) & curr & ~INPUT_CHORD_BUTTONS)
+        | ((curr ^ prev) & prev & INPUT_CHORD_BUTTONS);
 
     // Remember the current button state for next time.
     prev = curr;
 
+    if ((curr & INPUT_CHORD_LEFT_RIGHT) == INPUT_CHORD_LEFT_RIGHT
+        || (curr & INPUT_CHORD_UP_DOWN) == INPUT_CHORD_UP_DOWN) {
+        chorded = TRUE;
+    }
+
+    if (chorded) {
+        if (curr == 0) chorded = FALSE;
+        return BUTTON_NONE;
+    }
+
     // Find the first button that has just been pressed and return it.
     for (i = 0; i < BUTTON_COUNT; ++i) {
         if (getBit(diff, buttons[i])) return buttons[i];
@@ -83,17 +162,77 @@ int input_getButtonPress(void)
 // Checks to see if the specified button is currently pressed.
 bool input_isKeyDown(int button)
 {
-    return getBit(~FIO0PIN, button);
+    return getBit(input_readButtons(), button);
+}
+
+// Checks to see if every button of the given chord (such as
+// INPUT_CHORD_LEFT_RIGHT) is currently pressed.
+bool input_isChordDown(unsigned long chord)
+{
+    return (input_readButtons() & chord) == chord;
+}
+
+// Has the given task, added as SCHED_NOT_PERIODIC, read the buttons. It's
+// signalled by the next press, and must call input_nextPoll at the end of
+// each run. Call after sched_init.
+void input_startTask(int task)
+{
+    input_task = task;
+    input_quietPolls = INPUT_SETTLE_POLLS;
+
+#ifdef INPUT_REPLAY
+    sched_setPeriod(task, INPUT_PERIOD);
+#else
+    vic_install(VIC_CHANNEL_GPIO, VIC_PRIORITY_INPUT, input_wakeIsr);
+    input_armWake();
+#endif
 }
 
-// Blocks until a button is pressed, and then returns that buttons's ID.
-int input_waitForButtonPress(void)
+// Decides when the input task next reads the buttons. Call at the end of
+// each of its runs. While any is held, or has only just been let go, it
+// polls every INPUT_PERIOD ticks, so a chord can be watched and the
+// contacts settle. Once they've stayed up it waits for the next press.
+void input_nextPoll(void)
 {
-    int btn;
-    
-    // Super condensed.
-    while ((btn = input_getButtonPress()) == BUTTON_NONE);
-    return btn;
+#ifndef INPUT_REPLAY
+    if (input_readButtons() != 0) {
+        input_quietPolls = 0;
+    } else if (++input_quietPolls >= INPUT_SETTLE_POLLS) {
+        if (sched_tasks[input_task].period != SCHED_NOT_PERIODIC) {
+            sched_setPeriod(input_task, SCHED_NOT_PERIODIC);
+        }
+        input_armWake();
+        return;
+    }
+
+    if (sched_tasks[input_task].period == SCHED_NOT_PERIODIC) {
+        sched_setPeriod(input_task, INPUT_PERIOD);
+    }
+#endif
+}
+
+// Has the next button to go down raise an interrupt, which signals the
+// input task. The pins read 0 while pressed, so a press is a falling edge.
+// A button already down has no edge to come, so signals the task itself.
+void input_armWake(void)
+{
+    IO0_INT_CLR = BUTTON_MASK;
+    IO0_INT_EN_F |= BUTTON_MASK;
+
+    if (input_readButtons() != 0) sched_signal(input_task);
+}
+
+// Signals the input task when a button goes down. Turns the edge interrupt
+// off until input_armWake, as the task polls from here, and a bouncing
+// contact would otherwise keep raising it.
+void input_wakeIsr(void)
+{
+    IO0_INT_EN_F &= ~BUTTON_MASK;
+    IO0_INT_CLR = BUTTON_MASK;
+
+    sched_signal(input_task);
+
+    VICVectAddr = 0;
 }
 
 #endif
@@ -3,7 +3,7 @@
  * Author     : James King (gvnj58)
  * Email      : james.king3@durham.ac.uk
  * Contents   : A couple of handy functions related to drawing text on the LCD
- *              display.
+ *              display, including anti-aliased 2x scaled text.
  */
 
 #ifndef LCD_H_GUARD
@@ -54,6 +54,9 @@ typedef struct {
 // Function Declarations //
 ///////////////////////////
 
+bool lcd_charSample(unsigned char ch, int x, int y);
+bool lcd_bigCharSample(unsigned char ch, int x, int y);
+
 bool lcd_putBigChar(unsigned short x, unsigned short y, char chr);
 void lcd_putBigString(unsigned short x, unsigned short y, char *pStr);
 
@@ -69,41 +72,90 @@ Rect lcd_putBigStringCentered(unsigned short x, unsigned short y,
 // Function Definitions //
 //////////////////////////
 
-bool lcd_putBigChar(unsigned short x, unsigned short y, char chr)
-{  
-    static unsigned char const font_mask[8] =
-        {0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01};
+// Finds whether the given texel of the specified character is
+// solid in that character's bitmap.
+bool lcd_charSample(unsigned char ch, int x, int y)
+{
+    static unsigned char const font_mask[8] = {
+        0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01
+    };
+
+    // Check to see if the texel is out of bounds.
+    if (x < 0 || x >= CHAR_WIDTH) return FALSE;
+    if (y < 0 || y >= CHAR_HEIGHT) return FALSE;
+
+    return font5x7[ch][y] & font_mask[x];
+}
+
+// Finds whether the given texel of the specified character is
+// solid in a 2x super sampled version of that character's bitmap.
+bool lcd_bigCharSample(unsigned char ch, int x, int y)
+{
+    int ix, iy, l, r, t, b, i, j, n; bool dx, dy;
+
+    // Find the texel in the original bitmap.
+    ix = x >> 1;
+    iy = y >> 1;
+
+    // Find which edge of the original texel this texel is.
+    dx = x & 1;
+    dy = y & 1;
+
+    // Find bounds for finding neighbours of the texel.
+    l = ix - !dx; r = ix + dx; t = iy - !dy; b = iy + dy;
+
+    // Count how many neighbouring texels are solid.
+    n = 0;
+    for (i = l; i <= r; ++i) {
+        for (j = t; j <= b; ++j) {
+            if (!lcd_charSample(ch, i, j)) continue;
+            else if (i == ix && j == iy) n += 3;
+            else if (i == ix || j == iy) n += 2;
+            else                         n += 1;
+        }
+    }
 
-    unsigned char data = 0;
+    // Only draw this texel as solid if at least 4 neighbours are.
+    return lcd_charSample(ch, ix, iy) || (n >= 4);
+}
+
+// Draws the given character at the specified location in a font twice the
+// size of the default style. Adapted from lcd_grph.h
+bool lcd_putBigChar(unsigned short x, unsigned short y, char chr)
+{
     unsigned char i = 0, j = 0;
     unsigned char ch = (unsigned char) chr & 0x7f;
+    lcd_color_t color;
 
-    lcd_color_t color = BLACK;
-
-    if((x >= (DISPLAY_WIDTH - BIG_CHAR_WIDTH)) || (y >= (DISPLAY_HEIGHT - BIG_CHAR_HEIGHT))) return FALSE;
+    // Don't draw off-screen.
+    if ((x >= (DISPLAY_WIDTH - BIG_CHAR_WIDTH)) ||
+        (y >= (DISPLAY_HEIGHT - BIG_CHAR_HEIGHT))) return FALSE;
 
-    if((ch < 0x20) || (ch > 0x7f)) ch = 0x20;
+    // Treat strange characters as just spaces.
+    if ((ch < 0x20) || (ch > 0x7f)) ch = 0x20;
 
+    // The character bitmap array is offset by 0x20 from the actual char value.
     ch -= 0x20;
-    for (i = 0; i < BIG_CHAR_HEIGHT; ++i) {
-        data = font5x7[ch][i >> 1];
 
+
+    // Sample each pixel to be drawn. 
+    for (i = 0; i < BIG_CHAR_HEIGHT; ++i) {
         for (j = 0; j < BIG_CHAR_WIDTH; ++j) {
-            if((data & font_mask[j >> 1]) == 0) {  
-                color = BLACK;
-            } else {
-                color = WHITE;
-            }
-            lcd_point(x, y, color);       
+            color = lcd_bigCharSample(ch, j, i) ? WHITE : BLACK;
+            lcd_point(x, y, color);
             ++x;
         }   
         ++y;
         x -= BIG_CHAR_WIDTH;
     }
 
+    // I'm not sure why lcd_putChar returns TRUE, but we may as well replicate
+    // its functionality here just in case.
     return TRUE;
 }
 
+// Draws a string in the specified location in a font twice the size of the
+// default style.
 void lcd_putBigString(unsigned short x, unsigned short y, char *pStr)
 {
     for (;;) {      
@@ -119,20 +171,23 @@ Size lcd_getStringSize(char* str)
 {
     Size size;
 
-    // I should probably take newlines into account some day...
+    // No newline support yet.
     size.width = strlen(str) * CHAR_WIDTH;
     size.height = CHAR_HEIGHT;
 
     return size;
 }
 
+// Calculates the width and height of the given string if it were to be drawn
+// on the LCD display in a font twice the default size.
 Size lcd_getBigStringSize(char* str)
 {
     Size size;
 
-    // I should probably take newlines into account some day...
-    size.width = strlen(str) * BIG_CHAR_WIDTH;
-    size.height = BIG_CHAR_HEIGHT;
+    size = lcd_getStringSize(str);
+
+    size.width *= 2;
+    size.height *= 2;
 
     return size;
 }
@@ -140,6 +195,27 @@ Size lcd_getBigStringSize(char* str)
 // Draws the given string in the centre of the provided rectangle, as defined
 // by its top-left position, width, and height. Returns a Rect structure
 // containing the position and size of the drawn text.
+Rect lcd_putStringCentered(unsigned short x, unsigned short y,
+    unsigned short w, unsigned short h, char* str)
+{
+    Rect rect;
+
+    // Find the size of the text.
+    rect.size = lcd_getStringSize(str);
+
+    // Position the text taking the size into account.
+    rect.pos.x = x + ((w - rect.size.width) >> 1);
+    rect.pos.y = y + ((h - rect.size.height) >> 1);
+
+    // Draw the text at the calculated position.
+    lcd_putString(rect.pos.x, rect.pos.y, str);
+
+    return rect;
+}
+
+// Draws the given string in large lettering in the centre of the provided
+// rectangle, as defined by its top-left position, width, and height. Returns
+// a Rect structure containing the position and size of the drawn text.
 Rect lcd_putBigStringCentered(unsigned short x, unsigned short y,
     unsigned short w, unsigned short h, char* str)
 {
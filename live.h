@@ -0,0 +1,215 @@
+/**
+ * File Name  : live.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Passes audio straight from the A/D converter to the D/A
+ *              converter through a chain of effects from fx.h, a block at a
+ *              time. The interrupt that collects each sample clock tick's
+ *              A/D round swaps the new sample for a processed one with
+ *              live_exchange, and every LIVE_BLOCK samples raises the VIC's
+ *              software channel to have the block just filled processed.
+ *              That runs nested at VIC_PRIORITY_BLOCK, so the sample clock
+ *              and A/D rounds carry on through it, and everything else
+ *              waits.
+ *
+ *              Blocks are processed in place in a ring of LIVE_BLOCKS. While
+ *              one fills, the one before is processed and the one before
+ *              that plays, so a sample comes out LIVE_DELAY samples after it
+ *              went in, plus the A/D round it waits for after the tick, up
+ *              to about 10 us. At 44.1 kHz that's about 1.5 ms. The delay
+ *              from the start of each block going in to it coming out is
+ *              measured as it plays, and any block that comes round to play
+ *              before it has been processed is counted as late.
+ */
+
+#ifndef LIVE_H_GUARD
+#define LIVE_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lpc24xx.h>
+
+#include "utils.h"
+#include "vic.h"
+#include "sched.h"
+#include "prof.h"
+#include "fx.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of samples in each block, and in the ring of blocks. Both are
+// powers of two.
+#define LIVE_BLOCK 32
+#define LIVE_BLOCKS 4
+#define LIVE_RING (LIVE_BLOCK * LIVE_BLOCKS)
+
+// The number of samples between one going in and coming out: one block to
+// fill, and one to process.
+#define LIVE_DELAY (2 * LIVE_BLOCK)
+
+// The range of sample values, and the middle, which is taken as zero.
+#define LIVE_SAMPLE_MAX 0x3ff
+#define LIVE_MIDDLE 0x200
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The ring of blocks, centred on zero.
+int live_ring[LIVE_RING];
+
+// When the first sample of each block in the ring went in, from sched_now.
+unsigned long live_blockStart[LIVE_BLOCKS];
+
+// The number of samples that have gone in, and the number of blocks that
+// have been processed.
+volatile unsigned long live_samples;
+volatile unsigned long live_processed;
+
+// The number of blocks that started playing before they were processed.
+volatile unsigned long live_late;
+
+// The effects every block goes through.
+fx_Chain* live_chain;
+
+// Whether blocks are being processed.
+bool live_running;
+
+// Profiler zones for processing each block and for the delay through, in
+// PCLK cycles, or PROF_NO_ZONE. Set both before live_start.
+int live_zone, live_delayZone;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void live_start(fx_Chain* chain);
+void live_stop(void);
+void live_lock(void);
+void live_unlock(void);
+unsigned long live_delayMicros(int sampleRate);
+
+static inline short live_exchange(short sample);
+void live_process(void);
+void live_blockIsr(void) __attribute__((naked));
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Starts passing samples through the given chain of effects, with silence
+// coming out until the first block has been through. The sample clock
+// interrupt should start calling live_exchange straight afterwards.
+void live_start(fx_Chain* chain)
+{
+    int i;
+
+    for (i = 0; i < LIVE_RING; ++i) live_ring[i] = 0;
+
+    live_samples = 0;
+    live_processed = 0;
+    live_late = 0;
+    live_chain = chain;
+    live_running = TRUE;
+
+    VICSoftIntClr = 1 << VIC_CHANNEL_SOFTWARE;
+    vic_install(VIC_CHANNEL_SOFTWARE, VIC_PRIORITY_BLOCK, live_blockIsr);
+}
+
+// Stops processing blocks. The sample clock interrupt must have stopped
+// calling live_exchange first.
+void live_stop(void)
+{
+    live_running = FALSE;
+
+    vic_disable(VIC_CHANNEL_SOFTWARE);
+    VICSoftIntClr = 1 << VIC_CHANNEL_SOFTWARE;
+}
+
+// Holds off block processing, so the chain can be changed. Samples keep
+// flowing, and any block that fills in the meantime is processed on
+// live_unlock, so keep it short.
+void live_lock(void)
+{
+    vic_disable(VIC_CHANNEL_SOFTWARE);
+}
+
+// Lets block processing carry on after live_lock.
+void live_unlock(void)
+{
+    if (live_running) vic_enable(VIC_CHANNEL_SOFTWARE);
+}
+
+// Gives the designed delay through, at the given sample rate, in
+// microseconds. That's LIVE_DELAY samples, and leaves out the A/D round
+// each sample waits for after its tick, which takes up to about 10 us with
+// all four inputs at ADC_BURST_HZ (see adc.h).
+unsigned long live_delayMicros(int sampleRate)
+{
+    return (unsigned long) (LIVE_DELAY * 1000000ULL / sampleRate);
+}
+
+// Takes in the next 10 bit sample from the A/D converter, and gives out the
+// next one for the D/A converter. Call once per sample clock tick, from the
+// interrupt that collects the tick's A/D round (captureIsr in ex5).
+static inline short live_exchange(short sample)
+{
+    unsigned long i, block; int out;
+
+    i = live_samples & (LIVE_RING - 1);
+    block = i / LIVE_BLOCK;
+
+    // The slot being played from was filled LIVE_DELAY samples ago, and is
+    // about to be filled again.
+    out = live_ring[(i - LIVE_DELAY) & (LIVE_RING - 1)] + LIVE_MIDDLE;
+    live_ring[i] = sample - LIVE_MIDDLE;
+
+    if ((i & (LIVE_BLOCK - 1)) == 0) {
+        // Starting to play a block, which should have been processed.
+        if (live_samples >= LIVE_DELAY) {
+            if (live_processed <= (live_samples - LIVE_DELAY) / LIVE_BLOCK) {
+                ++live_late;
+            }
+
+            PROF_VALUE(live_delayZone, sched_now()
+                - live_blockStart[(block - LIVE_DELAY / LIVE_BLOCK)
+                    & (LIVE_BLOCKS - 1)]);
+        }
+
+        live_blockStart[block] = sched_now();
+    }
+
+    // Have the block processed once it's full.
+    if ((++live_samples & (LIVE_BLOCK - 1)) == 0) {
+        VICSoftInt = 1 << VIC_CHANNEL_SOFTWARE;
+    }
+
+    return (short) min(max(out, 0), LIVE_SAMPLE_MAX);
+}
+
+// Processes every block that has filled since last time. Run by
+// live_blockIsr with IRQs enabled, so the sample clock never waits on it.
+void live_process(void)
+{
+    int* block;
+
+    VICSoftIntClr = 1 << VIC_CHANNEL_SOFTWARE;
+
+    PROF_BEGIN(live_zone);
+
+    while (live_processed < live_samples / LIVE_BLOCK) {
+        block = &live_ring[(live_processed & (LIVE_BLOCKS - 1)) * LIVE_BLOCK];
+        fx_runChain(live_chain, block, LIVE_BLOCK);
+        ++live_processed;
+    }
+
+    PROF_END(live_zone);
+}
+
+VIC_NESTED(live_blockIsr, live_process)
+
+#endif
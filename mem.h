@@ -0,0 +1,192 @@
+/**
+ * File Name  : mem.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Allocators for carving up a region of memory (usually a large
+ *              global array, which lives in SDRAM in the EXTMEM build)
+ *              without touching the newlib heap. Pools hand out fixed size
+ *              blocks, and arenas hand out anything but can only be freed by
+ *              rolling back to an earlier mark. Both take constant time and
+ *              can't fragment.
+ */
+
+#ifndef MEM_H_GUARD
+#define MEM_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Everything handed out is aligned to this many bytes, which is enough for
+// any type we use.
+#define MEM_ALIGN 8
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Rounds the given size up to a multiple of MEM_ALIGN.
+#define memAlign(size) (((size) + MEM_ALIGN - 1) & ~(unsigned long) (MEM_ALIGN - 1))
+
+// The number of bytes needed to back a pool of count blocks of the given
+// size. Backing arrays should also be given MEM_ATTR_ALIGNED.
+#define memPoolBytes(blockSize, count) (memAlign(blockSize) * (count))
+
+// Aligns a backing array suitably for a pool or arena.
+#define MEM_ATTR_ALIGNED __attribute__((aligned(MEM_ALIGN)))
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A bump allocator over a region of memory, along with usage statistics.
+typedef struct {
+    char* base;
+    unsigned long size;
+    unsigned long used;
+    unsigned long highWater;
+    unsigned long failures;
+} mem_Arena;
+
+// A pool of equally sized blocks. Free blocks are kept in a linked list
+// threaded through the blocks themselves.
+typedef struct {
+    void* free;
+    unsigned long blockSize;
+    unsigned long count;
+    unsigned long inUse;
+    unsigned long highWater;
+    unsigned long failures;
+} mem_Pool;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void mem_arenaInit(mem_Arena* arena, void* base, unsigned long size);
+void* mem_arenaAlloc(mem_Arena* arena, unsigned long size);
+unsigned long mem_arenaMark(mem_Arena* arena);
+void mem_arenaReset(mem_Arena* arena, unsigned long mark);
+
+void mem_poolInit(mem_Pool* pool, void* base,
+    unsigned long blockSize, unsigned long count);
+void* mem_poolAlloc(mem_Pool* pool);
+void mem_poolFree(mem_Pool* pool, void* block);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Prepares an arena to allocate from the given region. The start of the
+// region is skipped forward if it isn't suitably aligned.
+void mem_arenaInit(mem_Arena* arena, void* base, unsigned long size)
+{
+    unsigned long skip;
+
+    skip = memAlign((unsigned long) base) - (unsigned long) base;
+
+    arena->base = (char*) base + skip;
+    arena->size = size > skip ? size - skip : 0;
+    arena->used = 0;
+    arena->highWater = 0;
+    arena->failures = 0;
+}
+
+// Allocates size bytes from the arena, or returns NULL if there isn't room.
+void* mem_arenaAlloc(mem_Arena* arena, unsigned long size)
+{
+    void* ptr;
+
+    size = memAlign(size);
+
+    if (size > arena->size - arena->used) {
+        ++arena->failures;
+        return NULL;
+    }
+
+    ptr = arena->base + arena->used;
+    arena->used += size;
+
+    if (arena->used > arena->highWater) arena->highWater = arena->used;
+
+    return ptr;
+}
+
+// Records how much of the arena is in use, so it can be rolled back to this
+// point later with mem_arenaReset.
+unsigned long mem_arenaMark(mem_Arena* arena)
+{
+    return arena->used;
+}
+
+// Frees everything allocated from the arena since the given mark was taken.
+// Pass 0 to free everything.
+void mem_arenaReset(mem_Arena* arena, unsigned long mark)
+{
+    if (mark < arena->used) arena->used = mark;
+}
+
+// Prepares a pool of count blocks of blockSize bytes each from the given
+// region, which must be at least count * memAlign(blockSize) bytes long and
+// aligned to MEM_ALIGN.
+void mem_poolInit(mem_Pool* pool, void* base,
+    unsigned long blockSize, unsigned long count)
+{
+    unsigned long i; void* block;
+
+    // Every block has to be able to hold the free list link.
+    blockSize = memAlign(max(blockSize, sizeof(void*)));
+
+    pool->blockSize = blockSize;
+    pool->count = count;
+    pool->inUse = 0;
+    pool->highWater = 0;
+    pool->failures = 0;
+
+    // Chain the blocks together in address order. Blocks are handled as void
+    // pointers so the link can be written without an alignment warning.
+    pool->free = NULL;
+    for (i = count; i > 0; --i) {
+        block = (char*) base + (i - 1) * blockSize;
+        *(void**) block = pool->free;
+        pool->free = block;
+    }
+}
+
+// Takes a block from the pool, or returns NULL if they are all in use.
+void* mem_poolAlloc(mem_Pool* pool)
+{
+    void* block;
+
+    block = pool->free;
+
+    if (block == NULL) {
+        ++pool->failures;
+        return NULL;
+    }
+
+    pool->free = *(void**) block;
+
+    if (++pool->inUse > pool->highWater) pool->highWater = pool->inUse;
+
+    return block;
+}
+
+// Returns a block to the pool it came from. Freeing NULL does nothing.
+void mem_poolFree(mem_Pool* pool, void* block)
+{
+    if (block == NULL) return;
+
+    *(void**) block = pool->free;
+    pool->free = block;
+
+    --pool->inUse;
+}
+
+#endif
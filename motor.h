@@ -4,7 +4,9 @@
  * Email      : james.king3@durham.ac.uk
  * Contents   : A method to initialize the motor, and another to set the motor
  *              frequency in hertz by finding an interpolated MR2 value from a
- *              a list of pre-recorded 'keypoints'.
+ *              a list of pre-recorded 'keypoints'. Speed changes can also be
+ *              posted as targets, which are then ramped towards from the PWM
+ *              period interrupt so the caller never waits on the motor.
  */
 
 #ifndef MOTOR_H_GUARD
@@ -15,6 +17,10 @@
 //////////////
 
 #include "utils.h"
+#include "vic.h"
+#include "fixed.h"
+#include "reg.h"
+#include "trace.h"
 
 ///////////////////////
 // Const Definitions //
@@ -23,6 +29,26 @@
 // The number of recorded keypoints.
 #define KEYPOINT_COUNT 18
 
+// The number of PCLK ticks in each PWM period. The motor interrupt fires once
+// per period, so at 18 MHz this gives 450 ramp steps a second.
+#define MOTOR_PERIOD 40000
+
+// Ramp profiles used to approach a posted target speed.
+#define MOTOR_RAMP_LINEAR 0
+#define MOTOR_RAMP_EXPONENTIAL 1
+#define MOTOR_RAMP_SCURVE 2
+
+// Largest change in MR2 per PWM period when ramping linearly.
+#define MOTOR_LINEAR_STEP 400
+
+// Fraction (as a power of two) of the remaining distance to the target that
+// is covered each PWM period when ramping exponentially.
+#define MOTOR_EXP_SHIFT 4
+
+// The number of PWM periods (as a power of two) taken by an S-curve ramp.
+#define MOTOR_SCURVE_SHIFT 6
+#define MOTOR_SCURVE_PERIODS (1 << MOTOR_SCURVE_SHIFT)
+
 //////////////////////
 // Type Definitions //
 //////////////////////
@@ -33,6 +59,24 @@ typedef struct {
     int mr2;
 } motor_KeyPoint;
 
+// State of the ramp currently being followed by the PWM period interrupt. MR2
+// values are used throughout so no conversion is needed inside the handler.
+typedef struct {
+    int profile;
+    int start;
+    int target;
+    int current;
+    int step;
+} motor_Ramp;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Shared between motor_setTarget and the PWM interrupt handler. Only written
+// by the former while the PWM channel is disabled in the VIC.
+volatile motor_Ramp motor_ramp;
+
 ///////////////////////////
 // Function Declarations //
 ///////////////////////////
@@ -40,6 +84,11 @@ typedef struct {
 int motor_findMR2Val(double hz);
 void motor_init(void);
 void motor_setSpeed(double hz);
+void motor_setTarget(double hz, int profile);
+
+int motor_stepRamp(volatile motor_Ramp* ramp);
+void motor_period(void);
+void motor_isr(void) __attribute__((naked));
 
 //////////////////////////
 // Function Definitions //
@@ -85,7 +134,8 @@ int motor_findMR2Val(double hz) {
         // MR2 between this keypoint and the previous one.
         if (curr.hz >= hz) {
             t = (hz - prev.hz) / (curr.hz - prev.hz);
-            return (int) round(t * curr.mr2 + (1.0 - t) * prev.mr2);
+            return prev.mr2 + fixed_mulInt(fixed_fromFloat(t),
+                curr.mr2 - prev.mr2);
         }
 
         // Record the current keypoint to be used as the previous one next
@@ -100,28 +150,135 @@ int motor_findMR2Val(double hz) {
 void motor_init(void)
 {
     // Apparently this enables PWM output on P1.3 or something.
-    PINSEL2 = setBits(PINSEL2, 6, 2);
+    reg_modify(&PINSEL2, fieldMask(PINSEL2_P1_3),
+        fieldVal(PINSEL2_P1_3, PINSEL_PWM0_2));
 
     // This tells the PWM unit to control something or other.
-    PWM0PCR = setBit(PWM0PCR, 10);
+    reg_set(&PWM0PCR, fieldMask(PWMPCR_ENA2));
 
     // Use 40k for the pulse period counter.
-    PWM0MR0 = 40000;
+    PWM0MR0 = MOTOR_PERIOD;
 
     // Don't start the motor just yet.
     PWM0MR2 = 0;
 
+    motor_ramp.profile = MOTOR_RAMP_LINEAR;
+    motor_ramp.start = 0;
+    motor_ramp.target = 0;
+    motor_ramp.current = 0;
+    motor_ramp.step = 0;
+
+    // Reset the counter and raise an interrupt on MR0, so there is exactly
+    // one interrupt at the start of each period.
+    reg_set(&PWM0MCR, fieldMask(PWMMCR_MR0I) | fieldMask(PWMMCR_MR0R));
+    trace_name(TRACE_ISR_ENTER, VIC_CHANNEL_PWM, "motor");
+    vic_install(VIC_CHANNEL_PWM, VIC_PRIORITY_MOTOR, motor_isr);
+    vic_enableInterrupts();
+
     // Start the PWM unit.
-    PWM0TCR = setBit(setBit(0, 0), 3);
+    PWM0TCR = fieldVal(PWMTCR_ENABLE, 1) | fieldVal(PWMTCR_PWM_ENABLE, 1);
 }
 
 // Set the motor to spin at a specified speed in revolutions per second.
 void motor_setSpeed(double hz)
 {
-    PWM0MR2 = motor_findMR2Val(hz);
+    int mr2;
+
+    mr2 = motor_findMR2Val(hz);
+
+    // Snap the ramp to the new speed so the interrupt handler doesn't drag it
+    // back towards an old target.
+    vic_disable(VIC_CHANNEL_PWM);
+
+    motor_ramp.start = mr2;
+    motor_ramp.target = mr2;
+    motor_ramp.current = mr2;
+
+    PWM0MR2 = mr2;
 
     // Update next cycle
     PWM0LER = 1 << 2;
+
+    vic_enable(VIC_CHANNEL_PWM);
 }
 
+// Post a new target speed in revolutions per second, to be approached using
+// the given MOTOR_RAMP_* profile. Returns immediately; the PWM period
+// interrupt does the actual stepping.
+void motor_setTarget(double hz, int profile)
+{
+    int mr2;
+
+    mr2 = motor_findMR2Val(hz);
+
+    // Re-posting the same target shouldn't restart the ramp.
+    if (mr2 == motor_ramp.target && profile == motor_ramp.profile) return;
+
+    // Keep the interrupt handler out while the ramp is rewritten.
+    vic_disable(VIC_CHANNEL_PWM);
+
+    motor_ramp.profile = profile;
+    motor_ramp.start = motor_ramp.current;
+    motor_ramp.target = mr2;
+    motor_ramp.step = 0;
+
+    vic_enable(VIC_CHANNEL_PWM);
+}
+
+// Advance the given ramp by one PWM period, returning the new MR2 value.
+int motor_stepRamp(volatile motor_Ramp* ramp)
+{
+    int diff, step, s;
+
+    diff = ramp->target - ramp->current;
+
+    switch (ramp->profile) {
+        case MOTOR_RAMP_LINEAR:
+            step = min(abs(diff), MOTOR_LINEAR_STEP);
+            return ramp->current + (diff < 0 ? -step : step);
+
+        case MOTOR_RAMP_EXPONENTIAL:
+            step = diff >> MOTOR_EXP_SHIFT;
+
+            // Make sure we actually arrive rather than creeping forever.
+            if (step == 0) step = diff < 0 ? -1 : 1;
+            return ramp->current + step;
+
+        case MOTOR_RAMP_SCURVE:
+            if (++ramp->step >= MOTOR_SCURVE_PERIODS) return ramp->target;
+
+            // Smoothstep 3t^2 - 2t^3 with t = step / MOTOR_SCURVE_PERIODS,
+            // scaled to a 12 bit fraction.
+            step = ramp->step;
+            s = (step * step * (3 * MOTOR_SCURVE_PERIODS - 2 * step))
+                >> (3 * MOTOR_SCURVE_SHIFT - 12);
+            return ramp->start + (((ramp->target - ramp->start) * s) >> 12);
+    }
+
+    return ramp->target;
+}
+
+// Called at the start of every PWM period. Moves MR2 one step along the
+// current ramp and latches it, so the new value only takes effect from the
+// start of the next period and can never glitch the one in progress. Run by
+// motor_isr with IRQs enabled.
+void motor_period(void)
+{
+    TRACE(TRACE_ISR_ENTER, VIC_CHANNEL_PWM, 0);
+
+    // Acknowledge the MR0 match.
+    PWM0IR = 1 << 0;
+
+    if (motor_ramp.current != motor_ramp.target) {
+        motor_ramp.current = motor_stepRamp(&motor_ramp);
+
+        PWM0MR2 = motor_ramp.current;
+        PWM0LER = 1 << 2;
+    }
+
+    TRACE(TRACE_ISR_EXIT, VIC_CHANNEL_PWM, 0);
+}
+
+VIC_NESTED(motor_isr, motor_period)
+
 #endif
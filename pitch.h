@@ -0,0 +1,328 @@
+/**
+ * File Name  : pitch.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Pitch detection on a stream of A/D converter samples, for a
+ *              tuner. A sample clock interrupt feeds each sample in with
+ *              pitch_feed, which sums every PITCH_DECIMATION of them into a
+ *              ring buffer at a lower rate. A task then calls pitch_step,
+ *              which every PITCH_HOP of those runs the YIN method over the
+ *              latest PITCH_SPAN of them, a few lags at a time so it never
+ *              holds up anything else for long.
+ *
+ *              YIN finds the period as the first lag at which the signal
+ *              differs little from itself shifted by that lag, normalised by
+ *              how much it differs on average at shorter lags. That picks the
+ *              fundamental rather than a louder harmonic, and copes with
+ *              notes that fade. The lag is refined between samples with a
+ *              parabola, and pitch_findNote turns the result into the nearest
+ *              note from wave.h and how many cents off it is.
+ *
+ *              The latest sample analysed is at most PITCH_HOP old when
+ *              analysis starts, and the oldest is PITCH_SPAN older than that,
+ *              so at 44.1 kHz a new note is picked up within about 40 ms
+ *              plus the few milliseconds the analysis takes.
+ */
+
+#ifndef PITCH_H_GUARD
+#define PITCH_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "fixed.h"
+#include "pt.h"
+#include "ramfunc.h"
+#include "wave.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of samples summed into each one analysed. At 44.1 kHz that
+// leaves 11025 a second, plenty for fundamentals up to the top of the range.
+// The sum is a crude low pass filter, so harmonics above half the new rate
+// fold down a little, which YIN shrugs off.
+#define PITCH_DECIMATION 4
+
+// The range of periods searched, in decimated samples. At 11025 Hz that's
+// from about 1378 Hz (F6) down to 69 Hz (C#2).
+#define PITCH_MIN_LAG 8
+#define PITCH_MAX_LAG 160
+
+// The number of decimated samples compared at each lag.
+#define PITCH_WINDOW 160
+
+// The number of decimated samples each analysis covers, allowing for one
+// more lag than the search needs, for refining the last one.
+#define PITCH_SPAN (PITCH_WINDOW + PITCH_MAX_LAG + 1)
+
+// The number of new decimated samples between analyses.
+#define PITCH_HOP 128
+
+// Size of the ring buffer of decimated samples, a power of two with room for
+// a span and a hop so the interrupt never catches up with the analysis.
+#define PITCH_RING 512
+
+// The most lags worked out per call to pitch_step.
+#define PITCH_LAGS_PER_SLICE 32
+
+// How far the normalised difference must dip, out of 1, to count as a
+// period.
+#define PITCH_THRESHOLD (FIXED_ONE * 15 / 100)
+
+// The least mean square of a decimated sample about the average that counts
+// as a note rather than silence. Decimated samples run from 0 to 2046.
+#define PITCH_MIN_POWER 64
+
+// The frequency below C in the table from wave.h at which the next octave
+// down starts, a quarter tone below it, in sixteenths of a hertz. Twice this
+// is where the next octave up starts.
+#define PITCH_OCTAVE_START (2033 * 16)
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A pitch detector. The interrupt owns sum, phase, written and the ring,
+// and pitch_step everything else.
+typedef struct {
+    short ring[PITCH_RING];
+    volatile unsigned long written;
+    int sum, phase;
+
+    pt_Thread pt;
+    int rate;
+    unsigned long analysed;
+    int count;
+    short samples[PITCH_SPAN];
+    unsigned long diffs[PITCH_MAX_LAG + 2];
+    unsigned long long total;
+    fixed norm, prevNorm;
+    int lag, best;
+
+    // The result of the latest analysis, in sixteenths of a hertz, or 0 if
+    // there was no clear pitch.
+    int hz16;
+} pitch_Detector;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void pitch_init(pitch_Detector* det, int sampleRate);
+static inline void pitch_feed(pitch_Detector* det, short sample);
+int pitch_step(pitch_Detector* det);
+bool pitch_load(pitch_Detector* det);
+unsigned long pitch_difference(const short* samples, int lag) RAMFUNC;
+int pitch_refine(const unsigned long* diffs, int lag);
+bool pitch_findNote(int hz16, int* octave, int* note, int* cents);
+int pitch_cents(int hz16, int noteHz16);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Empties the detector, ready to be fed samples taken at the given rate.
+// Call before the interrupt starts feeding it.
+void pitch_init(pitch_Detector* det, int sampleRate)
+{
+    PT_INIT(&det->pt);
+
+    det->written = 0;
+    det->sum = 0;
+    det->phase = 0;
+
+    det->rate = sampleRate / PITCH_DECIMATION;
+    det->analysed = 0;
+    det->count = 0;
+    det->hz16 = 0;
+}
+
+// Adds a 10 bit sample from the A/D converter. Call from the sample clock
+// interrupt.
+static inline void pitch_feed(pitch_Detector* det, short sample)
+{
+    det->sum += sample;
+    if (++det->phase < PITCH_DECIMATION) return;
+
+    // Halve the sum, so squared differences over a window fit in 32 bits.
+    det->ring[det->written & (PITCH_RING - 1)] = (short) (det->sum >> 1);
+    ++det->written;
+
+    det->sum = 0;
+    det->phase = 0;
+}
+
+// Works on the next analysis. Returns PT_WAITING until enough new samples
+// have arrived, PT_YIELDED while there is more work to do, and PT_ENDED once
+// hz16 holds a new result.
+int pitch_step(pitch_Detector* det)
+{
+    PT_BEGIN(&det->pt);
+
+    PT_WAIT_UNTIL(&det->pt, det->written - det->analysed >= PITCH_HOP
+        && det->written >= PITCH_SPAN);
+
+    det->hz16 = 0;
+    if (!pitch_load(det)) PT_EXIT(&det->pt);
+
+    // Work out the normalised difference at each lag, stopping at the bottom
+    // of the first dip under the threshold.
+    det->total = 0;
+    det->best = 0;
+    det->norm = FIXED_ONE;
+
+    for (det->lag = 1; det->lag <= PITCH_MAX_LAG + 1; ++det->lag) {
+        det->diffs[det->lag] = pitch_difference(det->samples, det->lag);
+        det->total += det->diffs[det->lag];
+
+        det->prevNorm = det->norm;
+        det->norm = det->total == 0 ? FIXED_ONE
+            : (fixed) ((((unsigned long long) det->diffs[det->lag] * det->lag)
+                << FIXED_SHIFT) / det->total);
+
+        // The dip has bottomed out at the previous lag.
+        if (det->best > 0 && det->norm >= det->prevNorm) break;
+
+        if (det->lag >= PITCH_MIN_LAG && det->lag <= PITCH_MAX_LAG
+            && det->norm < PITCH_THRESHOLD) {
+            det->best = det->lag;
+        }
+
+        PT_YIELD_EVERY(&det->pt, det->count, PITCH_LAGS_PER_SLICE);
+    }
+
+    // Refine the bottom of the dip. If the search ran out while still going
+    // down, that's the longest lag searched.
+    if (det->best > 0) {
+        det->hz16 = (int) (((long long) det->rate << (4 + 8))
+            / pitch_refine(det->diffs, det->best));
+    }
+
+    PT_END(&det->pt);
+}
+
+// Copies the latest PITCH_SPAN decimated samples out of the ring buffer with
+// their average taken off, and marks them as analysed. Returns FALSE if they
+// are too quiet to hold a note.
+bool pitch_load(pitch_Detector* det)
+{
+    int i; unsigned long end, power; long sum, mean; short val;
+
+    end = det->written;
+    det->analysed = end;
+
+    sum = 0;
+    for (i = 0; i < PITCH_SPAN; ++i) {
+        val = det->ring[(end - PITCH_SPAN + i) & (PITCH_RING - 1)];
+        det->samples[i] = val;
+        sum += val;
+    }
+    mean = sum / PITCH_SPAN;
+
+    power = 0;
+    for (i = 0; i < PITCH_SPAN; ++i) {
+        det->samples[i] -= (short) mean;
+        power += det->samples[i] * det->samples[i];
+    }
+
+    return power >= (unsigned long) PITCH_MIN_POWER * PITCH_SPAN;
+}
+
+// Sums the squared differences between the first PITCH_WINDOW samples and
+// the ones lag further on.
+unsigned long pitch_difference(const short* samples, int lag)
+{
+    int i, d; unsigned long sum;
+    const short* later;
+
+    later = samples + lag;
+    sum = 0;
+
+    for (i = 0; i < PITCH_WINDOW; ++i) {
+        d = samples[i] - later[i];
+        sum += (unsigned long) (d * d);
+    }
+
+    return sum;
+}
+
+// Fits a parabola through the differences either side of the given lag, and
+// gives the lag at its lowest point in 256ths of a sample. The raw
+// differences give a truer fit than the normalised ones, which are skewed by
+// the running average.
+int pitch_refine(const unsigned long* diffs, int lag)
+{
+    long long a, b, c, curve;
+
+    a = diffs[lag - 1];
+    b = diffs[lag];
+    c = diffs[lag + 1];
+
+    curve = a - 2 * b + c;
+    if (curve <= 0) return lag << 8;
+
+    return (lag << 8) + (int) (((a - c) << 7) / curve);
+}
+
+// Finds the note nearest the given frequency, in sixteenths of a hertz, and
+// how many cents sharp (positive) or flat (negative) of it the frequency is.
+// Returns FALSE if it is outside the octaves wave.h covers.
+bool pitch_findNote(int hz16, int* octave, int* note, int* cents)
+{
+    int n, c, best, bestCents;
+
+    if (hz16 <= 0) return FALSE;
+
+    // Bring the frequency into the table's octave, from a quarter tone below
+    // its C to a quarter tone below the next.
+    *octave = 7;
+    while (hz16 < PITCH_OCTAVE_START) {
+        hz16 <<= 1;
+        --*octave;
+    }
+    while (hz16 >= PITCH_OCTAVE_START * 2) {
+        hz16 >>= 1;
+        ++*octave;
+    }
+
+    // The C at the top of the octave is twice the one at the bottom.
+    best = NOTE_C;
+    bestCents = pitch_cents(hz16, wave_getHertz(7, NOTE_C) << 4);
+    for (n = NOTE_C_SHARP; n <= NOTE_B + 1; ++n) {
+        c = pitch_cents(hz16, n > NOTE_B ? wave_getHertz(7, NOTE_C) << 5
+            : wave_getHertz(7, n) << 4);
+        if (abs(c) < abs(bestCents)) {
+            best = n;
+            bestCents = c;
+        }
+    }
+
+    if (best > NOTE_B) {
+        best = NOTE_C;
+        ++*octave;
+    }
+
+    *note = best;
+    *cents = bestCents;
+
+    return *octave >= OCTAVE_MIN && *octave <= OCTAVE_MAX;
+}
+
+// Gives how many cents one frequency is above another, both in sixteenths of
+// a hertz. For the small ratios between neighbouring notes, ln(a / b) is very
+// nearly 2 (a - b) / (a + b), which saves a logarithm.
+int pitch_cents(int hz16, int noteHz16)
+{
+    int diff;
+
+    // 1200 / ln 2 cents in an e-fold, doubled, in tenths.
+    diff = hz16 - noteHz16;
+    return (diff * 34625 + (diff >= 0 ? 1 : -1) * 5 * (hz16 + noteHz16))
+        / (10 * (hz16 + noteHz16));
+}
+
+#endif
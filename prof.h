@@ -0,0 +1,371 @@
+/**
+ * File Name  : prof.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : A lightweight profiler. Code between PROF_BEGIN and PROF_END
+ *              is timed with the scheduler's free-running timer, and each
+ *              zone keeps a count, min / max / average and a histogram of
+ *              its run times in power of two buckets. The results can be
+ *              drawn over the display or sent over the serial port, and a
+ *              hotkey (left and right together) is provided to do both.
+ *              Up and down together send the event trace from trace.h.
+ */
+
+#ifndef PROF_H_GUARD
+#define PROF_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "lcd.h"
+#include "input.h"
+#include "sched.h"
+#include "uart.h"
+#include "trace.h"
+#include "replay.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Define PROF_ENABLED as 0 before including this to compile every zone out.
+#ifndef PROF_ENABLED
+#define PROF_ENABLED 1
+#endif
+
+// The most zones that may be added.
+#define PROF_MAX_ZONES 12
+
+// The number of histogram buckets. Bucket i counts runs taking from 2^i up to
+// 2^(i + 1) - 1 timer cycles, and the last bucket takes everything longer.
+#define PROF_BUCKETS 16
+
+// Returned by prof_addZone when there is no room for another zone. Zones
+// with this ID are ignored.
+#define PROF_NO_ZONE -1
+
+// Scheduler ticks between redraws of the overlay, when it is showing.
+#define PROF_OVERLAY_PERIOD 250
+
+// Width of the overlay in pixels.
+#define PROF_OVERLAY_WIDTH (31 * CHAR_WIDTH + 2 * PROF_BUCKETS + 2)
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Start and stop timing the given zone. A zone must not be nested inside
+// itself, but different zones may overlap freely, including from interrupt
+// handlers.
+#if PROF_ENABLED
+#define PROF_BEGIN(id) \
+    do { if ((id) >= 0) prof_zones[id].start = sched_now(); } while (0)
+#define PROF_END(id) \
+    do { if ((id) >= 0) \
+        prof_record(id, sched_now() - prof_zones[id].start); } while (0)
+#else
+#define PROF_BEGIN(id) do { } while (0)
+#define PROF_END(id) do { } while (0)
+#endif
+
+// Adds a measurement taken some other way to the given zone, such as an
+// interrupt latency from timer_latency.
+#if PROF_ENABLED
+#define PROF_VALUE(id, cycles) \
+    do { if ((id) >= 0) prof_record(id, cycles); } while (0)
+#else
+#define PROF_VALUE(id, cycles) do { } while (0)
+#endif
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Run time statistics for one zone, in Timer 0 cycles.
+typedef struct {
+    char* name;
+    unsigned long start;
+
+    unsigned long count;
+    unsigned long long total;
+    unsigned long min;
+    unsigned long max;
+    unsigned long histogram[PROF_BUCKETS];
+} prof_Zone;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// All added zones, in the order they were added. A zone's ID is its index.
+prof_Zone prof_zones[PROF_MAX_ZONES];
+int prof_zoneCount;
+
+// Whether the report overlay should currently be drawn. Toggled by the
+// hotkey.
+bool prof_showing;
+
+// Where the overlay is drawn.
+int prof_overlayX;
+int prof_overlayY;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void prof_init(int overlayX, int overlayY);
+int prof_addZone(char* name);
+void prof_resetZone(prof_Zone* zone);
+void prof_reset(void);
+void prof_record(int id, unsigned long cycles);
+int prof_bucket(unsigned long cycles);
+
+bool prof_pollHotkey(void);
+
+void prof_drawReport(int x, int y);
+void prof_sendReport(void);
+
+void prof_drawOverlay(void);
+void prof_clearOverlay(int colour);
+void prof_overlayTask(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Forgets about any existing zones, opens the serial port for reports, and
+// sets where the overlay is drawn. Add prof_overlayTask to the scheduler at a
+// low priority to have the overlay kept up to date while it is showing.
+void prof_init(int overlayX, int overlayY)
+{
+    prof_zoneCount = 0;
+    prof_showing = FALSE;
+    prof_overlayX = overlayX;
+    prof_overlayY = overlayY;
+
+    uart_init(UART_DEFAULT_BAUD);
+}
+
+// Adds a zone with the given name, to be shown in reports. Returns an ID to
+// pass to PROF_BEGIN and PROF_END, or PROF_NO_ZONE if the table is full.
+int prof_addZone(char* name)
+{
+    prof_Zone* zone;
+
+    if (prof_zoneCount >= PROF_MAX_ZONES) return PROF_NO_ZONE;
+
+    zone = &prof_zones[prof_zoneCount];
+    zone->name = name;
+    prof_resetZone(zone);
+
+    return prof_zoneCount++;
+}
+
+// Forgets everything recorded for the given zone.
+void prof_resetZone(prof_Zone* zone)
+{
+    zone->count = 0;
+    zone->total = 0;
+    zone->min = ~0UL;
+    zone->max = 0;
+    memset(zone->histogram, 0, sizeof(zone->histogram));
+}
+
+// Forgets everything recorded for every zone, keeping the zones themselves.
+void prof_reset(void)
+{
+    int i;
+
+    for (i = 0; i < prof_zoneCount; ++i) {
+        prof_resetZone(&prof_zones[i]);
+    }
+}
+
+// Adds one run of the given length to a zone's statistics. Used by PROF_END.
+void prof_record(int id, unsigned long cycles)
+{
+    prof_Zone* zone;
+
+    zone = &prof_zones[id];
+
+    ++zone->count;
+    zone->total += cycles;
+    if (cycles < zone->min) zone->min = cycles;
+    if (cycles > zone->max) zone->max = cycles;
+
+    ++zone->histogram[prof_bucket(cycles)];
+}
+
+// Finds which histogram bucket a run of the given length falls in, which is
+// the position of its highest set bit. The ARM7 has no CLZ instruction, so
+// this narrows it down by halves instead.
+int prof_bucket(unsigned long cycles)
+{
+    int bit;
+
+    bit = 0;
+    if (cycles >= 1UL << 16) { cycles >>= 16; bit += 16; }
+    if (cycles >= 1UL << 8) { cycles >>= 8; bit += 8; }
+    if (cycles >= 1UL << 4) { cycles >>= 4; bit += 4; }
+    if (cycles >= 1UL << 2) { cycles >>= 2; bit += 2; }
+    if (cycles >= 1UL << 1) { bit += 1; }
+
+    return min(bit, PROF_BUCKETS - 1);
+}
+
+// Checks the profiler hotkeys. When up and down have just been pressed
+// together, sends the event trace over the serial port. When left and right
+// have, sends a report (and any input script being recorded) over the serial
+// port and toggles prof_showing, then
+// returns TRUE so the caller can clear away the overlay and redraw what was
+// under it once it is hidden. Call this regularly from an input task.
+// input_getButtonPress never reports the buttons of either chord as presses
+// of their own.
+bool prof_pollHotkey(void)
+{
+    static bool wasReport = FALSE, wasTrace = FALSE;
+    bool report, trace;
+
+    report = input_isChordDown(INPUT_CHORD_LEFT_RIGHT);
+    trace = input_isChordDown(INPUT_CHORD_UP_DOWN);
+
+    if (trace && !wasTrace) trace_send();
+    wasTrace = trace;
+
+    // Report on a replayed session as soon as it ends, so runs can be
+    // compared.
+    if (replay_takeFinished()) {
+        uart_putString("\nREPLAY FINISHED\n");
+        prof_sendReport();
+    }
+
+    if (!report || wasReport) {
+        wasReport = report;
+        return FALSE;
+    }
+
+    wasReport = TRUE;
+    prof_showing = !prof_showing;
+    prof_sendReport();
+    replay_send();
+
+    return TRUE;
+}
+
+// Draws a table of each zone's run count, and minimum, average and maximum
+// run times in timer cycles, with a small histogram to the right of each
+// row. The top left corner is at the given position.
+void prof_drawReport(int x, int y)
+{
+    int i, b, h; prof_Zone* zone; char num[8];
+    unsigned long most; int barX;
+
+    lcd_putString(x, y, "ZONE    COUNT   MIN   AVG   MAX");
+
+    for (i = 0; i < prof_zoneCount; ++i) {
+        zone = &prof_zones[i];
+        y += CHAR_HEIGHT;
+
+        lcd_fillRect(x, y, x + 31 * CHAR_WIDTH + 2 * PROF_BUCKETS + 2,
+            y + CHAR_HEIGHT - 1, BLACK);
+        lcd_putString(x, y, zone->name);
+
+        formatNumber(num, zone->count, 6);
+        lcd_putString(x + 7 * CHAR_WIDTH, y, num);
+
+        if (zone->count == 0) continue;
+
+        formatNumber(num, zone->min, 6);
+        lcd_putString(x + 13 * CHAR_WIDTH, y, num);
+
+        formatNumber(num, (unsigned long) (zone->total / zone->count), 6);
+        lcd_putString(x + 19 * CHAR_WIDTH, y, num);
+
+        formatNumber(num, zone->max, 6);
+        lcd_putString(x + 25 * CHAR_WIDTH, y, num);
+
+        // Scale the bars so the fullest bucket fills the row.
+        most = 1;
+        for (b = 0; b < PROF_BUCKETS; ++b) {
+            most = max(most, zone->histogram[b]);
+        }
+
+        barX = x + 31 * CHAR_WIDTH + 2;
+        for (b = 0; b < PROF_BUCKETS; ++b) {
+            h = zone->histogram[b] * (CHAR_HEIGHT - 1) / most;
+            if (h > 0) {
+                lcd_fillRect(barX + 2 * b, y + CHAR_HEIGHT - 1 - h,
+                    barX + 2 * b, y + CHAR_HEIGHT - 2, GREEN);
+            }
+        }
+    }
+}
+
+// Sends the same table as prof_drawReport over the serial port, followed by
+// each zone's full histogram and the scheduler's worst wake up time.
+// uart_init must have been called.
+void prof_sendReport(void)
+{
+    int i, b; prof_Zone* zone;
+
+    uart_putString("\nZONE      COUNT       MIN       AVG       MAX\n");
+
+    for (i = 0; i < prof_zoneCount; ++i) {
+        zone = &prof_zones[i];
+
+        uart_putString(zone->name);
+        uart_putString("\t");
+        uart_putNumber(zone->count, 8);
+        uart_putNumber(zone->count == 0 ? 0 : zone->min, 10);
+        uart_putNumber(zone->count == 0 ? 0
+            : (unsigned long) (zone->total / zone->count), 10);
+        uart_putNumber(zone->max, 10);
+        uart_putString("\n");
+    }
+
+    uart_putString("\nHISTOGRAMS (BUCKET i COUNTS RUNS OF 2^i TO 2^(i+1)-1 CYCLES)\n");
+
+    for (i = 0; i < prof_zoneCount; ++i) {
+        zone = &prof_zones[i];
+
+        uart_putString(zone->name);
+        uart_putString("\t");
+        for (b = 0; b < PROF_BUCKETS; ++b) {
+            uart_putNumber(zone->histogram[b], 7);
+        }
+        uart_putString("\n");
+    }
+
+    uart_putString("\nWAKE FROM IDLE TAKES AT MOST");
+    uart_putNumber(sched_maxWakeCycles, 6);
+    uart_putString(" CYCLES\n");
+}
+
+// Draws the zone table with the scheduler's task table underneath it.
+void prof_drawOverlay(void)
+{
+    prof_drawReport(prof_overlayX, prof_overlayY);
+    sched_drawReport(prof_overlayX,
+        prof_overlayY + (prof_zoneCount + 2) * CHAR_HEIGHT);
+}
+
+// Fills the area covered by the overlay with the given colour.
+void prof_clearOverlay(int colour)
+{
+    lcd_fillRect(prof_overlayX, prof_overlayY,
+        prof_overlayX + PROF_OVERLAY_WIDTH,
+        prof_overlayY + (prof_zoneCount + sched_taskCount + 4) * CHAR_HEIGHT,
+        colour);
+}
+
+// Scheduler task that redraws the overlay while it is showing.
+void prof_overlayTask(void)
+{
+    if (prof_showing) prof_drawOverlay();
+}
+
+#endif
@@ -0,0 +1,70 @@
+/**
+ * File Name  : pt.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Stackless coroutines (protothreads) built out of a switch
+ *              statement, so long running jobs like drawing a graph can be
+ *              split into slices and resumed later from a scheduler task.
+ *
+ *              A coroutine is a function returning int that starts with
+ *              PT_BEGIN and finishes with PT_END. Local variables are lost
+ *              whenever it yields, so anything that needs to survive must
+ *              live in a structure passed in alongside the pt_Thread. A
+ *              coroutine can't contain a switch statement of its own around
+ *              a yield, and only one yield is allowed per source line.
+ */
+
+#ifndef PT_H_GUARD
+#define PT_H_GUARD
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Values returned by a coroutine each time it gives up control.
+#define PT_WAITING 0
+#define PT_YIELDED 1
+#define PT_ENDED 2
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Resets the coroutine so it starts from the beginning on its next call.
+#define PT_INIT(pt) ((pt)->lc = 0)
+
+// Marks the start of a coroutine's body, jumping to wherever it left off.
+#define PT_BEGIN(pt) switch ((pt)->lc) { case 0:
+
+// Marks the end of a coroutine's body. Once reached, the coroutine starts
+// from the beginning again if called.
+#define PT_END(pt) } (pt)->lc = 0; return PT_ENDED
+
+// Gives up control, carrying on from the next statement on the next call.
+#define PT_YIELD(pt) \
+    do { (pt)->lc = __LINE__; return PT_YIELDED; case __LINE__:; } while (0)
+
+// Gives up control until the given condition is true, which is checked each
+// time the coroutine is called.
+#define PT_WAIT_UNTIL(pt, cond) \
+    do { (pt)->lc = __LINE__; case __LINE__: \
+        if (!(cond)) return PT_WAITING; } while (0)
+
+// Gives up control once every n times it is reached, using the given counter
+// variable (which must survive between calls) to keep track.
+#define PT_YIELD_EVERY(pt, counter, n) \
+    do { if (++(counter) >= (n)) { (counter) = 0; PT_YIELD(pt); } } while (0)
+
+// Finishes the coroutine early.
+#define PT_EXIT(pt) do { (pt)->lc = 0; return PT_ENDED; } while (0)
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Where a coroutine got up to when it last gave up control.
+typedef struct {
+    int lc;
+} pt_Thread;
+
+#endif
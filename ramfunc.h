@@ -0,0 +1,72 @@
+/**
+ * File Name  : ramfunc.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : An attribute for placing hot functions in internal SRAM, where
+ *              they run without flash wait states, and the startup code to
+ *              copy them there. Needs ramfunc.ld at link time.
+ */
+
+#ifndef RAMFUNC_H_GUARD
+#define RAMFUNC_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Place after a function's declaration to have it run from internal SRAM.
+// SRAM is too far from flash for a plain BL, so calls to it are made long.
+// Anything marked RAMFUNC must not be called before ramfunc_init.
+#define RAMFUNC __attribute__((section(".ramfunc"), long_call, noinline))
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Provided by ramfunc.ld. Where the RAMFUNC code runs from, and where its
+// image is stored in flash.
+extern char __ramfunc_start[];
+extern char __ramfunc_end[];
+extern char __ramfunc_load[];
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void ramfunc_init(void);
+unsigned long ramfunc_size(void);
+void* ramfunc_relocate(void* func, void* base);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Copies every RAMFUNC function from its load image in flash to SRAM. Call
+// this first thing in main.
+void ramfunc_init(void)
+{
+    memcpy(__ramfunc_start, __ramfunc_load, ramfunc_size());
+}
+
+// Gives the size of all the RAMFUNC code together, in bytes.
+unsigned long ramfunc_size(void)
+{
+    return __ramfunc_end - __ramfunc_start;
+}
+
+// Finds where the given RAMFUNC function would be in a copy of the whole
+// RAMFUNC image starting at base. The flash load image is one such copy. Only
+// leaf functions can be called at their relocated address, since calls out
+// of the image are PC relative.
+void* ramfunc_relocate(void* func, void* base)
+{
+    return (char*) base + ((char*) func - __ramfunc_start);
+}
+
+#endif
@@ -0,0 +1,182 @@
+/**
+ * File Name  : reg.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Descriptions of the register fields we use, and helpers that
+ *              combine any number of field writes into a single read-modify-
+ *              write of the register. Unlike the bit macros in utils.h, every
+ *              argument is only evaluated once.
+ */
+
+#ifndef REG_H_GUARD
+#define REG_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Each field is described as a "first bit, bit count" pair, so it can be
+// passed straight to the macros below.
+
+// Pin function selection for the pins we use.
+#define PINSEL0_P0_2 4, 2
+#define PINSEL0_P0_3 6, 2
+#define PINSEL1_P0_23 14, 2
+#define PINSEL1_P0_24 16, 2
+#define PINSEL1_P0_25 18, 2
+#define PINSEL1_P0_26 20, 2
+
+// Pin function selection for A/D channel n, from AD0.0 on P0.23 to AD0.3 on
+// P0.26.
+#define PINSEL1_AD0(n) (14 + 2 * (n)), 2
+#define PINSEL2_P1_3 6, 2
+
+// Peripheral power control.
+#define PCONP_PCUART0 3, 1
+#define PCONP_PCAD 12, 1
+#define PCONP_PCTIM2 22, 1
+
+// Power mode control.
+#define PCON_IDL 0, 1
+#define PCON_PD 1, 1
+
+// Peripheral clock selection.
+#define PCLKSEL0_TIMER1 4, 2
+
+// A/D control register.
+#define AD0CR_SEL 0, 8
+#define AD0CR_CLKDIV 8, 8
+#define AD0CR_BURST 16, 1
+#define AD0CR_CLKS 17, 3
+#define AD0CR_PDN 21, 1
+#define AD0CR_START 24, 3
+#define AD0CR_EDGE 27, 1
+
+// A/D data registers, including the global one.
+#define AD0DR_RESULT 6, 10
+#define AD0DR_CHN 24, 3
+#define AD0DR_OVERRUN 30, 1
+#define AD0DR_DONE 31, 1
+
+// UART 0 line control, line status and fractional divider registers.
+#define U0LCR_WORD_LENGTH 0, 2
+#define U0LCR_DLAB 7, 1
+#define U0LSR_THRE 5, 1
+#define U0FDR_DIVADDVAL 0, 4
+#define U0FDR_MULVAL 4, 4
+
+// D/A converter register.
+#define DACR_VALUE 6, 10
+#define DACR_BIAS 16, 1
+
+// PWM match control, control and timer control registers.
+#define PWMMCR_MR0I 0, 1
+#define PWMMCR_MR0R 1, 1
+#define PWMPCR_ENA2 10, 1
+#define PWMTCR_ENABLE 0, 1
+#define PWMTCR_RESET 1, 1
+#define PWMTCR_PWM_ENABLE 3, 1
+
+// LCD cursor control, configuration, palette, position and clipping
+// registers.
+#define CRSR_CTRL_ON 0, 1
+#define CRSR_CTRL_NUM 4, 2
+#define CRSR_CFG_SIZE 0, 1
+#define CRSR_CFG_FRAME_SYNC 1, 1
+#define CRSR_PAL_RED 0, 8
+#define CRSR_PAL_GREEN 8, 8
+#define CRSR_PAL_BLUE 16, 8
+#define CRSR_XY_X 0, 10
+#define CRSR_XY_Y 16, 10
+#define CRSR_CLIP_X 0, 6
+#define CRSR_CLIP_Y 8, 6
+
+// Values for the A/D START field.
+#define AD0CR_START_NONE 0
+#define AD0CR_START_NOW 1
+
+// Values for the A/D CLKS field, which sets the clocks per burst conversion.
+#define AD0CR_CLKS_10BIT 0
+
+// Peripheral clock dividers.
+#define PCLKSEL_CCLK_4 0
+#define PCLKSEL_CCLK 1
+#define PCLKSEL_CCLK_2 2
+#define PCLKSEL_CCLK_8 3
+
+// Pin function values.
+#define PINSEL_GPIO 0
+#define PINSEL_TXD0 1
+#define PINSEL_RXD0 1
+#define PINSEL_AD0_1 1
+#define PINSEL_AD0 1
+#define PINSEL_AOUT 2
+#define PINSEL_PWM0_2 3
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// These take a field description as their first argument, which expands to
+// two arguments for the underlying macro.
+
+// Produces a mask covering every bit of the given field.
+#define fieldMask(f) _fieldMask(f)
+#define _fieldMask(i, c) ((unsigned long) bitMask(c) << (i))
+
+// Produces the given value shifted into place within the given field. Only
+// the bits of the value that fit in the field are kept.
+#define fieldVal(f, v) _fieldVal(f, v)
+#define _fieldVal(i, c, v) (((unsigned long) (v) & bitMask(c)) << (i))
+
+// Extracts the given field from a value read from a register.
+#define fieldGet(x, f) _fieldGet(x, f)
+#define _fieldGet(x, i, c) (((unsigned long) (x) >> (i)) & bitMask(c))
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+static inline void reg_modify(volatile unsigned long* reg,
+    unsigned long mask, unsigned long val);
+static inline void reg_set(volatile unsigned long* reg, unsigned long mask);
+static inline void reg_clear(volatile unsigned long* reg, unsigned long mask);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Replaces the bits of the register selected by mask with those of val, with
+// exactly one read and one write of the register. Several fields can be
+// written at once by OR-ing together their masks and values, for example:
+//
+//   reg_modify(&AD0CR, fieldMask(AD0CR_SEL) | fieldMask(AD0CR_START),
+//       fieldVal(AD0CR_SEL, 1 << 1) | fieldVal(AD0CR_START, 1));
+//
+// With constant masks and values this compiles to a load, a BIC, an ORR and a
+// store.
+static inline void reg_modify(volatile unsigned long* reg,
+    unsigned long mask, unsigned long val)
+{
+    *reg = (*reg & ~mask) | (val & mask);
+}
+
+// Sets every bit of the register selected by mask.
+static inline void reg_set(volatile unsigned long* reg, unsigned long mask)
+{
+    *reg = *reg | mask;
+}
+
+// Clears every bit of the register selected by mask.
+static inline void reg_clear(volatile unsigned long* reg, unsigned long mask)
+{
+    *reg = *reg & ~mask;
+}
+
+#endif
@@ -0,0 +1,228 @@
+/**
+ * File Name  : replay.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Records the buttons pressed during a session as a script of
+ *              timestamped changes, and plays a script back later in place
+ *              of the real buttons, so performance runs can be repeated
+ *              exactly. Sits underneath input.h, which passes every read of
+ *              the buttons through replay_filter.
+ *
+ *              Build with INPUT_RECORD defined to record. The script is sent
+ *              over the serial port as C source along with the profiler
+ *              report. Save it as replay_script.h and build with
+ *              INPUT_REPLAY defined instead to play it back. The random seed
+ *              is part of the script, so anything seeded from replay_init
+ *              behaves the same each time.
+ */
+
+#ifndef REPLAY_H_GUARD
+#define REPLAY_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "sched.h"
+#include "uart.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The most button changes that can be recorded.
+#define REPLAY_MAX_STEPS 512
+
+// What the replay layer is doing.
+#define REPLAY_LIVE 0
+#define REPLAY_RECORDING 1
+#define REPLAY_PLAYING 2
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A change in the buttons held down, as a mask of FIO0PIN bits, at the given
+// scheduler tick.
+typedef struct {
+    int tick;
+    unsigned long buttons;
+} replay_Step;
+
+// Pull in the script to play back, which defines replayScript and
+// REPLAY_SEED.
+#ifdef INPUT_REPLAY
+#include "replay_script.h"
+#endif
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// One of the REPLAY_* constants.
+int replay_mode;
+
+// The script being recorded or played, and how far through it we are.
+replay_Step replay_steps[REPLAY_MAX_STEPS];
+const replay_Step* replay_script;
+int replay_length;
+int replay_next;
+
+// The buttons held down as of the last step.
+unsigned long replay_buttons;
+
+// The random seed of the session.
+unsigned int replay_seedValue;
+
+// Set once playback reaches the end of the script.
+bool replay_finished;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+unsigned int replay_init(unsigned int seed);
+void replay_record(unsigned int seed);
+void replay_play(const replay_Step* script, int length, unsigned int seed);
+
+unsigned long replay_filter(unsigned long live);
+bool replay_takeFinished(void);
+void replay_send(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Starts recording or playing back depending on how we were built, and
+// returns the random seed to use. When playing back that is the recorded
+// seed; otherwise it is the given one. Call before sched_init, since step
+// times count from when the scheduler starts.
+unsigned int replay_init(unsigned int seed)
+{
+#if defined(INPUT_REPLAY)
+    replay_play(replayScript, sizeof(replayScript) / sizeof(replayScript[0]),
+        REPLAY_SEED);
+#elif defined(INPUT_RECORD)
+    replay_record(seed);
+#else
+    replay_mode = REPLAY_LIVE;
+    replay_seedValue = seed;
+#endif
+
+    return replay_seedValue;
+}
+
+// Starts recording every change in the buttons, for a session using the
+// given random seed.
+void replay_record(unsigned int seed)
+{
+    replay_mode = REPLAY_RECORDING;
+    replay_script = replay_steps;
+    replay_length = 0;
+    replay_buttons = 0;
+    replay_seedValue = seed;
+    replay_finished = FALSE;
+}
+
+// Starts playing back the given script in place of the real buttons.
+void replay_play(const replay_Step* script, int length, unsigned int seed)
+{
+    replay_mode = REPLAY_PLAYING;
+    replay_script = script;
+    replay_length = length;
+    replay_next = 0;
+    replay_buttons = 0;
+    replay_seedValue = seed;
+    replay_finished = FALSE;
+}
+
+// Given the buttons actually held down, gives the ones the program should
+// see. While recording that's the real ones, with any change noted down.
+// While playing back it's whatever the script says, ignoring the real ones.
+unsigned long replay_filter(unsigned long live)
+{
+    int now;
+
+    now = sched_ticks;
+
+    switch (replay_mode) {
+        case REPLAY_RECORDING:
+            if (live != replay_buttons) {
+                replay_buttons = live;
+
+                replay_steps[replay_length].tick = now;
+                replay_steps[replay_length].buttons = live;
+
+                // Stop when full, keeping what we have.
+                if (++replay_length >= REPLAY_MAX_STEPS) {
+                    replay_mode = REPLAY_LIVE;
+                }
+            }
+            return live;
+
+        case REPLAY_PLAYING:
+            while (replay_next < replay_length
+                && now - replay_script[replay_next].tick >= 0) {
+                replay_buttons = replay_script[replay_next++].buttons;
+            }
+
+            // Hand back to the real buttons once the script has run out. A
+            // recorded script ends with nothing held.
+            if (replay_next >= replay_length) {
+                replay_mode = REPLAY_LIVE;
+                replay_finished = TRUE;
+            }
+            return replay_buttons;
+
+        default:
+            return live;
+    }
+}
+
+// Returns TRUE once after playback has finished, so the caller can report
+// on the run.
+bool replay_takeFinished(void)
+{
+    if (!replay_finished) return FALSE;
+
+    replay_finished = FALSE;
+    return TRUE;
+}
+
+// Sends the recorded script over the serial port as C source, ready to be
+// saved as replay_script.h. uart_init must have been called.
+void replay_send(void)
+{
+    int i; char num[12];
+
+    if (replay_script != replay_steps) return;
+
+    uart_putString("\n// Recorded by replay.h. Save as replay_script.h.\n");
+    uart_putString("#define REPLAY_SEED 0x");
+    for (i = 28; i >= 0; i -= 4) {
+        uart_putChar("0123456789abcdef"[(replay_seedValue >> i) & 0xf]);
+    }
+    uart_putString("\nconst replay_Step replayScript[] = {\n");
+
+    // Start from nothing held, so an empty recording is still valid C.
+    uart_putString("    {          0,          0 },\n");
+
+    for (i = 0; i < replay_length; ++i) {
+        formatNumber(num, replay_steps[i].tick, 10);
+        uart_putString("    { ");
+        uart_putString(num);
+        uart_putString(", ");
+        formatNumber(num, replay_steps[i].buttons, 10);
+        uart_putString(num);
+        uart_putString(" },\n");
+    }
+
+    // Mark when the session ended, so playback runs for as long.
+    formatNumber(num, sched_ticks, 10);
+    uart_putString("    { ");
+    uart_putString(num);
+    uart_putString(",          0 }\n};\n");
+}
+
+#endif
@@ -0,0 +1,417 @@
+/**
+ * File Name  : resample.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Polyphase FIR filters for changing the sample rate of audio by
+ *              a whole factor, as 10 bit A/D and D/A converter samples. A
+ *              decimator takes samples at the sample clock rate and gives one
+ *              in every factor, low pass filtered first so nothing above the
+ *              new Nyquist frequency folds down into the recording. An
+ *              interpolator does the reverse for playback, filling in
+ *              factor - 1 samples between each pair. resample_Frames
+ *              decimates several channels sampled together in one pass.
+ *
+ *              Both are split into factor phases of RESAMPLE_TAPS taps, so
+ *              every sample at the higher rate costs the same: one run of
+ *              RESAMPLE_TAPS multiply-accumulates, whatever the factor. That
+ *              keeps them cheap and steady enough for a sample clock
+ *              interrupt. Each factor has its own Kaiser windowed sinc
+ *              filter in flash, cutting off at the lower rate's Nyquist
+ *              frequency. They are flat to within 0.1 dB up to 85% of it, and
+ *              anything that would alias below 80% of it is at least 65 dB
+ *              down, beyond what the 10-bit converters can show.
+ */
+
+#ifndef RESAMPLE_H_GUARD
+#define RESAMPLE_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "ramfunc.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of taps in each phase of a filter. Each filter has this many
+// times its factor altogether.
+#define RESAMPLE_TAPS 24
+
+// The largest factor there is a filter for. Factors of 1, 2, 4 and 6 are
+// supported.
+#define RESAMPLE_MAX_FACTOR 6
+
+// The most channels resample_Frames decimates together.
+#define RESAMPLE_MAX_CHANNELS 4
+
+// Number of fractional bits in the filter coefficients.
+#define RESAMPLE_COEFF_SHIFT 15
+
+// The range of sample values, and the one a filter's history starts full of
+// so it starts out silent rather than with a click.
+#define RESAMPLE_SAMPLE_MAX 0x3ff
+#define RESAMPLE_MIDDLE 0x200
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A decimator or interpolator. Each phase's taps are stored in the order
+// they are applied, so the inner loop runs straight through memory, and the
+// history is stored twice over, so the latest RESAMPLE_TAPS samples are
+// always in one run however the ring buffer has wrapped.
+typedef struct {
+    int factor, phase, head;
+    int acc;
+    short bank[RESAMPLE_MAX_FACTOR * RESAMPLE_TAPS];
+    short history[RESAMPLE_MAX_FACTOR][2 * RESAMPLE_TAPS];
+} resample_Filter;
+
+// A decimator for several channels sampled together, such as a frame of A/D
+// converter inputs. They share their taps, phase and head, so each frame
+// moves every channel along at once, and each tap is loaded once for a pair
+// of channels. Only the multiply-accumulates are done per channel.
+typedef struct {
+    int factor, phase, head, channels;
+    int acc[RESAMPLE_MAX_CHANNELS];
+    short bank[RESAMPLE_MAX_FACTOR * RESAMPLE_TAPS];
+    short history[RESAMPLE_MAX_FACTOR][RESAMPLE_MAX_CHANNELS]
+        [2 * RESAMPLE_TAPS];
+} resample_Frames;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Low pass filters for each factor, in Q1.15, each adding up to exactly 1.
+const short resample_filter2[2 * RESAMPLE_TAPS] = {
+        -3,     -6,     12,     19,    -29,    -43,     60,     82,
+      -110,   -145,    187,    238,   -300,   -375,    467,    580,
+      -720,   -899,   1136,   1468,  -1972,  -2852,   4858,  14731,
+     14731,   4858,  -2852,  -1972,   1468,   1136,   -899,   -720,
+       580,    467,   -375,   -300,    238,    187,   -145,   -110,
+        82,     60,    -43,    -29,     19,     12,     -6,     -3
+};
+
+const short resample_filter4[4 * RESAMPLE_TAPS] = {
+        -1,     -3,     -4,     -2,      3,     10,     12,      6,
+        -8,    -23,    -27,    -13,     16,     45,     52,     25,
+       -29,    -80,    -91,    -43,     49,    133,    150,     70,
+       -78,   -211,   -235,   -109,    121,    326,    362,    167,
+      -186,   -500,   -558,   -259,    291,    792,    899,    426,
+      -494,  -1402,  -1683,   -864,   1122,   3823,   6406,   7981,
+      7981,   6406,   3823,   1122,   -864,  -1683,  -1402,   -494,
+       426,    899,    792,    291,   -259,   -558,   -500,   -186,
+       167,    362,    326,    121,   -109,   -235,   -211,    -78,
+        70,    150,    133,     49,    -43,    -91,    -80,    -29,
+        25,     52,     45,     16,    -13,    -27,    -23,     -8,
+         6,     12,     10,      3,     -2,     -4,     -3,     -1
+};
+
+const short resample_filter6[6 * RESAMPLE_TAPS] = {
+         0,     -1,     -2,     -3,     -3,     -1,      1,      4,
+         7,      8,      7,      3,     -3,    -11,    -17,    -19,
+       -15,     -6,      7,     21,     32,     36,     29,     12,
+       -13,    -38,    -57,    -63,    -50,    -20,     22,     64,
+        95,    103,     81,     32,    -35,   -102,   -150,   -162,
+      -127,    -50,     54,    158,    232,    249,    196,     77,
+       -83,   -242,   -356,   -383,   -302,   -119,    129,    381,
+       564,    614,    491,    197,   -217,   -658,  -1006,  -1136,
+      -952,   -405,    482,   1620,   2858,   4016,   4911,   5398,
+      5398,   4911,   4016,   2858,   1620,    482,   -405,   -952,
+     -1136,  -1006,   -658,   -217,    197,    491,    614,    564,
+       381,    129,   -119,   -302,   -383,   -356,   -242,    -83,
+        77,    196,    249,    232,    158,     54,    -50,   -127,
+      -162,   -150,   -102,    -35,     32,     81,    103,     95,
+        64,     22,    -20,    -50,    -63,    -57,    -38,    -13,
+        12,     29,     36,     32,     21,      7,     -6,    -15,
+       -19,    -17,    -11,     -3,      3,      7,      8,      7,
+         4,      1,     -1,     -3,     -3,     -2,     -1,      0
+};
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+const short* resample_prototype(int factor);
+void resample_decimatorBank(short* bank, int factor);
+void resample_initDecimator(resample_Filter* filter, int factor);
+void resample_initInterpolator(resample_Filter* filter, int factor);
+void resample_reset(resample_Filter* filter);
+void resample_initFrames(resample_Frames* frames, int factor, int channels);
+
+static inline bool resample_decimate(resample_Filter* filter, short sample,
+    short* out);
+static inline bool resample_wantsInput(const resample_Filter* filter);
+static inline void resample_push(resample_Filter* filter, short sample);
+static inline short resample_interpolate(resample_Filter* filter);
+static inline bool resample_decimateFrame(resample_Frames* frames,
+    const short* frame, short* const* outs, unsigned long at);
+static inline short resample_clamp(int val);
+int resample_dot(const short* coeffs, const short* samples) RAMFUNC;
+void resample_dotFrame(const short* coeffs, const short* samples,
+    int channels, int* accs) RAMFUNC;
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Gives the filter for the given factor, or NULL for a factor of 1, which
+// needs none.
+const short* resample_prototype(int factor)
+{
+    switch (factor) {
+        case 2: return resample_filter2;
+        case 4: return resample_filter4;
+        case 6: return resample_filter6;
+        default: return NULL;
+    }
+}
+
+// Splits the filter for the given factor into the phases a decimator
+// applies, in bank. Leaves bank alone for a factor of 1.
+void resample_decimatorBank(short* bank, int factor)
+{
+    int p, j; const short* h;
+
+    h = resample_prototype(factor);
+    if (h == NULL) return;
+
+    // Taking one output every factor inputs, the input at phase p within
+    // each group meets every factor-th tap, starting from the far end of
+    // the first group.
+    for (p = 0; p < factor; ++p) {
+        for (j = 0; j < RESAMPLE_TAPS; ++j) {
+            bank[p * RESAMPLE_TAPS + j] = h[j * factor + factor - 1 - p];
+        }
+    }
+}
+
+// Sets up a filter to take samples at factor times the rate it gives them
+// out.
+void resample_initDecimator(resample_Filter* filter, int factor)
+{
+    filter->factor = factor;
+    resample_decimatorBank(filter->bank, factor);
+
+    resample_reset(filter);
+}
+
+// Sets up a filter to give out samples at factor times the rate they are
+// pushed in.
+void resample_initInterpolator(resample_Filter* filter, int factor)
+{
+    int p, j; const short* h;
+
+    filter->factor = factor;
+    h = resample_prototype(factor);
+
+    // The output at phase p between two inputs meets every factor-th tap,
+    // starting from tap p, as the zeros that would be stuffed in between the
+    // inputs contribute nothing.
+    if (h != NULL) {
+        for (p = 0; p < factor; ++p) {
+            for (j = 0; j < RESAMPLE_TAPS; ++j) {
+                filter->bank[p * RESAMPLE_TAPS + j] = h[j * factor + p];
+            }
+        }
+    }
+
+    resample_reset(filter);
+}
+
+// Forgets every sample the filter has seen, as if it had only ever been fed
+// silence.
+void resample_reset(resample_Filter* filter)
+{
+    int p, i;
+
+    for (p = 0; p < RESAMPLE_MAX_FACTOR; ++p) {
+        for (i = 0; i < 2 * RESAMPLE_TAPS; ++i) {
+            filter->history[p][i] = RESAMPLE_MIDDLE;
+        }
+    }
+
+    filter->phase = 0;
+    filter->head = 0;
+    filter->acc = 0;
+}
+
+// Sets up a decimator for the given number of channels, up to
+// RESAMPLE_MAX_CHANNELS, each taking samples at factor times the rate it
+// gives them out, and starting out silent.
+void resample_initFrames(resample_Frames* frames, int factor, int channels)
+{
+    int p, c, i;
+
+    frames->factor = factor;
+    frames->channels = channels;
+    resample_decimatorBank(frames->bank, factor);
+
+    for (p = 0; p < RESAMPLE_MAX_FACTOR; ++p) {
+        for (c = 0; c < RESAMPLE_MAX_CHANNELS; ++c) {
+            for (i = 0; i < 2 * RESAMPLE_TAPS; ++i) {
+                frames->history[p][c][i] = RESAMPLE_MIDDLE;
+            }
+        }
+    }
+
+    for (c = 0; c < RESAMPLE_MAX_CHANNELS; ++c) frames->acc[c] = 0;
+    frames->phase = 0;
+    frames->head = 0;
+}
+
+// Feeds a decimator the next sample. Once every factor samples, writes a
+// sample at the lower rate to out and returns TRUE.
+static inline bool resample_decimate(resample_Filter* filter, short sample,
+    short* out)
+{
+    short* history;
+
+    if (filter->factor == 1) {
+        *out = sample;
+        return TRUE;
+    }
+
+    // Each group of inputs moves every phase's history along by one.
+    if (filter->phase == 0) {
+        filter->head = filter->head > 0 ? filter->head - 1 : RESAMPLE_TAPS - 1;
+    }
+
+    history = filter->history[filter->phase];
+    history[filter->head] = history[filter->head + RESAMPLE_TAPS] = sample;
+
+    filter->acc += resample_dot(&filter->bank[filter->phase * RESAMPLE_TAPS],
+        &history[filter->head]);
+
+    if (++filter->phase < filter->factor) return FALSE;
+
+    *out = resample_clamp(filter->acc);
+    filter->acc = 0;
+    filter->phase = 0;
+
+    return TRUE;
+}
+
+// Whether an interpolator needs resample_push to be given the next sample at
+// the lower rate before resample_interpolate is next called.
+static inline bool resample_wantsInput(const resample_Filter* filter)
+{
+    return filter->phase == 0;
+}
+
+// Gives an interpolator the next sample at the lower rate.
+static inline void resample_push(resample_Filter* filter, short sample)
+{
+    filter->head = filter->head > 0 ? filter->head - 1 : RESAMPLE_TAPS - 1;
+    filter->history[0][filter->head] =
+        filter->history[0][filter->head + RESAMPLE_TAPS] = sample;
+}
+
+// Gives the next sample at the higher rate from an interpolator.
+static inline short resample_interpolate(resample_Filter* filter)
+{
+    int val;
+
+    if (filter->factor == 1) return filter->history[0][filter->head];
+
+    // Each phase's taps add up to 1 / factor, so make up the difference.
+    val = resample_dot(&filter->bank[filter->phase * RESAMPLE_TAPS],
+        &filter->history[0][filter->head]) * filter->factor;
+
+    if (++filter->phase >= filter->factor) filter->phase = 0;
+
+    return resample_clamp(val);
+}
+
+// Feeds a decimator the next frame, one sample for each channel. Once every
+// factor frames, writes a sample at the lower rate for each channel to
+// outs[c][at] and returns TRUE. Gives exactly what a resample_Filter
+// decimating each channel alone would.
+static inline bool resample_decimateFrame(resample_Frames* frames,
+    const short* frame, short* const* outs, unsigned long at)
+{
+    short* history; int c;
+
+    if (frames->factor == 1) {
+        for (c = 0; c < frames->channels; ++c) outs[c][at] = frame[c];
+        return TRUE;
+    }
+
+    if (frames->phase == 0) {
+        frames->head = frames->head > 0 ? frames->head - 1 : RESAMPLE_TAPS - 1;
+    }
+
+    history = &frames->history[frames->phase][0][frames->head];
+    for (c = 0; c < frames->channels; ++c) {
+        history[c * 2 * RESAMPLE_TAPS] =
+            history[c * 2 * RESAMPLE_TAPS + RESAMPLE_TAPS] = frame[c];
+    }
+
+    resample_dotFrame(&frames->bank[frames->phase * RESAMPLE_TAPS], history,
+        frames->channels, frames->acc);
+
+    if (++frames->phase < frames->factor) return FALSE;
+
+    for (c = 0; c < frames->channels; ++c) {
+        outs[c][at] = resample_clamp(frames->acc[c]);
+        frames->acc[c] = 0;
+    }
+    frames->phase = 0;
+
+    return TRUE;
+}
+
+// Rounds a filter's output back to a sample, keeping any overshoot from a
+// sudden step within range.
+static inline short resample_clamp(int val)
+{
+    val = (val + (1 << (RESAMPLE_COEFF_SHIFT - 1))) >> RESAMPLE_COEFF_SHIFT;
+    return (short) min(max(val, 0), RESAMPLE_SAMPLE_MAX);
+}
+
+// Applies RESAMPLE_TAPS taps to as many samples, newest first.
+int resample_dot(const short* coeffs, const short* samples)
+{
+    int i, sum;
+
+    sum = 0;
+    for (i = 0; i < RESAMPLE_TAPS; ++i) sum += coeffs[i] * samples[i];
+
+    return sum;
+}
+
+// Applies RESAMPLE_TAPS taps to as many samples of each of the given number
+// of channels, newest first, adding each channel's result to its entry in
+// accs. Each channel's samples follow the last's, 2 * RESAMPLE_TAPS on.
+// Channels are taken in pairs, so each tap is loaded once for both.
+void resample_dotFrame(const short* coeffs, const short* samples,
+    int channels, int* accs)
+{
+    const short *a, *b; int i, c, coeff, sumA, sumB;
+
+    for (c = 0; c + 1 < channels; c += 2) {
+        a = &samples[c * 2 * RESAMPLE_TAPS];
+        b = a + 2 * RESAMPLE_TAPS;
+
+        sumA = sumB = 0;
+        for (i = 0; i < RESAMPLE_TAPS; ++i) {
+            coeff = coeffs[i];
+            sumA += coeff * a[i];
+            sumB += coeff * b[i];
+        }
+
+        accs[c] += sumA;
+        accs[c + 1] += sumB;
+    }
+
+    // An odd one out on its own.
+    if (c < channels) {
+        accs[c] += resample_dot(coeffs, &samples[c * 2 * RESAMPLE_TAPS]);
+    }
+}
+
+#endif
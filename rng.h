@@ -0,0 +1,144 @@
+/**
+ * File Name  : rng.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : A small xorshift pseudo random number generator with a
+ *              seedable state, integer and fixed point outputs, and functions
+ *              to produce many values in one go.
+ */
+
+#ifndef RNG_H_GUARD
+#define RNG_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "fixed.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of values produced each time a pool is refilled.
+#define RNG_POOL_SIZE 64
+
+// Used in place of a zero seed, which xorshift can never leave.
+#define RNG_DEFAULT_SEED 0x2545f491
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// State of an xorshift32 generator. Has a period of 2^32 - 1.
+typedef struct {
+    unsigned int s;
+} rng_State;
+
+// A generator along with a buffer of values made ahead of time, so values can
+// be handed out one by one while being generated in bulk.
+typedef struct {
+    rng_State state;
+    unsigned int values[RNG_POOL_SIZE];
+    int next;
+} rng_Pool;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void rng_seed(rng_State* rng, unsigned int seed);
+unsigned int rng_next(rng_State* rng);
+fixed rng_nextQ16(rng_State* rng);
+
+void rng_fill(rng_State* rng, unsigned int* dest, int count);
+void rng_fillQ16(rng_State* rng, fixed* dest, int count);
+
+void rng_poolSeed(rng_Pool* pool, unsigned int seed);
+unsigned int rng_poolNext(rng_Pool* pool);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Prepares the given generator to produce the sequence for the given seed.
+void rng_seed(rng_State* rng, unsigned int seed)
+{
+    rng->s = seed != 0 ? seed : RNG_DEFAULT_SEED;
+}
+
+// Produces the next 32 bit value from the given generator.
+unsigned int rng_next(rng_State* rng)
+{
+    unsigned int s;
+
+    s = rng->s;
+    s ^= s << 13;
+    s ^= s >> 17;
+    s ^= s << 5;
+    rng->s = s;
+
+    return s;
+}
+
+// Produces a fixed point value from 0.0 (inclusive) to 1.0 (exclusive). Uses
+// the top bits of the next value, which are the best mixed.
+fixed rng_nextQ16(rng_State* rng)
+{
+    return (fixed) (rng_next(rng) >> (32 - FIXED_SHIFT));
+}
+
+// Writes the next count values from the given generator into dest. Keeps the
+// state in a register for the whole run rather than going through memory for
+// each value.
+void rng_fill(rng_State* rng, unsigned int* dest, int count)
+{
+    unsigned int s; int i;
+
+    s = rng->s;
+    for (i = 0; i < count; ++i) {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        dest[i] = s;
+    }
+    rng->s = s;
+}
+
+// Like rng_fill, but writes fixed point values from 0.0 to 1.0 as given by
+// rng_nextQ16.
+void rng_fillQ16(rng_State* rng, fixed* dest, int count)
+{
+    unsigned int s; int i;
+
+    s = rng->s;
+    for (i = 0; i < count; ++i) {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        dest[i] = (fixed) (s >> (32 - FIXED_SHIFT));
+    }
+    rng->s = s;
+}
+
+// Seeds the generator behind the given pool and discards anything left in it.
+void rng_poolSeed(rng_Pool* pool, unsigned int seed)
+{
+    rng_seed(&pool->state, seed);
+    pool->next = RNG_POOL_SIZE;
+}
+
+// Hands out the next value from the given pool, refilling it in one pass
+// whenever it runs dry.
+unsigned int rng_poolNext(rng_Pool* pool)
+{
+    if (pool->next >= RNG_POOL_SIZE) {
+        rng_fill(&pool->state, pool->values, RNG_POOL_SIZE);
+        pool->next = 0;
+    }
+
+    return pool->values[pool->next++];
+}
+
+#endif
@@ -0,0 +1,409 @@
+/**
+ * File Name  : sched.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : A small run-to-completion task scheduler. Tasks are run in
+ *              priority order whenever they are due, either periodically from
+ *              a timer tick or when signalled by an interrupt handler, and
+ *              the time spent in each one is recorded. Uses Timer 0, which is
+ *              left free-running so it can double as a cycle counter.
+ *
+ *              When nothing is ready the core is put to sleep (see idle.h),
+ *              and the tick interrupt is moved out to when the next periodic
+ *              task is due, so an idle system isn't woken every tick. Any
+ *              other interrupt (such as one signalling a task) wakes it
+ *              early.
+ */
+
+#ifndef SCHED_H_GUARD
+#define SCHED_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "vic.h"
+#include "timer.h"
+#include "lcd.h"
+#include "trace.h"
+#include "idle.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The most tasks that may be added.
+#define SCHED_MAX_TASKS 8
+
+// The number of scheduler ticks per second, and timer cycles per tick.
+#define SCHED_TICK_HZ 1000
+#define SCHED_TICK_CYCLES (PCLK_HZ / SCHED_TICK_HZ)
+
+// Priorities follow the VIC convention of 0 being the most urgent.
+#define SCHED_PRIORITY_HIGHEST 0
+#define SCHED_PRIORITY_LOWEST 15
+
+// Returned by sched_addTask when there is no room for another task.
+#define SCHED_NO_TASK -1
+
+// Period to give tasks that should only run when signalled.
+#define SCHED_NOT_PERIODIC 0
+
+// The most ticks to sleep for in one go. Timer 0 wraps after about four
+// minutes, and a match more than a wrap away would never be reached.
+#define SCHED_MAX_SLEEP 1000
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A function run as a task. Must return promptly, since nothing else runs
+// until it does (apart from interrupt handlers).
+typedef void (*sched_TaskFunc)(void);
+
+// Everything the scheduler knows about a task, including its run time
+// accounting. Times are measured in Timer 0 cycles.
+typedef struct {
+    char* name;
+    sched_TaskFunc func;
+    int priority;
+    int period;
+    int nextRun;
+    volatile bool signalled;
+
+    unsigned long runs;
+    unsigned long totalCycles;
+    unsigned long maxCycles;
+} sched_Task;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// All added tasks, in the order they were added. A task's ID is its index.
+sched_Task sched_tasks[SCHED_MAX_TASKS];
+int sched_taskCount;
+
+// Number of ticks since sched_init was called, and the time of the latest
+// one counted. While asleep ticks go uncounted until something wakes us, so
+// only update these with the tick interrupt held off.
+volatile int sched_ticks;
+unsigned long sched_tickTime;
+
+// Time spent with no task to run, most of it asleep.
+unsigned long sched_idleCycles;
+
+// Set while asleep waiting for the tick, so the tick handler can measure how
+// long it took to wake, and the longest that has taken in timer cycles.
+volatile bool sched_sleeping;
+unsigned long sched_maxWakeCycles;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void sched_init(void);
+int sched_addTask(char* name, sched_TaskFunc func, int priority, int period);
+void sched_signal(int task);
+void sched_setPeriod(int task, int period);
+
+unsigned long sched_now(void);
+sched_Task* sched_findDue(int ticks);
+bool sched_runOnce(void);
+void sched_idle(void);
+void sched_run(void);
+
+int sched_catchUp(void);
+void sched_setMatch(int ticks);
+int sched_ticksToNext(void);
+
+void sched_drawReport(int x, int y);
+
+void sched_tick(void);
+void sched_tickIsr(void) __attribute__((naked));
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Starts the tick interrupt and forgets about any existing tasks. Also
+// empties the trace, since the trace's timestamps come from this timer.
+void sched_init(void)
+{
+    sched_taskCount = 0;
+    sched_ticks = 0;
+    sched_tickTime = 0;
+    sched_idleCycles = 0;
+    sched_sleeping = FALSE;
+    sched_maxWakeCycles = 0;
+
+    trace_init();
+    trace_name(TRACE_ISR_ENTER, VIC_CHANNEL_TIMER0, "tick");
+
+    TIMER0->TCR = 1 << TIMER_TCR_RESET;
+    TIMER0->PR = 0;
+
+    // Interrupt on MR0 but don't reset, so TC keeps counting and can be used
+    // to time things. The handler moves MR0 on to the next tick each time.
+    TIMER0->MR[0] = SCHED_TICK_CYCLES;
+    TIMER0->MCR = 1 << TIMER_MCR_MR0I;
+
+    vic_install(VIC_CHANNEL_TIMER0, VIC_PRIORITY_TICK, sched_tickIsr);
+    vic_enableInterrupts();
+
+    TIMER0->TCR = 1 << TIMER_TCR_ENABLE;
+}
+
+// Adds a task that runs every period ticks (or only when signalled if period
+// is SCHED_NOT_PERIODIC), with the given priority. Returns an ID to pass to
+// sched_signal, or SCHED_NO_TASK if the task table is full.
+int sched_addTask(char* name, sched_TaskFunc func, int priority, int period)
+{
+    sched_Task* task;
+
+    if (sched_taskCount >= SCHED_MAX_TASKS) return SCHED_NO_TASK;
+
+    task = &sched_tasks[sched_taskCount];
+    task->name = name;
+    task->func = func;
+    task->priority = priority;
+    task->period = period;
+    task->nextRun = sched_ticks + period;
+    task->signalled = FALSE;
+    task->runs = 0;
+    task->totalCycles = 0;
+    task->maxCycles = 0;
+
+    trace_name(TRACE_TASK_BEGIN, sched_taskCount, name);
+
+    return sched_taskCount++;
+}
+
+// Marks the given task as ready to run. Safe to call from an interrupt
+// handler, since it is a single store.
+void sched_signal(int task)
+{
+    sched_tasks[task].signalled = TRUE;
+}
+
+// Changes the given task to run every period ticks from now, or only when
+// signalled if period is SCHED_NOT_PERIODIC. Call from a task, such as the
+// one being changed.
+void sched_setPeriod(int task, int period)
+{
+    sched_tasks[task].period = period;
+    sched_tasks[task].nextRun = sched_ticks + period;
+}
+
+// Gives the current value of the free-running timer, in PCLK cycles.
+unsigned long sched_now(void)
+{
+    return TIMER0->TC;
+}
+
+// Finds the most urgent task that has either been signalled or reached its
+// next periodic run as of the given tick, or NULL if none has. Tasks of
+// equal priority are picked in the order they were added.
+sched_Task* sched_findDue(int ticks)
+{
+    int i; bool due; sched_Task* task; sched_Task* best;
+
+    best = NULL;
+    for (i = 0; i < sched_taskCount; ++i) {
+        task = &sched_tasks[i];
+
+        due = task->signalled || (task->period != SCHED_NOT_PERIODIC
+            && ticks - task->nextRun >= 0);
+
+        if (due && (best == NULL || task->priority < best->priority)) {
+            best = task;
+        }
+    }
+
+    return best;
+}
+
+// Runs the most urgent task that is ready, if any. Returns TRUE if a task was
+// run.
+bool sched_runOnce(void)
+{
+    int ticks; sched_Task* best; unsigned long start, cycles;
+
+    ticks = sched_ticks;
+
+    best = sched_findDue(ticks);
+    if (best == NULL) return FALSE;
+
+    // Clear the signal before running, so a signal raised while the task
+    // runs makes it run again.
+    best->signalled = FALSE;
+
+    // Schedule the next run relative to when this one was due, so the period
+    // doesn't drift. If we've fallen a whole period behind, give up on
+    // catching up.
+    if (best->period != SCHED_NOT_PERIODIC && ticks - best->nextRun >= 0) {
+        best->nextRun += best->period;
+        if (ticks - best->nextRun >= 0) best->nextRun = ticks + best->period;
+    }
+
+    TRACE(TRACE_TASK_BEGIN, best - sched_tasks, 0);
+
+    start = sched_now();
+    best->func();
+    cycles = sched_now() - start;
+
+    TRACE(TRACE_TASK_END, best - sched_tasks, 0);
+
+    ++best->runs;
+    best->totalCycles += cycles;
+    if (cycles > best->maxCycles) best->maxCycles = cycles;
+
+    return TRUE;
+}
+
+// Sleeps until the next periodic task is due or an interrupt signals one,
+// unless one is ready already.
+void sched_idle(void)
+{
+    unsigned long start, cpsr;
+
+    start = sched_now();
+
+    // With IRQs held off, nothing can signal a task between checking and
+    // going to sleep, and the tick count can be caught up safely.
+    cpsr = vic_maskInterrupts();
+
+    if (sched_findDue(sched_catchUp()) == NULL) {
+        sched_setMatch(sched_ticksToNext());
+        sched_sleeping = TRUE;
+        idle_enter();
+    }
+
+    // Whatever woke us is handled here.
+    vic_restoreInterrupts(cpsr);
+
+    // If it wasn't the tick, count the ticks slept through and go back to
+    // one every tick.
+    cpsr = vic_maskInterrupts();
+    sched_sleeping = FALSE;
+    sched_setMatch(1);
+    vic_restoreInterrupts(cpsr);
+
+    sched_idleCycles += sched_now() - start;
+}
+
+// Runs tasks forever, sleeping whenever there's nothing to do.
+void sched_run(void)
+{
+    for (;;) {
+        if (!sched_runOnce()) sched_idle();
+    }
+}
+
+// Counts any ticks that have passed since the latest one counted, and returns
+// the new tick count. Call from the tick handler, or with IRQs masked.
+int sched_catchUp(void)
+{
+    unsigned long n;
+
+    n = (sched_now() - sched_tickTime) / SCHED_TICK_CYCLES;
+    sched_tickTime += n * SCHED_TICK_CYCLES;
+    sched_ticks += n;
+
+    return sched_ticks;
+}
+
+// Sets the tick interrupt to fire the given number of ticks after the latest
+// one. The timer only matches when the count is equal, so a match that has
+// already gone by would never fire; catch up and try again until it's set in
+// the future. Call from the tick handler, or with IRQs masked.
+void sched_setMatch(int ticks)
+{
+    do {
+        sched_catchUp();
+        TIMER0->MR[0] = sched_tickTime + ticks * SCHED_TICK_CYCLES;
+    } while ((long) (TIMER0->MR[0] - sched_now()) <= 0);
+}
+
+// Gives the number of ticks from the latest one until the next periodic task
+// is due, up to SCHED_MAX_SLEEP, and at least 1.
+int sched_ticksToNext(void)
+{
+    int i, next; sched_Task* task;
+
+    next = SCHED_MAX_SLEEP;
+    for (i = 0; i < sched_taskCount; ++i) {
+        task = &sched_tasks[i];
+
+        if (task->period != SCHED_NOT_PERIODIC) {
+            next = min(next, task->nextRun - sched_ticks);
+        }
+    }
+
+    return max(next, 1);
+}
+
+// Draws a table of each task's run count, and average and worst case run
+// times in microseconds, then the worst case time to wake from sleep, with
+// the top left corner at the given position.
+void sched_drawReport(int x, int y)
+{
+    int i; sched_Task* task; char num[8];
+
+    lcd_putString(x, y, "TASK      RUNS   AVG   MAX");
+
+    for (i = 0; i < sched_taskCount; ++i) {
+        task = &sched_tasks[i];
+        y += CHAR_HEIGHT;
+
+        lcd_fillRect(x, y, x + 26 * CHAR_WIDTH, y + CHAR_HEIGHT - 1, BLACK);
+        lcd_putString(x, y, task->name);
+
+        formatNumber(num, task->runs, 6);
+        lcd_putString(x + 8 * CHAR_WIDTH, y, num);
+
+        formatNumber(num, task->runs == 0 ? 0 : task->totalCycles
+            / task->runs / (PCLK_HZ / 1000000), 6);
+        lcd_putString(x + 14 * CHAR_WIDTH, y, num);
+
+        formatNumber(num, task->maxCycles / (PCLK_HZ / 1000000), 6);
+        lcd_putString(x + 20 * CHAR_WIDTH, y, num);
+    }
+
+    // Finish with the longest it has taken to wake up for a tick, which is
+    // too short to give in microseconds.
+    y += CHAR_HEIGHT;
+    lcd_fillRect(x, y, x + 26 * CHAR_WIDTH, y + CHAR_HEIGHT - 1, BLACK);
+    lcd_putString(x, y, "WAKE CYCLES");
+
+    formatNumber(num, sched_maxWakeCycles, 6);
+    lcd_putString(x + 20 * CHAR_WIDTH, y, num);
+}
+
+// Advances the tick count, and sets up the match for the next tick. Run by
+// sched_tickIsr with IRQs enabled, so the audio interrupts never wait on it.
+void sched_tick(void)
+{
+    unsigned long late;
+
+    TRACE(TRACE_ISR_ENTER, VIC_CHANNEL_TIMER0, 0);
+
+    // Note how long it took to wake up for this tick.
+    late = sched_now() - TIMER0->MR[0];
+    if (sched_sleeping) {
+        sched_sleeping = FALSE;
+        sched_maxWakeCycles = max(sched_maxWakeCycles, late);
+    }
+
+    TIMER0->IR = 1 << 0;
+    sched_setMatch(1);
+
+    TRACE(TRACE_ISR_EXIT, VIC_CHANNEL_TIMER0, 0);
+}
+
+VIC_NESTED(sched_tickIsr, sched_tick)
+
+#endif
@@ -0,0 +1,246 @@
+/**
+ * File Name  : scope.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : A live strip chart of incoming samples, scrolled by the LCD
+ *              controller rather than by moving pixels. While it runs the
+ *              display shows a frame buffer of its own, twice the height of
+ *              the screen. Each new row is written at the same place in both
+ *              halves and the controller's base address is moved down a row,
+ *              so the newest row appears at the bottom, everything else moves
+ *              up, and there is never a seam to wrap around.
+ *
+ *              Time runs up the screen, with each row showing one block of
+ *              samples across it: either the range the samples cover, or as a
+ *              waterfall, the spectrum of the latest samples with low
+ *              frequencies on the left. The display's own frame buffer is left
+ *              alone, and shown again when the chart stops.
+ */
+
+#ifndef SCOPE_H_GUARD
+#define SCOPE_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lpc24xx.h>
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "mem.h"
+#include "fft.h"
+#include "spectrum.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of samples each row covers. At 44.1 kHz that's a hundred rows
+// a second, so the screen holds a little over three seconds.
+#define SCOPE_BLOCK 441
+
+// The most rows drawn by one call to scope_update. If it falls further
+// behind than this, it skips ahead rather than holding up other tasks.
+#define SCOPE_MAX_ROWS 16
+
+// The most waterfall rows drawn by one call to scope_update, each of which
+// takes a transform.
+#define SCOPE_MAX_SPECTRA 4
+
+// Size of the transform behind each waterfall row, as a power of two. Half
+// of the bins cover the width of the screen, about 86 Hz each at 44.1 kHz.
+#define SCOPE_SPECTRUM_BITS 9
+#define SCOPE_SPECTRUM_POINTS (1 << SCOPE_SPECTRUM_BITS)
+
+// What each row of the chart shows.
+#define SCOPE_VIEW_RANGE 0
+#define SCOPE_VIEW_WATERFALL 1
+
+// The largest sample value, as read from the A/D converter.
+#define SCOPE_SAMPLE_MAX 0x3ff
+
+// Colours of the chart.
+#define SCOPE_BACKGROUND BLACK
+#define SCOPE_TRACE GREEN
+#define SCOPE_AXIS DARK_GRAY
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The chart's frame buffer. It's too big for internal RAM, so only exists in
+// the EXTMEM build.
+#ifdef EXTMEM
+lcd_color_t scope_buffer[2 * DISPLAY_HEIGHT * DISPLAY_WIDTH] MEM_ATTR_ALIGNED;
+#endif
+
+// The frame buffer the display was showing before the chart started.
+unsigned long scope_savedBase;
+
+// Whether the chart is being shown.
+bool scope_running;
+
+// What each new row shows, one of the SCOPE_VIEW_* constants.
+int scope_view;
+
+// Working space for the waterfall's transforms.
+fft_Complex scope_data[SCOPE_SPECTRUM_POINTS];
+
+// Where the next row goes, from 0 to DISPLAY_HEIGHT - 1.
+int scope_head;
+
+// The first sample not yet charted.
+unsigned long scope_next;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void scope_start(void);
+void scope_stop(void);
+void scope_update(const short* samples, unsigned long count);
+void scope_addRow(int low, int high);
+void scope_addSpectrumRow(const short* samples);
+void scope_scroll(void);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Clears the chart and shows it in place of the display's frame buffer, to be
+// fed from the start of a recording.
+void scope_start(void)
+{
+#ifdef EXTMEM
+    int i; unsigned long* dest;
+
+    // Two pixels at a time, since the buffer is word aligned.
+    dest = (unsigned long*) scope_buffer;
+    for (i = 0; i < DISPLAY_HEIGHT * DISPLAY_WIDTH; ++i) {
+        dest[i] = SCOPE_BACKGROUND | ((unsigned long) SCOPE_BACKGROUND << 16);
+    }
+
+    scope_head = 0;
+    scope_next = 0;
+
+    scope_savedBase = LCD_UPBASE;
+    LCD_UPBASE = (unsigned long) scope_buffer;
+    scope_running = TRUE;
+#endif
+}
+
+// Goes back to showing the display's own frame buffer.
+void scope_stop(void)
+{
+    if (!scope_running) return;
+
+    LCD_UPBASE = scope_savedBase;
+    scope_running = FALSE;
+}
+
+// Charts every whole block among the first count samples that hasn't been
+// charted yet. Call regularly while recording, with the number of samples
+// recorded so far.
+void scope_update(const short* samples, unsigned long count)
+{
+    int rows, most, low, high; short val; unsigned long i, end;
+
+    if (!scope_running) return;
+
+    // Skip whole blocks if we have fallen too far behind to catch up.
+    most = scope_view == SCOPE_VIEW_WATERFALL ? SCOPE_MAX_SPECTRA
+        : SCOPE_MAX_ROWS;
+    rows = (count - scope_next) / SCOPE_BLOCK;
+    if (rows > most) {
+        scope_next += (unsigned long) (rows - most) * SCOPE_BLOCK;
+    }
+
+    while (count - scope_next >= SCOPE_BLOCK) {
+        end = scope_next + SCOPE_BLOCK;
+
+        // The transform reaches back past the start of the block, so the
+        // first block of a recording has no spectrum.
+        if (scope_view == SCOPE_VIEW_WATERFALL) {
+            if (end >= SCOPE_SPECTRUM_POINTS) {
+                scope_addSpectrumRow(&samples[end - SCOPE_SPECTRUM_POINTS]);
+            }
+            scope_next = end;
+            continue;
+        }
+
+        low = SCOPE_SAMPLE_MAX;
+        high = 0;
+        for (i = scope_next; i < end; ++i) {
+            val = samples[i];
+            if (val < low) low = val;
+            if (val > high) high = val;
+        }
+
+        scope_addRow(low, high);
+        scope_next = end;
+    }
+}
+
+// Adds a row to the bottom of the chart, filled between the given sample
+// values, and scrolls everything else up by one.
+void scope_addRow(int low, int high)
+{
+#ifdef EXTMEM
+    int x, x0, x1; lcd_color_t colour; lcd_color_t *top, *bottom;
+
+    x0 = low * (DISPLAY_WIDTH - 1) / SCOPE_SAMPLE_MAX;
+    x1 = high * (DISPLAY_WIDTH - 1) / SCOPE_SAMPLE_MAX;
+
+    top = &scope_buffer[scope_head * DISPLAY_WIDTH];
+    bottom = top + DISPLAY_HEIGHT * DISPLAY_WIDTH;
+
+    for (x = 0; x < DISPLAY_WIDTH; ++x) {
+        if (x >= x0 && x <= x1) colour = SCOPE_TRACE;
+        else if (x == DISPLAY_WIDTH >> 1) colour = SCOPE_AXIS;
+        else colour = SCOPE_BACKGROUND;
+
+        top[x] = bottom[x] = colour;
+    }
+
+    scope_scroll();
+#else
+    (void) low; (void) high;
+#endif
+}
+
+// Adds a row to the bottom of the chart showing the spectrum of the
+// SCOPE_SPECTRUM_POINTS samples given, and scrolls everything else up by one.
+void scope_addSpectrumRow(const short* samples)
+{
+#ifdef EXTMEM
+    int x; lcd_color_t *top, *bottom;
+
+    fft_load(scope_data, samples, SCOPE_SPECTRUM_BITS);
+    fft_transform(scope_data, SCOPE_SPECTRUM_BITS);
+
+    top = &scope_buffer[scope_head * DISPLAY_WIDTH];
+    bottom = top + DISPLAY_HEIGHT * DISPLAY_WIDTH;
+
+    // Start from the first bin above the average, which was taken off.
+    for (x = 0; x < DISPLAY_WIDTH; ++x) {
+        top[x] = bottom[x] = spectrum_levelColour(fft_level(scope_data[x + 1]));
+    }
+
+    scope_scroll();
+#else
+    (void) samples;
+#endif
+}
+
+// Shows the screen's worth of rows ending with the one just written. The
+// controller picks up the new base at the start of the next frame.
+void scope_scroll(void)
+{
+#ifdef EXTMEM
+    scope_head = scope_head + 1 < DISPLAY_HEIGHT ? scope_head + 1 : 0;
+    LCD_UPBASE = (unsigned long) &scope_buffer[scope_head * DISPLAY_WIDTH];
+#endif
+}
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * File Name  : spectrum.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Spectrograms of recorded audio, drawn a column at a time like
+ *              the amplitude graphs in graph.h. Each column is the spectrum
+ *              of a short run of samples from fft.h, with low frequencies at
+ *              the bottom and each bin's level shown as a colour, from black
+ *              through blue, red and yellow to white.
+ */
+
+#ifndef SPECTRUM_H_GUARD
+#define SPECTRUM_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "pt.h"
+#include "fft.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Size of the transform behind each column of a spectrogram, as a power of
+// two. At 44.1 kHz each bin is about 172 Hz wide.
+#define SPECTRUM_BITS 8
+#define SPECTRUM_POINTS (1 << SPECTRUM_BITS)
+
+// The range of levels from fft_level shown by the colour scale. Anything
+// quieter is black and anything louder is white. A full scale tone comes out
+// at about 160, and the A/D converter's own noise at about 50.
+#define SPECTRUM_LEVEL_FLOOR 80
+#define SPECTRUM_LEVEL_RANGE 80
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Everything spectrum_step needs to remember between columns.
+typedef struct {
+    pt_Thread pt;
+    const short* samples;
+    int x, y, w, h;
+    unsigned long total;
+    int i;
+} spectrum_Draw;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Working space for the transforms.
+fft_Complex spectrum_data[SPECTRUM_POINTS];
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+lcd_color_t spectrum_levelColour(int level);
+lcd_color_t spectrum_rgb(int r, int g, int b);
+
+void spectrum_start(spectrum_Draw* draw, const short* samples,
+    unsigned long total, int x, int y, int w, int h);
+int spectrum_step(spectrum_Draw* draw);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Picks the colour that shows a level from fft_level.
+lcd_color_t spectrum_levelColour(int level)
+{
+    int t;
+
+    t = (level - SPECTRUM_LEVEL_FLOOR) * 256 / SPECTRUM_LEVEL_RANGE;
+    t = min(max(t, 0), 255);
+
+    // Four even steps, each ramping one channel up or down.
+    switch (t >> 6) {
+        case 0: return spectrum_rgb(0, 0, (t & 63) << 2);
+        case 1: return spectrum_rgb((t & 63) << 2, 0, 255 - ((t & 63) << 2));
+        case 2: return spectrum_rgb(255, (t & 63) << 2, 0);
+        default: return spectrum_rgb(255, 255, (t & 63) << 2);
+    }
+}
+
+// Packs 8 bits per channel into the display's 5-6-5 format.
+lcd_color_t spectrum_rgb(int r, int g, int b)
+{
+    return (lcd_color_t) (((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
+}
+
+// Start drawing a spectrogram of the given samples, with the given position
+// and size. Time runs left to right and one bin is drawn per row, starting
+// from the first bin above the average. The drawing itself is done a column
+// at a time by spectrum_step. The samples must stay put until the
+// spectrogram is finished.
+void spectrum_start(spectrum_Draw* draw, const short* samples,
+    unsigned long total, int x, int y, int w, int h)
+{
+    PT_INIT(&draw->pt);
+
+    draw->samples = samples;
+    draw->x = x;
+    draw->y = y;
+    draw->w = w;
+    draw->h = min(h, SPECTRUM_POINTS / 2 - 1);
+    draw->total = total;
+}
+
+// Draw the next column of a spectrogram. Columns are spread evenly over the
+// recording, so each one transforms the run of samples starting at its share
+// of the way through. Returns PT_ENDED once the spectrogram is complete, and
+// PT_YIELDED if there is more to do.
+int spectrum_step(spectrum_Draw* draw)
+{
+    int j; unsigned long start;
+
+    PT_BEGIN(&draw->pt);
+
+    // Too short to transform even once.
+    if (draw->total < SPECTRUM_POINTS || draw->w < 2) PT_EXIT(&draw->pt);
+
+    for (draw->i = 0; draw->i < draw->w; ++draw->i) {
+        start = (unsigned long) ((unsigned long long) draw->i
+            * (draw->total - SPECTRUM_POINTS) / (draw->w - 1));
+
+        fft_load(spectrum_data, &draw->samples[start], SPECTRUM_BITS);
+        fft_transform(spectrum_data, SPECTRUM_BITS);
+
+        for (j = 0; j < draw->h; ++j) {
+            lcd_point(draw->x + draw->i, draw->y + draw->h - 1 - j,
+                spectrum_levelColour(fft_level(spectrum_data[j + 1])));
+        }
+
+        PT_YIELD(&draw->pt);
+    }
+
+    PT_END(&draw->pt);
+}
+
+#endif
@@ -0,0 +1,247 @@
+/**
+ * File Name  : speed.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Variable speed playback of a recording of 10 bit samples,
+ *              forwards or backwards, from a quarter up to four times as
+ *              fast. A reader steps a fractional position through the
+ *              recording by a fixed point amount each sample, and works out
+ *              the sample between the two either side of it by linear
+ *              interpolation, or between the four around it with a cubic
+ *              (Catmull-Rom) spline, which is smoother for slowed down sound.
+ *
+ *              The weights for each fraction of the way between samples are
+ *              kept in a table with the volume already folded in, so each
+ *              sample costs two or four multiply-accumulates and a shift, and
+ *              the volume never needs a divide. The volume scales about the
+ *              middle of the range, so turning it down never shifts the
+ *              level the speaker sits at and there is no click.
+ */
+
+#ifndef SPEED_H_GUARD
+#define SPEED_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of fractional bits in positions and steps. A step of SPEED_ONE
+// plays at the recorded speed.
+#define SPEED_FRACTION_BITS 16
+#define SPEED_ONE (1L << SPEED_FRACTION_BITS)
+
+// The number of fractions between samples the weights are worked out for,
+// as a power of two. Positions are rounded down to the nearest.
+#define SPEED_PHASE_BITS 6
+#define SPEED_PHASES (1 << SPEED_PHASE_BITS)
+
+// Number of fractional bits in the weights, which leaves room for a full
+// volume of 256 and four 10 bit samples in 32 bits.
+#define SPEED_COEFF_SHIFT 14
+
+// The ways of working out samples between the recorded ones.
+#define SPEED_LINEAR 0
+#define SPEED_CUBIC 1
+
+// The range of sample values, and the middle the volume scales about.
+#define SPEED_SAMPLE_MAX 0x3ff
+#define SPEED_MIDDLE 0x200
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A reader, playing through a recording. Each row of coeffs holds the
+// weights of the samples before, at, after and two after the position, at
+// one fraction of the way between two samples. Linear interpolation only
+// uses the middle two.
+typedef struct {
+    const short* samples;
+    unsigned long length;
+    long long position;
+    volatile long step;
+    int method;
+    int bias;
+    short coeffs[SPEED_PHASES][4];
+} speed_Reader;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void speed_start(speed_Reader* reader, const short* samples,
+    unsigned long length, long step, int method);
+void speed_setStep(speed_Reader* reader, long step);
+void speed_move(speed_Reader* reader, const short* samples,
+    unsigned long length, long long position);
+void speed_setVolume(speed_Reader* reader, int volume);
+void speed_weights(int method, int phase, long* weights);
+
+static inline bool speed_finished(const speed_Reader* reader);
+static inline unsigned long speed_index(const speed_Reader* reader);
+static inline short speed_next(speed_Reader* reader);
+int speed_edge(const speed_Reader* reader, const short* coeffs, long index);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Starts a reader at one end of the given recording, playing at full volume
+// with the given step, in SPEED_ONEs, and one of the SPEED_* methods. A
+// negative step plays backwards from the end.
+void speed_start(speed_Reader* reader, const short* samples,
+    unsigned long length, long step, int method)
+{
+    reader->samples = samples;
+    reader->length = length;
+    reader->method = method;
+    reader->step = step;
+    reader->position = step < 0
+        ? (long long) (length - 1) << SPEED_FRACTION_BITS : 0;
+
+    speed_setVolume(reader, 256);
+}
+
+// Changes the speed and direction of a reader from the next sample on.
+// Safe to call while an interrupt is reading.
+void speed_setStep(speed_Reader* reader, long step)
+{
+    reader->step = step;
+}
+
+// Moves a reader onto another recording, at the given position in
+// SPEED_ONEs, keeping its weights, so it is quick enough to call from an
+// interrupt.
+void speed_move(speed_Reader* reader, const short* samples,
+    unsigned long length, long long position)
+{
+    reader->samples = samples;
+    reader->length = length;
+    reader->position = position;
+}
+
+// Sets the volume, out of 256, by scaling every weight. The weights at each
+// fraction are made to add up to exactly the volume, so the middle of the
+// range always comes out as the middle, which the bias makes up for.
+void speed_setVolume(speed_Reader* reader, int volume)
+{
+    int p, i, largest; long weights[4], scaled, total;
+
+    for (p = 0; p < SPEED_PHASES; ++p) {
+        speed_weights(reader->method, p, weights);
+
+        total = 0;
+        largest = 0;
+        for (i = 0; i < 4; ++i) {
+            scaled = (weights[i] * volume + 128) >> 8;
+            reader->coeffs[p][i] = (short) scaled;
+            total += scaled;
+
+            if (abs(weights[i]) > abs(weights[largest])) largest = i;
+        }
+
+        // Put any rounding error where it makes the least difference.
+        reader->coeffs[p][largest] += (short) (((long) volume
+            << (SPEED_COEFF_SHIFT - 8)) - total);
+    }
+
+    reader->bias = (((1 << SPEED_COEFF_SHIFT)
+        - (volume << (SPEED_COEFF_SHIFT - 8))) * SPEED_MIDDLE)
+        + (1 << (SPEED_COEFF_SHIFT - 1));
+}
+
+// Works out the weights of the four samples around a position the given
+// number of SPEED_PHASES of the way from one sample to the next, in
+// 1 << SPEED_COEFF_SHIFT.
+void speed_weights(int method, int phase, long* weights)
+{
+    long t, t2, t3;
+
+    // The fraction, its square and its cube, all with SPEED_COEFF_SHIFT
+    // fractional bits.
+    t = (long) phase << (SPEED_COEFF_SHIFT - SPEED_PHASE_BITS);
+    t2 = (t * t) >> SPEED_COEFF_SHIFT;
+    t3 = (t2 * t) >> SPEED_COEFF_SHIFT;
+
+    if (method == SPEED_LINEAR) {
+        weights[0] = 0;
+        weights[1] = (1L << SPEED_COEFF_SHIFT) - t;
+        weights[2] = t;
+        weights[3] = 0;
+        return;
+    }
+
+    // The Catmull-Rom spline passes through every sample, with the slope at
+    // each one set by its neighbours.
+    weights[0] = (-t3 + 2 * t2 - t) >> 1;
+    weights[1] = (3 * t3 - 5 * t2 + (2L << SPEED_COEFF_SHIFT)) >> 1;
+    weights[2] = (-3 * t3 + 4 * t2 + t) >> 1;
+    weights[3] = (t3 - t2) >> 1;
+}
+
+// Whether a reader has gone past either end of its recording.
+static inline bool speed_finished(const speed_Reader* reader)
+{
+    return reader->position < 0 || (unsigned long long) reader->position
+        >= (unsigned long long) reader->length << SPEED_FRACTION_BITS;
+}
+
+// Gives the index of the recorded sample at or just before a reader's
+// position.
+static inline unsigned long speed_index(const speed_Reader* reader)
+{
+    return (unsigned long) (reader->position >> SPEED_FRACTION_BITS);
+}
+
+// Gives the sample at a reader's position, at its volume, and moves it on by
+// its step. Call speed_finished first.
+static inline short speed_next(speed_Reader* reader)
+{
+    long index; int val; const short *coeffs, *x;
+
+    index = (long) (reader->position >> SPEED_FRACTION_BITS);
+    coeffs = reader->coeffs[((unsigned long) reader->position
+        >> (SPEED_FRACTION_BITS - SPEED_PHASE_BITS)) & (SPEED_PHASES - 1)];
+
+    // Only the first and last sample or two need any care taken.
+    if (index >= 1 && (unsigned long) index + 2 < reader->length) {
+        x = &reader->samples[index - 1];
+        if (reader->method == SPEED_LINEAR) {
+            val = coeffs[1] * x[1] + coeffs[2] * x[2];
+        } else {
+            val = coeffs[0] * x[0] + coeffs[1] * x[1]
+                + coeffs[2] * x[2] + coeffs[3] * x[3];
+        }
+    } else {
+        val = speed_edge(reader, coeffs, index);
+    }
+
+    reader->position += reader->step;
+
+    val = (val + reader->bias) >> SPEED_COEFF_SHIFT;
+    return (short) min(max(val, 0), SPEED_SAMPLE_MAX);
+}
+
+// Applies the given weights around the given index, near enough to an end
+// of the recording that some of the samples would be past it. Those are
+// taken to be the same as the end sample.
+int speed_edge(const speed_Reader* reader, const short* coeffs, long index)
+{
+    int i, val; long j;
+
+    val = 0;
+    for (i = 0; i < 4; ++i) {
+        j = min(max(index - 1 + i, 0), (long) reader->length - 1);
+        val += coeffs[i] * reader->samples[j];
+    }
+
+    return val;
+}
+
+#endif
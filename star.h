@@ -0,0 +1,121 @@
+/**
+ * File Name  : star.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Projection and drawing of the stars in exercise 3's star
+ *              field. Kept apart from the exercise so the benchmark can time
+ *              the same code.
+ */
+
+#ifndef STAR_H_GUARD
+#define STAR_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "lcd.h"
+#include "ramfunc.h"
+#include "prof.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The distance of the virtual view plane from the camera, which affects the
+// field of view of the scene.
+#define Z_PLANE_DIST 0.75f
+
+// The shortest distance a star's streak covers, so stars are still drawn
+// when the camera is stopped.
+#define STAR_MIN_STREAK 0.00390625f
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Star structure, recording the location of the star in 3D space, and colour.
+typedef struct {
+    float x;
+    float y;
+    float z;
+    int clr;
+} Star;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Profiler zones for projecting and drawing stars. Left as PROF_NO_ZONE
+// unless the program adds zones for them.
+int star_projectZone = PROF_NO_ZONE;
+int star_drawZone = PROF_NO_ZONE;
+
+// The area covered by the last line star_render drew, so anything it was
+// drawn over can be repaired. Has no size if the star was off screen.
+Rect star_lastLine;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void star_render(Star star, float speed, int colour) RAMFUNC;
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Projects a given star in 3D, and draws it to the screen. The star is drawn
+// as a line, with a length proportional to the camera speed to give the
+// illusion of non-instantaneous camera exposure. Draws the star in the
+// provided colour.
+void star_render(Star star, float speed, int colour)
+{
+    float mn, mf; int xn, yn, xf, yf;
+
+    star_lastLine.size.width = star_lastLine.size.height = 0;
+
+    // Don't draw a star if it is behind the camera! This should never occur
+    // anyway, since we push them back when they pass the camera.
+    if (star.z <= 0.0f) return;
+
+    PROF_BEGIN(star_projectZone);
+
+    // Work out the perspective multipliers for the near and far points of the
+    // line we will draw for the star. Also ensures that we don't draw nothing
+    // if the camera is stopped.
+    mn = Z_PLANE_DIST / star.z;
+    mf = Z_PLANE_DIST / (star.z + max(speed * 2.0f, STAR_MIN_STREAK));
+
+    // Make sure the line doesn't go off screen because apparently that crashes
+    // the program occasionally.
+    mn = min(mn, 0.5f / abs(star.x));
+    mn = min(mn, 0.5f / abs(star.y));
+
+    // Using the perspective multipliers, calculate the two (X, Y) coordinate
+    // pairs for the star's line. Positions the line to be relative to the
+    // centre of the screen, and stretches it.
+    xn = (int) ((star.x * mn + 0.5f) * DISPLAY_WIDTH);
+    yn = (int) ((star.y * mn + 0.5f) * DISPLAY_HEIGHT);
+    xf = (int) ((star.x * mf + 0.5f) * DISPLAY_WIDTH);
+    yf = (int) ((star.y * mf + 0.5f) * DISPLAY_HEIGHT);
+
+    PROF_END(star_projectZone);
+
+    // If the line isn't completely off-screen, draw it.
+    if (xf >= 0 && xf < DISPLAY_WIDTH && yf >= 0 && yf < DISPLAY_HEIGHT) {
+        PROF_BEGIN(star_drawZone);
+        lcd_line(xn, yn, xf, yf, colour);
+        PROF_END(star_drawZone);
+
+        star_lastLine.pos.x = min(xn, xf);
+        star_lastLine.pos.y = min(yn, yf);
+        star_lastLine.size.width = abs(xn - xf) + 1;
+        star_lastLine.size.height = abs(yn - yf) + 1;
+    }
+}
+
+#endif
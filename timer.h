@@ -0,0 +1,124 @@
+/**
+ * File Name  : timer.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Methods to run one of the general purpose timers as a periodic
+ *              interrupt source, such as a sample clock for audio, and to
+ *              measure how late its handler starts.
+ */
+
+#ifndef TIMER_H_GUARD
+#define TIMER_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "vic.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Each timer's register block, starting from its first register. Going
+// through an integer drops the register's own volatile, which the members
+// of timer_Regs already have.
+#define TIMER0 ((timer_Regs*) (unsigned long) &T0IR)
+#define TIMER1 ((timer_Regs*) (unsigned long) &T1IR)
+#define TIMER2 ((timer_Regs*) (unsigned long) &T2IR)
+#define TIMER3 ((timer_Regs*) (unsigned long) &T3IR)
+
+// Bits in the timer control register.
+#define TIMER_TCR_ENABLE 0
+#define TIMER_TCR_RESET 1
+
+// Bits in the match control register for MR0.
+#define TIMER_MCR_MR0I 0
+#define TIMER_MCR_MR0R 1
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// Layout of a timer's register block, so one set of functions can drive any
+// of the four timers.
+typedef struct {
+    volatile unsigned long IR;
+    volatile unsigned long TCR;
+    volatile unsigned long TC;
+    volatile unsigned long PR;
+    volatile unsigned long PC;
+    volatile unsigned long MCR;
+    volatile unsigned long MR[4];
+    volatile unsigned long CCR;
+    volatile unsigned long CR[4];
+    volatile unsigned long EMR;
+} timer_Regs;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void timer_startPeriodic(timer_Regs* timer, int channel, int priority,
+    int hz, vic_Handler isr);
+void timer_setRate(timer_Regs* timer, int hz);
+void timer_stop(timer_Regs* timer, int channel);
+static inline unsigned long timer_latency(timer_Regs* timer);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Starts the given timer raising an interrupt hz times a second, handled by
+// isr at the given VIC priority. The handler must write 1 to the timer's IR
+// to acknowledge each interrupt.
+void timer_startPeriodic(timer_Regs* timer, int channel, int priority,
+    int hz, vic_Handler isr)
+{
+    // Hold the timer in reset while it is set up.
+    timer->TCR = 1 << TIMER_TCR_RESET;
+
+    // Count PCLK cycles, and wrap around every period.
+    timer->PR = 0;
+    timer->MR[0] = PCLK_HZ / hz - 1;
+    timer->MCR = (1 << TIMER_MCR_MR0I) | (1 << TIMER_MCR_MR0R);
+
+    vic_install(channel, priority, isr);
+    vic_enableInterrupts();
+
+    timer->TCR = 1 << TIMER_TCR_ENABLE;
+}
+
+// Changes how many times a second a timer started by timer_startPeriodic
+// raises its interrupt. The count starts again from 0, so the next interrupt
+// is a whole new period away.
+void timer_setRate(timer_Regs* timer, int hz)
+{
+    timer->TCR = 1 << TIMER_TCR_RESET;
+    timer->MR[0] = PCLK_HZ / hz - 1;
+    timer->TCR = 1 << TIMER_TCR_ENABLE;
+}
+
+// Stops the given timer and its interrupt.
+void timer_stop(timer_Regs* timer, int channel)
+{
+    timer->TCR = 0;
+    vic_disable(channel);
+
+    // Clear any interrupt that was pending when it stopped.
+    timer->IR = bitMask(6);
+}
+
+// Gives the number of PCLK cycles since a timer started by
+// timer_startPeriodic last raised its interrupt. Read it first thing in the
+// handler to find the interrupt latency, which is the time the handler has
+// lost to whatever was running (or masking IRQs) when it fired. Only valid
+// while the handler's deadline is being met.
+static inline unsigned long timer_latency(timer_Regs* timer)
+{
+    // The count resets to 0 on the match that raises the interrupt.
+    return timer->TC;
+}
+
+#endif
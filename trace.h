@@ -0,0 +1,231 @@
+/**
+ * File Name  : trace.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : A binary event trace. Timestamped events (interrupt entry and
+ *              exit, task runs, button edges, frame boundaries and so on) are
+ *              written into a ring buffer, which keeps the most recent
+ *              TRACE_LENGTH of them. The ring can be sent over the serial
+ *              port on demand and turned into a timeline on the PC with
+ *              tracedec.
+ *
+ *              Writing an event takes a few cycles. IRQs are masked only for
+ *              the handful of instructions that claim a slot, so an event
+ *              written from an interrupt handler can never land in the same
+ *              slot as one it interrupted.
+ */
+
+#ifndef TRACE_H_GUARD
+#define TRACE_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "vic.h"
+#include "timer.h"
+#include "uart.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Define TRACE_ENABLED as 0 before including this to compile every event
+// out.
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif
+
+// The number of events kept, which must be a power of two. In the EXTMEM
+// build the ring lives in SDRAM along with every other global, and sending
+// a full ring takes about 11 seconds at 115200 baud. Otherwise it has to
+// share the 64K of internal RAM, so is kept small.
+#ifndef TRACE_LENGTH
+#ifdef EXTMEM
+#define TRACE_LENGTH 16384
+#else
+#define TRACE_LENGTH 256
+#endif
+#endif
+
+// The most names that may be given to IDs.
+#define TRACE_MAX_NAMES 32
+
+// Event types. The ID and argument of each are described alongside.
+#define TRACE_ISR_ENTER 1   // ID is the VIC channel.
+#define TRACE_ISR_EXIT 2    // ID is the VIC channel.
+#define TRACE_TASK_BEGIN 3  // ID is the scheduler task ID.
+#define TRACE_TASK_END 4    // ID is the scheduler task ID.
+#define TRACE_BUTTON_DOWN 5 // ID is the button's bit number.
+#define TRACE_BUTTON_UP 6   // ID is the button's bit number.
+#define TRACE_FRAME 7       // Argument is the frame number.
+#define TRACE_MARK 8        // ID and argument are up to the caller.
+
+// Sent at the start of a dump so the decoder can find it among any text
+// sent before it.
+#define TRACE_MAGIC "TRCE"
+#define TRACE_VERSION 1
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Records an event, or does nothing if tracing is compiled out.
+#if TRACE_ENABLED
+#define TRACE(type, id, arg) trace_event(type, id, arg)
+#else
+#define TRACE(type, id, arg) do { } while (0)
+#endif
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A single event, as stored and as sent. The time is in Timer 0 cycles.
+typedef struct {
+    unsigned long time;
+    unsigned char type;
+    unsigned char id;
+    unsigned short arg;
+} trace_Event;
+
+// A name for the given ID of the given event type, sent along with the
+// events so the decoder can show something more useful than a number.
+typedef struct {
+    unsigned char type;
+    unsigned char id;
+    char* name;
+} trace_Name;
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The ring, and the total number of events ever written to it. The slot for
+// the next event is trace_head modulo TRACE_LENGTH.
+trace_Event trace_events[TRACE_LENGTH];
+volatile unsigned long trace_head;
+
+// Events are dropped rather than recorded while this is set, so a dump sees
+// a consistent ring.
+volatile bool trace_paused;
+
+trace_Name trace_names[TRACE_MAX_NAMES];
+int trace_nameCount;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void trace_init(void);
+void trace_name(int type, int id, char* name);
+static inline void trace_event(int type, int id, int arg);
+
+void trace_send(void);
+void trace_sendBytes(unsigned long val, int count);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Empties the ring. Called by sched_init. Names are kept, so they may be
+// given before or after.
+void trace_init(void)
+{
+    trace_head = 0;
+    trace_paused = FALSE;
+}
+
+// Gives a name to the given ID of the given event type. For the paired
+// types, name the starting one (TRACE_ISR_ENTER or TRACE_TASK_BEGIN).
+void trace_name(int type, int id, char* name)
+{
+    trace_Name* entry;
+
+    if (trace_nameCount >= TRACE_MAX_NAMES) return;
+
+    entry = &trace_names[trace_nameCount++];
+    entry->type = type;
+    entry->id = id;
+    entry->name = name;
+}
+
+// Records an event at the current time. Safe to call from anywhere.
+static inline void trace_event(int type, int id, int arg)
+{
+    unsigned long cpsr, i; trace_Event* event;
+
+    if (trace_paused) return;
+
+    // Claim a slot and take the time with IRQs masked, so slots are handed
+    // out in time order.
+    vic_readCpsr(cpsr);
+    vic_writeCpsr(cpsr | CPSR_IRQ_DISABLE);
+
+    i = trace_head++;
+    event = &trace_events[i & (TRACE_LENGTH - 1)];
+    event->time = TIMER0->TC;
+
+    vic_writeCpsr(cpsr);
+
+    event->type = type;
+    event->id = id;
+    event->arg = arg;
+}
+
+// Sends the contents of the ring over the serial port, oldest first, in the
+// format read by tracedec. Everything is little endian:
+//
+//   "TRCE", u16 version, u16 name count, u32 clock Hz, u32 event count,
+//   u32 events lost to wrapping, then for each name: u8 type, u8 id,
+//   u8 length, characters, then for each event: u32 time, u8 type, u8 id,
+//   u16 argument.
+//
+// Recording is paused while sending, and the ring is emptied afterwards.
+// uart_init must have been called.
+void trace_send(void)
+{
+    unsigned long head, first, i; int n, c, len; trace_Event* event;
+
+    trace_paused = TRUE;
+    head = trace_head;
+    first = head > TRACE_LENGTH ? head - TRACE_LENGTH : 0;
+
+    uart_putString(TRACE_MAGIC);
+    trace_sendBytes(TRACE_VERSION, 2);
+    trace_sendBytes(trace_nameCount, 2);
+    trace_sendBytes(PCLK_HZ, 4);
+    trace_sendBytes(head - first, 4);
+    trace_sendBytes(first, 4);
+
+    for (n = 0; n < trace_nameCount; ++n) {
+        len = min((int) strlen(trace_names[n].name), 255);
+        trace_sendBytes(trace_names[n].type, 1);
+        trace_sendBytes(trace_names[n].id, 1);
+        trace_sendBytes(len, 1);
+        for (c = 0; c < len; ++c) uart_putChar(trace_names[n].name[c]);
+    }
+
+    for (i = first; i < head; ++i) {
+        event = &trace_events[i & (TRACE_LENGTH - 1)];
+        trace_sendBytes(event->time, 4);
+        trace_sendBytes(event->type, 1);
+        trace_sendBytes(event->id, 1);
+        trace_sendBytes(event->arg, 2);
+    }
+
+    trace_head = 0;
+    trace_paused = FALSE;
+}
+
+// Sends the lowest count bytes of val, least significant first.
+void trace_sendBytes(unsigned long val, int count)
+{
+    while (count-- > 0) {
+        uart_putChar((char) (val & 0xff));
+        val >>= 8;
+    }
+}
+
+#endif
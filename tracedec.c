@@ -0,0 +1,340 @@
+/**
+ * File Name  : tracedec.c
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Host tool (not for the board) that decodes an event trace
+ *              captured from the serial port, as sent by trace_send in
+ *              trace.h, into Chrome trace event JSON. The result can be
+ *              opened in chrome://tracing or ui.perfetto.dev. Anything
+ *              before the start of the trace in the capture (such as a
+ *              profiler report) is skipped.
+ * Usage      : tracedec capture.bin [trace.json]
+ *              Build with "make tracedec", or any C compiler for the PC.
+ */
+
+//////////////
+// Includes //
+//////////////
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// These must match trace.h.
+#define TRACE_ISR_ENTER 1
+#define TRACE_ISR_EXIT 2
+#define TRACE_TASK_BEGIN 3
+#define TRACE_TASK_END 4
+#define TRACE_BUTTON_DOWN 5
+#define TRACE_BUTTON_UP 6
+#define TRACE_FRAME 7
+#define TRACE_MARK 8
+
+#define TRACE_MAGIC "TRCE"
+#define TRACE_VERSION 1
+
+// Timeline rows, shown as threads of a single process.
+#define ROW_TASKS 1
+#define ROW_INTERRUPTS 2
+#define ROW_INPUT 3
+#define ROW_FRAMES 4
+
+// The most names a trace can carry, which is limited by the u8 type and id.
+#define MAX_NAMES 256
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A name sent with the trace for an event type and ID.
+typedef struct {
+    int type;
+    int id;
+    char name[256];
+} Name;
+
+// A capture being read, and how far through it we are.
+typedef struct {
+    unsigned char* data;
+    long size;
+    long pos;
+} Reader;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+int readBytes(Reader* reader, unsigned long* val, int count);
+long findMagic(Reader* reader);
+
+const char* findName(Name* names, int nameCount, int type, int id);
+const char* buttonName(int bit);
+void putString(FILE* out, const char* str);
+
+int decode(Reader* reader, FILE* out);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Reads a little endian value count bytes long. Returns 0 if the capture
+// ends first.
+int readBytes(Reader* reader, unsigned long* val, int count)
+{
+    int i;
+
+    if (reader->pos + count > reader->size) return 0;
+
+    *val = 0;
+    for (i = 0; i < count; ++i) {
+        *val |= (unsigned long) reader->data[reader->pos++] << (8 * i);
+    }
+
+    return 1;
+}
+
+// Finds the first start of a trace in the capture. Returns its position, or
+// -1 if there is none.
+long findMagic(Reader* reader)
+{
+    long i; size_t len;
+
+    len = strlen(TRACE_MAGIC);
+
+    for (i = 0; i + (long) len <= reader->size; ++i) {
+        if (memcmp(reader->data + i, TRACE_MAGIC, len) == 0) return i;
+    }
+
+    return -1;
+}
+
+// Finds the name given for an event type and ID, or NULL if there is none.
+const char* findName(Name* names, int nameCount, int type, int id)
+{
+    int i;
+
+    for (i = 0; i < nameCount; ++i) {
+        if (names[i].type == type && names[i].id == id) return names[i].name;
+    }
+
+    return NULL;
+}
+
+// Names the buttons by their bit numbers in FIO0PIN, as in input.h.
+const char* buttonName(int bit)
+{
+    switch (bit) {
+        case 10: return "up";
+        case 11: return "down";
+        case 12: return "left";
+        case 13: return "right";
+        case 22: return "centre";
+        default: return "button";
+    }
+}
+
+// Writes a string as a quoted JSON string.
+void putString(FILE* out, const char* str)
+{
+    fputc('"', out);
+
+    for (; *str != '\0'; ++str) {
+        if (*str == '"' || *str == '\\') fputc('\\', out);
+        if ((unsigned char) *str < 0x20) fputc('?', out);
+        else fputc(*str, out);
+    }
+
+    fputc('"', out);
+}
+
+// Decodes the trace starting at the reader's position, writing JSON to out.
+// Returns 0 on success, or 1 if the trace is malformed.
+int decode(Reader* reader, FILE* out)
+{
+    static Name names[MAX_NAMES];
+
+    unsigned long version, nameCount, hz, count, lost, val;
+    unsigned long time, type, id, arg, last, i, n, c, nameType;
+    unsigned long long wide;
+    const char *name, *phase;
+    char fallback[32];
+    int row, first;
+
+    reader->pos += strlen(TRACE_MAGIC);
+
+    if (!readBytes(reader, &version, 2) || !readBytes(reader, &nameCount, 2)
+        || !readBytes(reader, &hz, 4) || !readBytes(reader, &count, 4)
+        || !readBytes(reader, &lost, 4)) {
+        fprintf(stderr, "tracedec: capture ends inside the header\n");
+        return 1;
+    }
+
+    if (version != TRACE_VERSION) {
+        fprintf(stderr, "tracedec: unknown trace version %lu\n", version);
+        return 1;
+    }
+
+    if (hz == 0 || nameCount > MAX_NAMES) {
+        fprintf(stderr, "tracedec: header is corrupt\n");
+        return 1;
+    }
+
+    for (n = 0; n < nameCount; ++n) {
+        if (!readBytes(reader, &type, 1) || !readBytes(reader, &id, 1)
+            || !readBytes(reader, &val, 1)) {
+            fprintf(stderr, "tracedec: capture ends inside the names\n");
+            return 1;
+        }
+
+        names[n].type = (int) type;
+        names[n].id = (int) id;
+        for (c = 0; c < val; ++c) {
+            if (!readBytes(reader, &arg, 1)) return 1;
+            names[n].name[c] = (char) arg;
+        }
+        names[n].name[val] = '\0';
+    }
+
+    fprintf(stderr, "tracedec: %lu events at %lu Hz, %lu lost to wrapping\n",
+        count, hz, lost);
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\","
+        "\"args\":{\"name\":\"LPC2478\"}},\n");
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\","
+        "\"args\":{\"name\":\"tasks\"}},\n", ROW_TASKS);
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\","
+        "\"args\":{\"name\":\"interrupts\"}},\n", ROW_INTERRUPTS);
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\","
+        "\"args\":{\"name\":\"input\"}},\n", ROW_INPUT);
+    fprintf(out, "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\","
+        "\"args\":{\"name\":\"frames\"}}", ROW_FRAMES);
+
+    // Timestamps are a free-running 32 bit count, so unwrap them into a
+    // 64 bit one by assuming events are never a whole wrap apart.
+    wide = 0;
+    last = 0;
+    first = 1;
+
+    for (i = 0; i < count; ++i) {
+        if (!readBytes(reader, &time, 4) || !readBytes(reader, &type, 1)
+            || !readBytes(reader, &id, 1) || !readBytes(reader, &arg, 2)) {
+            fprintf(stderr, "tracedec: capture ends after %lu events\n", i);
+            break;
+        }
+
+        if (!first) wide += (unsigned long) ((time - last) & 0xffffffffUL);
+        first = 0;
+        last = time;
+
+        // The paired types are named by their starting type.
+        nameType = type;
+
+        switch (type) {
+            case TRACE_ISR_ENTER:
+            case TRACE_ISR_EXIT:
+                row = ROW_INTERRUPTS;
+                phase = type == TRACE_ISR_ENTER ? "B" : "E";
+                nameType = TRACE_ISR_ENTER;
+                name = findName(names, (int) nameCount, TRACE_ISR_ENTER, id);
+                break;
+            case TRACE_TASK_BEGIN:
+            case TRACE_TASK_END:
+                row = ROW_TASKS;
+                phase = type == TRACE_TASK_BEGIN ? "B" : "E";
+                nameType = TRACE_TASK_BEGIN;
+                name = findName(names, (int) nameCount, TRACE_TASK_BEGIN, id);
+                break;
+            case TRACE_BUTTON_DOWN:
+            case TRACE_BUTTON_UP:
+                // Buttons can overlap, so they are shown as instants rather
+                // than spans.
+                row = ROW_INPUT;
+                phase = "i";
+                sprintf(fallback, "%s %s", buttonName((int) id),
+                    type == TRACE_BUTTON_DOWN ? "down" : "up");
+                name = fallback;
+                break;
+            case TRACE_FRAME:
+                row = ROW_FRAMES;
+                phase = "i";
+                name = "frame";
+                break;
+            default:
+                row = ROW_FRAMES;
+                phase = "i";
+                name = findName(names, (int) nameCount, TRACE_MARK, id);
+                break;
+        }
+
+        if (name == NULL) {
+            sprintf(fallback, "%lu/%lu", nameType, id);
+            name = fallback;
+        }
+
+        fprintf(out, ",\n{\"ph\":\"%s\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,"
+            "\"name\":", phase, row, (double) wide * 1e6 / hz);
+        putString(out, name);
+        if (phase[0] == 'i') fprintf(out, ",\"s\":\"t\"");
+        fprintf(out, ",\"args\":{\"arg\":%lu}}", arg);
+    }
+
+    fprintf(out, "\n]}\n");
+
+    return 0;
+}
+
+// Entry point. Reads the whole capture into memory, then decodes the first
+// trace in it.
+int main(int argc, char** argv)
+{
+    FILE *in, *out; Reader reader; long start; int result;
+
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "usage: tracedec capture.bin [trace.json]\n");
+        return 2;
+    }
+
+    in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    fseek(in, 0, SEEK_END);
+    reader.size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+
+    reader.data = malloc(reader.size > 0 ? reader.size : 1);
+    reader.pos = 0;
+    if (reader.data == NULL
+        || fread(reader.data, 1, reader.size, in) != (size_t) reader.size) {
+        fprintf(stderr, "tracedec: couldn't read %s\n", argv[1]);
+        return 1;
+    }
+    fclose(in);
+
+    start = findMagic(&reader);
+    if (start < 0) {
+        fprintf(stderr, "tracedec: no trace found in %s\n", argv[1]);
+        return 1;
+    }
+    reader.pos = start;
+
+    out = argc == 3 ? fopen(argv[2], "w") : stdout;
+    if (out == NULL) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    result = decode(&reader, out);
+
+    if (out != stdout) fclose(out);
+    free(reader.data);
+
+    return result;
+}
@@ -0,0 +1,118 @@
+/**
+ * File Name  : trigger.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Tells sound from silence, to start and stop recording on a
+ *              voice. A detector keeps the sum and the sum of squares of the
+ *              latest TRIGGER_WINDOW samples, adding each new sample in and
+ *              the one that drops out of the window back out, so each sample
+ *              costs the same however long the window is. From those it has
+ *              the variance of the window, which is the power of the signal
+ *              with the A/D converter's offset taken away, without ever
+ *              having to know what the offset is.
+ *
+ *              It triggers once the power reaches the start level, and counts
+ *              the samples since it was last at least the stop level, which is
+ *              lower so that a voice trailing off doesn't count as silence.
+ */
+
+#ifndef TRIGGER_H_GUARD
+#define TRIGGER_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The number of samples the power is worked out over, as a power of two. At
+// 44.1 kHz that's about 12 ms, long enough to span a cycle of the lowest
+// voice.
+#define TRIGGER_WINDOW_BITS 9
+#define TRIGGER_WINDOW (1 << TRIGGER_WINDOW_BITS)
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A detector. The levels and power are the variance of the window scaled by
+// TRIGGER_WINDOW squared, which keeps them whole numbers.
+typedef struct {
+    short window[TRIGGER_WINDOW];
+    unsigned long count;
+    long sum;
+    unsigned long squares;
+    unsigned long long startLevel, stopLevel;
+    unsigned long long power;
+    bool triggered;
+    unsigned long quiet;
+} trigger_Detector;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void trigger_init(trigger_Detector* det, int startLevel, int stopLevel);
+static inline void trigger_feed(trigger_Detector* det, short sample);
+int trigger_percent(const trigger_Detector* det);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Empties a detector, to trigger once the RMS level of the signal about its
+// average reaches startLevel, and to count it as quiet while under
+// stopLevel, both in 10 bit sample units.
+void trigger_init(trigger_Detector* det, int startLevel, int stopLevel)
+{
+    det->count = 0;
+    det->sum = 0;
+    det->squares = 0;
+    det->power = 0;
+    det->triggered = FALSE;
+    det->quiet = 0;
+
+    det->startLevel = ((unsigned long long) startLevel * startLevel)
+        << (2 * TRIGGER_WINDOW_BITS);
+    det->stopLevel = ((unsigned long long) stopLevel * stopLevel)
+        << (2 * TRIGGER_WINDOW_BITS);
+}
+
+// Adds a 10 bit sample, working out the power of the latest window. Nothing
+// is triggered until the window has filled. Call from the sample clock
+// interrupt.
+static inline void trigger_feed(trigger_Detector* det, short sample)
+{
+    short* slot; short old;
+
+    slot = &det->window[det->count & (TRIGGER_WINDOW - 1)];
+    old = det->count >= TRIGGER_WINDOW ? *slot : 0;
+    *slot = sample;
+    ++det->count;
+
+    det->sum += sample - old;
+    det->squares += sample * sample - old * old;
+
+    if (det->count < TRIGGER_WINDOW) return;
+
+    // The window's size times its sum of squares, less its sum squared, is
+    // its variance times the size squared.
+    det->power = ((unsigned long long) det->squares << TRIGGER_WINDOW_BITS)
+        - (unsigned long long) ((long long) det->sum * det->sum);
+
+    if (det->power >= det->startLevel) det->triggered = TRUE;
+    det->quiet = det->power >= det->stopLevel ? 0 : det->quiet + 1;
+}
+
+// Gives how close the power is to triggering, as a percentage.
+int trigger_percent(const trigger_Detector* det)
+{
+    if (det->power >= det->startLevel) return 100;
+    return (int) (det->power * 100 / det->startLevel);
+}
+
+#endif
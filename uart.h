@@ -0,0 +1,112 @@
+/**
+ * File Name  : uart.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Polled output over UART 0, which is wired to the board's
+ *              serial port, for sending reports to a terminal on the PC.
+ */
+
+#ifndef UART_H_GUARD
+#define UART_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "reg.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Baud rate to use when nothing else is asked for.
+#define UART_DEFAULT_BAUD 115200
+
+// Value for the word length field giving 8 data bits. With the other line
+// control fields left at zero this gives 8N1.
+#define UART_WORD_8_BITS 3
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void uart_init(int baud);
+void uart_putChar(char c);
+void uart_putString(char* str);
+void uart_putNumber(unsigned long val, int width);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Sets UART 0 up to send 8N1 at the given baud rate. The PCLK divided by 16
+// rarely divides evenly into a standard rate, so the fractional divider is
+// searched for the setting closest to the requested rate.
+void uart_init(int baud)
+{
+    int mul, add, bestMul, bestAdd;
+    unsigned long div, bestDiv; long err, bestErr;
+
+    reg_set(&PCONP, fieldMask(PCONP_PCUART0));
+    reg_modify(&PINSEL0, fieldMask(PINSEL0_P0_2) | fieldMask(PINSEL0_P0_3),
+        fieldVal(PINSEL0_P0_2, PINSEL_TXD0)
+        | fieldVal(PINSEL0_P0_3, PINSEL_RXD0));
+
+    // The rate is PCLK / (16 * div * (1 + add / mul)).
+    bestMul = 1; bestAdd = 0; bestDiv = 1; bestErr = baud;
+    for (mul = 1; mul <= 15; ++mul) {
+        for (add = 0; add < mul; ++add) {
+            div = (unsigned long) PCLK_HZ * mul / (16UL * baud * (mul + add));
+            // The fractional divider needs a divisor of at least 3.
+            if (div == 0 || (add > 0 && div < 3)) continue;
+
+            err = (long) ((unsigned long) PCLK_HZ * mul
+                / (16UL * div * (mul + add))) - baud;
+            err = abs(err);
+
+            if (err < bestErr) {
+                bestErr = err;
+                bestMul = mul; bestAdd = add; bestDiv = div;
+            }
+        }
+    }
+
+    // The divisor latch is only reachable while DLAB is set.
+    U0LCR = fieldVal(U0LCR_DLAB, 1)
+        | fieldVal(U0LCR_WORD_LENGTH, UART_WORD_8_BITS);
+    U0DLL = bestDiv & 0xff;
+    U0DLM = (bestDiv >> 8) & 0xff;
+    U0FDR = fieldVal(U0FDR_DIVADDVAL, bestAdd) | fieldVal(U0FDR_MULVAL, bestMul);
+    U0LCR = fieldVal(U0LCR_WORD_LENGTH, UART_WORD_8_BITS);
+
+    // Enable and reset the FIFOs.
+    U0FCR = 0x07;
+}
+
+// Waits for room in the transmit holding register, then sends one character.
+void uart_putChar(char c)
+{
+    while (!fieldGet(U0LSR, U0LSR_THRE));
+    U0THR = c;
+}
+
+// Sends a string, turning each \n into \r\n for the benefit of terminals.
+void uart_putString(char* str)
+{
+    for (; *str != '\0'; ++str) {
+        if (*str == '\n') uart_putChar('\r');
+        uart_putChar(*str);
+    }
+}
+
+// Sends a number right aligned to the given width, as formatNumber does.
+void uart_putNumber(unsigned long val, int width)
+{
+    char num[12];
+
+    formatNumber(num, val, min(width, 11));
+    uart_putString(num);
+}
+
+#endif
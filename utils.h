@@ -24,9 +24,16 @@
 #define TRUE 1
 #define FALSE 0
 
-// Approximate number of iterations of the delay loop per millisecond.
+// Approximate number of iterations of the delay loop per millisecond, at the
+// clock the board starts up with. clock_init measures it again for CCLK_HZ.
 #define DELAY_MULT 3000
 
+// Frequency of the core clock, as set up by clock_init in clock.h.
+#define CCLK_HZ 72000000
+
+// Frequency of the peripheral clock that drives the timers, PWM and ADC.
+#define PCLK_HZ (CCLK_HZ / 4)
+
 // According to Wikipedia.
 #define PI 3.14159265358979323846264338327950288419716939937511
 #define E 2.71828182845904523536028747135266249775724709369995
@@ -78,34 +85,54 @@
 // I'm homesick for sane languages.
 typedef int bool;
 
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// Number of iterations of the delay loop per millisecond at the current
+// clock speed.
+int delayMult = DELAY_MULT;
+
 ///////////////////////////
 // Function Declarations //
 ///////////////////////////
 
-void srand(int seed);
-int rand(void);
-
-double round(double val);
-double sqrt(double val);
-
-float randFloat(void);
 void wait(int millis);
+void delayLoop(int count) __attribute__((noinline));
+void formatNumber(char* dest, unsigned long val, int width);
 
 //////////////////////////
 // Function Definitions //
 //////////////////////////
 
-// Returns a random single precision number between 0.0 and 1.0.
-float randFloat(void)
+// Blocks execution for approximately the given number of milliseconds.
+void wait(int millis)
 {
-    return (rand() % 65536) / 65536.0f;
+	delayLoop(millis * delayMult);
 }
 
-// Blocks execution for approximately the given number of milliseconds.
-void wait(int millis)
+// Spins for the given number of iterations of the delay loop. Kept out of
+// line so that wait and its calibration always time the same code.
+void delayLoop(int count)
 {
 	volatile int i = 0;
-	for (i = 0; i < millis * DELAY_MULT; ++i);
+	for (i = 0; i < count; ++i);
+}
+
+// Writes the decimal representation of val into dest, right aligned in a
+// field of the given width and null terminated. dest must have room for
+// width + 1 characters. Saves pulling in sprintf for simple readouts.
+void formatNumber(char* dest, unsigned long val, int width)
+{
+    int i;
+
+    dest[width] = '\0';
+
+    // Fill in digits from the right, then pad what's left with spaces.
+    for (i = width - 1; i >= 0; --i) {
+        dest[i] = (i == width - 1 || val != 0) ? '0' + val % 10 : ' ';
+        val /= 10;
+    }
 }
 
 #endif
@@ -0,0 +1,267 @@
+/**
+ * File Name  : vic.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Helpers for registering vectored interrupt handlers with the
+ *              Vectored Interrupt Controller, and for switching interrupts on
+ *              and off.
+ *
+ *              Every handler gets one of the VIC_PRIORITY_* slots below, so
+ *              how urgent each one is can be seen in one place. Handlers made
+ *              with VIC_NESTED run with IRQs enabled, so anything in a more
+ *              urgent slot can interrupt them. The audio sample clocks have
+ *              the most urgent slot and are not nested, so nothing can delay
+ *              them for longer than the longest non-nested handler.
+ */
+
+#ifndef VIC_H_GUARD
+#define VIC_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// The VIC has one vector address and one priority register per channel, laid
+// out as arrays so they may be indexed by channel number.
+#define VIC_VECT_ADDRS ((volatile unsigned long*) 0xFFFFF100)
+#define VIC_VECT_PRIORITIES ((volatile unsigned long*) 0xFFFFF200)
+
+// Channel numbers of the peripherals we are interested in. Nothing but
+// VICSoftInt raises the software channel.
+#define VIC_CHANNEL_SOFTWARE 1
+#define VIC_CHANNEL_TIMER0 4
+#define VIC_CHANNEL_TIMER1 5
+#define VIC_CHANNEL_UART0 6
+#define VIC_CHANNEL_PWM 8
+#define VIC_CHANNEL_TIMER2 26
+#define VIC_CHANNEL_GPIO 17
+#define VIC_CHANNEL_ADC0 18
+
+// Priorities range from 0 (most urgent) to 15 (least urgent).
+#define VIC_PRIORITY_HIGHEST 0
+#define VIC_PRIORITY_LOWEST 15
+
+// The slot each handler uses. An interrupt can only preempt a handler in a
+// less urgent slot, and only if that handler is nested.
+#define VIC_PRIORITY_AUDIO 0  // Sample clocks and A/D rounds, 44.1 kHz.
+#define VIC_PRIORITY_BLOCK 4  // Live effects, once per block of samples.
+#define VIC_PRIORITY_MOTOR 8  // Motor ramp, once per PWM period.
+#define VIC_PRIORITY_TICK 12  // Scheduler tick, 1 kHz.
+#define VIC_PRIORITY_INPUT 14 // Buttons, only to wake from idle.
+
+// The I bit in the CPSR, which masks IRQs when set.
+#define CPSR_IRQ_DISABLE 0x80
+
+// The mode bits in the CPSR, and the two modes that run on sp_usr.
+#define CPSR_MODE_MASK 0x1f
+#define CPSR_MODE_USER 0x10
+#define CPSR_MODE_SYSTEM 0x1f
+
+// The size of the stack VIC_NESTED handlers run on, in bytes. Room for every
+// nested slot to be running at once, each preempting the last.
+#define VIC_NESTED_STACK_SIZE 2048
+
+///////////////////////
+// Macro Definitions //
+///////////////////////
+
+// Defines an interrupt handler called name that runs handler, an ordinary
+// function, with IRQs enabled so more urgent interrupts can preempt it.
+// Declare name with __attribute__((naked)), as the compiler mustn't add any
+// entry or exit code of its own, and install it with vic_install as usual.
+// handler must acknowledge its peripheral but not write VICVectAddr, which is
+// done here once it returns.
+//
+// The IRQ mode registers are saved on the IRQ stack, and handler is run in
+// System mode, so a nested interrupt can't overwrite the return address.
+// System mode runs on sp_usr, which the startup code can't be relied on to
+// set up, as main runs in a privileged mode that doesn't use it. So the
+// first vic_install points sp_usr at vic_nestedStack, before any channel can
+// fire. A program already running on sp_usr (in System mode) is left on
+// it, and its handlers nest on its own stack. The VIC won't raise anything
+// in the same or a less urgent slot until VICVectAddr is written, so handler
+// can't be re-entered.
+#ifdef __arm__
+#define VIC_NESTED(name, handler) \
+    void name(void) \
+    { \
+        __asm__ volatile ( \
+            "sub lr, lr, #4\n\t" \
+            "stmfd sp!, {r0-r3, r12, lr}\n\t" \
+            "mrs r0, spsr\n\t" \
+            "stmfd sp!, {r0}\n\t" \
+            "msr cpsr_c, #0x1f\n\t" /* System mode, IRQs on. */ \
+            "stmfd sp!, {r0, lr}\n\t" \
+            "ldr r0, =" #handler "\n\t" \
+            "mov lr, pc\n\t" \
+            "bx r0\n\t" \
+            "ldmfd sp!, {r0, lr}\n\t" \
+            "msr cpsr_c, #0x92\n\t" /* IRQ mode, IRQs off. */ \
+            "mvn r0, #0xff\n\t" /* &VICVectAddr */ \
+            "str r0, [r0]\n\t" \
+            "ldmfd sp!, {r0}\n\t" \
+            "msr spsr_cxsf, r0\n\t" \
+            "ldmfd sp!, {r0-r3, r12, pc}^\n\t" \
+            ".ltorg\n\t"); \
+    }
+#else
+// The host test programs have no interrupts, so there handler is just called.
+#define VIC_NESTED(name, handler) \
+    void name(void) \
+    { \
+        handler(); \
+    }
+#endif
+
+// Read and write the CPSR, where the I bit lives. The host test programs
+// have no CPSR, so there it always reads as IRQs enabled and writes do
+// nothing.
+#ifdef __arm__
+#define vic_readCpsr(cpsr) __asm__ volatile ("mrs %0, cpsr" : "=r" (cpsr))
+#define vic_writeCpsr(cpsr) __asm__ volatile ("msr cpsr_c, %0" : : "r" (cpsr))
+#else
+#define vic_readCpsr(cpsr) ((cpsr) = 0)
+#define vic_writeCpsr(cpsr) ((void) (cpsr))
+#endif
+
+// Points sp_usr at top, from any privileged mode. IRQs are held off while
+// in System mode, as its stack is only half set up. Nothing to do on the
+// host.
+#ifdef __arm__
+#define vic_setUserStack(top) \
+    __asm__ volatile ( \
+        "mrs r1, cpsr\n\t" \
+        "msr cpsr_c, #0x9f\n\t" /* System mode, IRQs off. */ \
+        "mov sp, %0\n\t" \
+        "msr cpsr_c, r1\n\t" \
+        : : "r" (top) : "r1")
+#else
+#define vic_setUserStack(top) ((void) (top))
+#endif
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// An interrupt service routine, as installed with vic_install. A handler that
+// isn't nested is declared with __attribute__((interrupt("IRQ"))) so the
+// compiler generates the right entry and exit sequence. A nested handler is
+// a plain function passed to VIC_NESTED, and it's the function VIC_NESTED
+// defines that is installed. Marking the plain function as an IRQ handler
+// would break the wrapper's return.
+typedef void (*vic_Handler)(void);
+
+//////////////////////
+// Global Variables //
+//////////////////////
+
+// The stack VIC_NESTED handlers run on, unless the program runs on sp_usr
+// itself, and whether sp_usr has been seen to yet.
+unsigned long vic_nestedStack[VIC_NESTED_STACK_SIZE / 4]
+    __attribute__((aligned(8)));
+bool vic_nestedReady = FALSE;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void vic_initNested(void);
+void vic_install(int channel, int priority, vic_Handler isr);
+void vic_enable(int channel);
+void vic_disable(int channel);
+void vic_enableInterrupts(void);
+unsigned long vic_maskInterrupts(void);
+void vic_restoreInterrupts(unsigned long cpsr);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Makes sure sp_usr points at a stack VIC_NESTED handlers can run on. Only
+// does anything the first time. If the program is running in User or System
+// mode, sp_usr is its own stack and is left alone. Otherwise it points it at
+// vic_nestedStack.
+void vic_initNested(void)
+{
+    unsigned long cpsr, mode;
+
+    if (vic_nestedReady) return;
+    vic_nestedReady = TRUE;
+
+    vic_readCpsr(cpsr);
+    mode = cpsr & CPSR_MODE_MASK;
+    if (mode == CPSR_MODE_USER || mode == CPSR_MODE_SYSTEM) return;
+
+    vic_setUserStack(&vic_nestedStack[VIC_NESTED_STACK_SIZE / 4]);
+}
+
+// Registers the given handler for the specified channel with the given
+// priority, and then enables that channel.
+void vic_install(int channel, int priority, vic_Handler isr)
+{
+    // Any handler might be nested, and could run as soon as its channel is
+    // enabled.
+    vic_initNested();
+
+    // Make sure the channel is quiet while we change its vector.
+    vic_disable(channel);
+
+    VIC_VECT_ADDRS[channel] = (unsigned long) isr;
+    VIC_VECT_PRIORITIES[channel] = priority & bitMask(4);
+
+    // Route the channel to IRQ rather than FIQ.
+    VICIntSelect = clrBit(VICIntSelect, channel);
+
+    vic_enable(channel);
+}
+
+// Allows the specified channel to raise interrupts.
+void vic_enable(int channel)
+{
+    // Writing a 1 to VICIntEnable only sets bits, so there's no need to read
+    // the current value first.
+    VICIntEnable = 1 << channel;
+}
+
+// Stops the specified channel from raising interrupts. Used to guard data
+// shared with that channel's handler.
+void vic_disable(int channel)
+{
+    VICIntEnClr = 1 << channel;
+}
+
+// Clears the I bit in the CPSR so that IRQs reach the core.
+void vic_enableInterrupts(void)
+{
+    unsigned long cpsr;
+
+    vic_readCpsr(cpsr);
+    vic_writeCpsr(cpsr & ~CPSR_IRQ_DISABLE);
+}
+
+// Sets the I bit in the CPSR so that IRQs are held off, and returns the
+// CPSR from before so it can be put back with vic_restoreInterrupts.
+unsigned long vic_maskInterrupts(void)
+{
+    unsigned long cpsr;
+
+    vic_readCpsr(cpsr);
+    vic_writeCpsr(cpsr | CPSR_IRQ_DISABLE);
+
+    return cpsr;
+}
+
+// Puts back the CPSR returned by vic_maskInterrupts. Any interrupt raised in
+// the meantime is taken straight away.
+void vic_restoreInterrupts(unsigned long cpsr)
+{
+    vic_writeCpsr(cpsr);
+}
+
+#endif
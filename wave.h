@@ -0,0 +1,124 @@
+/**
+ * File Name  : wave.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Note frequencies, and a builder for one period of a triangle,
+ *              square or sine wave at a given note, as 10 bit DAC samples.
+ */
+
+#ifndef WAVE_H_GUARD
+#define WAVE_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include "utils.h"
+#include "fixed.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Wave shapes.
+#define WAVE_TRIANGLE 0
+#define WAVE_SQUARE 1
+#define WAVE_SINE 2
+#define WAVE_LAST 2
+
+// Notes within an octave.
+#define NOTE_C 0
+#define NOTE_C_SHARP 1
+#define NOTE_D 2
+#define NOTE_D_SHARP 3
+#define NOTE_E 4
+#define NOTE_F 5
+#define NOTE_F_SHARP 6
+#define NOTE_G 7
+#define NOTE_G_SHARP 8
+#define NOTE_A 9
+#define NOTE_A_SHARP 10
+#define NOTE_B 11
+
+#define OCTAVE_MIN 0
+#define OCTAVE_MAX 7
+
+// A table's length multiplied by the frequency of its note.
+#define WAVE_LENGTH_HZ 266980
+
+// Table length of the lowest note, which is the longest any waveform gets.
+#define WAVE_MAX_LENGTH (WAVE_LENGTH_HZ / (2093 >> (7 - OCTAVE_MIN)))
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+int wave_getLength(int hz);
+int wave_getHertz(int octave, int note);
+int wave_build(short* dest, int type, int octave, int note);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Gives the number of samples in one period of a wave at the given
+// frequency.
+int wave_getLength(int hz)
+{
+    return WAVE_LENGTH_HZ / hz;
+}
+
+// Gives the frequency of the given note, rounded down to a whole hertz.
+int wave_getHertz(int octave, int note)
+{
+    const int notes[12] = {
+        2093, // NOTE_C
+        2217, // NOTE_C_SHARP
+        2349, // NOTE_D
+        2489, // NOTE_D_SHARP
+        2637, // NOTE_E
+        2794, // NOTE_F
+        2960, // NOTE_F_SHARP
+        3136, // NOTE_G
+        3322, // NOTE_G_SHARP
+        3520, // NOTE_A
+        3729, // NOTE_A_SHARP
+        3951  // NOTE_B
+    };
+
+    return notes[note] >> (7 - octave);
+}
+
+// Writes one period of the given wave shape at the given note into dest,
+// which must have room for WAVE_MAX_LENGTH samples. Returns the number of
+// samples written.
+int wave_build(short* dest, int type, int octave, int note)
+{
+    int length, hz, i; fixed t, v;
+
+    v = 0;
+
+    hz = wave_getHertz(octave, note);
+    length = wave_getLength(hz);
+
+    for (i = 0; i < length; ++i) {
+        t = fixed_fromInt(i) / length;
+        switch (type) {
+            case WAVE_SQUARE:
+                v = t < FIXED_HALF ? 0 : FIXED_ONE;
+                break;
+            case WAVE_TRIANGLE:
+                v = t < FIXED_HALF ? t * 2 : FIXED_ONE * 2 - t * 2;
+                break;
+            case WAVE_SINE:
+                v = (fixed_sin(t) >> 1) + FIXED_HALF;
+                break;
+        }
+
+        dest[i] = (short) fixed_toInt(v * 512) & 0x3ff;
+    }
+
+    return length;
+}
+
+#endif
@@ -0,0 +1,561 @@
+/**
+ * File Name  : widget.h
+ * Author     : James King (gvnj58)
+ * Email      : james.king3@durham.ac.uk
+ * Contents   : Retained mode widgets for the displays in the exercises: bar
+ *              gauges (also used as progress bars), a piano keyboard, text
+ *              labels and graphs of recordings. Each widget remembers what it
+ *              last drew, so setting a new value only marks the part that
+ *              changed as damaged, and drawing repaints just that part.
+ *
+ *              Widgets are set up with an init function, changed with a set
+ *              function, and brought up to date on the display with a draw
+ *              function, which does nothing if nothing has changed. Calling
+ *              widget_invalidate* forces a full repaint next time, such as
+ *              after the screen has been cleared. Bars can also be told
+ *              which area something else has drawn over with
+ *              widget_damageBar, and repair only that.
+ */
+
+#ifndef WIDGET_H_GUARD
+#define WIDGET_H_GUARD
+
+//////////////
+// Includes //
+//////////////
+
+#include <lcd_grph.h>
+
+#include "utils.h"
+#include "lcd.h"
+#include "graph.h"
+#include "spectrum.h"
+
+///////////////////////
+// Const Definitions //
+///////////////////////
+
+// Which way a bar fills up as its value increases.
+#define WIDGET_FILL_UP 0
+#define WIDGET_FILL_RIGHT 1
+
+// Stored in place of what was last drawn when the whole widget needs
+// painting.
+#define WIDGET_NOT_DRAWN -1
+
+// Gap between a bar's outline and its fill, when it has one.
+#define WIDGET_BAR_INSET 2
+
+// Size of the keys in a keyboard, which is drawn on its side with the lowest
+// note at the top.
+#define WIDGET_KEY_WHITE_WIDTH 120
+#define WIDGET_KEY_WHITE_HEIGHT 20
+#define WIDGET_KEY_BLACK_WIDTH 80
+#define WIDGET_KEY_BLACK_HEIGHT 10
+
+// The number of keys in a keyboard, which covers one octave.
+#define WIDGET_KEYS 12
+
+// What a graph shows of its samples.
+#define WIDGET_GRAPH_AMPLITUDE 0
+#define WIDGET_GRAPH_SPECTRUM 1
+
+// The longest text a label can show.
+#define WIDGET_LABEL_LENGTH 15
+
+//////////////////////
+// Type Definitions //
+//////////////////////
+
+// A bar gauge, filled in proportion to a value, with an optional outline.
+typedef struct {
+    Rect rect;
+    int direction;
+    bool outline;
+    int colour, background;
+
+    // The length of the filled part in pixels, now and when last drawn, and
+    // the colour it was drawn in.
+    int fill, drawnFill, drawnColour;
+
+    // The stretch along the bar that something else has drawn over, from
+    // the end it fills from, or an empty stretch if nothing has.
+    int damageFrom, damageTo;
+} widget_Bar;
+
+// A keyboard of one octave, with one key highlighted.
+typedef struct {
+    Point pos;
+    int note, drawnNote;
+} widget_Keyboard;
+
+// A line of text centred in a rectangle, in either the normal or the big
+// font.
+typedef struct {
+    Rect rect;
+    bool big;
+    char text[WIDGET_LABEL_LENGTH + 1];
+
+    // What was last drawn and where, or an empty string if nothing has been.
+    char drawn[WIDGET_LABEL_LENGTH + 1];
+    Point drawnPos;
+} widget_Label;
+
+// A graph of a run of samples, either of its amplitude or a spectrogram,
+// drawn a slice at a time. The amplitude graph's first line starts a pixel
+// left of its first column, so the area includes a column for that.
+typedef struct {
+    Rect rect;
+    int view;
+    graph_Draw graph;
+    spectrum_Draw spectrum;
+    bool drawing;
+} widget_Graph;
+
+///////////////////////////
+// Function Declarations //
+///////////////////////////
+
+void widget_fillRect(int x, int y, int w, int h, int colour);
+
+void widget_initBar(widget_Bar* bar, Rect rect, int direction, bool outline,
+    int colour, int background);
+void widget_setBar(widget_Bar* bar, int value, int range);
+void widget_setBarColour(widget_Bar* bar, int colour);
+void widget_invalidateBar(widget_Bar* bar);
+void widget_damageBar(widget_Bar* bar, Rect area);
+void widget_drawBar(widget_Bar* bar);
+int widget_barLength(widget_Bar* bar);
+void widget_paintBar(widget_Bar* bar, int from, int to);
+void widget_paintBarSpan(widget_Bar* bar, int from, int to, int a, int b,
+    int c, int d, int colour);
+
+void widget_initKeyboard(widget_Keyboard* keys, Point pos, int note);
+void widget_setKeyboard(widget_Keyboard* keys, int note);
+void widget_invalidateKeyboard(widget_Keyboard* keys);
+void widget_drawKeyboard(widget_Keyboard* keys);
+bool widget_isBlackKey(int key);
+void widget_drawKey(widget_Keyboard* keys, int key);
+
+void widget_initLabel(widget_Label* label, Rect rect, bool big);
+void widget_setLabel(widget_Label* label, char* text);
+void widget_invalidateLabel(widget_Label* label);
+void widget_drawLabel(widget_Label* label);
+
+void widget_initGraph(widget_Graph* graph, Rect rect);
+void widget_setGraph(widget_Graph* graph, const short* samples,
+    unsigned long total);
+void widget_setGraphPart(widget_Graph* graph, const short* samples,
+    unsigned long total, int column, int width);
+void widget_setGraphView(widget_Graph* graph, int view);
+void widget_clearGraph(widget_Graph* graph);
+bool widget_drawGraph(widget_Graph* graph);
+
+//////////////////////////
+// Function Definitions //
+//////////////////////////
+
+// Fills the given area, given as a position and size rather than two
+// corners. Does nothing if the area is empty.
+void widget_fillRect(int x, int y, int w, int h, int colour)
+{
+    if (w <= 0 || h <= 0) return;
+
+    lcd_fillRect(x, y, x + w - 1, y + h - 1, colour);
+}
+
+// Sets up a bar covering the given area, empty to start with.
+void widget_initBar(widget_Bar* bar, Rect rect, int direction, bool outline,
+    int colour, int background)
+{
+    bar->rect = rect;
+    bar->direction = direction;
+    bar->outline = outline;
+    bar->colour = colour;
+    bar->background = background;
+    bar->fill = 0;
+
+    widget_invalidateBar(bar);
+}
+
+// Fills the bar in proportion to value out of range, which are clamped to
+// fit.
+void widget_setBar(widget_Bar* bar, int value, int range)
+{
+    int length;
+
+    length = widget_barLength(bar)
+        - 2 * (bar->outline ? WIDGET_BAR_INSET : 0);
+
+    value = max(0, min(value, range));
+    bar->fill = range > 0 ? (int) ((long long) value * length / range) : 0;
+}
+
+// Changes the colour of the filled part and the outline, which repaints all
+// of the bar.
+void widget_setBarColour(widget_Bar* bar, int colour)
+{
+    bar->colour = colour;
+}
+
+// Has the whole bar painted next time it is drawn.
+void widget_invalidateBar(widget_Bar* bar)
+{
+    bar->drawnFill = WIDGET_NOT_DRAWN;
+    bar->damageFrom = bar->damageTo = 0;
+}
+
+// Notes that something has been drawn over the given area, so whatever part
+// of the bar it covers is repainted next time the bar is drawn.
+void widget_damageBar(widget_Bar* bar, Rect area)
+{
+    int from, to, length;
+
+    // Ignore anything that misses the bar entirely.
+    if (area.pos.x >= bar->rect.pos.x + bar->rect.size.width
+        || area.pos.x + area.size.width <= bar->rect.pos.x
+        || area.pos.y >= bar->rect.pos.y + bar->rect.size.height
+        || area.pos.y + area.size.height <= bar->rect.pos.y) return;
+
+    // Turn the area into a stretch along the bar, counting from the end it
+    // fills from (the bottom of a bar that fills up).
+    length = widget_barLength(bar);
+    if (bar->direction == WIDGET_FILL_UP) {
+        from = bar->rect.pos.y + length - area.pos.y - area.size.height;
+        to = bar->rect.pos.y + length - area.pos.y;
+    } else {
+        from = area.pos.x - bar->rect.pos.x;
+        to = area.pos.x + area.size.width - bar->rect.pos.x;
+    }
+
+    from = max(from, 0);
+    to = min(to, length);
+
+    if (bar->damageFrom >= bar->damageTo) {
+        bar->damageFrom = from;
+        bar->damageTo = to;
+    } else {
+        bar->damageFrom = min(bar->damageFrom, from);
+        bar->damageTo = max(bar->damageTo, to);
+    }
+}
+
+// Brings the bar up to date. Only the strip between the old and new ends of
+// the fill is painted, along with anything that has been drawn over, unless
+// the colour has changed or the bar hasn't been drawn yet.
+void widget_drawBar(widget_Bar* bar)
+{
+    int inset;
+
+    inset = bar->outline ? WIDGET_BAR_INSET : 0;
+
+    if (bar->drawnFill == WIDGET_NOT_DRAWN
+        || bar->colour != bar->drawnColour) {
+        widget_paintBar(bar, 0, widget_barLength(bar));
+    } else {
+        if (bar->fill != bar->drawnFill) {
+            widget_paintBar(bar, inset + min(bar->fill, bar->drawnFill),
+                inset + max(bar->fill, bar->drawnFill));
+        }
+        if (bar->damageFrom < bar->damageTo) {
+            widget_paintBar(bar, bar->damageFrom, bar->damageTo);
+        }
+    }
+
+    bar->drawnFill = bar->fill;
+    bar->drawnColour = bar->colour;
+    bar->damageFrom = bar->damageTo = 0;
+}
+
+// Finds the length of the bar in pixels, in the direction it fills.
+int widget_barLength(widget_Bar* bar)
+{
+    return bar->direction == WIDGET_FILL_UP
+        ? bar->rect.size.height : bar->rect.size.width;
+}
+
+// Paints the given stretch along the bar, counting in pixels from the end it
+// fills from (the bottom of a bar that fills up), with each pixel painted only
+// once so nothing flickers.
+void widget_paintBar(widget_Bar* bar, int from, int to)
+{
+    int length, width, inset, edge, fillEnd;
+
+    length = widget_barLength(bar);
+    width = bar->direction == WIDGET_FILL_UP
+        ? bar->rect.size.width : bar->rect.size.height;
+    inset = bar->outline ? WIDGET_BAR_INSET : 0;
+    edge = bar->outline ? 1 : 0;
+    fillEnd = inset + bar->fill;
+
+    // The gap inside the outline before the fill starts.
+    widget_paintBarSpan(bar, from, to, edge, inset,
+        0, width, bar->background);
+
+    // The fill, with the gap either side of it.
+    widget_paintBarSpan(bar, from, to, inset, fillEnd,
+        inset, width - inset, bar->colour);
+    widget_paintBarSpan(bar, from, to, inset, fillEnd,
+        edge, inset, bar->background);
+    widget_paintBarSpan(bar, from, to, inset, fillEnd,
+        width - inset, width - edge, bar->background);
+
+    // Everything past the fill, up to the outline.
+    widget_paintBarSpan(bar, from, to, fillEnd, length - edge,
+        edge, width - edge, bar->background);
+
+    if (!bar->outline) return;
+
+    // The ends and sides of the outline.
+    widget_paintBarSpan(bar, from, to, 0, 1, 0, width, bar->colour);
+    widget_paintBarSpan(bar, from, to, length - 1, length,
+        0, width, bar->colour);
+    widget_paintBarSpan(bar, from, to, 1, length - 1, 0, 1, bar->colour);
+    widget_paintBarSpan(bar, from, to, 1, length - 1,
+        width - 1, width, bar->colour);
+}
+
+// Paints the part of the stretch from a to b along the bar that lies between
+// from and to, and from c to d across it, in the given colour.
+void widget_paintBarSpan(widget_Bar* bar, int from, int to, int a, int b,
+    int c, int d, int colour)
+{
+    a = max(a, from);
+    b = min(b, to);
+    if (a >= b || c >= d) return;
+
+    if (bar->direction == WIDGET_FILL_UP) {
+        widget_fillRect(bar->rect.pos.x + c,
+            bar->rect.pos.y + bar->rect.size.height - b, d - c, b - a, colour);
+    } else {
+        widget_fillRect(bar->rect.pos.x + a, bar->rect.pos.y + c,
+            b - a, d - c, colour);
+    }
+}
+
+// Sets up a keyboard with its top left corner at the given position (the
+// black keys stick out above it by half their height), with the given note
+// highlighted.
+void widget_initKeyboard(widget_Keyboard* keys, Point pos, int note)
+{
+    keys->pos = pos;
+    keys->note = note;
+
+    widget_invalidateKeyboard(keys);
+}
+
+// Highlights the given note, from 0 (C) to 11 (B).
+void widget_setKeyboard(widget_Keyboard* keys, int note)
+{
+    keys->note = note;
+}
+
+// Has every key painted next time the keyboard is drawn.
+void widget_invalidateKeyboard(widget_Keyboard* keys)
+{
+    keys->drawnNote = WIDGET_NOT_DRAWN;
+}
+
+// Brings the keyboard up to date. When the highlight moves, only the key it
+// left and the key it moved to are painted.
+void widget_drawKeyboard(widget_Keyboard* keys)
+{
+    int key;
+
+    if (keys->drawnNote == WIDGET_NOT_DRAWN) {
+        // White keys first, so the black ones end up on top.
+        for (key = 0; key < WIDGET_KEYS; ++key) {
+            if (!widget_isBlackKey(key)) widget_drawKey(keys, key);
+        }
+        for (key = 0; key < WIDGET_KEYS; ++key) {
+            if (widget_isBlackKey(key)) widget_drawKey(keys, key);
+        }
+    } else if (keys->note != keys->drawnNote) {
+        widget_drawKey(keys, keys->drawnNote);
+        widget_drawKey(keys, keys->note);
+    }
+
+    keys->drawnNote = keys->note;
+}
+
+// Finds whether the given key of the octave is a black one.
+bool widget_isBlackKey(int key)
+{
+    // One bit per key, starting from C.
+    return getBit(0x54a, key);
+}
+
+// Paints a single key, highlighted if it is the current note. Painting a
+// white key covers half of each black key next to it, so those are painted
+// again too.
+void widget_drawKey(widget_Keyboard* keys, int key)
+{
+    int i, whites, colour;
+
+    // Count the white keys above this one to find where it goes.
+    whites = 0;
+    for (i = 0; i < key; ++i) {
+        if (!widget_isBlackKey(i)) ++whites;
+    }
+
+    if (widget_isBlackKey(key)) {
+        colour = key == keys->note ? RED : BLACK;
+        widget_fillRect(
+            keys->pos.x + WIDGET_KEY_WHITE_WIDTH - WIDGET_KEY_BLACK_WIDTH,
+            keys->pos.y + whites * WIDGET_KEY_WHITE_HEIGHT
+                - (WIDGET_KEY_BLACK_HEIGHT >> 1),
+            WIDGET_KEY_BLACK_WIDTH + 1, WIDGET_KEY_BLACK_HEIGHT + 1, colour);
+        return;
+    }
+
+    // Leave a line above each white key to separate it from the last.
+    colour = key == keys->note ? RED : WHITE;
+    widget_fillRect(keys->pos.x, keys->pos.y + whites * WIDGET_KEY_WHITE_HEIGHT
+        + 1, WIDGET_KEY_WHITE_WIDTH, WIDGET_KEY_WHITE_HEIGHT - 1, colour);
+
+    if (key > 0 && widget_isBlackKey(key - 1)) {
+        widget_drawKey(keys, key - 1);
+    }
+    if (key < WIDGET_KEYS - 1 && widget_isBlackKey(key + 1)) {
+        widget_drawKey(keys, key + 1);
+    }
+}
+
+// Sets up a label centred in the given area, showing nothing to start with.
+void widget_initLabel(widget_Label* label, Rect rect, bool big)
+{
+    label->rect = rect;
+    label->big = big;
+    label->text[0] = '\0';
+
+    widget_invalidateLabel(label);
+}
+
+// Changes the text shown, which is cut short at WIDGET_LABEL_LENGTH
+// characters.
+void widget_setLabel(widget_Label* label, char* text)
+{
+    strncpy(label->text, text, WIDGET_LABEL_LENGTH);
+    label->text[WIDGET_LABEL_LENGTH] = '\0';
+}
+
+// Has the whole label painted next time it is drawn.
+void widget_invalidateLabel(widget_Label* label)
+{
+    label->drawn[0] = '\0';
+}
+
+// Brings the label up to date. If the text is the same length as before it
+// stays where it is, so only the characters that differ are painted.
+// Otherwise the area is cleared and the text centred again.
+void widget_drawLabel(widget_Label* label)
+{
+    int i, width; Size size;
+
+    if (strcmp(label->text, label->drawn) == 0) return;
+
+    width = label->big ? BIG_CHAR_WIDTH : CHAR_WIDTH;
+
+    if (label->drawn[0] == '\0'
+        || strlen(label->text) != strlen(label->drawn)) {
+        widget_fillRect(label->rect.pos.x, label->rect.pos.y,
+            label->rect.size.width, label->rect.size.height, BLACK);
+
+        size = label->big ? lcd_getBigStringSize(label->text)
+            : lcd_getStringSize(label->text);
+        label->drawnPos.x = label->rect.pos.x
+            + ((label->rect.size.width - size.width) >> 1);
+        label->drawnPos.y = label->rect.pos.y
+            + ((label->rect.size.height - size.height) >> 1);
+
+        // Nothing matches, so every character is painted below.
+        memset(label->drawn, 0, sizeof(label->drawn));
+    }
+
+    for (i = 0; label->text[i] != '\0'; ++i) {
+        if (label->text[i] == label->drawn[i]) continue;
+
+        if (label->big) {
+            lcd_putBigChar(label->drawnPos.x + i * width, label->drawnPos.y,
+                label->text[i]);
+        } else {
+            lcd_putChar(label->drawnPos.x + i * width, label->drawnPos.y,
+                label->text[i]);
+        }
+    }
+
+    strcpy(label->drawn, label->text);
+}
+
+// Sets up an empty amplitude graph covering the given area.
+void widget_initGraph(widget_Graph* graph, Rect rect)
+{
+    graph->rect = rect;
+    graph->view = WIDGET_GRAPH_AMPLITUDE;
+    graph->drawing = FALSE;
+}
+
+// Starts graphing the given samples, which must stay put until the graph is
+// finished. The graph is drawn over whatever is there, so clear it first if
+// something else was.
+void widget_setGraph(widget_Graph* graph, const short* samples,
+    unsigned long total)
+{
+    widget_setGraphPart(graph, samples, total, 0,
+        graph->rect.size.width - 2);
+}
+
+// Starts graphing the given samples across width columns of the graph from
+// the given one, so a recording in several pieces can be shown a piece at a
+// time. Each piece is scaled to fit on its own.
+void widget_setGraphPart(widget_Graph* graph, const short* samples,
+    unsigned long total, int column, int width)
+{
+    int x;
+
+    x = graph->rect.pos.x + 1 + column;
+
+    if (graph->view == WIDGET_GRAPH_SPECTRUM) {
+        spectrum_start(&graph->spectrum, samples, total, x,
+            graph->rect.pos.y, width, graph->rect.size.height);
+    } else {
+        graph_start(&graph->graph, samples, total, x,
+            graph->rect.pos.y, width, graph->rect.size.height - 1);
+    }
+    graph->drawing = total > 0 && width > 0;
+}
+
+// Picks what the graph shows, one of the WIDGET_GRAPH_* constants, from the
+// next call to widget_setGraph on.
+void widget_setGraphView(widget_Graph* graph, int view)
+{
+    graph->view = view;
+}
+
+// Abandons any graph being drawn and blanks the area.
+void widget_clearGraph(widget_Graph* graph)
+{
+    graph->drawing = FALSE;
+
+    widget_fillRect(graph->rect.pos.x, graph->rect.pos.y,
+        graph->rect.size.width, graph->rect.size.height, BLACK);
+}
+
+// Draws the next slice of the graph, if it is still being drawn. Returns
+// TRUE if there is more to draw.
+bool widget_drawGraph(widget_Graph* graph)
+{
+    if (!graph->drawing) return FALSE;
+
+    if (graph->view == WIDGET_GRAPH_SPECTRUM) {
+        if (spectrum_step(&graph->spectrum) == PT_ENDED) {
+            graph->drawing = FALSE;
+        }
+    } else if (graph_step(&graph->graph) == PT_ENDED) {
+        graph->drawing = FALSE;
+    }
+
+    return graph->drawing;
+}
+
+#endif